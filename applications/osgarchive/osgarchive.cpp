@@ -12,15 +12,109 @@
 #include <osg/Timer>
 #include <osg/ArgumentParser>
 #include <osg/ApplicationUsage>
+#include <osg/ParallelTask>
 
 #include <osgDB/Archive>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
 #include <osgDB/FileUtils>
+#include <osgDB/FileNameUtils>
+#include <osgDB/Registry>
+#include <osgDB/fstream>
+
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
 
 #include <iostream>
 #include <algorithm>
 
+typedef std::vector<std::string> FileNameList;
+
+bool insertFile(osgDB::Archive* archive, const std::string& filename)
+{
+    osg::ref_ptr<osg::Object> obj = osgDB::readRefObjectFile(filename);
+    if (!obj.valid()) return false;
+
+    osg::Image* image = dynamic_cast<osg::Image*>(obj.get());
+    osg::HeightField* hf = dynamic_cast<osg::HeightField*>(obj.get());
+    osg::Node* node = dynamic_cast<osg::Node*>(obj.get());
+    osg::Shader* shader = dynamic_cast<osg::Shader*>(obj.get());
+    if (image) return archive->writeImage(*image, filename).success();
+    else if (hf) return archive->writeHeightField(*hf, filename).success();
+    else if (node) return archive->writeNode(*node, filename).success();
+    else if (shader) return archive->writeShader(*shader, filename).success();
+    else return archive->writeObject(*obj, filename).success();
+}
+
+// reading files and writing them into the archive, the archive serializes them in parallel
+// and only appends each one under its lock.  The first file is inserted beforehand, so items start from the second.
+class InsertTask : public osg::ParallelTask
+{
+public:
+    InsertTask(osgDB::Archive* archive, const FileNameList& files):
+        osg::ParallelTask(files.empty() ? 0 : static_cast<unsigned int>(files.size())-1),
+        _archive(archive),
+        _files(files) {}
+
+    virtual void process(unsigned int i)
+    {
+        if (!insertFile(_archive, _files[i+1])) ++_numFailed;
+    }
+
+    osgDB::Archive*         _archive;
+    const FileNameList&     _files;
+    OpenThreads::Atomic     _numFailed;
+};
+
+// reads of files from the archive, shared between the threads so they all finish together.
+class ReadTask : public osg::ParallelTask
+{
+public:
+    ReadTask(osgDB::Archive* archive, const osgDB::Archive::FileNameList& fileNames, unsigned int numReads):
+        osg::ParallelTask(numReads),
+        _archive(archive),
+        _fileNames(fileNames) {}
+
+    virtual void process(unsigned int i)
+    {
+        osgDB::ReaderWriter::ReadResult result = _archive->readObject(_fileNames[i%_fileNames.size()]);
+        if (!result.validObject()) ++_numFailed;
+    }
+
+    osgDB::Archive*                         _archive;
+    const osgDB::Archive::FileNameList&     _fileNames;
+    OpenThreads::Atomic                     _numFailed;
+};
+
+void benchmarkReads(const std::string& name, osgDB::Archive* archive, unsigned int numThreads, unsigned int numIterations)
+{
+    if (!archive)
+    {
+        std::cout<<name<<" : unable to open archive"<<std::endl;
+        return;
+    }
+
+    osgDB::Archive::FileNameList fileNames;
+    if (!archive->getFileNames(fileNames))
+    {
+        std::cout<<name<<" : archive is empty"<<std::endl;
+        return;
+    }
+
+    unsigned int numReads = static_cast<unsigned int>(fileNames.size())*numIterations;
+    osg::ref_ptr<ReadTask> task = new ReadTask(archive, fileNames, numReads);
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    osg::ParallelTaskThreadPool::instance()->run(task.get(), numThreads);
+
+    double duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    std::cout<<name<<std::endl;
+    std::cout<<"    throughput       : "<<(duration>0.0 ? double(numReads)/duration : 0.0)<<" reads/s, "<<numReads<<" reads by "<<numThreads<<" threads"<<std::endl;
+    if (task->_numFailed>0) std::cout<<"    failed           : "<<task->_numFailed<<" reads"<<std::endl;
+}
+
 
 int main( int argc, char **argv )
 {
@@ -31,6 +125,15 @@ int main( int argc, char **argv )
     arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
     arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" is an application for collecting a set of separate files into a single archive file that can be later read in OSG applications..");
     arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] filename ...");
+    arguments.getApplicationUsage()->addCommandLineOption("-a <filename> or --archive <filename>","Archive to operate on.");
+    arguments.getApplicationUsage()->addCommandLineOption("-i or --insert","Insert the listed files and directories into the archive.");
+    arguments.getApplicationUsage()->addCommandLineOption("-e or --extract","Extract the listed files from the archive.");
+    arguments.getApplicationUsage()->addCommandLineOption("-l or --list","List the files in the archive.");
+    arguments.getApplicationUsage()->addCommandLineOption("--bulk","Insert the files from several threads into a new archive with a hashed index, for building archives holding many files.");
+    arguments.getApplicationUsage()->addCommandLineOption("--append","Allow --bulk to add files to an existing archive rather than refusing to open it.");
+    arguments.getApplicationUsage()->addCommandLineOption("--benchmark","Measure the throughput of reading every file in the archive from several threads, memory mapped, through a pool of file streams and through a single shared stream.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Number of threads used by --bulk and --benchmark, default one per processor.");
+    arguments.getApplicationUsage()->addCommandLineOption("--iterations <num>","Number of times --benchmark reads each file, default 4.");
 
     // if user request help write it out to cout.
     if (arguments.read("-h") || arguments.read("--help"))
@@ -62,7 +165,32 @@ int main( int argc, char **argv )
         list = true;
     }
 
-    typedef std::vector<std::string> FileNameList;
+    bool bulk = false;
+    while (arguments.read("--bulk"))
+    {
+        bulk = true;
+        insert = true;
+    }
+
+    bool append = false;
+    while (arguments.read("--append"))
+    {
+        append = true;
+    }
+
+    bool benchmark = false;
+    while (arguments.read("--benchmark"))
+    {
+        benchmark = true;
+    }
+
+    unsigned int numThreads = OpenThreads::GetNumberOfProcessors();
+    while (arguments.read("--threads",numThreads)) {}
+    if (numThreads<1) numThreads = 1;
+
+    unsigned int numIterations = 4;
+    while (arguments.read("--iterations",numIterations)) {}
+
     FileNameList files;
     for(int pos=1;pos<arguments.argc();++pos)
     {
@@ -110,9 +238,9 @@ int main( int argc, char **argv )
         return 1;
     }
 
-    if (!insert && !extract && !list)
+    if (!insert && !extract && !list && !benchmark)
     {
-        std::cout<<"Please specify an operation on the archive, either --insert, --extract or --list"<<std::endl;
+        std::cout<<"Please specify an operation on the archive, either --insert, --extract, --list or --benchmark"<<std::endl;
         return 1;
     }
 
@@ -122,9 +250,42 @@ int main( int argc, char **argv )
         return 1;
     }
 
+    if (bulk && !append && osgDB::fileExists(archiveFilename))
+    {
+        std::cout<<"Archive "<<archiveFilename<<" already exists, use --append to add the files to it with --bulk."<<std::endl;
+        return 1;
+    }
+
     osg::ref_ptr<osgDB::Archive> archive;
 
-    if (insert)
+    if (bulk)
+    {
+        // new archives get the hashed index, which is written once when the archive is closed.
+        osg::ref_ptr<osgDB::Options> options = new osgDB::Options("HashedIndex");
+        options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+        archive = osgDB::openArchive(archiveFilename, osgDB::Archive::WRITE, 4096, options.get());
+
+        if (archive.valid() && !files.empty())
+        {
+            osg::Timer_t start = osg::Timer::instance()->tick();
+
+            // the first file is written before the others so that it is recorded as the master file.
+            osg::ref_ptr<InsertTask> task = new InsertTask(archive.get(), files);
+            if (!insertFile(archive.get(), files.front())) ++(task->_numFailed);
+
+            osg::ParallelTaskThreadPool::instance()->run(task.get(), numThreads);
+
+            archive->close();
+
+            unsigned int numFailed = task->_numFailed;
+            std::cout<<"Inserted "<<files.size()-numFailed<<" files in "<<osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick())<<"s using "<<numThreads<<" threads"<<std::endl;
+            if (numFailed>0) std::cout<<"Unable to insert "<<numFailed<<" files"<<std::endl;
+
+            // reopen the finished archive for --list and --benchmark.
+            archive = osgDB::openArchive(archiveFilename, osgDB::Archive::READ, 4096, options.get());
+        }
+    }
+    else if (insert)
     {
         archive = osgDB::openArchive(archiveFilename, osgDB::Archive::WRITE);
 
@@ -174,6 +335,32 @@ int main( int argc, char **argv )
         }
     }
 
+    if (benchmark && archive.valid())
+    {
+        // open separate instances, bypassing the archive cache, so each read path is measured on its own.
+        osg::ref_ptr<osgDB::Options> mappedOptions = new osgDB::Options;
+        mappedOptions->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+        osg::ref_ptr<osgDB::Archive> mappedArchive = osgDB::openArchive(archiveFilename, osgDB::Archive::READ, 4096, mappedOptions.get());
+        benchmarkReads("Memory mapped", mappedArchive.get(), numThreads, numIterations);
+        mappedArchive = 0;
+
+        osg::ref_ptr<osgDB::Options> streamOptions = new osgDB::Options("NoMemoryMapping");
+        streamOptions->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+        osg::ref_ptr<osgDB::Archive> streamArchive = osgDB::openArchive(archiveFilename, osgDB::Archive::READ, 4096, streamOptions.get());
+        benchmarkReads("File stream pool", streamArchive.get(), numThreads, numIterations);
+        streamArchive = 0;
+
+        // an archive opened from a stream has to serialize all reads through it, as every read did previously.
+        osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension(osgDB::getLowerCaseFileExtension(archiveFilename));
+        osgDB::ifstream fin(archiveFilename.c_str(), std::ios_base::binary | std::ios_base::in);
+        if (rw && fin)
+        {
+            osgDB::ReaderWriter::ReadResult result = rw->openArchive(fin, streamOptions.get());
+            osg::ref_ptr<osgDB::Archive> sharedArchive = result.getArchive();
+            benchmarkReads("Single shared stream", sharedArchive.get(), numThreads, numIterations);
+        }
+    }
+
     if (list && archive.valid())
     {
         std::cout<<"List of files in archive:"<<std::endl;
@@ -435,6 +435,8 @@ static void usage( const char *prog, const char *msg )
     // print tool options
     osg::notify(osg::NOTICE)<<"options:"<< std::endl;
     osg::notify(osg::NOTICE)<<"    -O option          - ReaderWriter option"<< std::endl;
+    osg::notify(osg::NOTICE)<<"                         e.g. -O Compressor=lz4 to compress .osgb files with"<< std::endl;
+    osg::notify(osg::NOTICE)<<"                         blocks that are decompressed in parallel."<< std::endl;
     osg::notify(osg::NOTICE)<< std::endl;
     osg::notify(osg::NOTICE)<<"    --compressed       - Enable the usage of compressed textures,"<< std::endl;
     osg::notify(osg::NOTICE)<<"                         defaults to OpenGL ARB compressed textures."<< std::endl;
@@ -516,6 +518,11 @@ static void usage( const char *prog, const char *msg )
                               "                         that don't have their own color values\n"
                               "                         (--addMissingColours also accepted)."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --overallNormal    - Replace normals with a single overall normal."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --optimizer-stats  - Report the time taken and the change in scene graph\n"
+                              "                         counts for each optimizer pass, and the draw call\n"
+                              "                         and culling trade off of MERGE_GEOMETRY."<< std::endl;
+    osg::notify(osg::NOTICE)<<"    --optimizer-threads n - Number of threads used by the per geometry\n"
+                              "                         optimizer passes, 0 for one per processor."<< std::endl;
     osg::notify(osg::NOTICE)<<"    --enable-object-cache - Enable caching of objects, images, etc."<< std::endl;
 
     osg::notify( osg::NOTICE ) << std::endl;
@@ -747,6 +754,12 @@ int main( int argc, char **argv )
     bool enableObjectCache = false;
     while(arguments.read("--enable-object-cache")) { enableObjectCache = true; }
 
+    bool optimizerStats = false;
+    while(arguments.read("--optimizer-stats")) { optimizerStats = true; }
+
+    int optimizerThreads = -1;
+    while(arguments.read("--optimizer-threads", optimizerThreads)) {}
+
     // any option left unread are converted into errors to write out later.
     arguments.reportRemainingOptionsAsUnrecognized();
 
@@ -818,7 +831,21 @@ int main( int argc, char **argv )
 
         // optimize the scene graph, remove redundant nodes and state etc.
         osgUtil::Optimizer optimizer;
+        if (optimizerThreads>=0) optimizer.setNumThreads(optimizerThreads);
+        if (optimizerStats) optimizer.setStats(new osgUtil::Optimizer::Stats);
         optimizer.optimize(root.get());
+        if (optimizerStats)
+        {
+            optimizer.getStats()->print(std::cout);
+
+            const osgUtil::Optimizer::MergeStats& mergeStats = optimizer.getMergeStats();
+            if (mergeStats._numGeometriesBefore>0)
+            {
+                std::cout<<"  MERGE_GEOMETRY merged "<<mergeStats._numGeometriesBefore<<" geometries into "<<mergeStats._numGeometriesAfter
+                         <<", draw call reduction "<<mergeStats.getDrawCallReduction()
+                         <<", cull efficiency "<<mergeStats.getCullEfficiency()<<std::endl;
+            }
+        }
 
         if( do_convert )
             root = oc.convert( root.get() );
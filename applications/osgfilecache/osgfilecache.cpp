@@ -415,6 +415,9 @@ int main( int argc, char **argv )
     arguments.getApplicationUsage()->addCommandLineOption("-e level minX minY maxX maxY","Read down to <level> across the extents minX, minY to maxY, maxY.  Note, for geocentric datase X and Y are longitude and latitude respectively.");
     arguments.getApplicationUsage()->addCommandLineOption("-c directory","Shorthand for --file-cache directory.");
     arguments.getApplicationUsage()->addCommandLineOption("--file-cache directory","Set directory as to place cache download files.");
+    arguments.getApplicationUsage()->addCommandLineOption("--write-behind","Write files to the cache from a background thread.");
+    arguments.getApplicationUsage()->addCommandLineOption("--checksums","Write a checksum alongside each cached file and check it before the file is read.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-size MB","Limit the size of the cache, removing the least recently used files.");
 
     // if user request help write it out to cout.
     if (arguments.read("-h") || arguments.read("--help"))
@@ -443,7 +446,16 @@ int main( int argc, char **argv )
         return 1;
     }
 
-    ldv.setFileCache(new osgDB::FileCache(fileCachePath));
+    osg::ref_ptr<osgDB::FileCache> fileCache = new osgDB::FileCache(fileCachePath);
+
+    if (arguments.read("--write-behind")) fileCache->setWriteBehind(true);
+    if (arguments.read("--checksums")) fileCache->setUseChecksums(true);
+
+    double maxSize = 0.0;
+    while(arguments.read("--max-size", maxSize)) {}
+    if (maxSize>0.0) fileCache->setMaximumCacheSize(static_cast<unsigned long long>(maxSize*1024.0*1024.0));
+
+    ldv.setFileCache(fileCache.get());
 
     unsigned int maxLevels = 0;
     while(arguments.read("-l",maxLevels))
@@ -484,6 +496,13 @@ int main( int argc, char **argv )
 
     loadedModel->accept(ldv);
 
+    osg::Timer_t startFlush = osg::Timer::instance()->tick();
+    fileCache->flush();
+    if (fileCache->getWriteBehind())
+    {
+        std::cout<<"Waited "<<osg::Timer::instance()->delta_s(startFlush, osg::Timer::instance()->tick())<<"s for pending writes to the file cache"<<std::endl;
+    }
+
     if (s_ExitApplication)
     {
         std::cout<<"osgfilecache exited in response to signal : "<<s_SigValue<<std::endl;
@@ -0,0 +1,211 @@
+/* OpenSceneGraph example, osgbinaryloadbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+#include <osgDB/WriteFile>
+#include <osgDB/FileUtils>
+#include <osgDB/fstream>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "../osgkdtreebenchmark/SyntheticMesh.h"
+
+// Benchmark comparing loading .osgb files through the memory mapped path with the std::ifstream path
+// (the NoMemoryMapping option): load time and the peak resident memory while loading. The resident memory of
+// the memory mapped path includes the pages of the file while it is mapped, these are shared with the OS file
+// cache rather than allocated, so the heap used by the two paths is the difference from the file size.
+
+#if defined(__linux__)
+// reset the peak resident set size, supported since Linux 4.0.
+void resetPeakMemory()
+{
+#if defined(__GLIBC__)
+    // return memory freed by earlier steps to the OS so it isn't counted in the baseline.
+    malloc_trim(0);
+#endif
+    osgDB::ofstream fout("/proc/self/clear_refs");
+    if (fout) fout<<"5";
+}
+
+// the peak resident set size in MB since the last reset, from VmHWM.
+double getPeakMemory()
+{
+    osgDB::ifstream fin("/proc/self/status");
+    std::string line;
+    while(std::getline(fin, line))
+    {
+        if (line.compare(0, 6, "VmHWM:")==0)
+        {
+            std::istringstream iss(line.substr(6));
+            double kb = 0.0;
+            iss>>kb;
+            return kb/1024.0;
+        }
+    }
+    return 0.0;
+}
+
+double getCurrentMemory()
+{
+    osgDB::ifstream fin("/proc/self/status");
+    std::string line;
+    while(std::getline(fin, line))
+    {
+        if (line.compare(0, 6, "VmRSS:")==0)
+        {
+            std::istringstream iss(line.substr(6));
+            double kb = 0.0;
+            iss>>kb;
+            return kb/1024.0;
+        }
+    }
+    return 0.0;
+}
+#else
+void resetPeakMemory() {}
+double getPeakMemory() { return 0.0; }
+double getCurrentMemory() { return 0.0; }
+#endif
+
+typedef std::vector<std::string> FileNames;
+
+void runConfiguration(const std::string& name, const FileNames& fileNames, const std::string& optionString, unsigned int numIterations)
+{
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionString);
+    options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+    resetPeakMemory();
+    double baseMemory = getCurrentMemory();
+
+    unsigned int numLoaded = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    for(unsigned int i=0; i<numIterations; ++i)
+    {
+        for(FileNames::const_iterator itr = fileNames.begin();
+            itr != fileNames.end();
+            ++itr)
+        {
+            osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(*itr, options.get());
+            if (node.valid()) ++numLoaded;
+        }
+    }
+
+    double duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    std::cout<<name<<std::endl;
+    std::cout<<"    load time        : "<<(numLoaded>0 ? duration*1000.0/double(numLoaded) : 0.0)<<"ms per file, "<<numLoaded<<" files loaded"<<std::endl;
+    std::cout<<"    peak memory      : "<<getPeakMemory()-baseMemory<<"MB above the "<<baseMemory<<"MB resident before loading"<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" compares the load time and peak memory of reading .osgb files memory mapped and through a std::ifstream.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename.osgb ...]");
+    arguments.getApplicationUsage()->addCommandLineOption("--grid <columns> <rows>", "Size of each synthetic tile when no files are specified, default 512 512.");
+    arguments.getApplicationUsage()->addCommandLineOption("--tiles <num>", "Number of synthetic tiles written out, default 8.");
+    arguments.getApplicationUsage()->addCommandLineOption("--compressor <name>", "Compressor used when writing the synthetic tiles, default none.");
+    arguments.getApplicationUsage()->addCommandLineOption("--align", "Write the synthetic tiles with AlignArrays, so that their array data is aligned in the file.");
+    arguments.getApplicationUsage()->addCommandLineOption("--iterations <num>", "Number of times each file is loaded, default 4.");
+    arguments.getApplicationUsage()->addCommandLineOption("--mode <mode>", "mapped, stream or both, default both. Run one mode per process for the most reliable memory figures.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numColumns = 512, numRows = 512, numTiles = 8;
+    unsigned int numIterations = 4;
+    std::string compressor;
+    bool alignArrays = false;
+    std::string mode("both");
+
+    while(arguments.read("--grid", numColumns, numRows)) {}
+    while(arguments.read("--tiles", numTiles)) {}
+    while(arguments.read("--compressor", compressor)) {}
+    while(arguments.read("--align")) { alignArrays = true; }
+    while(arguments.read("--iterations", numIterations)) {}
+    while(arguments.read("--mode", mode)) {}
+
+    FileNames fileNames;
+    for(int pos=1; pos<arguments.argc(); ++pos)
+    {
+        if (!arguments.isOption(pos)) fileNames.push_back(arguments[pos]);
+    }
+
+    FileNames temporaryFiles;
+    if (fileNames.empty())
+    {
+        std::cout<<"Writing "<<numTiles<<" synthetic tiles of "<<numColumns*numRows*2<<" triangles."<<std::endl;
+
+        std::string writeOptionString;
+        if (!compressor.empty()) writeOptionString += std::string("Compressor=")+compressor+" ";
+        if (alignArrays) writeOptionString += "AlignArrays";
+
+        osg::ref_ptr<osgDB::Options> writeOptions = new osgDB::Options(writeOptionString);
+        for(unsigned int t=0; t<numTiles; ++t)
+        {
+            std::ostringstream fileName;
+            fileName<<"osgbinaryloadbenchmark_tile_"<<t<<".osgb";
+
+            osg::ref_ptr<osg::Geode> tile = new osg::Geode;
+            tile->addDrawable(createSyntheticMeshTile(numColumns, numRows, float(t), true, true));
+            if (osgDB::writeNodeFile(*tile, fileName.str(), writeOptions.get()))
+            {
+                temporaryFiles.push_back(fileName.str());
+            }
+        }
+        fileNames = temporaryFiles;
+    }
+
+    if (fileNames.empty())
+    {
+        std::cout<<"No files to load."<<std::endl;
+        return 1;
+    }
+
+    if (mode=="both" || mode=="mapped") runConfiguration("Memory mapped", fileNames, std::string(), numIterations);
+    if (mode=="both" || mode=="stream") runConfiguration("std::ifstream", fileNames, std::string("NoMemoryMapping"), numIterations);
+
+    for(FileNames::iterator itr = temporaryFiles.begin();
+        itr != temporaryFiles.end();
+        ++itr)
+    {
+        remove(itr->c_str());
+    }
+
+    return 0;
+}
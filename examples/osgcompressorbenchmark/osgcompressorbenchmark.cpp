@@ -0,0 +1,155 @@
+/* OpenSceneGraph example, osgcompressorbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+#include <osgDB/ObjectWrapper>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../osgkdtreebenchmark/SyntheticMesh.h"
+
+// Benchmark comparing the compressors available to the .osgb writer, Compressor=<name>: compression and
+// decompression throughput and compression ratio of the serialized scene graph.
+
+// the serialized scene graph, as the .osgb writer hands it to the compressor.
+bool serializeScene(osg::Node& node, std::string& data)
+{
+    osgDB::ReaderWriter* rw = osgDB::Registry::instance()->getReaderWriterForExtension("osgb");
+    if (!rw) return false;
+
+    std::ostringstream oss(std::ios::out | std::ios::binary);
+    if (!rw->writeNode(node, oss).success()) return false;
+
+    data = oss.str();
+    return true;
+}
+
+void runConfiguration(const std::string& name, const std::string& data, unsigned int numIterations, unsigned int numThreads)
+{
+    osgDB::BaseCompressor* compressor = osgDB::Registry::instance()->getObjectWrapperManager()->findCompressor(name);
+    if (!compressor)
+    {
+        std::cout<<name<<" : not available"<<std::endl;
+        return;
+    }
+
+    osgDB::BlockCompressor* blockCompressor = dynamic_cast<osgDB::BlockCompressor*>(compressor);
+    if (blockCompressor) blockCompressor->setNumThreads(numThreads);
+
+    std::string compressed;
+    double compressTime = 0.0;
+    for(unsigned int i=0; i<numIterations; ++i)
+    {
+        std::ostringstream oss(std::ios::out | std::ios::binary);
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        compressor->compress(oss, data);
+        compressTime += osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+        compressed = oss.str();
+    }
+
+    bool matches = true;
+    double decompressTime = 0.0;
+    for(unsigned int i=0; i<numIterations; ++i)
+    {
+        std::istringstream iss(compressed, std::ios::in | std::ios::binary);
+        std::string decompressed;
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        compressor->decompress(iss, decompressed);
+        decompressTime += osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+        if (decompressed!=data) matches = false;
+    }
+
+    double megabytes = double(data.size())*double(numIterations)/(1024.0*1024.0);
+
+    std::cout<<name<<(blockCompressor ? " (block compressed)" : "")<<std::endl;
+    std::cout<<"    ratio            : "<<(compressed.empty() ? 0.0 : double(data.size())/double(compressed.size()))<<", "<<compressed.size()<<" bytes"<<std::endl;
+    std::cout<<"    compress         : "<<(compressTime>0.0 ? megabytes/compressTime : 0.0)<<" MB/s"<<std::endl;
+    std::cout<<"    decompress       : "<<(decompressTime>0.0 ? megabytes/decompressTime : 0.0)<<" MB/s"<<(matches ? "" : ", DATA MISMATCH")<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" compares the throughput and compression ratio of the .osgb compressors.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename ...]");
+    arguments.getApplicationUsage()->addCommandLineOption("--grid <columns> <rows>", "Size of the synthetic mesh when no model is specified, default 1000 1000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--compressor <name>", "Compressor to test, may be repeated, default zlib, zlibblocks and lz4.");
+    arguments.getApplicationUsage()->addCommandLineOption("--iterations <num>", "Number of times the data is compressed and decompressed, default 4.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>", "Number of threads used by the block compressors, default one per processor.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numColumns = 1000, numRows = 1000;
+    unsigned int numIterations = 4;
+    unsigned int numThreads = 0;
+    std::vector<std::string> compressors;
+    std::string compressor;
+
+    while(arguments.read("--grid", numColumns, numRows)) {}
+    while(arguments.read("--compressor", compressor)) { compressors.push_back(compressor); }
+    while(arguments.read("--iterations", numIterations)) {}
+    while(arguments.read("--threads", numThreads)) {}
+
+    if (compressors.empty())
+    {
+        compressors.push_back("zlib");
+        compressors.push_back("zlibblocks");
+        compressors.push_back("lz4");
+    }
+
+    osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
+    if (!scene)
+    {
+        std::cout<<"Creating a synthetic mesh of "<<numColumns*numRows*2<<" triangles."<<std::endl;
+        scene = createSyntheticMesh(numColumns, numRows, 1, true, false);
+    }
+
+    std::string data;
+    if (!serializeScene(*scene, data))
+    {
+        std::cout<<"Unable to serialize the scene, is the osg plugin available?"<<std::endl;
+        return 1;
+    }
+
+    std::cout<<"Serialized scene is "<<data.size()<<" bytes."<<std::endl;
+
+    for(std::vector<std::string>::iterator itr = compressors.begin();
+        itr != compressors.end();
+        ++itr)
+    {
+        runConfiguration(*itr, data, numIterations, numThreads);
+    }
+
+    return 0;
+}
@@ -0,0 +1,251 @@
+/* OpenSceneGraph example, osgcullbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/BoundingVolumeBatch>
+#include <osg/CullingSet>
+#include <osg/Geode>
+#include <osg/MatrixTransform>
+#include <osg/ShapeDrawable>
+#include <osg/Timer>
+
+#include <osgUtil/CullVisitor>
+#include <osgUtil/SceneView>
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+// Benchmark comparing view frustum culling of bounding volumes one at a time, CullingSet::isCulled(const BoundingSphere&),
+// with the batched CullingSet::isCulled(const BoundingSphereBatch&,...) the CullVisitor uses for the children of groups,
+// first on arrays of bounds and then culling a scene graph of many transformed children.
+
+float randomValue(float minValue, float maxValue)
+{
+    return minValue + (maxValue-minValue)*float(rand())/float(RAND_MAX);
+}
+
+// a camera looking down the -z axis into a cube of bounds, so roughly a third of the bounds are in view.
+osg::CullingSet createCullingSet()
+{
+    osg::Matrixd projection = osg::Matrixd::perspective(60.0, 1.5, 1.0, 1000.0);
+    osg::Matrixd view = osg::Matrixd::lookAt(osg::Vec3d(0.0, 0.0, 500.0), osg::Vec3d(0.0, 0.0, 0.0), osg::Vec3d(0.0, 1.0, 0.0));
+
+    osg::Polytope frustum;
+    frustum.setToUnitFrustum(true, true);
+    frustum.transformProvidingInverse(view*projection);
+
+    osg::CullingSet cullingSet;
+    cullingSet.setFrustum(frustum);
+    cullingSet.setCullingMask(osg::CullingSet::VIEW_FRUSTUM_CULLING);
+    cullingSet.pushCurrentMask();
+    return cullingSet;
+}
+
+template<class BV, class Batch>
+void runBoundsConfiguration(const std::string& name, const std::vector<BV>& bounds, unsigned int blockSize, unsigned int numIterations)
+{
+    osg::CullingSet cullingSet = createCullingSet();
+
+    // one at a time, as the CullVisitor visits each child.
+    unsigned int numCulled = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for(unsigned int it=0; it<numIterations; ++it)
+    {
+        for(typename std::vector<BV>::const_iterator itr = bounds.begin();
+            itr != bounds.end();
+            ++itr)
+        {
+            if (cullingSet.isCulled(*itr)) ++numCulled;
+        }
+    }
+    double singleTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    // the bounds already held in structure of arrays form.
+    Batch batch;
+    batch.reserve(bounds.size());
+    for(typename std::vector<BV>::const_iterator itr = bounds.begin();
+        itr != bounds.end();
+        ++itr)
+    {
+        batch.push_back(*itr);
+    }
+
+    bool* culled = new bool[bounds.size()];
+    osg::Polytope::ClippingMask* masks = new osg::Polytope::ClippingMask[bounds.size()];
+
+    unsigned int numBatchedCulled = 0;
+    start = osg::Timer::instance()->tick();
+    for(unsigned int it=0; it<numIterations; ++it)
+    {
+        cullingSet.isCulled(batch, culled, masks);
+        for(unsigned int i=0; i<bounds.size(); ++i)
+        {
+            if (culled[i]) ++numBatchedCulled;
+        }
+    }
+    double batchedTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    // gathered from the individual bounds a block at a time, as the CullVisitor gathers the bounds of a group's children.
+    Batch block;
+    block.reserve(blockSize);
+    unsigned int numBlockCulled = 0;
+    start = osg::Timer::instance()->tick();
+    for(unsigned int it=0; it<numIterations; ++it)
+    {
+        for(unsigned int i=0; i<bounds.size(); i+=blockSize)
+        {
+            unsigned int end = osg::minimum(i+blockSize, static_cast<unsigned int>(bounds.size()));
+            block.clear();
+            for(unsigned int j=i; j<end; ++j) block.push_back(bounds[j]);
+
+            cullingSet.isCulled(block, culled, masks);
+            for(unsigned int j=0; j<end-i; ++j)
+            {
+                if (culled[j]) ++numBlockCulled;
+            }
+        }
+    }
+    double blockTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    delete [] culled;
+    delete [] masks;
+
+    double numTests = double(bounds.size())*double(numIterations);
+    std::cout<<name<<", "<<numCulled/numIterations<<" of "<<bounds.size()<<" culled"<<std::endl;
+    std::cout<<"    one at a time    : "<<singleTime*1e9/numTests<<"ns per bound"<<std::endl;
+    std::cout<<"    batched          : "<<batchedTime*1e9/numTests<<"ns per bound, speed up "<<(batchedTime>0.0 ? singleTime/batchedTime : 0.0)
+             <<(numBatchedCulled==numCulled ? "" : ", RESULTS DIFFER")<<std::endl;
+    std::cout<<"    gathered blocks  : "<<blockTime*1e9/numTests<<"ns per bound, speed up "<<(blockTime>0.0 ? singleTime/blockTime : 0.0)
+             <<(numBlockCulled==numCulled ? "" : ", RESULTS DIFFER")<<std::endl;
+}
+
+// groups of transformed boxes scattered through the same cube as the bounds.
+osg::Node* createScene(unsigned int numChildren, unsigned int numChildrenPerGroup)
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(new osg::ShapeDrawable(new osg::Box(osg::Vec3(), 1.0f)));
+
+    osg::ref_ptr<osg::Group> root = new osg::Group;
+    osg::Group* group = 0;
+    for(unsigned int i=0; i<numChildren; ++i)
+    {
+        if (!group || group->getNumChildren()>=numChildrenPerGroup)
+        {
+            group = new osg::Group;
+            root->addChild(group);
+        }
+
+        osg::MatrixTransform* transform = new osg::MatrixTransform(osg::Matrix::translate(randomValue(-500.0f, 500.0f), randomValue(-500.0f, 500.0f), randomValue(-500.0f, 500.0f)));
+        transform->addChild(geode.get());
+        group->addChild(transform);
+    }
+    return root.release();
+}
+
+void runSceneConfiguration(const std::string& name, osg::Node* scene, unsigned int minNumChildrenForBatchedCulling, unsigned int numIterations)
+{
+    osg::ref_ptr<osgUtil::SceneView> sceneView = new osgUtil::SceneView;
+    sceneView->setDefaults();
+    sceneView->setComputeNearFarMode(osg::CullSettings::DO_NOT_COMPUTE_NEAR_FAR);
+    sceneView->setCullingMode(osg::CullSettings::VIEW_FRUSTUM_CULLING);
+    sceneView->setSceneData(scene);
+    sceneView->setViewport(0, 0, 1280, 1024);
+    sceneView->setProjectionMatrixAsPerspective(60.0, 1.25, 1.0, 1000.0);
+    sceneView->setViewMatrixAsLookAt(osg::Vec3d(0.0, 0.0, 500.0), osg::Vec3d(0.0, 0.0, 0.0), osg::Vec3d(0.0, 1.0, 0.0));
+    sceneView->getCullVisitor()->setMinNumChildrenForBatchedCulling(minNumChildrenForBatchedCulling);
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    sceneView->setFrameStamp(frameStamp.get());
+
+    // first cull to compute the bounds and fill the reused RenderLeaf and StateGraph lists.
+    sceneView->cull();
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    for(unsigned int i=0; i<numIterations; ++i)
+    {
+        frameStamp->setFrameNumber(i+1);
+        sceneView->cull();
+    }
+    double duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    std::cout<<name<<std::endl;
+    std::cout<<"    cull time        : "<<duration*1000.0/double(numIterations)<<"ms per frame"<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" compares view frustum culling bounding volumes one at a time and in batches.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--bounds <num>", "Number of bounding spheres and boxes culled, default 1000000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--block <num>", "Number of bounds gathered into each batch, default 64.");
+    arguments.getApplicationUsage()->addCommandLineOption("--children <num>", "Number of transformed children in the scene graph culled, default 100000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--children-per-group <num>", "Number of children of each group in the scene graph, default 100.");
+    arguments.getApplicationUsage()->addCommandLineOption("--iterations <num>", "Number of times the bounds and the scene are culled, default 10.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numBounds = 1000000;
+    unsigned int blockSize = 64;
+    unsigned int numChildren = 100000;
+    unsigned int numChildrenPerGroup = 100;
+    unsigned int numIterations = 10;
+
+    while(arguments.read("--bounds", numBounds)) {}
+    while(arguments.read("--block", blockSize)) {}
+    while(arguments.read("--children", numChildren)) {}
+    while(arguments.read("--children-per-group", numChildrenPerGroup)) {}
+    while(arguments.read("--iterations", numIterations)) {}
+
+    if (numIterations==0) numIterations = 1;
+    if (blockSize==0) blockSize = 1;
+
+    srand(1);
+
+    std::vector<osg::BoundingSphere> spheres;
+    std::vector<osg::BoundingBox> boxes;
+    spheres.reserve(numBounds);
+    boxes.reserve(numBounds);
+    for(unsigned int i=0; i<numBounds; ++i)
+    {
+        osg::Vec3 center(randomValue(-500.0f, 500.0f), randomValue(-500.0f, 500.0f), randomValue(-500.0f, 500.0f));
+        float radius = randomValue(0.5f, 5.0f);
+        spheres.push_back(osg::BoundingSphere(center, radius));
+        boxes.push_back(osg::BoundingBox(center-osg::Vec3(radius, radius, radius), center+osg::Vec3(radius, radius, radius)));
+    }
+
+    runBoundsConfiguration<osg::BoundingSphere, osg::BoundingSphereBatch>("Bounding spheres", spheres, blockSize, numIterations);
+    runBoundsConfiguration<osg::BoundingBox, osg::BoundingBoxBatch>("Bounding boxes", boxes, blockSize, numIterations);
+
+    if (numChildren>0)
+    {
+        osg::ref_ptr<osg::Node> scene = createScene(numChildren, numChildrenPerGroup);
+        runSceneConfiguration("CullVisitor, children culled one at a time", scene.get(), 0, numIterations);
+        runSceneConfiguration("CullVisitor, children culled in batches", scene.get(), 4, numIterations);
+    }
+
+    return 0;
+}
@@ -0,0 +1,269 @@
+/* OpenSceneGraph example, osgintersectionbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/MatrixTransform>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+#include <osgUtil/PolytopeIntersector>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+#include <math.h>
+
+// Benchmark measuring how IntersectionVisitor's parallel traversal scales from 1 to N threads, using a polytope
+// selection box and a batch of line segments over a generated city of many independently transformed buildings.
+
+// a unit box with each face subdivided into a grid of quads, so each building has a realistic number of triangles.
+osg::Geometry* createBuilding(unsigned int numSubdivisions)
+{
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::DrawElementsUInt> quads = new osg::DrawElementsUInt(GL_QUADS);
+
+    const osg::Vec3 corners[6][3] =
+    {
+        { osg::Vec3(0.0f,0.0f,0.0f), osg::Vec3(1.0f,0.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f) },
+        { osg::Vec3(1.0f,0.0f,0.0f), osg::Vec3(0.0f,1.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f) },
+        { osg::Vec3(1.0f,1.0f,0.0f), osg::Vec3(-1.0f,0.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f) },
+        { osg::Vec3(0.0f,1.0f,0.0f), osg::Vec3(0.0f,-1.0f,0.0f), osg::Vec3(0.0f,0.0f,1.0f) },
+        { osg::Vec3(0.0f,0.0f,1.0f), osg::Vec3(1.0f,0.0f,0.0f), osg::Vec3(0.0f,1.0f,0.0f) },
+        { osg::Vec3(0.0f,1.0f,0.0f), osg::Vec3(1.0f,0.0f,0.0f), osg::Vec3(0.0f,-1.0f,0.0f) }
+    };
+
+    for(unsigned int f=0; f<6; ++f)
+    {
+        unsigned int base = vertices->size();
+        for(unsigned int r=0; r<=numSubdivisions; ++r)
+        {
+            for(unsigned int c=0; c<=numSubdivisions; ++c)
+            {
+                vertices->push_back(corners[f][0] + corners[f][1]*(float(c)/float(numSubdivisions)) + corners[f][2]*(float(r)/float(numSubdivisions)));
+            }
+        }
+
+        for(unsigned int r=0; r<numSubdivisions; ++r)
+        {
+            for(unsigned int c=0; c<numSubdivisions; ++c)
+            {
+                unsigned int i = base + r*(numSubdivisions+1) + c;
+                quads->push_back(i);
+                quads->push_back(i+1);
+                quads->push_back(i+numSubdivisions+2);
+                quads->push_back(i+numSubdivisions+1);
+            }
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(quads.get());
+    return geometry.release();
+}
+
+// a city of blocks of buildings, each building having its own transform and geometry.
+osg::Node* createCity(unsigned int numBlocks, unsigned int numBuildingsPerBlock, unsigned int numSubdivisions)
+{
+    osg::ref_ptr<osg::Group> city = new osg::Group;
+
+    unsigned int seed = 1;
+    for(unsigned int by=0; by<numBlocks; ++by)
+    {
+        for(unsigned int bx=0; bx<numBlocks; ++bx)
+        {
+            osg::ref_ptr<osg::Group> block = new osg::Group;
+            for(unsigned int y=0; y<numBuildingsPerBlock; ++y)
+            {
+                for(unsigned int x=0; x<numBuildingsPerBlock; ++x)
+                {
+                    seed = seed*1103515245u + 12345u;
+                    float height = 2.0f + 20.0f*float((seed>>8)&0xffff)/65535.0f;
+
+                    osg::Vec3 position(float(bx*(numBuildingsPerBlock+1)+x)*2.0f, float(by*(numBuildingsPerBlock+1)+y)*2.0f, 0.0f);
+
+                    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+                    geode->addDrawable(createBuilding(numSubdivisions));
+
+                    osg::ref_ptr<osg::MatrixTransform> transform = new osg::MatrixTransform(osg::Matrix::scale(1.5f, 1.5f, height)*osg::Matrix::translate(position));
+                    transform->addChild(geode.get());
+                    block->addChild(transform.get());
+                }
+            }
+            city->addChild(block.get());
+        }
+    }
+
+    return city.release();
+}
+
+struct QueryResult
+{
+    QueryResult(): _duration(0.0), _numHits(0) {}
+
+    double              _duration;
+    unsigned long long  _numHits;
+};
+
+// select everything within the middle of the city, as a rubber band selection box looking down on it would.
+QueryResult runPolytopeQuery(osg::Node* scene, unsigned int numThreads, unsigned int numQueries)
+{
+    osg::BoundingBox bb;
+    bb.expandBy(scene->getBound());
+
+    osg::Vec3 size = bb._max-bb._min;
+    osg::Vec3 minimum = bb._min + size*0.4f;
+    osg::Vec3 maximum = bb._max - size*0.4f;
+
+    QueryResult result;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    for(unsigned int i=0; i<numQueries; ++i)
+    {
+        osg::ref_ptr<osgUtil::PolytopeIntersector> intersector = new osgUtil::PolytopeIntersector(osgUtil::Intersector::MODEL, minimum.x(), minimum.y(), maximum.x(), maximum.y());
+
+        osgUtil::IntersectionVisitor iv(intersector.get());
+        iv.setNumThreads(numThreads);
+        scene->accept(iv);
+
+        result._numHits += intersector->getIntersections().size();
+    }
+
+    result._duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    return result;
+}
+
+// a batch of line of sight style segments spread across the city, traversed together in one IntersectorGroup.
+QueryResult runLineSegmentQuery(osg::Node* scene, unsigned int numThreads, unsigned int numSegments)
+{
+    osg::BoundingBox bb;
+    bb.expandBy(scene->getBound());
+
+    osg::ref_ptr<osgUtil::IntersectorGroup> group = new osgUtil::IntersectorGroup;
+
+    unsigned int seed = 1;
+    for(unsigned int i=0; i<numSegments; ++i)
+    {
+        seed = seed*1103515245u + 12345u;
+        double x0 = double((seed>>8)&0xffff)/65535.0;
+        seed = seed*1103515245u + 12345u;
+        double y0 = double((seed>>8)&0xffff)/65535.0;
+        seed = seed*1103515245u + 12345u;
+        double x1 = double((seed>>8)&0xffff)/65535.0;
+        seed = seed*1103515245u + 12345u;
+        double y1 = double((seed>>8)&0xffff)/65535.0;
+
+        osg::Vec3d s(bb.xMin()+x0*(bb.xMax()-bb.xMin()), bb.yMin()+y0*(bb.yMax()-bb.yMin()), 10.0);
+        osg::Vec3d e(bb.xMin()+x1*(bb.xMax()-bb.xMin()), bb.yMin()+y1*(bb.yMax()-bb.yMin()), 1.0);
+        group->addIntersector(new osgUtil::LineSegmentIntersector(s, e));
+    }
+
+    QueryResult result;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    osgUtil::IntersectionVisitor iv(group.get());
+    iv.setNumThreads(numThreads);
+    scene->accept(iv);
+
+    result._duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    osgUtil::IntersectorGroup::Intersectors& intersectors = group->getIntersectors();
+    for(osgUtil::IntersectorGroup::Intersectors::iterator itr = intersectors.begin();
+        itr != intersectors.end();
+        ++itr)
+    {
+        result._numHits += static_cast<osgUtil::LineSegmentIntersector*>(itr->get())->getIntersections().size();
+    }
+
+    return result;
+}
+
+void reportResult(const std::string& name, unsigned int numThreads, const QueryResult& result, const QueryResult& serial)
+{
+    std::cout<<"    "<<name<<" "<<numThreads<<" thread"<<(numThreads>1 ? "s" : " ")<<" : "<<result._duration*1000.0<<"ms, speed up "
+             <<(result._duration>0.0 ? serial._duration/result._duration : 0.0)<<", "<<result._numHits<<" intersections";
+    if (result._numHits!=serial._numHits) std::cout<<" MISMATCH, serial traversal found "<<serial._numHits;
+    std::cout<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" measures how IntersectionVisitor's parallel traversal scales with the number of threads.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename ...]");
+    arguments.getApplicationUsage()->addCommandLineOption("--blocks <num>", "Number of blocks along each side of the generated city, default 8.");
+    arguments.getApplicationUsage()->addCommandLineOption("--buildings <num>", "Number of buildings along each side of a block, default 16.");
+    arguments.getApplicationUsage()->addCommandLineOption("--subdivisions <num>", "Number of quads along each side of a building face, default 8.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>", "Maximum number of threads to scale up to, default one per processor.");
+    arguments.getApplicationUsage()->addCommandLineOption("--queries <num>", "Number of polytope queries timed for each thread count, default 10.");
+    arguments.getApplicationUsage()->addCommandLineOption("--segments <num>", "Number of line segments in the batched line segment query, default 1000.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numBlocks = 8, numBuildingsPerBlock = 16, numSubdivisions = 8;
+    unsigned int maxNumThreads = OpenThreads::GetNumberOfProcessors()>0 ? OpenThreads::GetNumberOfProcessors() : 1;
+    unsigned int numQueries = 10;
+    unsigned int numSegments = 1000;
+
+    while(arguments.read("--blocks", numBlocks)) {}
+    while(arguments.read("--buildings", numBuildingsPerBlock)) {}
+    while(arguments.read("--subdivisions", numSubdivisions)) {}
+    while(arguments.read("--threads", maxNumThreads)) {}
+    while(arguments.read("--queries", numQueries)) {}
+    while(arguments.read("--segments", numSegments)) {}
+
+    osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
+    if (!scene)
+    {
+        unsigned int numBuildings = numBlocks*numBlocks*numBuildingsPerBlock*numBuildingsPerBlock;
+        std::cout<<"Creating city of "<<numBuildings<<" buildings, "<<numBuildings*numSubdivisions*numSubdivisions*12<<" triangles."<<std::endl;
+        scene = createCity(numBlocks, numBuildingsPerBlock, numSubdivisions);
+    }
+
+    // warm up, so that lazily computed bounds aren't included in the serial timings.
+    runPolytopeQuery(scene.get(), 1, 1);
+
+    QueryResult serialPolytope = runPolytopeQuery(scene.get(), 1, numQueries);
+    QueryResult serialSegments = runLineSegmentQuery(scene.get(), 1, numSegments);
+
+    std::cout<<"Polytope selection box, "<<numQueries<<" queries"<<std::endl;
+    for(unsigned int numThreads=1; numThreads<=maxNumThreads; ++numThreads)
+    {
+        reportResult("PolytopeIntersector", numThreads, numThreads==1 ? serialPolytope : runPolytopeQuery(scene.get(), numThreads, numQueries), serialPolytope);
+    }
+
+    std::cout<<"Batch of "<<numSegments<<" line segments"<<std::endl;
+    for(unsigned int numThreads=1; numThreads<=maxNumThreads; ++numThreads)
+    {
+        reportResult("LineSegmentIntersector", numThreads, numThreads==1 ? serialSegments : runLineSegmentQuery(scene.get(), numThreads, numSegments), serialSegments);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+/* OpenSceneGraph example, osgkdtreebenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#ifndef SYNTHETICMESH_H
+#define SYNTHETICMESH_H
+
+#include <osg/Geode>
+#include <osg/Geometry>
+
+#include <math.h>
+
+// Synthetic test data shared by the benchmark examples: a bumpy terrain like grid of triangles, similar in character to
+// photogrammetry meshes and to the big Vec3Array/DrawElementsUInt payloads paged databases are made of.
+
+// create a tile of numColumns by numRows quads, each split into two triangles, covering x0 to x0+1 by 0 to 1.
+inline osg::Geometry* createSyntheticMeshTile(unsigned int numColumns, unsigned int numRows, float x0, bool addNormals, bool addTexCoords)
+{
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array;
+    osg::ref_ptr<osg::Vec3Array> normals = addNormals ? new osg::Vec3Array : 0;
+    osg::ref_ptr<osg::Vec2Array> texcoords = addTexCoords ? new osg::Vec2Array : 0;
+
+    vertices->reserve((numColumns+1)*(numRows+1));
+    if (normals.valid()) normals->reserve((numColumns+1)*(numRows+1));
+    if (texcoords.valid()) texcoords->reserve((numColumns+1)*(numRows+1));
+
+    for(unsigned int r=0; r<=numRows; ++r)
+    {
+        for(unsigned int c=0; c<=numColumns; ++c)
+        {
+            float x = x0 + float(c)/float(numColumns);
+            float y = float(r)/float(numRows);
+            float z = 0.05f*sinf(x*37.0f)*cosf(y*23.0f) + 0.02f*sinf(x*131.0f+y*97.0f);
+            vertices->push_back(osg::Vec3(x, y, z));
+            if (normals.valid()) normals->push_back(osg::Vec3(0.0f, 0.0f, 1.0f));
+            if (texcoords.valid()) texcoords->push_back(osg::Vec2(x-x0, y));
+        }
+    }
+
+    osg::ref_ptr<osg::DrawElementsUInt> triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+    triangles->reserve(numColumns*numRows*6);
+    for(unsigned int r=0; r<numRows; ++r)
+    {
+        for(unsigned int c=0; c<numColumns; ++c)
+        {
+            unsigned int i = r*(numColumns+1)+c;
+            triangles->push_back(i);
+            triangles->push_back(i+1);
+            triangles->push_back(i+numColumns+2);
+            triangles->push_back(i);
+            triangles->push_back(i+numColumns+2);
+            triangles->push_back(i+numColumns+1);
+        }
+    }
+
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    if (normals.valid()) geometry->setNormalArray(normals.get(), osg::Array::BIND_PER_VERTEX);
+    if (texcoords.valid()) geometry->setTexCoordArray(0, texcoords.get(), osg::Array::BIND_PER_VERTEX);
+    geometry->addPrimitiveSet(triangles.get());
+    return geometry.release();
+}
+
+// create numTiles tiles side by side along the x axis, each a separate Geometry.
+inline osg::Geode* createSyntheticMesh(unsigned int numColumns, unsigned int numRows, unsigned int numTiles, bool addNormals, bool addTexCoords)
+{
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    for(unsigned int t=0; t<numTiles; ++t)
+    {
+        geode->addDrawable(createSyntheticMeshTile(numColumns, numRows, float(t), addNormals, addTexCoords));
+    }
+    return geode.release();
+}
+
+#endif
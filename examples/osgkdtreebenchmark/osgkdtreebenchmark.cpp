@@ -0,0 +1,216 @@
+/* OpenSceneGraph example, osgkdtreebenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/KdTree>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+
+#include <osgUtil/IntersectionVisitor>
+#include <osgUtil/LineSegmentIntersector>
+
+#include <OpenThreads/Thread>
+
+#include <iostream>
+
+#include "SyntheticMesh.h"
+
+// Benchmark comparing the KdTree build methods on the kind of workloads osgkdtree is used for: build time, memory
+// use and the rate at which line segments can be intersected with the resulting trees.
+
+class RemoveKdTreesVisitor : public osg::NodeVisitor
+{
+public:
+
+    RemoveKdTreesVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN) {}
+
+    void apply(osg::Geometry& geometry)
+    {
+        if (dynamic_cast<osg::KdTree*>(geometry.getShape())) geometry.setShape(0);
+    }
+};
+
+class KdTreeStatsVisitor : public osg::NodeVisitor
+{
+public:
+
+    KdTreeStatsVisitor():
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _numKdTrees(0),
+        _numNodes(0),
+        _numBytes(0) {}
+
+    void apply(osg::Geometry& geometry)
+    {
+        osg::KdTree* kdTree = dynamic_cast<osg::KdTree*>(geometry.getShape());
+        if (!kdTree) return;
+
+        ++_numKdTrees;
+        _numNodes += kdTree->getNodes().size();
+        _numBytes += kdTree->getNodes().capacity()*sizeof(osg::KdTree::KdNode) +
+                     kdTree->getPrimitiveIndices().capacity()*sizeof(unsigned int) +
+                     kdTree->getVertexIndices().capacity()*sizeof(unsigned int);
+    }
+
+    unsigned int        _numKdTrees;
+    unsigned int        _numNodes;
+    unsigned long long  _numBytes;
+};
+
+struct RandomNumbers
+{
+    RandomNumbers(): _seed(1) {}
+
+    // values between 0.0 and 1.0, repeatable so that every configuration fires the same rays.
+    double operator() ()
+    {
+        _seed = _seed*1103515245u + 12345u;
+        return double((_seed>>8)&0xffffff)/double(0xffffff);
+    }
+
+    unsigned int _seed;
+};
+
+struct RayQueryResult
+{
+    RayQueryResult(): _duration(0.0), _numHits(0) {}
+
+    double          _duration;
+    unsigned int    _numHits;
+};
+
+RayQueryResult runRayQueries(osg::Node* scene, unsigned int numRays)
+{
+    const osg::BoundingSphere& bs = scene->getBound();
+    osg::BoundingBox bb;
+    bb.expandBy(bs);
+
+    RandomNumbers random;
+    RayQueryResult result;
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    for(unsigned int i=0; i<numRays; ++i)
+    {
+        osg::Vec3d s(bb.xMin()+random()*(bb.xMax()-bb.xMin()), bb.yMin()+random()*(bb.yMax()-bb.yMin()), bb.zMax());
+        osg::Vec3d e(bb.xMin()+random()*(bb.xMax()-bb.xMin()), bb.yMin()+random()*(bb.yMax()-bb.yMin()), bb.zMin());
+
+        osg::ref_ptr<osgUtil::LineSegmentIntersector> intersector = new osgUtil::LineSegmentIntersector(s, e);
+        intersector->setIntersectionLimit(osgUtil::Intersector::LIMIT_NEAREST);
+
+        osgUtil::IntersectionVisitor iv(intersector.get());
+        iv.setUseKdTreeWhenAvailable(true);
+        scene->accept(iv);
+
+        if (intersector->containsIntersections()) ++result._numHits;
+    }
+
+    result._duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    return result;
+}
+
+void runConfiguration(const std::string& name, osg::Node* scene, const osg::KdTree::BuildOptions& options, unsigned int numRays)
+{
+    RemoveKdTreesVisitor rkv;
+    scene->accept(rkv);
+
+    osg::ref_ptr<osg::KdTreeBuilder> builder = new osg::KdTreeBuilder;
+    builder->_buildOptions = options;
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+    scene->accept(*builder);
+    double buildTime = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    KdTreeStatsVisitor ksv;
+    scene->accept(ksv);
+
+    RayQueryResult rays = runRayQueries(scene, numRays);
+
+    std::cout<<name<<std::endl;
+    std::cout<<"    build time       : "<<buildTime*1000.0<<"ms for "<<ksv._numKdTrees<<" KdTrees"<<std::endl;
+    std::cout<<"    memory           : "<<double(ksv._numBytes)/(1024.0*1024.0)<<"MB in "<<ksv._numNodes<<" nodes of "<<sizeof(osg::KdTree::KdNode)<<" bytes"<<std::endl;
+    std::cout<<"    ray queries      : "<<(rays._duration>0.0 ? double(numRays)/rays._duration : 0.0)<<" rays/sec, "<<rays._numHits<<" of "<<numRays<<" hit"<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" compares the build time, memory use and ray query rate of the KdTree build methods.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename ...]");
+    arguments.getApplicationUsage()->addCommandLineOption("--grid <columns> <rows>", "Size of each synthetic mesh tile when no model is specified, default 1000 1000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--tiles <num>", "Number of synthetic mesh tiles, default 4.");
+    arguments.getApplicationUsage()->addCommandLineOption("--rays <num>", "Number of line segments intersected with each tree, default 100000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--leaf <num>", "Target number of primitives per leaf, default 4.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max <num>", "Maximum number of levels in the tree, default 32.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>", "Number of threads used by the multi-threaded builds, default one per processor.");
+    arguments.getApplicationUsage()->addCommandLineOption("--bins <num>", "Number of bins used to evaluate the surface area heuristic, default 16.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numColumns = 1000, numRows = 1000, numTiles = 4;
+    unsigned int numRays = 100000;
+    unsigned int numThreads = OpenThreads::GetNumberOfProcessors()>0 ? OpenThreads::GetNumberOfProcessors() : 1;
+
+    osg::KdTree::BuildOptions options;
+
+    while(arguments.read("--grid", numColumns, numRows)) {}
+    while(arguments.read("--tiles", numTiles)) {}
+    while(arguments.read("--rays", numRays)) {}
+    while(arguments.read("--leaf", options._targetNumTrianglesPerLeaf)) {}
+    while(arguments.read("--max", options._maxNumLevels)) {}
+    while(arguments.read("--threads", numThreads)) {}
+    while(arguments.read("--bins", options._numSAHBins)) {}
+
+    osg::ref_ptr<osg::Node> scene = osgDB::readRefNodeFiles(arguments);
+    if (!scene)
+    {
+        std::cout<<"Creating "<<numTiles<<" synthetic mesh tiles of "<<numColumns*numRows*2<<" triangles."<<std::endl;
+        scene = createSyntheticMesh(numColumns, numRows, numTiles, false, false);
+    }
+
+    osg::KdTree::BuildOptions midpoint(options);
+    midpoint._splitMethod = osg::KdTree::BuildOptions::SPLIT_AT_MIDPOINT;
+    midpoint._numThreads = 1;
+    runConfiguration("Midpoint split, 1 thread", scene.get(), midpoint, numRays);
+
+    osg::KdTree::BuildOptions midpointThreaded(midpoint);
+    midpointThreaded._numThreads = numThreads;
+    runConfiguration("Midpoint split, threaded across geometries", scene.get(), midpointThreaded, numRays);
+
+    osg::KdTree::BuildOptions sah(options);
+    sah._splitMethod = osg::KdTree::BuildOptions::SPLIT_BY_SAH;
+    sah._numThreads = 1;
+    runConfiguration("SAH split, 1 thread", scene.get(), sah, numRays);
+
+    osg::KdTree::BuildOptions sahThreaded(sah);
+    sahThreaded._numThreads = numThreads;
+    runConfiguration("SAH split, threaded", scene.get(), sahThreaded, numRays);
+
+    return 0;
+}
@@ -17,10 +17,23 @@
 */
 
 #include <osg/Group>
+#include <osg/Geode>
+#include <osg/Geometry>
+#include <osg/Timer>
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
 #include <osgDB/ReadFile>
+#include <osgDB/Registry>
 
 #include <osgViewer/Viewer>
 
+#include <OpenThreads/Thread>
+#include <OpenThreads/Atomic>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
 #include <assert.h>
 
 osg::Group* createObjectCache()
@@ -84,10 +97,164 @@ osg::Group* createObjectCache()
     return group;
 }
 
-int main(int , char **)
+// a small geometry of numVertices vertices, standing in for a loaded model.
+osg::Node* createObject(unsigned int numVertices)
 {
+    osg::ref_ptr<osg::Vec3Array> vertices = new osg::Vec3Array(numVertices);
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    geometry->setVertexArray(vertices.get());
+    geometry->addPrimitiveSet(new osg::DrawArrays(GL_POINTS, 0, numVertices));
+
+    osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+    geode->addDrawable(geometry.get());
+    return geode.release();
+}
+
+struct BenchmarkSettings
+{
+    BenchmarkSettings():
+        numFiles(10000),
+        numOperations(200000),
+        numVertices(256),
+        hotFraction(0.1) {}
+
+    unsigned int numFiles;
+    unsigned int numOperations;
+    unsigned int numVertices;
+    double hotFraction;
+};
+
+// looks up files in the ObjectCache, adding them when missed as a reader would. 90% of the lookups go to a hot
+// set of hotFraction of the files so that the LRU policy has something to keep.
+class LookupThread : public OpenThreads::Thread
+{
+public:
+
+    LookupThread(osgDB::ObjectCache* objectCache, const BenchmarkSettings& settings, OpenThreads::Atomic& next, unsigned int seed):
+        _objectCache(objectCache),
+        _settings(settings),
+        _next(next),
+        _seed(seed) {}
+
+    virtual void run()
+    {
+        unsigned int numHot = osg::maximum(1u, static_cast<unsigned int>(double(_settings.numFiles)*_settings.hotFraction));
+
+        for(unsigned int i=(++_next)-1; i<_settings.numOperations; i=(++_next)-1)
+        {
+            unsigned int r = random();
+            unsigned int fileIndex = (r%10)!=0 ? (random()%numHot) : (random()%_settings.numFiles);
+
+            std::ostringstream fileName;
+            fileName<<"file_"<<fileIndex<<".osgb";
+
+            osg::ref_ptr<osg::Object> object = _objectCache->getRefFromObjectCache(fileName.str());
+            if (!object)
+            {
+                object = createObject(_settings.numVertices);
+                _objectCache->addEntryToObjectCache(fileName.str(), object.get());
+            }
+        }
+    }
+
+protected:
+
+    // a thread local linear congruential generator, rand() isn't thread safe.
+    unsigned int random()
+    {
+        _seed = _seed*1664525u + 1013904223u;
+        return _seed>>8;
+    }
+
+    osgDB::ObjectCache*         _objectCache;
+    const BenchmarkSettings&    _settings;
+    OpenThreads::Atomic&        _next;
+    unsigned int                _seed;
+};
+
+void runBenchmark(const BenchmarkSettings& settings, unsigned int numThreads, unsigned int maxObjects, double maxMemory)
+{
+    osg::ref_ptr<osgDB::ObjectCache> objectCache = new osgDB::ObjectCache;
+    objectCache->setMaximumNumberOfObjects(maxObjects);
+    objectCache->setMaximumNumberOfBytes(static_cast<unsigned long long>(maxMemory*1024.0*1024.0));
+
+    OpenThreads::Atomic next;
+    std::vector<LookupThread*> threads;
+    for(unsigned int i=1; i<numThreads; ++i)
+    {
+        threads.push_back(new LookupThread(objectCache.get(), settings, next, i*7919u));
+        threads.back()->start();
+    }
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    LookupThread(objectCache.get(), settings, next, 0).run();
+
+    for(std::vector<LookupThread*>::iterator itr = threads.begin();
+        itr != threads.end();
+        ++itr)
+    {
+        (*itr)->join();
+        delete *itr;
+    }
+
+    double duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    unsigned int numLookups = objectCache->getNumHits()+objectCache->getNumMisses();
+
+    std::cout<<numThreads<<" thread(s), maximum objects "<<maxObjects<<", maximum memory "<<maxMemory<<"MB"<<std::endl;
+    std::cout<<"    lookups          : "<<(duration>0.0 ? double(numLookups)/duration : 0.0)<<" per second"<<std::endl;
+    std::cout<<"    hit rate         : "<<(numLookups>0 ? 100.0*double(objectCache->getNumHits())/double(numLookups) : 0.0)<<"%"<<std::endl;
+    std::cout<<"    evictions        : "<<objectCache->getNumEvictions()<<std::endl;
+    std::cout<<"    cached           : "<<objectCache->getNumObjects()<<" objects, "<<double(objectCache->getNumBytes())/(1024.0*1024.0)<<"MB"<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" tests the ObjectCache's handling of Options, or with --benchmark its throughput and eviction policy.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--benchmark", "Look up synthetic files in an ObjectCache from several threads and report the hit rate, evictions and throughput.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>", "Number of threads looking up files, default one per processor.");
+    arguments.getApplicationUsage()->addCommandLineOption("--files <num>", "Number of distinct files looked up, default 10000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--operations <num>", "Total number of lookups, default 200000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--vertices <num>", "Number of vertices in each synthetic object, default 256.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-objects <num>", "Maximum number of objects in the cache, default 1000, 0 for no limit.");
+    arguments.getApplicationUsage()->addCommandLineOption("--max-memory <MB>", "Maximum estimated memory of the objects in the cache, default 0 for no limit.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    if (arguments.read("--benchmark"))
+    {
+        BenchmarkSettings settings;
+        unsigned int numThreads = OpenThreads::GetNumberOfProcessors();
+        unsigned int maxObjects = 1000;
+        double maxMemory = 0.0;
+
+        while(arguments.read("--threads", numThreads)) {}
+        while(arguments.read("--files", settings.numFiles)) {}
+        while(arguments.read("--operations", settings.numOperations)) {}
+        while(arguments.read("--vertices", settings.numVertices)) {}
+        while(arguments.read("--max-objects", maxObjects)) {}
+        while(arguments.read("--max-memory", maxMemory)) {}
+
+        numThreads = osg::maximum(1u, numThreads);
+
+        // single threaded first, as the baseline for the contention between threads.
+        runBenchmark(settings, 1, maxObjects, maxMemory);
+        if (numThreads>1) runBenchmark(settings, numThreads, maxObjects, maxMemory);
+
+        return 0;
+    }
+
     // construct the viewer.
-    osgViewer::Viewer viewer;
+    osgViewer::Viewer viewer(arguments);
 
     // add model to viewer.
     viewer.setSceneData(createObjectCache());
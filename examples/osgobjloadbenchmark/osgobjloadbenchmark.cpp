@@ -0,0 +1,151 @@
+/* OpenSceneGraph example, osgobjloadbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Timer>
+
+#include <osgDB/ReadFile>
+#include <osgDB/fstream>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+
+#include "../osgkdtreebenchmark/SyntheticMesh.h"
+
+// Benchmark comparing the .obj plugin's memory mapped, parallel parser with the line by line stream reader
+// (the noMemoryMapping option), on an OBJ file like the textured meshes exported by photogrammetry tools.
+
+// write the synthetic mesh as a grid of textured triangles with per vertex normals, numColumns by numRows quads.
+bool writeSyntheticOBJ(const std::string& fileName, unsigned int numColumns, unsigned int numRows)
+{
+    osg::ref_ptr<osg::Geometry> geometry = createSyntheticMeshTile(numColumns, numRows, 0.0f, true, true);
+    const osg::Vec3Array* vertices = static_cast<const osg::Vec3Array*>(geometry->getVertexArray());
+    const osg::Vec3Array* normals = static_cast<const osg::Vec3Array*>(geometry->getNormalArray());
+    const osg::Vec2Array* texcoords = static_cast<const osg::Vec2Array*>(geometry->getTexCoordArray(0));
+    const osg::DrawElementsUInt* triangles = static_cast<const osg::DrawElementsUInt*>(geometry->getPrimitiveSet(0));
+
+    osgDB::ofstream fout(fileName.c_str());
+    if (!fout) return false;
+
+    fout<<"# synthetic mesh written by osgobjloadbenchmark"<<std::endl;
+    fout<<"o mesh"<<std::endl;
+
+    char line[256];
+    for(unsigned int i=0; i<vertices->size(); ++i)
+    {
+        const osg::Vec3& v = (*vertices)[i];
+        const osg::Vec2& t = (*texcoords)[i];
+        const osg::Vec3& n = (*normals)[i];
+        sprintf(line, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n", v.x(), v.y(), v.z(), t.x(), t.y(), n.x(), n.y(), n.z());
+        fout<<line;
+    }
+
+    // OBJ indices start at 1, the vertex, texture coordinate and normal of each corner share the same index.
+    for(unsigned int i=0; i+2<triangles->size(); i+=3)
+    {
+        unsigned int i0 = (*triangles)[i]+1, i1 = (*triangles)[i+1]+1, i2 = (*triangles)[i+2]+1;
+        sprintf(line, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", i0, i0, i0, i1, i1, i1, i2, i2, i2);
+        fout<<line;
+    }
+
+    return !fout.fail();
+}
+
+void runConfiguration(const std::string& name, const std::string& fileName, const std::string& optionString, unsigned int numIterations)
+{
+    osg::ref_ptr<osgDB::Options> options = new osgDB::Options(optionString);
+    options->setObjectCacheHint(osgDB::Options::CACHE_NONE);
+
+    unsigned int numLoaded = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    for(unsigned int i=0; i<numIterations; ++i)
+    {
+        osg::ref_ptr<osg::Node> node = osgDB::readRefNodeFile(fileName, options.get());
+        if (node.valid()) ++numLoaded;
+    }
+
+    double duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    std::cout<<name<<" ("<<optionString<<")"<<std::endl;
+    std::cout<<"    load time        : "<<(numLoaded>0 ? duration/double(numLoaded) : 0.0)<<"s per load, "<<numLoaded<<" loaded"<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" compares the load time of .obj files parsed in parallel from a memory mapping and read a line at a time.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename.obj]");
+    arguments.getApplicationUsage()->addCommandLineOption("--grid <columns> <rows>", "Size of the synthetic mesh when no file is specified, default 1000 1000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--iterations <num>", "Number of times the file is loaded, default 2.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>", "Number of threads parsing the file, default one per processor.");
+    arguments.getApplicationUsage()->addCommandLineOption("-O <options>", "Additional options passed to the plugin, for example noTriStripPolygons to time just reading.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numColumns = 1000, numRows = 1000;
+    unsigned int numIterations = 2;
+    unsigned int numThreads = 0;
+    std::string extraOptions;
+    std::string option;
+
+    while(arguments.read("--grid", numColumns, numRows)) {}
+    while(arguments.read("--iterations", numIterations)) {}
+    while(arguments.read("--threads", numThreads)) {}
+    while(arguments.read("-O", option)) { extraOptions += (extraOptions.empty() ? "" : " ") + option; }
+
+    std::string fileName;
+    for(int pos=1; pos<arguments.argc(); ++pos)
+    {
+        if (!arguments.isOption(pos)) fileName = arguments[pos];
+    }
+
+    bool temporaryFile = false;
+    if (fileName.empty())
+    {
+        fileName = "osgobjloadbenchmark_mesh.obj";
+        std::cout<<"Writing a synthetic mesh of "<<numColumns*numRows*2<<" triangles."<<std::endl;
+        if (!writeSyntheticOBJ(fileName, numColumns, numRows))
+        {
+            std::cout<<"Unable to write "<<fileName<<std::endl;
+            return 1;
+        }
+        temporaryFile = true;
+    }
+
+    std::ostringstream parallelOptions;
+    parallelOptions<<extraOptions;
+    if (numThreads>0) parallelOptions<<(extraOptions.empty() ? "" : " ")<<"numThreads="<<numThreads;
+
+    runConfiguration("Memory mapped, parallel", fileName, parallelOptions.str(), numIterations);
+    runConfiguration("Stream, line by line", fileName, extraOptions.empty() ? std::string("noMemoryMapping") : extraOptions+" noMemoryMapping", numIterations);
+
+    if (temporaryFile) remove(fileName.c_str());
+
+    return 0;
+}
@@ -0,0 +1,375 @@
+/* OpenSceneGraph example, osgpagerbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/DisplaySettings>
+#include <osg/FrameStamp>
+#include <osg/Geode>
+#include <osg/ShapeDrawable>
+#include <osg/Timer>
+
+#include <osgDB/DatabasePager>
+#include <osgDB/FileNameUtils>
+#include <osgDB/ReadFile>
+#include <osgDB/Registry>
+
+#include <osgViewer/Viewer>
+#include <osgViewer/ViewerEventHandlers>
+
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <map>
+#include <vector>
+
+// A single request made by the cull traversal to the DatabasePager.
+struct TraceRequest
+{
+    TraceRequest(): frameNumber(0), priority(0.0f) {}
+
+    TraceRequest(unsigned int fn, float p, const std::string& name):
+        frameNumber(fn), priority(p), fileName(name) {}
+
+    unsigned int    frameNumber;
+    float           priority;
+    std::string     fileName;
+};
+
+typedef std::vector<TraceRequest> Trace;
+
+// DatabasePager that records every request made to it so that a session can be replayed later.
+class RecordingDatabasePager : public osgDB::DatabasePager
+{
+public:
+
+    RecordingDatabasePager(std::ostream& out): _out(out) {}
+
+    virtual void requestNodeFile(const std::string& fileName, osg::NodePath& nodePath,
+                                 float priority, const osg::FrameStamp* framestamp,
+                                 osg::ref_ptr<osg::Referenced>& databaseRequest,
+                                 const osg::Referenced* options)
+    {
+        if (framestamp) _out<<framestamp->getFrameNumber()<<" "<<priority<<" "<<fileName<<std::endl;
+
+        osgDB::DatabasePager::requestNodeFile(fileName, nodePath, priority, framestamp, databaseRequest, options);
+    }
+
+protected:
+
+    std::ostream& _out;
+};
+
+// Loader for the synthetic .pagerbench tiles, simulating the latency of a real load.
+class SyntheticTileReaderWriter : public osgDB::ReaderWriter
+{
+public:
+
+    SyntheticTileReaderWriter(unsigned int loadTime): _loadTime(loadTime)
+    {
+        supportsExtension("pagerbench","Synthetic tiles used by osgpagerbenchmark");
+    }
+
+    virtual const char* className() const { return "osgpagerbenchmark synthetic tile loader"; }
+
+    virtual ReadResult readNode(const std::string& fileName, const osgDB::Options*) const
+    {
+        if (!acceptsExtension(osgDB::getLowerCaseFileExtension(fileName))) return ReadResult::FILE_NOT_HANDLED;
+
+        OpenThreads::Thread::microSleep(_loadTime);
+
+        osg::ref_ptr<osg::Geode> geode = new osg::Geode;
+        geode->addDrawable(new osg::ShapeDrawable(new osg::Box(osg::Vec3(0.0f,0.0f,0.0f), 1.0f)));
+        return geode.release();
+    }
+
+protected:
+
+    unsigned int _loadTime;
+};
+
+struct EarlierFrame
+{
+    bool operator() (const TraceRequest& lhs, const TraceRequest& rhs) const { return lhs.frameNumber<rhs.frameNumber; }
+};
+
+bool readTrace(const std::string& fileName, Trace& trace)
+{
+    std::ifstream fin(fileName.c_str());
+    if (!fin) return false;
+
+    std::string line;
+    while(std::getline(fin, line))
+    {
+        std::istringstream str(line);
+        TraceRequest request;
+        if (str>>request.frameNumber>>request.priority)
+        {
+            std::getline(str>>std::ws, request.fileName);
+            if (!request.fileName.empty()) trace.push_back(request);
+        }
+    }
+
+    std::stable_sort(trace.begin(), trace.end(), EarlierFrame());
+
+    return !trace.empty();
+}
+
+// Create a trace of numTiles tiles, tilesPerFrame coming into view each frame and each
+// remaining in view for numFramesVisible frames, as would happen when flying over terrain.
+void createSyntheticTrace(Trace& trace, unsigned int numTiles, unsigned int tilesPerFrame, unsigned int numFramesVisible)
+{
+    unsigned int seed = 1;
+    for(unsigned int i=0; i<numTiles; ++i)
+    {
+        seed = seed*1103515245u + 12345u;
+        float priority = static_cast<float>((seed>>16) & 0x7fff)/32767.0f;
+
+        std::ostringstream name;
+        name<<"tile_"<<i<<".pagerbench";
+
+        unsigned int firstFrame = i/tilesPerFrame;
+        for(unsigned int f=firstFrame; f<firstFrame+numFramesVisible; ++f)
+        {
+            trace.push_back(TraceRequest(f, priority, name.str()));
+        }
+    }
+
+    std::stable_sort(trace.begin(), trace.end(), EarlierFrame());
+}
+
+struct ReplayResult
+{
+    ReplayResult(): numTiles(0), numMerged(0), numFrames(0), elapsedTime(0.0), minimumTimeToMerge(0.0), averageTimeToMerge(0.0), maximumTimeToMerge(0.0), maximumMergeTimePerFrame(0.0), maximumMergeBacklog(0) {}
+
+    unsigned int    numTiles;
+    unsigned int    numMerged;
+    unsigned int    numFrames;
+    double          elapsedTime;
+    double          minimumTimeToMerge;
+    double          averageTimeToMerge;
+    double          maximumTimeToMerge;
+    double          maximumMergeTimePerFrame;
+    unsigned int    maximumMergeBacklog;
+};
+
+struct TileRequest
+{
+    osg::ref_ptr<osg::Group>        group;
+    osg::ref_ptr<osg::Referenced>   databaseRequest;
+};
+
+// Replay the trace at a fixed frame rate, mimicking the update/cull ordering of osgViewer.
+ReplayResult replay(const Trace& trace, osgDB::DatabasePager::RequestSchedulingPolicy policy, unsigned int numThreads, double frameRate, double mergeTime, unsigned int maxDrainFrames)
+{
+    osg::DisplaySettings::instance()->setNumOfDatabaseThreadsHint(numThreads);
+    osg::DisplaySettings::instance()->setNumOfHttpDatabaseThreadsHint(0);
+
+    osg::ref_ptr<osgDB::DatabasePager> pager = new osgDB::DatabasePager;
+    pager->setRequestSchedulingPolicy(policy);
+    pager->setUpThreads(numThreads, 0);
+    pager->setMaximumMergeTimePerFrame(mergeTime);
+
+    typedef std::map<std::string, TileRequest> TileRequests;
+    TileRequests tiles;
+    for(Trace::const_iterator itr = trace.begin(); itr != trace.end(); ++itr)
+    {
+        TileRequest& tile = tiles[itr->fileName];
+        if (!tile.group) tile.group = new osg::Group;
+    }
+
+    ReplayResult result;
+    result.numTiles = tiles.size();
+
+    osg::ref_ptr<osg::FrameStamp> frameStamp = new osg::FrameStamp;
+    osg::ElapsedTime elapsedTime;
+    double frameTime = 1.0/frameRate;
+
+    Trace::const_iterator itr = trace.begin();
+    unsigned int frameNumber = trace.front().frameNumber;
+    unsigned int drainFrames = 0;
+    while(itr != trace.end() || (pager->getRequestsInProgress() && drainFrames<maxDrainFrames))
+    {
+        double frameStart = elapsedTime.elapsedTime();
+
+        frameStamp->setFrameNumber(frameNumber);
+        frameStamp->setReferenceTime(frameStart);
+        frameStamp->setSimulationTime(frameStart);
+
+        pager->signalBeginFrame(frameStamp.get());
+
+        pager->updateSceneGraph(*frameStamp);
+
+        result.maximumMergeTimePerFrame = osg::maximum(result.maximumMergeTimePerFrame, pager->getMergeTimeLastFrame());
+        result.maximumMergeBacklog = osg::maximum(result.maximumMergeBacklog, pager->getMergeBacklog());
+
+        for(; itr != trace.end() && itr->frameNumber==frameNumber; ++itr)
+        {
+            TileRequest& tile = tiles[itr->fileName];
+            if (tile.group->getNumChildren()!=0) continue;
+
+            osg::NodePath nodePath;
+            nodePath.push_back(tile.group.get());
+            pager->requestNodeFile(itr->fileName, nodePath, itr->priority, frameStamp.get(), tile.databaseRequest, 0);
+        }
+
+        pager->signalEndFrame();
+
+        if (itr == trace.end()) ++drainFrames;
+        ++frameNumber;
+        ++result.numFrames;
+
+        double frameDuration = elapsedTime.elapsedTime()-frameStart;
+        if (frameDuration<frameTime) OpenThreads::Thread::microSleep(static_cast<unsigned int>((frameTime-frameDuration)*1000000.0));
+    }
+
+    result.elapsedTime = elapsedTime.elapsedTime();
+
+    pager->cancel();
+
+    for(TileRequests::iterator titr = tiles.begin(); titr != tiles.end(); ++titr)
+    {
+        if (titr->second.group->getNumChildren()!=0) ++result.numMerged;
+    }
+
+    if (result.numMerged>0)
+    {
+        result.minimumTimeToMerge = pager->getMinimumTimeToMergeTile();
+        result.averageTimeToMerge = pager->getAverageTimeToMergeTiles();
+        result.maximumTimeToMerge = pager->getMaximumTimeToMergeTile();
+    }
+
+    return result;
+}
+
+void printResult(const std::string& name, const ReplayResult& result)
+{
+    std::cout<<name<<std::endl;
+    std::cout<<"    tiles merged        "<<result.numMerged<<" of "<<result.numTiles<<" in "<<result.numFrames<<" frames"<<std::endl;
+    std::cout<<"    elapsed time        "<<result.elapsedTime<<"s"<<std::endl;
+    std::cout<<"    throughput          "<<(result.elapsedTime>0.0 ? static_cast<double>(result.numMerged)/result.elapsedTime : 0.0)<<" tiles/s"<<std::endl;
+    std::cout<<"    request to merge    min="<<result.minimumTimeToMerge*1000.0<<"ms avg="<<result.averageTimeToMerge*1000.0<<"ms max="<<result.maximumTimeToMerge*1000.0<<"ms"<<std::endl;
+    std::cout<<"    merge per frame     max="<<result.maximumMergeTimePerFrame*1000.0<<"ms, max backlog="<<result.maximumMergeBacklog<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" records and replays DatabasePager request traces to compare the throughput and latency of the request scheduling policies.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options] [filename ...]");
+    arguments.getApplicationUsage()->addCommandLineOption("--record <trace>","Run a viewer on the specified model, writing every DatabasePager request to the trace file.");
+    arguments.getApplicationUsage()->addCommandLineOption("--replay <trace>","Replay a previously recorded trace.");
+    arguments.getApplicationUsage()->addCommandLineOption("--synthetic <numTiles>","Replay a generated trace of synthetic tiles (default).");
+    arguments.getApplicationUsage()->addCommandLineOption("--tiles-per-frame <num>","Number of synthetic tiles that come into view each frame.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames-visible <num>","Number of frames each synthetic tile remains in view.");
+    arguments.getApplicationUsage()->addCommandLineOption("--load-time <us>","Time taken to load each synthetic tile in microseconds.");
+    arguments.getApplicationUsage()->addCommandLineOption("--threads <num>","Number of database threads.");
+    arguments.getApplicationUsage()->addCommandLineOption("--fps <rate>","Frame rate at which the trace is replayed.");
+    arguments.getApplicationUsage()->addCommandLineOption("--policy <List|WorkStealing|All>","Request scheduling policy to benchmark.");
+    arguments.getApplicationUsage()->addCommandLineOption("--merge-time <us>","Maximum time in microseconds spent merging loaded tiles each frame, 0 for no limit.");
+    arguments.getApplicationUsage()->addCommandLineOption("-h or --help","Display this information");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    std::string traceFileName;
+    if (arguments.read("--record", traceFileName))
+    {
+        std::ofstream fout(traceFileName.c_str());
+        if (!fout)
+        {
+            std::cout<<arguments.getApplicationName()<<": unable to open "<<traceFileName<<" for writing."<<std::endl;
+            return 1;
+        }
+
+        osgViewer::Viewer viewer(arguments);
+        viewer.setDatabasePager(new RecordingDatabasePager(fout));
+        viewer.addEventHandler(new osgViewer::StatsHandler);
+
+        osg::ref_ptr<osg::Node> model = osgDB::readRefNodeFiles(arguments);
+        if (!model)
+        {
+            std::cout<<arguments.getApplicationName()<<": No data loaded"<<std::endl;
+            return 1;
+        }
+
+        viewer.setSceneData(model.get());
+        return viewer.run();
+    }
+
+    unsigned int numThreads = 8;
+    while(arguments.read("--threads", numThreads)) {}
+
+    double frameRate = 60.0;
+    while(arguments.read("--fps", frameRate)) {}
+
+    unsigned int loadTime = 2000;
+    while(arguments.read("--load-time", loadTime)) {}
+
+    unsigned int numTiles = 2000;
+    unsigned int tilesPerFrame = 20;
+    unsigned int numFramesVisible = 30;
+    while(arguments.read("--synthetic", numTiles)) {}
+    while(arguments.read("--tiles-per-frame", tilesPerFrame)) {}
+    while(arguments.read("--frames-visible", numFramesVisible)) {}
+
+    double mergeTime = 0.0;
+    while(arguments.read("--merge-time", mergeTime)) {}
+
+    std::string policy("All");
+    while(arguments.read("--policy", policy)) {}
+
+    Trace trace;
+    if (arguments.read("--replay", traceFileName))
+    {
+        if (!readTrace(traceFileName, trace))
+        {
+            std::cout<<arguments.getApplicationName()<<": unable to read trace "<<traceFileName<<std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        osgDB::Registry::instance()->addReaderWriter(new SyntheticTileReaderWriter(loadTime));
+        createSyntheticTrace(trace, numTiles, tilesPerFrame>0 ? tilesPerFrame : 1, numFramesVisible>0 ? numFramesVisible : 1);
+    }
+
+    std::cout<<"Replaying "<<trace.size()<<" requests with "<<numThreads<<" database threads at "<<frameRate<<"fps"<<std::endl;
+
+    unsigned int maxDrainFrames = static_cast<unsigned int>(frameRate*10.0);
+
+    if (policy=="List" || policy=="All")
+    {
+        printResult("SCHEDULE_BY_SCANNING_LIST", replay(trace, osgDB::DatabasePager::SCHEDULE_BY_SCANNING_LIST, numThreads, frameRate, mergeTime, maxDrainFrames));
+    }
+
+    if (policy=="WorkStealing" || policy=="All")
+    {
+        printResult("SCHEDULE_BY_PRIORITY_WITH_WORK_STEALING", replay(trace, osgDB::DatabasePager::SCHEDULE_BY_PRIORITY_WITH_WORK_STEALING, numThreads, frameRate, mergeTime, maxDrainFrames));
+    }
+
+    return 0;
+}
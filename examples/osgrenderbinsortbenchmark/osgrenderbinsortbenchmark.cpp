@@ -0,0 +1,154 @@
+/* OpenSceneGraph example, osgrenderbinsortbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/Geometry>
+#include <osg/StateSet>
+#include <osg/Timer>
+
+#include <osgUtil/RenderBin>
+#include <osgUtil/StateGraph>
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+// Benchmark comparing the std::sort based depth sorts of osgUtil::RenderBin, SORT_BACK_TO_FRONT and SORT_FRONT_TO_BACK,
+// with the radix sorts of RADIX_SORT_BACK_TO_FRONT and RADIX_SORT_FRONT_TO_BACK, on a bin of transparent leaves
+// spread over a number of StateGraphs as the CullVisitor leaves them.
+
+float randomValue(float minValue, float maxValue)
+{
+    return minValue + (maxValue-minValue)*float(rand())/float(RAND_MAX);
+}
+
+typedef std::vector< osg::ref_ptr<osg::StateSet> > StateSets;
+typedef std::vector< osg::ref_ptr<osgUtil::StateGraph> > StateGraphs;
+
+// the StateGraphs only keep a C pointer to their StateSet so the StateSets are kept in their own list.
+void createStateGraphs(StateSets& stateSets, StateGraphs& stateGraphs, unsigned int numLeaves, unsigned int numStateSets)
+{
+    osg::ref_ptr<osgUtil::StateGraph> root = new osgUtil::StateGraph;
+    stateGraphs.push_back(root.get());
+
+    std::vector<osgUtil::StateGraph*> leafStateGraphs;
+    for(unsigned int i=0; i<numStateSets; ++i)
+    {
+        stateSets.push_back(new osg::StateSet);
+        leafStateGraphs.push_back(root->find_or_insert(stateSets.back().get()));
+        stateGraphs.push_back(leafStateGraphs.back());
+    }
+
+    osg::ref_ptr<osg::RefMatrix> projection = new osg::RefMatrix;
+    osg::ref_ptr<osg::RefMatrix> modelview = new osg::RefMatrix;
+    osg::ref_ptr<osg::Geometry> geometry = new osg::Geometry;
+    for(unsigned int i=0; i<numLeaves; ++i)
+    {
+        // a coarse grid of depths, so some leaves share their depth like the leaves of a single object.
+        float depth = floorf(randomValue(1.0f, 1000.0f)*16.0f)/16.0f;
+        leafStateGraphs[rand()%numStateSets]->addLeaf(new osgUtil::RenderLeaf(geometry.get(), projection.get(), modelview.get(), depth, i));
+    }
+}
+
+void fillRenderBin(osgUtil::RenderBin& bin, const StateGraphs& stateGraphs)
+{
+    bin.reset();
+    for(StateGraphs::const_iterator itr = stateGraphs.begin();
+        itr != stateGraphs.end();
+        ++itr)
+    {
+        if (!(*itr)->_leaves.empty()) bin.addStateGraph(itr->get());
+    }
+}
+
+double timeSort(osgUtil::RenderBin::SortMode sortMode, const StateGraphs& stateGraphs, unsigned int numIterations, std::vector<float>& depths)
+{
+    osg::ref_ptr<osgUtil::RenderBin> bin = new osgUtil::RenderBin(sortMode);
+
+    double duration = 0.0;
+    for(unsigned int it=0; it<numIterations; ++it)
+    {
+        fillRenderBin(*bin, stateGraphs);
+
+        osg::Timer_t start = osg::Timer::instance()->tick();
+        bin->sort();
+        duration += osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    }
+
+    depths.clear();
+    const osgUtil::RenderBin::RenderLeafList& leaves = bin->getRenderLeafList();
+    for(osgUtil::RenderBin::RenderLeafList::const_iterator itr = leaves.begin();
+        itr != leaves.end();
+        ++itr)
+    {
+        depths.push_back((*itr)->_depth);
+    }
+
+    return duration/double(numIterations);
+}
+
+void runConfiguration(const std::string& name, osgUtil::RenderBin::SortMode sortMode, osgUtil::RenderBin::SortMode radixSortMode,
+                      const StateGraphs& stateGraphs, unsigned int numIterations)
+{
+    std::vector<float> depths, radixDepths;
+    double sortTime = timeSort(sortMode, stateGraphs, numIterations, depths);
+    double radixSortTime = timeSort(radixSortMode, stateGraphs, numIterations, radixDepths);
+
+    std::cout<<name<<", "<<depths.size()<<" leaves"<<std::endl;
+    std::cout<<"    std::sort        : "<<sortTime*1000.0<<"ms per sort"<<std::endl;
+    std::cout<<"    radix sort       : "<<radixSortTime*1000.0<<"ms per sort, speed up "<<(radixSortTime>0.0 ? sortTime/radixSortTime : 0.0)
+             <<(depths==radixDepths ? "" : ", ORDER DIFFERS")<<std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" compares the std::sort and radix sort depth sorting of RenderBin leaves.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--leaves <num>", "Number of leaves in the bin, default 100000.");
+    arguments.getApplicationUsage()->addCommandLineOption("--statesets <num>", "Number of StateGraphs the leaves are spread over, default 64.");
+    arguments.getApplicationUsage()->addCommandLineOption("--iterations <num>", "Number of times the bin is sorted, default 20.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numLeaves = 100000;
+    unsigned int numStateSets = 64;
+    unsigned int numIterations = 20;
+
+    while(arguments.read("--leaves", numLeaves)) {}
+    while(arguments.read("--statesets", numStateSets)) {}
+    while(arguments.read("--iterations", numIterations)) {}
+
+    if (numStateSets==0) numStateSets = 1;
+
+    StateSets stateSets;
+    StateGraphs stateGraphs;
+    createStateGraphs(stateSets, stateGraphs, numLeaves, numStateSets);
+
+    runConfiguration("Back to front", osgUtil::RenderBin::SORT_BACK_TO_FRONT, osgUtil::RenderBin::RADIX_SORT_BACK_TO_FRONT, stateGraphs, numIterations);
+    runConfiguration("Front to back", osgUtil::RenderBin::SORT_FRONT_TO_BACK, osgUtil::RenderBin::RADIX_SORT_FRONT_TO_BACK, stateGraphs, numIterations);
+
+    return 0;
+}
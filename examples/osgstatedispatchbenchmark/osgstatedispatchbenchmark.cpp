@@ -0,0 +1,283 @@
+/* OpenSceneGraph example, osgstatedispatchbenchmark.
+*
+*  Permission is hereby granted, free of charge, to any person obtaining a copy
+*  of this software and associated documentation files (the "Software"), to deal
+*  in the Software without restriction, including without limitation the rights
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+*  copies of the Software, and to permit persons to whom the Software is
+*  furnished to do so, subject to the following conditions:
+*
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+*  THE SOFTWARE.
+*/
+
+#include <osg/ArgumentParser>
+#include <osg/ApplicationUsage>
+#include <osg/State>
+#include <osg/StateSet>
+#include <osg/Timer>
+
+#include <osgUtil/StateGraph>
+
+#include <iostream>
+#include <vector>
+#include <stdlib.h>
+
+// Benchmark of the CPU cost of osg::State applying the StateSets of a draw traversal, without a graphics context.
+// A stream of draws is recorded as the leaf StateGraphs a RenderBin would visit, and each frame replays it with
+// StateGraph::moveStateGraph() and State::apply() as RenderLeaf::render() does.
+// No GL calls are made: the attributes are stand-ins whose apply() does no GL, the State's texture unit entry
+// point is a no-op function and the glEnable/glDisable calls of modes go to the no-op dispatch the GL library
+// uses when no context is current.
+
+static unsigned int s_numAttributesApplied = 0;
+
+// stand-in for a StateAttribute of any type, apply() just counts the call.
+class NullAttribute : public osg::StateAttribute
+{
+    public:
+
+        NullAttribute():
+            _type(osg::StateAttribute::MATERIAL),
+            _member(0),
+            _value(0) {}
+
+        NullAttribute(Type type, unsigned int member, unsigned int value):
+            _type(type),
+            _member(member),
+            _value(value) {}
+
+        NullAttribute(const NullAttribute& rhs, const osg::CopyOp& copyop=osg::CopyOp::SHALLOW_COPY):
+            osg::StateAttribute(rhs, copyop),
+            _type(rhs._type),
+            _member(rhs._member),
+            _value(rhs._value) {}
+
+        virtual osg::Object* cloneType() const { return new NullAttribute(_type, _member, 0); }
+        virtual osg::Object* clone(const osg::CopyOp& copyop) const { return new NullAttribute(*this, copyop); }
+        virtual bool isSameKindAs(const osg::Object* obj) const { return dynamic_cast<const NullAttribute*>(obj)!=NULL; }
+        virtual const char* libraryName() const { return "osgstatedispatchbenchmark"; }
+        virtual const char* className() const { return "NullAttribute"; }
+
+        virtual Type getType() const { return _type; }
+        virtual unsigned int getMember() const { return _member; }
+        virtual bool isTextureAttribute() const { return _type==osg::StateAttribute::TEXTURE || _type==osg::StateAttribute::TEXENV; }
+
+        virtual int compare(const osg::StateAttribute& sa) const
+        {
+            COMPARE_StateAttribute_Types(NullAttribute, sa)
+            COMPARE_StateAttribute_Parameter(_type)
+            COMPARE_StateAttribute_Parameter(_member)
+            COMPARE_StateAttribute_Parameter(_value)
+            return 0;
+        }
+
+        virtual void apply(osg::State&) const { ++s_numAttributesApplied; }
+
+    protected:
+
+        Type            _type;
+        unsigned int    _member;
+        unsigned int    _value;
+};
+
+// State with a no-op glActiveTexture in place of the one initializeExtensionProcs() would get from the driver.
+class NullGLState : public osg::State
+{
+    public:
+
+        NullGLState(unsigned int numTextureUnits)
+        {
+            _glActiveTexture = &nullActiveTexture;
+            _glClientActiveTexture = &nullActiveTexture;
+            _glMaxTextureUnits = numTextureUnits;
+            _glMaxTextureCoords = numTextureUnits;
+        }
+
+    protected:
+
+        static void GL_APIENTRY nullActiveTexture(GLenum) {}
+};
+
+typedef std::vector< osg::ref_ptr<osg::StateSet> > StateSets;
+typedef std::vector< osg::ref_ptr<osg::StateAttribute> > Attributes;
+typedef std::vector<osgUtil::StateGraph*> DrawStream;
+
+static const GLenum s_modes[] =
+{
+    GL_BLEND, GL_CULL_FACE, GL_DEPTH_TEST, GL_LIGHTING, GL_NORMALIZE, GL_POLYGON_OFFSET_FILL, GL_STENCIL_TEST,
+    GL_LIGHT0, GL_LIGHT0+1, GL_LIGHT0+2, GL_LIGHT0+3, GL_SCISSOR_TEST, GL_FOG, GL_ALPHA_TEST, GL_LINE_SMOOTH, GL_MULTISAMPLE
+};
+
+static const osg::StateAttribute::Type s_types[] =
+{
+    osg::StateAttribute::POLYGONMODE, osg::StateAttribute::POLYGONOFFSET, osg::StateAttribute::MATERIAL, osg::StateAttribute::ALPHAFUNC,
+    osg::StateAttribute::CULLFACE, osg::StateAttribute::FOG, osg::StateAttribute::LIGHT, osg::StateAttribute::LINEWIDTH,
+    osg::StateAttribute::BLENDFUNC, osg::StateAttribute::STENCIL, osg::StateAttribute::COLORMASK, osg::StateAttribute::DEPTH,
+    osg::StateAttribute::VIEWPORT, osg::StateAttribute::SCISSOR, osg::StateAttribute::PROGRAM, osg::StateAttribute::CLIPPLANE
+};
+
+// a StateSet with a random selection of modes, attributes and texture attributes, like the StateSets of the
+// Geodes of a loaded model.
+osg::StateSet* createStateSet(unsigned int numModes, unsigned int numAttributes, unsigned int numTextureUnits, const Attributes& attributes, const Attributes& textures)
+{
+    osg::ref_ptr<osg::StateSet> stateset = new osg::StateSet;
+
+    const unsigned int numAvailableModes = sizeof(s_modes)/sizeof(GLenum);
+    for(unsigned int i=0; i<numModes; ++i)
+    {
+        stateset->setMode(s_modes[rand()%numAvailableModes], (rand()%2) ? osg::StateAttribute::ON : osg::StateAttribute::OFF);
+    }
+
+    for(unsigned int i=0; i<numAttributes; ++i)
+    {
+        stateset->setAttribute(attributes[rand()%attributes.size()].get());
+    }
+
+    for(unsigned int unit=0; unit<numTextureUnits; ++unit)
+    {
+        if (rand()%4==0) continue;
+        stateset->setTextureAttribute(unit, textures[rand()%textures.size()].get());
+        stateset->setTextureMode(unit, GL_TEXTURE_2D, osg::StateAttribute::ON);
+    }
+
+    return stateset.release();
+}
+
+// build a StateGraph of a root with numParents children each with numLeaves children, and record the draws of
+// a frame as the StateGraph leaves in the order a RenderBin sorted by state would visit them, each leaf drawn
+// numDrawsPerLeaf times.
+osgUtil::StateGraph* createDrawStream(StateSets& stateSets, DrawStream& drawStream, unsigned int numParents, unsigned int numLeaves, unsigned int numDrawsPerLeaf,
+                                      unsigned int numModes, unsigned int numAttributes, unsigned int numTextureUnits)
+{
+    Attributes attributes;
+    const unsigned int numTypes = sizeof(s_types)/sizeof(osg::StateAttribute::Type);
+    for(unsigned int t=0; t<numTypes; ++t)
+    {
+        unsigned int numMembers = (s_types[t]==osg::StateAttribute::LIGHT || s_types[t]==osg::StateAttribute::CLIPPLANE) ? 4 : 1;
+        for(unsigned int member=0; member<numMembers; ++member)
+        {
+            for(unsigned int value=0; value<4; ++value)
+            {
+                attributes.push_back(new NullAttribute(s_types[t], member, value));
+            }
+        }
+    }
+
+    Attributes textures;
+    for(unsigned int value=0; value<64; ++value)
+    {
+        textures.push_back(new NullAttribute(osg::StateAttribute::TEXTURE, 0, value));
+    }
+
+    osgUtil::StateGraph* root = new osgUtil::StateGraph;
+
+    stateSets.push_back(createStateSet(numModes, numAttributes, 0, attributes, textures));
+    osgUtil::StateGraph* global = root->find_or_insert(stateSets.back().get());
+
+    for(unsigned int p=0; p<numParents; ++p)
+    {
+        stateSets.push_back(createStateSet(numModes/2, numAttributes/2, 0, attributes, textures));
+        osgUtil::StateGraph* parent = global->find_or_insert(stateSets.back().get());
+
+        for(unsigned int l=0; l<numLeaves; ++l)
+        {
+            stateSets.push_back(createStateSet(numModes, numAttributes, numTextureUnits, attributes, textures));
+            osgUtil::StateGraph* leaf = parent->find_or_insert(stateSets.back().get());
+
+            for(unsigned int d=0; d<numDrawsPerLeaf; ++d) drawStream.push_back(leaf);
+        }
+    }
+
+    return root;
+}
+
+int main(int argc, char** argv)
+{
+    osg::ArgumentParser arguments(&argc, argv);
+
+    arguments.getApplicationUsage()->setApplicationName(arguments.getApplicationName());
+    arguments.getApplicationUsage()->setDescription(arguments.getApplicationName()+" times osg::State applying a recorded stream of StateSets, without a graphics context.");
+    arguments.getApplicationUsage()->setCommandLineUsage(arguments.getApplicationName()+" [options]");
+    arguments.getApplicationUsage()->addCommandLineOption("--parents <num>", "Number of parent StateSets, default 64.");
+    arguments.getApplicationUsage()->addCommandLineOption("--leaves <num>", "Number of leaf StateSets below each parent, default 16.");
+    arguments.getApplicationUsage()->addCommandLineOption("--draws <num>", "Number of draws of each leaf StateSet, default 2.");
+    arguments.getApplicationUsage()->addCommandLineOption("--modes <num>", "Number of modes set in each StateSet, default 6.");
+    arguments.getApplicationUsage()->addCommandLineOption("--attributes <num>", "Number of attributes set in each StateSet, default 6.");
+    arguments.getApplicationUsage()->addCommandLineOption("--units <num>", "Number of texture units used by the leaf StateSets, default 4.");
+    arguments.getApplicationUsage()->addCommandLineOption("--frames <num>", "Number of frames replayed, default 1000.");
+
+    if (arguments.read("-h") || arguments.read("--help"))
+    {
+        arguments.getApplicationUsage()->write(std::cout);
+        return 1;
+    }
+
+    unsigned int numParents = 64;
+    unsigned int numLeaves = 16;
+    unsigned int numDrawsPerLeaf = 2;
+    unsigned int numModes = 6;
+    unsigned int numAttributes = 6;
+    unsigned int numTextureUnits = 4;
+    unsigned int numFrames = 1000;
+
+    while(arguments.read("--parents", numParents)) {}
+    while(arguments.read("--leaves", numLeaves)) {}
+    while(arguments.read("--draws", numDrawsPerLeaf)) {}
+    while(arguments.read("--modes", numModes)) {}
+    while(arguments.read("--attributes", numAttributes)) {}
+    while(arguments.read("--units", numTextureUnits)) {}
+    while(arguments.read("--frames", numFrames)) {}
+
+    srand(1);
+
+    StateSets stateSets;
+    DrawStream drawStream;
+    osg::ref_ptr<osgUtil::StateGraph> root = createDrawStream(stateSets, drawStream, numParents, numLeaves, numDrawsPerLeaf, numModes, numAttributes, numTextureUnits);
+
+    osg::ref_ptr<osg::State> state = new NullGLState(numTextureUnits);
+
+    s_numAttributesApplied = 0;
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    for(unsigned int frame=0; frame<numFrames; ++frame)
+    {
+        // the same state changes as RenderLeaf::render(), move to the parent of the leaf then apply the leaf's StateSet.
+        osgUtil::StateGraph* previous = 0;
+        for(DrawStream::iterator itr = drawStream.begin();
+            itr != drawStream.end();
+            ++itr)
+        {
+            osgUtil::StateGraph* current = *itr;
+            if (!previous || previous->_parent!=current->_parent)
+            {
+                osgUtil::StateGraph::moveStateGraph(*state, previous ? previous->_parent : 0, current->_parent);
+                state->apply(current->getStateSet());
+            }
+            else if (previous!=current)
+            {
+                state->apply(current->getStateSet());
+            }
+            previous = current;
+        }
+
+        // return to the root of the StateGraph at the end of the frame, as RenderBin::draw() leaves it.
+        if (previous) osgUtil::StateGraph::moveStateGraph(*state, previous->_parent, 0);
+        state->apply();
+    }
+
+    double duration = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    double numDraws = double(drawStream.size())*double(numFrames);
+
+    std::cout<<"StateSets "<<stateSets.size()<<", draws per frame "<<drawStream.size()<<", frames "<<numFrames<<std::endl;
+    std::cout<<"    time per frame         : "<<duration*1000.0/double(numFrames)<<"ms"<<std::endl;
+    std::cout<<"    time per draw          : "<<duration*1.0e9/numDraws<<"ns"<<std::endl;
+    std::cout<<"    attributes applied     : "<<double(s_numAttributesApplied)/double(numFrames)<<" per frame"<<std::endl;
+
+    return 0;
+}
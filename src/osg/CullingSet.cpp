@@ -64,6 +64,64 @@ void CullingSet::popOccludersCurrentMask(NodePath& nodePath)
     }
 }
 
+bool CullingSet::isCulled(const BoundingSphereBatch& batch, bool* culled, Polytope::ClippingMask* frustumMasks)
+{
+    if ((_mask&SHADOW_OCCLUSION_CULLING) && !_occluderList.empty()) return false;
+
+    unsigned int size = batch.size();
+    if (_mask&VIEW_FRUSTUM_CULLING)
+    {
+        // is it outside the view frustum...
+        _frustum.contains(batch, culled, frustumMasks);
+        for(unsigned int i=0; i<size; ++i) culled[i] = !culled[i];
+    }
+    else
+    {
+        for(unsigned int i=0; i<size; ++i)
+        {
+            culled[i] = false;
+            frustumMasks[i] = _frustum.getResultMask();
+        }
+    }
+
+    if (_mask&SMALL_FEATURE_CULLING)
+    {
+        for(unsigned int i=0; i<size; ++i)
+        {
+            if (!culled[i])
+            {
+                BoundingSphere bs = batch.get(i);
+                if (((bs.center()*_pixelSizeVector)*_smallFeatureCullingPixelSize)>bs.radius()) culled[i] = true;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool CullingSet::isCulled(const BoundingBoxBatch& batch, bool* culled, Polytope::ClippingMask* frustumMasks)
+{
+    if ((_mask&SHADOW_OCCLUSION_CULLING) && !_occluderList.empty()) return false;
+
+    unsigned int size = batch.size();
+    if (_mask&VIEW_FRUSTUM_CULLING)
+    {
+        // is it outside the view frustum...
+        _frustum.contains(batch, culled, frustumMasks);
+        for(unsigned int i=0; i<size; ++i) culled[i] = !culled[i];
+    }
+    else
+    {
+        for(unsigned int i=0; i<size; ++i)
+        {
+            culled[i] = false;
+            frustumMasks[i] = _frustum.getResultMask();
+        }
+    }
+
+    return true;
+}
+
 osg::Vec4 CullingSet::computePixelSizeVector(const Viewport& W, const Matrix& P, const Matrix& M)
 {
     // pre adjust P00,P20,P23,P33 by multiplying them by the viewport window matrix.
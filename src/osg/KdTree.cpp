@@ -19,6 +19,13 @@
 
 #include <osg/io_utils>
 
+#include <osg/ParallelTask>
+
+#include <OpenThreads/Thread>
+
+#include <algorithm>
+#include <float.h>
+
 using namespace osg;
 
 //#define VERBOSE_OUTPUT
@@ -31,9 +38,20 @@ using namespace osg;
 struct BuildKdTree
 {
     BuildKdTree(KdTree& kdTree):
-        _kdTree(kdTree) {}
+        _kdTree(kdTree),
+        _collectBounds(false) {}
 
     typedef std::vector< osg::Vec3 >            CenterList;
+
+    struct PrimitiveBound
+    {
+        PrimitiveBound(const osg::BoundingBox& bb, unsigned int index): _bb(bb), _index(index) {}
+
+        osg::BoundingBox    _bb;
+        unsigned int        _index;
+    };
+
+    typedef std::vector< PrimitiveBound >       PrimitiveBoundList;
     typedef std::vector< unsigned int >           Indices;
     typedef std::vector< unsigned int >         AxisStack;
 
@@ -43,6 +61,14 @@ struct BuildKdTree
 
     int divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int nodeIndex, unsigned int level);
 
+    void reorderDepthFirst();
+
+    int copyDepthFirst(const KdTree::KdNodeList& nodes, int nodeIndex, KdTree::KdNodeList& orderedNodes);
+
+    int divideSAH(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, unsigned int start, unsigned int end, unsigned int level, unsigned int numThreads);
+
+    bool splitSAH(const KdTree::BuildOptions& options, unsigned int start, unsigned int end, unsigned int& mid);
+
     KdTree&             _kdTree;
 
     osg::BoundingBox    _bb;
@@ -50,6 +76,9 @@ struct BuildKdTree
     Indices             _primitiveIndices;
     CenterList          _centers;
 
+    bool                _collectBounds;
+    PrimitiveBoundList  _primitiveBounds;
+
 protected:
 
     BuildKdTree& operator = (const BuildKdTree&) { return *this; }
@@ -74,6 +103,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        if (_buildKdTree->_collectBounds) _buildKdTree->_primitiveBounds.push_back(BuildKdTree::PrimitiveBound(bb, _buildKdTree->_centers.size()-1));
     }
 
     inline void operator () (unsigned int p0, unsigned int p1)
@@ -98,6 +128,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        if (_buildKdTree->_collectBounds) _buildKdTree->_primitiveBounds.push_back(BuildKdTree::PrimitiveBound(bb, _buildKdTree->_centers.size()-1));
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2)
@@ -125,6 +156,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        if (_buildKdTree->_collectBounds) _buildKdTree->_primitiveBounds.push_back(BuildKdTree::PrimitiveBound(bb, _buildKdTree->_centers.size()-1));
     }
 
     inline void operator () (unsigned int p0, unsigned int p1, unsigned int p2, unsigned int p3)
@@ -154,6 +186,7 @@ struct PrimitiveIndicesCollector
 
         _buildKdTree->_primitiveIndices.push_back(_buildKdTree->_centers.size());
         _buildKdTree->_centers.push_back(bb.center());
+        if (_buildKdTree->_collectBounds) _buildKdTree->_primitiveBounds.push_back(BuildKdTree::PrimitiveBound(bb, _buildKdTree->_centers.size()-1));
     }
 
     BuildKdTree* _buildKdTree;
@@ -196,19 +229,43 @@ bool BuildKdTree::build(KdTree::BuildOptions& options, osg::Geometry* geometry)
     _primitiveIndices.reserve(estimatedNumTriangles);
     _centers.reserve(estimatedNumTriangles);
 
+    _collectBounds = (options._splitMethod==KdTree::BuildOptions::SPLIT_BY_SAH);
+    if (_collectBounds) _primitiveBounds.reserve(estimatedNumTriangles);
+
     osg::TemplatePrimitiveIndexFunctor<PrimitiveIndicesCollector> collectIndices;
     collectIndices._buildKdTree = this;
     geometry->accept(collectIndices);
 
     _primitiveIndices.reserve(vertices->size());
 
-    KdTree::KdNode node(-1, _primitiveIndices.size());
-    node.bb = _bb;
+    int nodeNum = 0;
+    if (options._splitMethod==KdTree::BuildOptions::SPLIT_BY_SAH)
+    {
+        unsigned int numThreads = options._numThreads>0 ? options._numThreads : static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+        nodeNum = divideSAH(options, _kdTree.getNodes(), 0, _primitiveBounds.size(), 0, numThreads);
+
+        // the primitives were partitioned along with their bounds, so copy the final order back.
+        for(unsigned int i=0; i<_primitiveBounds.size(); ++i)
+        {
+            _primitiveIndices[i] = _primitiveBounds[i]._index;
+        }
+        PrimitiveBoundList().swap(_primitiveBounds);
+    }
+    else
+    {
+        KdTree::KdNode node(-1, _primitiveIndices.size());
+        node.bb = _bb;
 
-    int nodeNum = _kdTree.addNode(node);
+        nodeNum = _kdTree.addNode(node);
 
-    osg::BoundingBox bb = _bb;
-    nodeNum = divide(options, bb, nodeNum, 0);
+        osg::BoundingBox bb = _bb;
+        nodeNum = divide(options, bb, nodeNum, 0);
+
+        reorderDepthFirst();
+    }
+
+    // release the capacity reserved for the estimated number of nodes.
+    KdTree::KdNodeList(_kdTree.getNodes()).swap(_kdTree.getNodes());
 
     osg::KdTree::Indices& primitiveIndices = _kdTree.getPrimitiveIndices();
 
@@ -469,6 +526,290 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 
 }
 
+void BuildKdTree::reorderDepthFirst()
+{
+    KdTree::KdNodeList& nodes = _kdTree.getNodes();
+    if (nodes.empty()) return;
+
+    KdTree::KdNodeList orderedNodes;
+    orderedNodes.reserve(nodes.size());
+
+    copyDepthFirst(nodes, 0, orderedNodes);
+
+    nodes.swap(orderedNodes);
+}
+
+int BuildKdTree::copyDepthFirst(const KdTree::KdNodeList& nodes, int nodeIndex, KdTree::KdNodeList& orderedNodes)
+{
+    int newNodeIndex = static_cast<int>(orderedNodes.size());
+    orderedNodes.push_back(nodes[nodeIndex]);
+
+    const KdTree::KdNode& node = nodes[nodeIndex];
+    if (node.first>=0)
+    {
+        int first = node.first>0 ? copyDepthFirst(nodes, node.first, orderedNodes) : 0;
+        int second = node.second>0 ? copyDepthFirst(nodes, node.second, orderedNodes) : 0;
+
+        orderedNodes[newNodeIndex].first = first;
+        orderedNodes[newNodeIndex].second = second;
+    }
+
+    return newNodeIndex;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Surface area heuristic build
+
+namespace
+{
+
+inline float surfaceArea(const osg::BoundingBox& bb)
+{
+    if (!bb.valid()) return 0.0f;
+    float dx = bb.xMax()-bb.xMin();
+    float dy = bb.yMax()-bb.yMin();
+    float dz = bb.zMax()-bb.zMin();
+    return 2.0f*(dx*dy + dy*dz + dz*dx);
+}
+
+struct SAHBin
+{
+    SAHBin(): count(0) {}
+
+    osg::BoundingBox    bb;
+    unsigned int        count;
+};
+
+struct SAHBinMapping
+{
+    SAHBinMapping(int axis, float minimum, float scale, unsigned int numBins):
+        _axis(axis), _minimum(minimum), _scale(scale), _numBins(numBins) {}
+
+    inline unsigned int operator() (const osg::Vec3& center) const
+    {
+        unsigned int bin = static_cast<unsigned int>((center[_axis]-_minimum)*_scale);
+        return bin<_numBins ? bin : _numBins-1;
+    }
+
+    int             _axis;
+    float           _minimum;
+    float           _scale;
+    unsigned int    _numBins;
+};
+
+struct InLeftBins
+{
+    InLeftBins(const SAHBinMapping& mapping, unsigned int lastLeftBin):
+        _mapping(mapping), _lastLeftBin(lastLeftBin) {}
+
+    inline bool operator() (const BuildKdTree::PrimitiveBound& primitive) const
+    {
+        return _mapping(primitive._bb.center())<=_lastLeftBin;
+    }
+
+    SAHBinMapping   _mapping;
+    unsigned int    _lastLeftBin;
+};
+
+/** Builds the two subtrees of a split at once, the left into the caller's node list and the right into its own.*/
+class SAHSubtreesTask : public osg::ParallelTask
+{
+public:
+
+    SAHSubtreesTask(BuildKdTree& buildKdTree, const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes,
+                    unsigned int start, unsigned int mid, unsigned int end, unsigned int level, unsigned int numThreads):
+        osg::ParallelTask(2),
+        _buildKdTree(buildKdTree),
+        _options(options),
+        _nodes(nodes),
+        _start(start),
+        _mid(mid),
+        _end(end),
+        _level(level),
+        _rightNumThreads(numThreads/2),
+        _leftNumThreads(numThreads-_rightNumThreads),
+        _leftChildIndex(0) {}
+
+    virtual void process(unsigned int i)
+    {
+        if (i==0) _leftChildIndex = _buildKdTree.divideSAH(_options, _nodes, _start, _mid, _level, _leftNumThreads);
+        else _buildKdTree.divideSAH(_options, _rightNodes, _mid, _end, _level, _rightNumThreads);
+    }
+
+    BuildKdTree&                _buildKdTree;
+    const KdTree::BuildOptions& _options;
+    KdTree::KdNodeList&         _nodes;
+    unsigned int                _start;
+    unsigned int                _mid;
+    unsigned int                _end;
+    unsigned int                _level;
+    unsigned int                _rightNumThreads;
+    unsigned int                _leftNumThreads;
+    int                         _leftChildIndex;
+    KdTree::KdNodeList          _rightNodes;
+
+protected:
+
+    SAHSubtreesTask& operator = (const SAHSubtreesTask&) { return *this; }
+};
+
+}
+
+bool BuildKdTree::splitSAH(const KdTree::BuildOptions& options, unsigned int start, unsigned int end, unsigned int& mid)
+{
+    osg::BoundingBox centerBounds;
+    for(unsigned int i=start; i<end; ++i)
+    {
+        centerBounds.expandBy(_primitiveBounds[i]._bb.center());
+    }
+
+    const unsigned int maxNumBins = 64;
+    unsigned int numBins = osg::clampBetween(options._numSAHBins, 2u, maxNumBins);
+
+    // bin the primitives along all three axes in a single pass.
+    SAHBin bins[3][maxNumBins];
+    float scales[3];
+    for(int axis=0; axis<3; ++axis)
+    {
+        float extent = centerBounds._max[axis]-centerBounds._min[axis];
+        scales[axis] = extent>0.0f ? float(numBins)/extent : 0.0f;
+    }
+
+    for(unsigned int i=start; i<end; ++i)
+    {
+        const osg::BoundingBox& bb = _primitiveBounds[i]._bb;
+        osg::Vec3 center = bb.center();
+        for(int axis=0; axis<3; ++axis)
+        {
+            SAHBin& bin = bins[axis][SAHBinMapping(axis, centerBounds._min[axis], scales[axis], numBins)(center)];
+            ++bin.count;
+            bin.bb.expandBy(bb);
+        }
+    }
+
+    float rightAreas[maxNumBins];
+    unsigned int rightCounts[maxNumBins];
+
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    unsigned int bestBin = 0;
+
+    for(int axis=0; axis<3; ++axis)
+    {
+        if (scales[axis]==0.0f) continue;
+
+        // sweep from the right accumulating the cost of everything to the right of each candidate plane.
+        osg::BoundingBox bb;
+        unsigned int count = 0;
+        for(unsigned int b=numBins-1; b>0; --b)
+        {
+            bb.expandBy(bins[axis][b].bb);
+            count += bins[axis][b].count;
+            rightAreas[b] = surfaceArea(bb);
+            rightCounts[b] = count;
+        }
+
+        // then sweep from the left to find the cheapest plane.
+        bb.init();
+        count = 0;
+        for(unsigned int b=0; b<numBins-1; ++b)
+        {
+            bb.expandBy(bins[axis][b].bb);
+            count += bins[axis][b].count;
+
+            if (count==0 || rightCounts[b+1]==0) continue;
+
+            float cost = surfaceArea(bb)*float(count) + rightAreas[b+1]*float(rightCounts[b+1]);
+            if (cost<bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    // all the primitive centers coincide so there is nothing to split.
+    if (bestAxis<0) return false;
+
+    SAHBinMapping mapping(bestAxis, centerBounds._min[bestAxis], scales[bestAxis], numBins);
+
+    PrimitiveBoundList::iterator itr = std::partition(_primitiveBounds.begin()+start, _primitiveBounds.begin()+end, InLeftBins(mapping, bestBin));
+    mid = static_cast<unsigned int>(itr-_primitiveBounds.begin());
+
+    return mid>start && mid<end;
+}
+
+int BuildKdTree::divideSAH(const KdTree::BuildOptions& options, KdTree::KdNodeList& nodes, unsigned int start, unsigned int end, unsigned int level, unsigned int numThreads)
+{
+    int nodeIndex = static_cast<int>(nodes.size());
+    nodes.push_back(KdTree::KdNode(-static_cast<int>(start)-1, end-start));
+
+    unsigned int mid = start;
+    if (end-start<=options._targetNumTrianglesPerLeaf || level>=options._maxNumLevels || !splitSAH(options, start, end, mid))
+    {
+        // leaf is done, now compute bound on it.
+        KdTree::KdNode& node = nodes[nodeIndex];
+        node.bb.init();
+        for(unsigned int i=start; i<end; ++i)
+        {
+            node.bb.expandBy(_primitiveBounds[i]._bb);
+        }
+
+        if (node.bb.valid())
+        {
+            float epsilon = 1e-6f;
+            node.bb._min -= osg::Vec3(epsilon, epsilon, epsilon);
+            node.bb._max += osg::Vec3(epsilon, epsilon, epsilon);
+        }
+
+        return nodeIndex;
+    }
+
+    int leftChildIndex = 0;
+    int rightChildIndex = 0;
+
+    if (numThreads>1 && end-mid>=options._minNumPrimitivesPerThread && mid-start>=options._minNumPrimitivesPerThread)
+    {
+        // build the right subtree in its own node list alongside the left subtree, then append it after the left subtree.
+        osg::ref_ptr<SAHSubtreesTask> task = new SAHSubtreesTask(*this, options, nodes, start, mid, end, level+1, numThreads);
+        osg::ParallelTaskThreadPool::instance()->run(task.get(), numThreads);
+
+        leftChildIndex = task->_leftChildIndex;
+
+        KdTree::KdNodeList& rightNodes = task->_rightNodes;
+        int offset = static_cast<int>(nodes.size());
+        for(KdTree::KdNodeList::iterator itr = rightNodes.begin();
+            itr != rightNodes.end();
+            ++itr)
+        {
+            if (itr->first>0)
+            {
+                itr->first += offset;
+                itr->second += offset;
+            }
+        }
+        nodes.insert(nodes.end(), rightNodes.begin(), rightNodes.end());
+
+        rightChildIndex = offset;
+    }
+    else
+    {
+        leftChildIndex = divideSAH(options, nodes, start, mid, level+1, 1);
+        rightChildIndex = divideSAH(options, nodes, mid, end, level+1, 1);
+    }
+
+    KdTree::KdNode& node = nodes[nodeIndex];
+    node.first = leftChildIndex;
+    node.second = rightChildIndex;
+    node.bb.init();
+    node.bb.expandBy(nodes[leftChildIndex].bb);
+    node.bb.expandBy(nodes[rightChildIndex].bb);
+
+    return nodeIndex;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // KdTree::BuildOptions
@@ -476,7 +817,11 @@ int BuildKdTree::divide(KdTree::BuildOptions& options, osg::BoundingBox& bb, int
 KdTree::BuildOptions::BuildOptions():
         _numVerticesProcessed(0),
         _targetNumTrianglesPerLeaf(4),
-        _maxNumLevels(32)
+        _maxNumLevels(32),
+        _splitMethod(SPLIT_AT_MIDPOINT),
+        _numSAHBins(16),
+        _numThreads(1),
+        _minNumPrimitivesPerThread(16384)
 {
 }
 
@@ -507,8 +852,62 @@ bool KdTree::build(BuildOptions& options, osg::Geometry* geometry)
 ////////////////////////////////////////////////////////////////////////////////
 //
 // KdTreeBuilder
+
+namespace
+{
+
+struct KdTreeBuildJob
+{
+    KdTreeBuildJob(osg::Geometry* geometry, osg::KdTree* kdTree, const KdTree::BuildOptions& options):
+        _geometry(geometry),
+        _kdTree(kdTree),
+        _options(options),
+        _built(false) {}
+
+    osg::Geometry*              _geometry;
+    osg::ref_ptr<osg::KdTree>   _kdTree;
+    KdTree::BuildOptions        _options;
+    bool                        _built;
+};
+
+typedef std::vector<KdTreeBuildJob> KdTreeBuildJobs;
+
+struct MoreVertices
+{
+    bool operator() (const osg::ref_ptr<osg::Geometry>& lhs, const osg::ref_ptr<osg::Geometry>& rhs) const
+    {
+        unsigned int lhsSize = lhs->getVertexArray() ? lhs->getVertexArray()->getNumElements() : 0;
+        unsigned int rhsSize = rhs->getVertexArray() ? rhs->getVertexArray()->getNumElements() : 0;
+        return lhsSize>rhsSize;
+    }
+};
+
+class KdTreeBuildTask : public osg::ParallelTask
+{
+public:
+
+    KdTreeBuildTask(KdTreeBuildJobs& jobs):
+        osg::ParallelTask(jobs.size()),
+        _jobs(jobs) {}
+
+    virtual void process(unsigned int i)
+    {
+        KdTreeBuildJob& job = _jobs[i];
+        job._built = job._kdTree->build(job._options, job._geometry);
+    }
+
+protected:
+
+    KdTreeBuildTask& operator = (const KdTreeBuildTask&) { return *this; }
+
+    KdTreeBuildJobs&        _jobs;
+};
+
+}
+
 KdTreeBuilder::KdTreeBuilder():
-    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN)
+    osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+    _traversalDepth(0)
 {
     _kdTreePrototype = new osg::KdTree;
 }
@@ -517,15 +916,35 @@ KdTreeBuilder::KdTreeBuilder(const KdTreeBuilder& rhs):
     osg::Object(rhs),
     osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
     _buildOptions(rhs._buildOptions),
-    _kdTreePrototype(rhs._kdTreePrototype)
+    _kdTreePrototype(rhs._kdTreePrototype),
+    _traversalDepth(0)
 {
 }
 
+void KdTreeBuilder::apply(osg::Node& node)
+{
+    ++_traversalDepth;
+
+    traverse(node);
+
+    --_traversalDepth;
+
+    // build the geometries collected once we're back at the top of the traversal.
+    if (_traversalDepth==0 && !_geometriesToBuild.empty()) buildCollectedKdTrees();
+}
+
 void KdTreeBuilder::apply(osg::Geometry& geometry)
 {
     osg::KdTree* previous = dynamic_cast<osg::KdTree*>(geometry.getShape());
     if (previous) return;
 
+    if (_buildOptions._numThreads!=1)
+    {
+        _geometriesToBuild.push_back(&geometry);
+        if (_traversalDepth==0) buildCollectedKdTrees();
+        return;
+    }
+
     osg::ref_ptr<osg::KdTree> kdTree = osg::clone(_kdTreePrototype.get());
 
     if (kdTree->build(_buildOptions, &geometry))
@@ -533,3 +952,71 @@ void KdTreeBuilder::apply(osg::Geometry& geometry)
         geometry.setShape(kdTree.get());
     }
 }
+
+void KdTreeBuilder::buildCollectedKdTrees()
+{
+    if (_geometriesToBuild.empty()) return;
+
+    unsigned int numThreads = _buildOptions._numThreads>0 ? _buildOptions._numThreads : static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    // remove duplicates of shared geometries, and start with the largest so the threads finish close together.
+    std::sort(_geometriesToBuild.begin(), _geometriesToBuild.end());
+    _geometriesToBuild.erase(std::unique(_geometriesToBuild.begin(), _geometriesToBuild.end()), _geometriesToBuild.end());
+    std::stable_sort(_geometriesToBuild.begin(), _geometriesToBuild.end(), MoreVertices());
+
+    KdTree::BuildOptions serialOptions(_buildOptions);
+    serialOptions._numThreads = 1;
+    serialOptions._numVerticesProcessed = 0;
+
+    KdTreeBuildJobs largeJobs, smallJobs;
+    for(GeometryList::iterator itr = _geometriesToBuild.begin();
+        itr != _geometriesToBuild.end();
+        ++itr)
+    {
+        osg::Geometry* geometry = itr->get();
+        if (dynamic_cast<osg::KdTree*>(geometry->getShape())) continue;
+
+        // only the SAH build divides a single geometry between threads, so with the other split methods large
+        // geometries go into the thread pool alongside the small ones, largest first.
+        unsigned int numVertices = geometry->getVertexArray() ? geometry->getVertexArray()->getNumElements() : 0;
+        if (numThreads>1 && _buildOptions._splitMethod==KdTree::BuildOptions::SPLIT_BY_SAH && numVertices>=2*_buildOptions._minNumPrimitivesPerThread)
+        {
+            // large geometries are divided between the threads within their own build.
+            KdTreeBuildJob job(geometry, osg::clone(_kdTreePrototype.get()), serialOptions);
+            job._options._numThreads = numThreads;
+            largeJobs.push_back(job);
+        }
+        else
+        {
+            smallJobs.push_back(KdTreeBuildJob(geometry, osg::clone(_kdTreePrototype.get()), serialOptions));
+        }
+    }
+
+    for(KdTreeBuildJobs::iterator itr = largeJobs.begin();
+        itr != largeJobs.end();
+        ++itr)
+    {
+        itr->_built = itr->_kdTree->build(itr->_options, itr->_geometry);
+    }
+
+    if (!smallJobs.empty())
+    {
+        osg::ref_ptr<KdTreeBuildTask> task = new KdTreeBuildTask(smallJobs);
+        osg::ParallelTaskThreadPool::instance()->run(task.get(), numThreads);
+    }
+
+    // attach the KdTrees on the calling thread now all the builds are complete.
+    for(int pass=0; pass<2; ++pass)
+    {
+        KdTreeBuildJobs& jobs = pass==0 ? largeJobs : smallJobs;
+        for(KdTreeBuildJobs::iterator itr = jobs.begin();
+            itr != jobs.end();
+            ++itr)
+        {
+            _buildOptions._numVerticesProcessed += itr->_options._numVerticesProcessed;
+            if (itr->_built) itr->_geometry->setShape(itr->_kdTree.get());
+        }
+    }
+
+    _geometriesToBuild.clear();
+}
@@ -0,0 +1,153 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2006 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osg/ParallelTask>
+#include <osg/Math>
+
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+
+using namespace osg;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ParallelTask
+//
+ParallelTask::ParallelTask(unsigned int numItems):
+    Referenced(true),
+    _numItems(numItems),
+    _completed(false)
+{
+}
+
+ParallelTask::~ParallelTask()
+{
+}
+
+void ParallelTask::run()
+{
+    for(unsigned int i = (++_nextItem)-1; i<_numItems; i = (++_nextItem)-1)
+    {
+        process(i);
+
+        // only the thread completing the last item needs the lock.
+        if ((++_numItemsProcessed)==_numItems)
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_completionMutex);
+            _completed = true;
+            _completionCondition.broadcast();
+        }
+    }
+}
+
+void ParallelTask::waitForCompletion()
+{
+    if (_numItems==0) return;
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_completionMutex);
+    while(!_completed)
+    {
+        _completionCondition.wait(&_completionMutex);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// ParallelTaskThreadPool
+//
+namespace
+{
+
+class ParallelTaskOperation : public Operation
+{
+public:
+
+    ParallelTaskOperation(ParallelTask* task):
+        Operation("ParallelTaskOperation", false),
+        _task(task) {}
+
+    virtual void operator () (Object*)
+    {
+        _task->run();
+    }
+
+    // keeps the task alive for operations that only reach a pool thread after the task has completed.
+    ref_ptr<ParallelTask> _task;
+};
+
+}
+
+ParallelTaskThreadPool* ParallelTaskThreadPool::instance()
+{
+    static ref_ptr<ParallelTaskThreadPool> s_threadPool = new ParallelTaskThreadPool;
+    return s_threadPool.get();
+}
+
+ParallelTaskThreadPool::ParallelTaskThreadPool():
+    Referenced(true),
+    _operationQueue(new OperationQueue)
+{
+}
+
+ParallelTaskThreadPool::~ParallelTaskThreadPool()
+{
+    for(Threads::iterator itr = _threads.begin();
+        itr != _threads.end();
+        ++itr)
+    {
+        (*itr)->setDone(true);
+    }
+
+    for(Threads::iterator itr = _threads.begin();
+        itr != _threads.end();
+        ++itr)
+    {
+        (*itr)->cancel();
+    }
+}
+
+void ParallelTaskThreadPool::run(ParallelTask* task, unsigned int numThreads)
+{
+    if (!task) return;
+
+    if (numThreads==0) numThreads = static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    if (numThreads>1)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+        // size the pool before limiting the threads to the number of items, so nested tasks have the threads they need too.
+        while(_threads.size()<numThreads-1)
+        {
+            ref_ptr<OperationThread> thread = new OperationThread;
+            thread->setOperationQueue(_operationQueue.get());
+            thread->startThread();
+            _threads.push_back(thread);
+        }
+
+        for(unsigned int i=1; i<numThreads && i<task->getNumItems(); ++i)
+        {
+            _operationQueue->add(new ParallelTaskOperation(task));
+        }
+    }
+
+    // the calling thread takes its share of the items too.
+    task->run();
+    task->waitForCompletion();
+}
+
+unsigned int ParallelTaskThreadPool::getNumThreads() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return static_cast<unsigned int>(_threads.size());
+}
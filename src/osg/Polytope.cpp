@@ -14,6 +14,17 @@
 #include <osg/Polytope>
 #include <osg/Notify>
 
+#include <float.h>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define OSG_POLYTOPE_USE_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    #include <arm_neon.h>
+    #define OSG_POLYTOPE_USE_NEON
+#endif
+
 using namespace osg;
 
 bool Polytope::contains(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::Vec3f& v2) const
@@ -99,3 +110,387 @@ bool Polytope::contains(const osg::Vec3f& v0, const osg::Vec3f& v1, const osg::V
     //OSG_NOTICE<<"Polytope::contains() triangle within Polytope, src.size()="<<src.size()<<std::endl;
     return true;
 }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Batched bounding volume tests
+//
+namespace
+{
+
+// four lanes of 32 bit masks, all bits set for true in comparisons, mapped onto SSE2 or NEON when available.
+struct Mask4
+{
+#if defined(OSG_POLYTOPE_USE_SSE)
+    __m128i _v;
+
+    Mask4() {}
+    Mask4(__m128i v): _v(v) {}
+    explicit Mask4(unsigned int m): _v(_mm_set1_epi32(static_cast<int>(m))) {}
+
+    inline Mask4 operator | (const Mask4& rhs) const { return Mask4(_mm_or_si128(_v, rhs._v)); }
+    inline Mask4 operator & (const Mask4& rhs) const { return Mask4(_mm_and_si128(_v, rhs._v)); }
+    inline Mask4 operator ^ (const Mask4& rhs) const { return Mask4(_mm_xor_si128(_v, rhs._v)); }
+
+    // this & ~rhs
+    inline Mask4 andNot(const Mask4& rhs) const { return Mask4(_mm_andnot_si128(rhs._v, _v)); }
+
+    // a bit per lane, set when the lane's top bit is set.
+    inline unsigned int lanes() const { return _mm_movemask_ps(_mm_castsi128_ps(_v)); }
+
+    inline void store(unsigned int* ptr) const { _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), _v); }
+#elif defined(OSG_POLYTOPE_USE_NEON)
+    uint32x4_t _v;
+
+    Mask4() {}
+    Mask4(uint32x4_t v): _v(v) {}
+    explicit Mask4(unsigned int m): _v(vdupq_n_u32(m)) {}
+
+    inline Mask4 operator | (const Mask4& rhs) const { return Mask4(vorrq_u32(_v, rhs._v)); }
+    inline Mask4 operator & (const Mask4& rhs) const { return Mask4(vandq_u32(_v, rhs._v)); }
+    inline Mask4 operator ^ (const Mask4& rhs) const { return Mask4(veorq_u32(_v, rhs._v)); }
+
+    // this & ~rhs
+    inline Mask4 andNot(const Mask4& rhs) const { return Mask4(vbicq_u32(_v, rhs._v)); }
+
+    // a bit per lane, set when the lane's top bit is set.
+    inline unsigned int lanes() const
+    {
+        uint32x4_t bits = vshrq_n_u32(_v, 31);
+        return vgetq_lane_u32(bits, 0) | (vgetq_lane_u32(bits, 1)<<1) | (vgetq_lane_u32(bits, 2)<<2) | (vgetq_lane_u32(bits, 3)<<3);
+    }
+
+    inline void store(unsigned int* ptr) const { vst1q_u32(ptr, _v); }
+#else
+    unsigned int _v[4];
+
+    Mask4() {}
+    explicit Mask4(unsigned int m) { _v[0] = _v[1] = _v[2] = _v[3] = m; }
+    Mask4(unsigned int a, unsigned int b, unsigned int c, unsigned int d) { _v[0] = a; _v[1] = b; _v[2] = c; _v[3] = d; }
+
+    inline Mask4 operator | (const Mask4& rhs) const { return Mask4(_v[0]|rhs._v[0], _v[1]|rhs._v[1], _v[2]|rhs._v[2], _v[3]|rhs._v[3]); }
+    inline Mask4 operator & (const Mask4& rhs) const { return Mask4(_v[0]&rhs._v[0], _v[1]&rhs._v[1], _v[2]&rhs._v[2], _v[3]&rhs._v[3]); }
+    inline Mask4 operator ^ (const Mask4& rhs) const { return Mask4(_v[0]^rhs._v[0], _v[1]^rhs._v[1], _v[2]^rhs._v[2], _v[3]^rhs._v[3]); }
+
+    // this & ~rhs
+    inline Mask4 andNot(const Mask4& rhs) const { return Mask4(_v[0]&~rhs._v[0], _v[1]&~rhs._v[1], _v[2]&~rhs._v[2], _v[3]&~rhs._v[3]); }
+
+    // a bit per lane, set when the lane's top bit is set.
+    inline unsigned int lanes() const { return (_v[0]>>31) | ((_v[1]>>31)<<1) | ((_v[2]>>31)<<2) | ((_v[3]>>31)<<3); }
+
+    inline void store(unsigned int* ptr) const { ptr[0] = _v[0]; ptr[1] = _v[1]; ptr[2] = _v[2]; ptr[3] = _v[3]; }
+#endif
+};
+
+// four floats operated on together, mapped onto SSE2 or NEON when available.
+struct Float4
+{
+#if defined(OSG_POLYTOPE_USE_SSE)
+    __m128 _v;
+
+    Float4() {}
+    Float4(__m128 v): _v(v) {}
+    explicit Float4(float f): _v(_mm_set1_ps(f)) {}
+
+    static inline Float4 load(const float* ptr) { return Float4(_mm_loadu_ps(ptr)); }
+
+    inline Float4 operator + (const Float4& rhs) const { return Float4(_mm_add_ps(_v, rhs._v)); }
+    inline Float4 operator - (const Float4& rhs) const { return Float4(_mm_sub_ps(_v, rhs._v)); }
+    inline Float4 operator * (const Float4& rhs) const { return Float4(_mm_mul_ps(_v, rhs._v)); }
+    inline Float4 operator - () const { return Float4(_mm_xor_ps(_v, _mm_set1_ps(-0.0f))); }
+
+    inline Mask4 operator < (const Float4& rhs) const { return Mask4(_mm_castps_si128(_mm_cmplt_ps(_v, rhs._v))); }
+    inline Mask4 operator > (const Float4& rhs) const { return Mask4(_mm_castps_si128(_mm_cmpgt_ps(_v, rhs._v))); }
+    inline Mask4 operator <= (const Float4& rhs) const { return Mask4(_mm_castps_si128(_mm_cmple_ps(_v, rhs._v))); }
+    inline Mask4 operator >= (const Float4& rhs) const { return Mask4(_mm_castps_si128(_mm_cmpge_ps(_v, rhs._v))); }
+
+    static inline Float4 absolute(const Float4& f) { return Float4(_mm_andnot_ps(_mm_set1_ps(-0.0f), f._v)); }
+#elif defined(OSG_POLYTOPE_USE_NEON)
+    float32x4_t _v;
+
+    Float4() {}
+    Float4(float32x4_t v): _v(v) {}
+    explicit Float4(float f): _v(vdupq_n_f32(f)) {}
+
+    static inline Float4 load(const float* ptr) { return Float4(vld1q_f32(ptr)); }
+
+    inline Float4 operator + (const Float4& rhs) const { return Float4(vaddq_f32(_v, rhs._v)); }
+    inline Float4 operator - (const Float4& rhs) const { return Float4(vsubq_f32(_v, rhs._v)); }
+    inline Float4 operator * (const Float4& rhs) const { return Float4(vmulq_f32(_v, rhs._v)); }
+    inline Float4 operator - () const { return Float4(vnegq_f32(_v)); }
+
+    inline Mask4 operator < (const Float4& rhs) const { return Mask4(vcltq_f32(_v, rhs._v)); }
+    inline Mask4 operator > (const Float4& rhs) const { return Mask4(vcgtq_f32(_v, rhs._v)); }
+    inline Mask4 operator <= (const Float4& rhs) const { return Mask4(vcleq_f32(_v, rhs._v)); }
+    inline Mask4 operator >= (const Float4& rhs) const { return Mask4(vcgeq_f32(_v, rhs._v)); }
+
+    static inline Float4 absolute(const Float4& f) { return Float4(vabsq_f32(f._v)); }
+#else
+    float _v[4];
+
+    Float4() {}
+    explicit Float4(float f) { _v[0] = _v[1] = _v[2] = _v[3] = f; }
+    Float4(float a, float b, float c, float d) { _v[0] = a; _v[1] = b; _v[2] = c; _v[3] = d; }
+
+    static inline Float4 load(const float* ptr) { return Float4(ptr[0], ptr[1], ptr[2], ptr[3]); }
+
+    inline Float4 operator + (const Float4& rhs) const { return Float4(_v[0]+rhs._v[0], _v[1]+rhs._v[1], _v[2]+rhs._v[2], _v[3]+rhs._v[3]); }
+    inline Float4 operator - (const Float4& rhs) const { return Float4(_v[0]-rhs._v[0], _v[1]-rhs._v[1], _v[2]-rhs._v[2], _v[3]-rhs._v[3]); }
+    inline Float4 operator * (const Float4& rhs) const { return Float4(_v[0]*rhs._v[0], _v[1]*rhs._v[1], _v[2]*rhs._v[2], _v[3]*rhs._v[3]); }
+    inline Float4 operator - () const { return Float4(-_v[0], -_v[1], -_v[2], -_v[3]); }
+
+    inline Mask4 operator < (const Float4& rhs) const { return Mask4(_v[0]<rhs._v[0] ? ~0u : 0u, _v[1]<rhs._v[1] ? ~0u : 0u, _v[2]<rhs._v[2] ? ~0u : 0u, _v[3]<rhs._v[3] ? ~0u : 0u); }
+    inline Mask4 operator > (const Float4& rhs) const { return Mask4(_v[0]>rhs._v[0] ? ~0u : 0u, _v[1]>rhs._v[1] ? ~0u : 0u, _v[2]>rhs._v[2] ? ~0u : 0u, _v[3]>rhs._v[3] ? ~0u : 0u); }
+    inline Mask4 operator <= (const Float4& rhs) const { return Mask4(_v[0]<=rhs._v[0] ? ~0u : 0u, _v[1]<=rhs._v[1] ? ~0u : 0u, _v[2]<=rhs._v[2] ? ~0u : 0u, _v[3]<=rhs._v[3] ? ~0u : 0u); }
+    inline Mask4 operator >= (const Float4& rhs) const { return Mask4(_v[0]>=rhs._v[0] ? ~0u : 0u, _v[1]>=rhs._v[1] ? ~0u : 0u, _v[2]>=rhs._v[2] ? ~0u : 0u, _v[3]>=rhs._v[3] ? ~0u : 0u); }
+
+    static inline Float4 absolute(const Float4& f) { return Float4(fabsf(f._v[0]), fabsf(f._v[1]), fabsf(f._v[2]), fabsf(f._v[3])); }
+#endif
+};
+
+// The kernels evaluate the plane equations in single precision, Plane::distance() in the plane's precision, so the kernels
+// only decide the planes where the distance is further from the threshold than a bound on the rounding error, scaled from
+// the largest magnitude of the terms summed for any of the planes. Anything closer is decided by retesting with the per
+// plane checks of the unbatched tests, so the batched results always match the unbatched ones.
+const float s_roundingErrorScale = 16.0f*FLT_EPSILON;
+
+// a plane of the polytope that is enabled in the current mask, in the form used by the kernels.
+struct BatchPlane
+{
+    Float4 a, b, c, d;
+    bool positiveA, positiveB, positiveC;
+    Mask4 selector;
+};
+
+// set up the planes enabled in mask, and the largest normal component and distance of them scaled for the rounding error bound.
+unsigned int setUpBatchPlanes(const Polytope::PlaneList& planeList, Polytope::ClippingMask mask, BatchPlane* planes, Float4& maxAbsNormal, Float4& maxAbsD)
+{
+    float maxNormal = 0.0f, maxD = 0.0f;
+    unsigned int numPlanes = 0;
+    Polytope::ClippingMask selector_mask = 0x1;
+    for(Polytope::PlaneList::const_iterator itr=planeList.begin();
+        itr!=planeList.end() && selector_mask!=0;
+        ++itr)
+    {
+        if (mask&selector_mask)
+        {
+            const Plane& plane = *itr;
+            float a = float(plane[0]), b = float(plane[1]), c = float(plane[2]), d = float(plane[3]);
+
+            BatchPlane& bp = planes[numPlanes++];
+            bp.a = Float4(a);
+            bp.b = Float4(b);
+            bp.c = Float4(c);
+            bp.d = Float4(d);
+            maxNormal = osg::maximum(maxNormal, osg::maximum(fabsf(a), osg::maximum(fabsf(b), fabsf(c))));
+            maxD = osg::maximum(maxD, fabsf(d));
+            bp.positiveA = plane[0]>=0.0;
+            bp.positiveB = plane[1]>=0.0;
+            bp.positiveC = plane[2]>=0.0;
+            bp.selector = Mask4(selector_mask);
+        }
+        selector_mask <<= 1;
+    }
+
+    maxAbsNormal = Float4(maxNormal*s_roundingErrorScale);
+    maxAbsD = Float4(maxD*s_roundingErrorScale);
+    return numPlanes;
+}
+
+// exact test of a single bounding volume, as done by the inline Polytope::contains().
+template<class BV>
+bool containsMasked(const Polytope::PlaneList& planeList, Polytope::ClippingMask mask, const BV& bv, Polytope::ClippingMask& resultMask)
+{
+    resultMask = mask;
+    Polytope::ClippingMask selector_mask = 0x1;
+    for(Polytope::PlaneList::const_iterator itr=planeList.begin();
+        itr!=planeList.end();
+        ++itr)
+    {
+        if (resultMask&selector_mask)
+        {
+            int res=itr->intersect(bv);
+            if (res<0) return false;
+            else if (res>0) resultMask ^= selector_mask;
+        }
+        selector_mask <<= 1;
+    }
+    return true;
+}
+
+// copy the results of a block of four into the output arrays, retesting the lanes the kernel couldn't decide.
+template<class Batch>
+unsigned int storeBlock(const Polytope::PlaneList& planeList, Polytope::ClippingMask mask, const Batch& batch, unsigned int i,
+                        unsigned int outside, unsigned int uncertain, const Mask4& laneMasks,
+                        bool* contained, Polytope::ClippingMask* resultMasks)
+{
+    unsigned int masks[4];
+    laneMasks.store(masks);
+
+    unsigned int numContained = 0;
+    for(unsigned int l=0; l<4; ++l)
+    {
+        bool inside = (outside&(1<<l))==0;
+        contained[i+l] = inside;
+        resultMasks[i+l] = masks[l];
+        numContained += inside ? 1 : 0;
+    }
+
+    if (uncertain)
+    {
+        for(unsigned int l=0; l<4; ++l)
+        {
+            if (uncertain&(1<<l))
+            {
+                if (contained[i+l]) --numContained;
+                contained[i+l] = containsMasked(planeList, mask, batch.get(i+l), resultMasks[i+l]);
+                if (contained[i+l]) ++numContained;
+            }
+        }
+    }
+    return numContained;
+}
+
+}
+
+unsigned int Polytope::contains(const BoundingSphereBatch& batch, bool* contained, ClippingMask* resultMasks) const
+{
+    unsigned int size = batch.size();
+    ClippingMask mask = _maskStack.back();
+    if (!mask)
+    {
+        for(unsigned int i=0; i<size; ++i)
+        {
+            contained[i] = true;
+            resultMasks[i] = _resultMask;
+        }
+        return size;
+    }
+
+    BatchPlane planes[sizeof(ClippingMask)*8];
+    Float4 maxAbsNormal, maxAbsD;
+    unsigned int numPlanes = setUpBatchPlanes(_planeList, mask, planes, maxAbsNormal, maxAbsD);
+    const Mask4 allLanes(~0u);
+
+    const Float4 zero(0.0f);
+    const Float4 errorScale(s_roundingErrorScale);
+
+    unsigned int numContained = 0;
+    unsigned int i = 0;
+    for(; i+4<=size; i+=4)
+    {
+        Float4 x = Float4::load(&batch._x[i]);
+        Float4 y = Float4::load(&batch._y[i]);
+        Float4 z = Float4::load(&batch._z[i]);
+        Float4 radius = Float4::load(&batch._radius[i]);
+
+        // the distances are decided when further than the rounding error bound from the radius either side of the plane.
+        Float4 error = (Float4::absolute(x) + Float4::absolute(y) + Float4::absolute(z))*maxAbsNormal + maxAbsD + Float4::absolute(radius)*errorScale;
+        Float4 upper = radius + error;
+        Float4 lower = radius - error;
+        Float4 negUpper = -upper;
+
+        Mask4 laneMasks(mask);
+        Mask4 outside(0u);
+
+        // invalid spheres, including NaN radii, are left to the unbatched test.
+        Mask4 uncertain = (zero<=radius) ^ allLanes;
+
+        for(unsigned int p=0; p<numPlanes; ++p)
+        {
+            const BatchPlane& plane = planes[p];
+            Float4 distance = plane.a*x + plane.b*y + plane.c*z + plane.d;
+
+            Mask4 planeInside = distance > upper;
+            Mask4 planeOutside = distance < negUpper;
+            Mask4 planeIntersects = Float4::absolute(distance) < lower;
+
+            // once a lane is outside the remaining planes don't affect its result, as contains() returns on the first plane outside.
+            laneMasks = laneMasks ^ (planeInside & plane.selector).andNot(outside);
+            uncertain = uncertain | ((planeInside | planeOutside | planeIntersects | outside) ^ allLanes);
+            outside = outside | planeOutside;
+        }
+
+        numContained += storeBlock(_planeList, mask, batch, i, outside.lanes(), uncertain.lanes(), laneMasks, contained, resultMasks);
+    }
+
+    for(; i<size; ++i)
+    {
+        contained[i] = containsMasked(_planeList, mask, batch.get(i), resultMasks[i]);
+        if (contained[i]) ++numContained;
+    }
+
+    return numContained;
+}
+
+unsigned int Polytope::contains(const BoundingBoxBatch& batch, bool* contained, ClippingMask* resultMasks) const
+{
+    unsigned int size = batch.size();
+    ClippingMask mask = _maskStack.back();
+    if (!mask)
+    {
+        for(unsigned int i=0; i<size; ++i)
+        {
+            contained[i] = true;
+            resultMasks[i] = _resultMask;
+        }
+        return size;
+    }
+
+    BatchPlane planes[sizeof(ClippingMask)*8];
+    Float4 maxAbsNormal, maxAbsD;
+    unsigned int numPlanes = setUpBatchPlanes(_planeList, mask, planes, maxAbsNormal, maxAbsD);
+    const Mask4 allLanes(~0u);
+
+    unsigned int numContained = 0;
+    unsigned int i = 0;
+    for(; i+4<=size; i+=4)
+    {
+        Float4 xMin = Float4::load(&batch._xMin[i]);
+        Float4 yMin = Float4::load(&batch._yMin[i]);
+        Float4 zMin = Float4::load(&batch._zMin[i]);
+        Float4 xMax = Float4::load(&batch._xMax[i]);
+        Float4 yMax = Float4::load(&batch._yMax[i]);
+        Float4 zMax = Float4::load(&batch._zMax[i]);
+
+        // the distances are decided when further than the rounding error bound, covering either corner, from the plane.
+        Float4 error = (Float4::absolute(xMin) + Float4::absolute(xMax) +
+                        Float4::absolute(yMin) + Float4::absolute(yMax) +
+                        Float4::absolute(zMin) + Float4::absolute(zMax))*maxAbsNormal + maxAbsD;
+        Float4 negError = -error;
+
+        Mask4 laneMasks(mask);
+        Mask4 outside(0u);
+
+        // inverted boxes, including those with NaN extents, are left to the unbatched test.
+        Mask4 uncertain = ((xMin<=xMax) & (yMin<=yMax) & (zMin<=zMax)) ^ allLanes;
+
+        for(unsigned int p=0; p<numPlanes; ++p)
+        {
+            const BatchPlane& plane = planes[p];
+
+            // the corners of the box lowest and highest relative to the plane, as Plane::intersect(const BoundingBox&).
+            Float4 lowerDistance = plane.a*(plane.positiveA ? xMin : xMax) + plane.b*(plane.positiveB ? yMin : yMax) + plane.c*(plane.positiveC ? zMin : zMax) + plane.d;
+            Float4 upperDistance = plane.a*(plane.positiveA ? xMax : xMin) + plane.b*(plane.positiveB ? yMax : yMin) + plane.c*(plane.positiveC ? zMax : zMin) + plane.d;
+
+            Mask4 planeInside = lowerDistance > error;
+            Mask4 planeOutside = upperDistance < negError;
+            Mask4 planeIntersects = (lowerDistance < negError) & (upperDistance > error);
+
+            // once a lane is outside the remaining planes don't affect its result, as contains() returns on the first plane outside.
+            laneMasks = laneMasks ^ (planeInside & plane.selector).andNot(outside);
+            uncertain = uncertain | ((planeInside | planeOutside | planeIntersects | outside) ^ allLanes);
+            outside = outside | planeOutside;
+        }
+
+        numContained += storeBlock(_planeList, mask, batch, i, outside.lanes(), uncertain.lanes(), laneMasks, contained, resultMasks);
+    }
+
+    for(; i<size; ++i)
+    {
+        contained[i] = containsMasked(_planeList, mask, batch.get(i), resultMasks[i]);
+        if (contained[i]) ++numContained;
+    }
+
+    return numContained;
+}
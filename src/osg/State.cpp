@@ -470,11 +470,9 @@ void State::releaseGLObjects()
     _textureModeMapList.clear();
 
     // release any cached attributes
-    for(AttributeMap::iterator aitr = _attributeMap.begin();
-        aitr != _attributeMap.end();
-        ++aitr)
+    for(unsigned int index=0; index<_attributeMap.size(); ++index)
     {
-        AttributeStack& as = aitr->second;
+        AttributeStack& as = _attributeMap.stack(index);
         if (as.global_default_attribute.valid())
         {
             as.global_default_attribute->releaseGLObjects(this);
@@ -488,11 +486,9 @@ void State::releaseGLObjects()
         ++itr)
     {
         AttributeMap& attributeMap = *itr;
-        for(AttributeMap::iterator aitr = attributeMap.begin();
-            aitr != attributeMap.end();
-            ++aitr)
+        for(unsigned int index=0; index<attributeMap.size(); ++index)
         {
-            AttributeStack& as = aitr->second;
+            AttributeStack& as = attributeMap.stack(index);
             if (as.global_default_attribute.valid())
             {
                 as.global_default_attribute->releaseGLObjects(this);
@@ -508,34 +504,31 @@ void State::reset()
     OSG_NOTICE<<std::endl<<"State::reset() *************************** "<<std::endl;
 
 #if 1
-    for(ModeMap::iterator mitr=_modeMap.begin();
-        mitr!=_modeMap.end();
-        ++mitr)
+    for(unsigned int index=0; index<_modeMap.size(); ++index)
     {
-        ModeStack& ms = mitr->second;
+        ModeStack& ms = _modeMap.stack(index);
         ms.valueVec.clear();
         ms.last_applied_value = !ms.global_default_value;
-        ms.changed = true;
     }
+    _modeMap.setAllChanged();
 #else
     _modeMap.clear();
 #endif
 
-    _modeMap[GL_DEPTH_TEST].global_default_value = true;
-    _modeMap[GL_DEPTH_TEST].changed = true;
+    unsigned int depthTestIndex = _modeMap.insert(GL_DEPTH_TEST);
+    _modeMap.stack(depthTestIndex).global_default_value = true;
+    _modeMap.setChanged(depthTestIndex);
 
     // go through all active StateAttribute's, setting to change to force update,
     // the idea is to leave only the global defaults left.
-    for(AttributeMap::iterator aitr=_attributeMap.begin();
-        aitr!=_attributeMap.end();
-        ++aitr)
+    for(unsigned int index=0; index<_attributeMap.size(); ++index)
     {
-        AttributeStack& as = aitr->second;
+        AttributeStack& as = _attributeMap.stack(index);
         as.attributeVec.clear();
         as.last_applied_attribute = NULL;
         as.last_applied_shadercomponent = NULL;
-        as.changed = true;
     }
+    _attributeMap.setAllChanged();
 
     // we can do a straight clear, we aren't interested in GL_DEPTH_TEST defaults in texture modes.
     for(TextureModeMapList::iterator tmmItr=_textureModeMapList.begin();
@@ -552,16 +545,14 @@ void State::reset()
     {
         AttributeMap& attributeMap = *tamItr;
         // go through all active StateAttribute's, setting to change to force update.
-        for(AttributeMap::iterator aitr=attributeMap.begin();
-            aitr!=attributeMap.end();
-            ++aitr)
+        for(unsigned int index=0; index<attributeMap.size(); ++index)
         {
-            AttributeStack& as = aitr->second;
+            AttributeStack& as = attributeMap.stack(index);
             as.attributeVec.clear();
             as.last_applied_attribute = NULL;
             as.last_applied_shadercomponent = NULL;
-            as.changed = true;
         }
+        attributeMap.setAllChanged();
     }
 
     _stateStateStack.clear();
@@ -824,23 +815,18 @@ void State::captureCurrentState(StateSet& stateset) const
     // empty the stateset first.
     stateset.clear();
 
-    for(ModeMap::const_iterator mitr=_modeMap.begin();
-        mitr!=_modeMap.end();
-        ++mitr)
+    for(unsigned int index=0; index<_modeMap.size(); ++index)
     {
-        // note GLMode = mitr->first
-        const ModeStack& ms = mitr->second;
+        const ModeStack& ms = _modeMap.stack(index);
         if (!ms.valueVec.empty())
         {
-            stateset.setMode(mitr->first,ms.valueVec.back());
+            stateset.setMode(_modeMap.key(index),ms.valueVec.back());
         }
     }
 
-    for(AttributeMap::const_iterator aitr=_attributeMap.begin();
-        aitr!=_attributeMap.end();
-        ++aitr)
+    for(unsigned int index=0; index<_attributeMap.size(); ++index)
     {
-        const AttributeStack& as = aitr->second;
+        const AttributeStack& as = _attributeMap.stack(index);
         if (!as.attributeVec.empty())
         {
             stateset.setAttribute(const_cast<StateAttribute*>(as.attributeVec.back().first));
@@ -1007,13 +993,9 @@ void State::applyShaderComposition()
 
             // OSG_NOTICE<<"State::applyShaderComposition() : _attributeMap.size()=="<<_attributeMap.size()<<std::endl;
 
-            for(AttributeMap::iterator itr = _attributeMap.begin();
-                itr != _attributeMap.end();
-                ++itr)
+            for(unsigned int index=0; index<_attributeMap.size(); ++index)
             {
-                // OSG_NOTICE<<"  itr->first="<<itr->first.first<<", "<<itr->first.second<<std::endl;
-
-                AttributeStack& as = itr->second;
+                AttributeStack& as = _attributeMap.stack(index);
                 if (as.last_applied_shadercomponent)
                 {
                     shaderComponents.push_back(const_cast<ShaderComponent*>(as.last_applied_shadercomponent));
@@ -1098,25 +1080,26 @@ const StateAttribute* State::getLastAppliedTextureAttribute(unsigned int unit,St
 
 void State::haveAppliedMode(ModeMap& modeMap,StateAttribute::GLMode mode,StateAttribute::GLModeValue value)
 {
-    ModeStack& ms = modeMap[mode];
+    unsigned int index = modeMap.insert(mode);
 
-    ms.last_applied_value = value & StateAttribute::ON;
+    modeMap.stack(index).last_applied_value = value & StateAttribute::ON;
 
     // will need to disable this mode on next apply so set it to changed.
-    ms.changed = true;
+    modeMap.setChanged(index);
 }
 
 /** mode has been set externally, update state to reflect this setting.*/
 void State::haveAppliedMode(ModeMap& modeMap,StateAttribute::GLMode mode)
 {
-    ModeStack& ms = modeMap[mode];
+    unsigned int index = modeMap.insert(mode);
+    ModeStack& ms = modeMap.stack(index);
 
     // don't know what last applied value is can't apply it.
     // assume that it has changed by toggle the value of last_applied_value.
     ms.last_applied_value = !ms.last_applied_value;
 
     // will need to disable this mode on next apply so set it to changed.
-    ms.changed = true;
+    modeMap.setChanged(index);
 }
 
 /** attribute has been applied externally, update state to reflect this setting.*/
@@ -1124,35 +1107,34 @@ void State::haveAppliedAttribute(AttributeMap& attributeMap,const StateAttribute
 {
     if (attribute)
     {
-        AttributeStack& as = attributeMap[attribute->getTypeMemberPair()];
+        unsigned int index = attributeMap.insert(attribute->getTypeMemberPair());
 
-        as.last_applied_attribute = attribute;
+        attributeMap.stack(index).last_applied_attribute = attribute;
 
         // will need to update this attribute on next apply so set it to changed.
-        as.changed = true;
+        attributeMap.setChanged(index);
     }
 }
 
 void State::haveAppliedAttribute(AttributeMap& attributeMap,StateAttribute::Type type, unsigned int member)
 {
 
-    AttributeMap::iterator itr = attributeMap.find(StateAttribute::TypeMemberPair(type,member));
-    if (itr!=attributeMap.end())
+    int index = attributeMap.find(StateAttribute::TypeMemberPair(type,member));
+    if (index>=0)
     {
-        AttributeStack& as = itr->second;
-        as.last_applied_attribute = 0L;
+        attributeMap.stack(index).last_applied_attribute = 0L;
 
         // will need to update this attribute on next apply so set it to changed.
-        as.changed = true;
+        attributeMap.setChanged(index);
     }
 }
 
 bool State::getLastAppliedMode(const ModeMap& modeMap,StateAttribute::GLMode mode) const
 {
-    ModeMap::const_iterator itr = modeMap.find(mode);
-    if (itr!=modeMap.end())
+    int index = modeMap.find(mode);
+    if (index>=0)
     {
-        const ModeStack& ms = itr->second;
+        const ModeStack& ms = modeMap.stack(index);
         return ms.last_applied_value;
     }
     else
@@ -1163,10 +1145,10 @@ bool State::getLastAppliedMode(const ModeMap& modeMap,StateAttribute::GLMode mod
 
 const StateAttribute* State::getLastAppliedAttribute(const AttributeMap& attributeMap,StateAttribute::Type type, unsigned int member) const
 {
-    AttributeMap::const_iterator itr = attributeMap.find(StateAttribute::TypeMemberPair(type,member));
-    if (itr!=attributeMap.end())
+    int index = attributeMap.find(StateAttribute::TypeMemberPair(type,member));
+    if (index>=0)
     {
-        const AttributeStack& as = itr->second;
+        const AttributeStack& as = attributeMap.stack(index);
         return as.last_applied_attribute;
     }
     else
@@ -1177,42 +1159,34 @@ const StateAttribute* State::getLastAppliedAttribute(const AttributeMap& attribu
 
 void State::dirtyAllModes()
 {
-    for(ModeMap::iterator mitr=_modeMap.begin();
-        mitr!=_modeMap.end();
-        ++mitr)
+    for(unsigned int index=0; index<_modeMap.size(); ++index)
     {
-        ModeStack& ms = mitr->second;
+        ModeStack& ms = _modeMap.stack(index);
         ms.last_applied_value = !ms.last_applied_value;
-        ms.changed = true;
-
     }
+    _modeMap.setAllChanged();
 
     for(TextureModeMapList::iterator tmmItr=_textureModeMapList.begin();
         tmmItr!=_textureModeMapList.end();
         ++tmmItr)
     {
-        for(ModeMap::iterator mitr=tmmItr->begin();
-            mitr!=tmmItr->end();
-            ++mitr)
+        ModeMap& modeMap = *tmmItr;
+        for(unsigned int index=0; index<modeMap.size(); ++index)
         {
-            ModeStack& ms = mitr->second;
+            ModeStack& ms = modeMap.stack(index);
             ms.last_applied_value = !ms.last_applied_value;
-            ms.changed = true;
-
         }
+        modeMap.setAllChanged();
     }
 }
 
 void State::dirtyAllAttributes()
 {
-    for(AttributeMap::iterator aitr=_attributeMap.begin();
-        aitr!=_attributeMap.end();
-        ++aitr)
+    for(unsigned int index=0; index<_attributeMap.size(); ++index)
     {
-        AttributeStack& as = aitr->second;
-        as.last_applied_attribute = 0;
-        as.changed = true;
+        _attributeMap.stack(index).last_applied_attribute = 0;
     }
+    _attributeMap.setAllChanged();
 
 
     for(TextureAttributeMapList::iterator tamItr=_textureAttributeMapList.begin();
@@ -1220,14 +1194,11 @@ void State::dirtyAllAttributes()
         ++tamItr)
     {
         AttributeMap& attributeMap = *tamItr;
-        for(AttributeMap::iterator aitr=attributeMap.begin();
-            aitr!=attributeMap.end();
-            ++aitr)
+        for(unsigned int index=0; index<attributeMap.size(); ++index)
         {
-            AttributeStack& as = aitr->second;
-            as.last_applied_attribute = 0;
-            as.changed = true;
+            attributeMap.stack(index).last_applied_attribute = 0;
         }
+        attributeMap.setAllChanged();
     }
 
 }
@@ -1750,7 +1721,6 @@ void State::drawQuads(GLint first, GLsizei count, GLsizei primCount)
 void State::ModeStack::print(std::ostream& fout) const
 {
     fout<<"    valid = "<<valid<<std::endl;
-    fout<<"    changed = "<<changed<<std::endl;
     fout<<"    last_applied_value = "<<last_applied_value<<std::endl;
     fout<<"    global_default_value = "<<global_default_value<<std::endl;
     fout<<"    valueVec { "<<std::endl;
@@ -1766,7 +1736,6 @@ void State::ModeStack::print(std::ostream& fout) const
 
 void State::AttributeStack::print(std::ostream& fout) const
 {
-    fout<<"    changed = "<<changed<<std::endl;
     fout<<"    last_applied_attribute = "<<last_applied_attribute;
     if (last_applied_attribute) fout<<", "<<last_applied_attribute->className()<<", "<<last_applied_attribute->getName()<<std::endl;
     fout<<"    last_applied_shadercomponent = "<<last_applied_shadercomponent<<std::endl;
@@ -1850,23 +1819,21 @@ void State::print(std::ostream& fout) const
         Program::AttribBindingList  _attributeBindingList;
 #endif
         fout<<"ModeMap _modeMap {"<<std::endl;
-        for(ModeMap::const_iterator itr = _modeMap.begin();
-            itr != _modeMap.end();
-            ++itr)
+        for(unsigned int index=0; index<_modeMap.size(); ++index)
         {
-            fout<<"  GLMode="<<itr->first<<", ModeStack {"<<std::endl;
-            itr->second.print(fout);
+            fout<<"  GLMode="<<_modeMap.key(index)<<", ModeStack {"<<std::endl;
+            fout<<"    changed = "<<_modeMap.isChanged(index)<<std::endl;
+            _modeMap.stack(index).print(fout);
             fout<<"  }"<<std::endl;
         }
         fout<<"}"<<std::endl;
 
         fout<<"AttributeMap _attributeMap {"<<std::endl;
-        for(AttributeMap::const_iterator itr = _attributeMap.begin();
-            itr != _attributeMap.end();
-            ++itr)
+        for(unsigned int index=0; index<_attributeMap.size(); ++index)
         {
-            fout<<"  TypeMemberPaid=("<<itr->first.first<<", "<<itr->first.second<<") AttributeStack {"<<std::endl;
-            itr->second.print(fout);
+            fout<<"  TypeMemberPaid=("<<_attributeMap.key(index).first<<", "<<_attributeMap.key(index).second<<") AttributeStack {"<<std::endl;
+            fout<<"    changed = "<<_attributeMap.isChanged(index)<<std::endl;
+            _attributeMap.stack(index).print(fout);
             fout<<"  }"<<std::endl;
         }
         fout<<"}"<<std::endl;
@@ -1988,8 +1955,8 @@ void State::getDefineString(std::string& shaderDefineStr, const osg::ShaderPragm
                 }
                 else
                 {
-                    ModeMap::const_iterator mm_itr = _modeMap.find(mode);
-                    bool mode_enabled = (mm_itr!=_modeMap.end() && mm_itr->second.last_applied_value);
+                    int mm_index = _modeMap.find(mode);
+                    bool mode_enabled = (mm_index>=0 && _modeMap.stack(mm_index).last_applied_value);
 
                     shaderDefineStr += "#define ";
                     shaderDefineStr += modeStr;
@@ -2004,12 +1971,10 @@ void State::getDefineString(std::string& shaderDefineStr, const osg::ShaderPragm
         {
             const ModeMap& modeMap = _textureModeMapList[i];
             const ModeDefineMap& modeDefineMap = _textureModeDefineMapList[i];
-            for(ModeMap::const_iterator tm_itr = modeMap.begin();
-                tm_itr != modeMap.end();
-                ++tm_itr)
+            for(unsigned int index=0; index<modeMap.size(); ++index)
             {
-                GLenum mode = tm_itr->first;
-                if (tm_itr->second.last_applied_value)
+                GLenum mode = modeMap.key(index);
+                if (modeMap.stack(index).last_applied_value)
                 {
                     ModeDefineMap::const_iterator mdm_itr = modeDefineMap.find(mode);
                     if (mdm_itr!=modeDefineMap.end()) shaderDefineStr += mdm_itr->second;
@@ -2035,8 +2000,8 @@ void State::getDefineString(std::string& shaderDefineStr, const osg::ShaderPragm
                         // OSG_NOTICE<<"Need to look up mode ["<<modeStr<<"]"<<std::endl;
 
                         StateAttribute::GLMode mode = m_itr->second;
-                        ModeMap::const_iterator mm_itr = modeMap.find(mode);
-                        bool mode_enabled = mm_itr!=modeMap.end() && mm_itr->second.last_applied_value;
+                        int mm_index = modeMap.find(mode);
+                        bool mode_enabled = mm_index>=0 && modeMap.stack(mm_index).last_applied_value;
 
                         shaderDefineStr += "#define ";
                         shaderDefineStr += modeStr;
@@ -14,6 +14,7 @@
 #include <osg/State>
 #include <osg/NodeVisitor>
 #include <osg/Notify>
+#include <osg/Hash>
 
 #include <algorithm>
 
@@ -24,6 +25,11 @@ StateAttribute::StateAttribute()
 {
 }
 
+unsigned int StateAttribute::computeHash() const
+{
+    return hashCombine(hashCombine(0u, className()), static_cast<unsigned int>(getType()));
+}
+
 
 void StateAttribute::addParent(osg::StateSet* object)
 {
@@ -15,6 +15,7 @@
 #include <osg/StateSet>
 #include <osg/State>
 #include <osg/Notify>
+#include <osg/Hash>
 
 #include <osg/AlphaFunc>
 #include <osg/Material>
@@ -603,6 +604,90 @@ int StateSet::compare(const StateSet& rhs,bool compareAttributeContents) const
     return 0;
 }
 
+namespace
+{
+unsigned int hashModes(unsigned int hash, const StateSet::ModeList& modes)
+{
+    hash = hashCombine(hash, static_cast<unsigned int>(modes.size()));
+    for(StateSet::ModeList::const_iterator itr = modes.begin();
+        itr != modes.end();
+        ++itr)
+    {
+        hash = hashCombine(hash, static_cast<unsigned int>(itr->first));
+        hash = hashCombine(hash, static_cast<unsigned int>(itr->second));
+    }
+    return hash;
+}
+
+unsigned int hashAttributes(unsigned int hash, const StateSet::AttributeList& attributes, bool hashAttributeContents)
+{
+    hash = hashCombine(hash, static_cast<unsigned int>(attributes.size()));
+    for(StateSet::AttributeList::const_iterator itr = attributes.begin();
+        itr != attributes.end();
+        ++itr)
+    {
+        hash = hashCombine(hash, static_cast<unsigned int>(itr->first.first));
+        hash = hashCombine(hash, itr->first.second);
+        if (hashAttributeContents) hash = hashCombine(hash, itr->second.first->computeHash());
+        else hash = hashCombine(hash, static_cast<const void*>(itr->second.first.get()));
+        hash = hashCombine(hash, static_cast<unsigned int>(itr->second.second));
+    }
+    return hash;
+}
+}
+
+unsigned int StateSet::computeHash(bool hashAttributeContents) const
+{
+    unsigned int hash = hashCombine(0u, static_cast<unsigned int>(_binMode));
+    if (_binMode != INHERIT_RENDERBIN_DETAILS)
+    {
+        hash = hashCombine(hash, _binNum);
+        hash = hashCombine(hash, _binName);
+    }
+
+    hash = hashCombine(hash, static_cast<unsigned int>(_textureAttributeList.size()));
+    for(TextureAttributeList::const_iterator itr = _textureAttributeList.begin();
+        itr != _textureAttributeList.end();
+        ++itr)
+    {
+        hash = hashAttributes(hash, *itr, hashAttributeContents);
+    }
+
+    hash = hashAttributes(hash, _attributeList, hashAttributeContents);
+
+    hash = hashCombine(hash, static_cast<unsigned int>(_textureModeList.size()));
+    for(TextureModeList::const_iterator itr = _textureModeList.begin();
+        itr != _textureModeList.end();
+        ++itr)
+    {
+        hash = hashModes(hash, *itr);
+    }
+
+    hash = hashModes(hash, _modeList);
+
+    hash = hashCombine(hash, static_cast<unsigned int>(_uniformList.size()));
+    for(UniformList::const_iterator itr = _uniformList.begin();
+        itr != _uniformList.end();
+        ++itr)
+    {
+        hash = hashCombine(hash, itr->first);
+        hash = hashCombine(hash, itr->second.first->computeHash());
+        hash = hashCombine(hash, static_cast<unsigned int>(itr->second.second));
+    }
+
+    hash = hashCombine(hash, static_cast<unsigned int>(_defineList.size()));
+    for(DefineList::const_iterator itr = _defineList.begin();
+        itr != _defineList.end();
+        ++itr)
+    {
+        hash = hashCombine(hash, itr->first);
+        hash = hashCombine(hash, itr->second.first);
+        hash = hashCombine(hash, static_cast<unsigned int>(itr->second.second));
+    }
+
+    return hash;
+}
+
 int StateSet::compareModes(const ModeList& lhs,const ModeList& rhs)
 {
     ModeList::const_iterator lhs_mode_itr = lhs.begin();
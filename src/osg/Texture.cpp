@@ -22,6 +22,7 @@
 #include <osg/TextureRectangle>
 #include <osg/Texture1D>
 #include <osg/ContextData>
+#include <osg/Hash>
 
 #include <OpenThreads/ScopedLock>
 #include <OpenThreads/Mutex>
@@ -1337,6 +1338,35 @@ int Texture::compareTexture(const Texture& rhs) const
     return 0;
 }
 
+unsigned int Texture::computeHash() const
+{
+    // _internalFormat is only compared when set on both textures so is left out of the hash.
+    unsigned int hash = StateAttribute::computeHash();
+    hash = hashCombine(hash, static_cast<unsigned int>(_wrap_s));
+    hash = hashCombine(hash, static_cast<unsigned int>(_wrap_t));
+    hash = hashCombine(hash, static_cast<unsigned int>(_wrap_r));
+    hash = hashCombine(hash, static_cast<unsigned int>(_min_filter));
+    hash = hashCombine(hash, static_cast<unsigned int>(_mag_filter));
+    hash = hashCombine(hash, _maxAnisotropy);
+    hash = hashCombine(hash, _minlod);
+    hash = hashCombine(hash, _maxlod);
+    hash = hashCombine(hash, _lodbias);
+    for(unsigned int i=0; i<4; ++i) hash = hashCombine(hash, _swizzle[i]);
+    hash = hashCombine(hash, _useHardwareMipMapGeneration);
+    hash = hashCombine(hash, static_cast<unsigned int>(_internalFormatMode));
+    hash = hashCombine(hash, static_cast<unsigned int>(_sourceFormat));
+    hash = hashCombine(hash, static_cast<unsigned int>(_sourceType));
+    hash = hashCombine(hash, _use_shadow_comparison);
+    hash = hashCombine(hash, static_cast<unsigned int>(_shadow_compare_func));
+    hash = hashCombine(hash, static_cast<unsigned int>(_shadow_texture_mode));
+    hash = hashCombine(hash, _shadow_ambient);
+    hash = hashCombine(hash, _unrefImageDataAfterApply);
+    hash = hashCombine(hash, _clientStorageHint);
+    hash = hashCombine(hash, _resizeNonPowerOfTwoHint);
+    hash = hashCombine(hash, static_cast<unsigned int>(_internalFormatType));
+    return hash;
+}
+
 int Texture::compareTextureObjects(const Texture& rhs) const
 {
     if (_textureObjectBuffer.size()<rhs._textureObjectBuffer.size()) return -1;
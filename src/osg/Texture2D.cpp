@@ -16,6 +16,7 @@
 #include <osg/State>
 #include <osg/ContextData>
 #include <osg/Notify>
+#include <osg/Hash>
 
 using namespace osg;
 
@@ -107,6 +108,25 @@ int Texture2D::compare(const StateAttribute& sa) const
     return 0; // passed all the above comparison macros, must be equal.
 }
 
+unsigned int Texture2D::computeHash() const
+{
+    // hash the image parameters that Image::compare(..) checks rather than the file name,
+    // as images sharing the same data compare equal regardless of their file names.
+    unsigned int hash = Texture::computeHash();
+    hash = hashCombine(hash, _image.valid());
+    if (_image.valid())
+    {
+        hash = hashCombine(hash, _image->s());
+        hash = hashCombine(hash, _image->t());
+        hash = hashCombine(hash, _image->getInternalTextureFormat());
+        hash = hashCombine(hash, static_cast<unsigned int>(_image->getPixelFormat()));
+        hash = hashCombine(hash, static_cast<unsigned int>(_image->getDataType()));
+        hash = hashCombine(hash, _image->getPacking());
+    }
+    hash = hashCombine(hash, static_cast<const void*>(_subloadCallback.get()));
+    return hash;
+}
+
 void Texture2D::setImage(Image* image)
 {
     if (_image == image) return;
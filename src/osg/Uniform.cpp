@@ -23,6 +23,7 @@
 #include <osg/StateSet>
 
 #include <osg/Timer>
+#include <osg/Hash>
 
 #include <limits.h>
 #include <algorithm>
@@ -71,6 +72,11 @@ int UniformBase::compareData(const UniformBase&) const
     return 0;
 }
 
+unsigned int UniformBase::computeHash() const
+{
+    return hashCombine(hashCombine(0u, className()), getName());
+}
+
 void UniformBase::setName( const std::string& name )
 {
     if (_name==name) return;
@@ -424,7 +430,7 @@ bool Uniform::setArray( Int64Array* array )
 
 int Uniform::compare(const UniformBase& ub_rhs) const
 {
-    if (typeid(this)!=typeid(&ub_rhs)) return (this<&ub_rhs);
+    if (typeid(*this)!=typeid(ub_rhs)) return (this<&ub_rhs) ? -1 : 1;
 
     const Uniform& rhs = reinterpret_cast<const Uniform&>(ub_rhs);
 
@@ -442,11 +448,30 @@ int Uniform::compare(const UniformBase& ub_rhs) const
     return compareData( rhs );
 }
 
+unsigned int Uniform::computeHash() const
+{
+    unsigned int hash = UniformBase::computeHash();
+    hash = hashCombine(hash, static_cast<unsigned int>(_type));
+    hash = hashCombine(hash, _numElements);
+
+    // compareData(..) uses memcmp so hashing the raw bytes is consistent with it.
+    const Array* array = 0;
+    if (_floatArray.valid()) array = _floatArray.get();
+    else if (_doubleArray.valid()) array = _doubleArray.get();
+    else if (_intArray.valid()) array = _intArray.get();
+    else if (_uintArray.valid()) array = _uintArray.get();
+    else if (_int64Array.valid()) array = _int64Array.get();
+    else if (_uint64Array.valid()) array = _uint64Array.get();
+
+    if (array) hash = hashBytes(hash, array->getDataPointer(), array->getTotalDataSize());
+    return hash;
+}
+
 int Uniform::compareData(const UniformBase& ub_rhs) const
 {
     // caller must ensure that _type==rhs._type
 
-    if (typeid(this)!=typeid(&ub_rhs)) return (this<&ub_rhs);
+    if (typeid(*this)!=typeid(ub_rhs)) return (this<&ub_rhs) ? -1 : 1;
 
     const Uniform& rhs = reinterpret_cast<const Uniform&>(ub_rhs);
 
@@ -13,10 +13,13 @@
 // Written by Wang Rui, (C) 2010
 
 #include <osg/Notify>
+#include <osg/ParallelTask>
 #include <osgDB/Registry>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <OpenThreads/Atomic>
 #include <sstream>
+#include <string.h>
 
 using namespace osgDB;
 
@@ -48,6 +51,363 @@ public:
 
 REGISTER_COMPRESSOR( "null", NullCompressor )
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// BlockCompressor
+//
+namespace
+{
+// block headers are always little endian so files can be moved between platforms.
+void writeUInt32( std::ostream& fout, unsigned int value )
+{
+    char bytes[4];
+    for ( unsigned int i=0; i<4; ++i ) bytes[i] = char((value>>(i*8))&0xff);
+    fout.write( bytes, 4 );
+}
+
+bool readUInt32( std::istream& fin, unsigned int& value )
+{
+    unsigned char bytes[4];
+    fin.read( (char*)bytes, 4 );
+    if ( fin.gcount()!=4 ) return false;
+    value = bytes[0] | (bytes[1]<<8) | (bytes[2]<<16) | (static_cast<unsigned int>(bytes[3])<<24);
+    return true;
+}
+
+const unsigned int BLOCK_FORMAT_VERSION = 1;
+
+struct BlockOperation
+{
+    virtual ~BlockOperation() {}
+    virtual bool operator() ( unsigned int block ) = 0;
+};
+
+class BlockOperationTask : public osg::ParallelTask
+{
+public:
+    BlockOperationTask( BlockOperation& operation, unsigned int numBlocks ):
+        osg::ParallelTask(numBlocks), _operation(operation) {}
+
+    virtual void process( unsigned int block )
+    {
+        if ( !_operation(block) ) ++_numFailed;
+    }
+
+    OpenThreads::Atomic     _numFailed;
+
+protected:
+    BlockOperationTask& operator = (const BlockOperationTask&) { return *this; }
+
+    BlockOperation&         _operation;
+};
+
+bool runBlockOperation( BlockOperation& operation, unsigned int numBlocks, unsigned int numThreads )
+{
+    osg::ref_ptr<BlockOperationTask> task = new BlockOperationTask( operation, numBlocks );
+    osg::ParallelTaskThreadPool::instance()->run( task.get(), numThreads );
+    return static_cast<unsigned int>(task->_numFailed)==0;
+}
+
+struct CompressBlocksOperation : public BlockOperation
+{
+    CompressBlocksOperation( const BlockCompressor& compressor, const std::string& src, std::vector<std::string>& blocks ):
+        _compressor(compressor), _src(src), _blocks(blocks) {}
+
+    virtual bool operator() ( unsigned int block )
+    {
+        unsigned int blockSize = _compressor.getBlockSize();
+        std::string::size_type start = std::string::size_type(block)*blockSize;
+        unsigned int size = static_cast<unsigned int>(osg::minimum<std::string::size_type>(blockSize, _src.size()-start));
+
+        std::string& dst = _blocks[block];
+        if ( !_compressor.compressBlock(_src.data()+start, size, dst) ) return false;
+
+        // store blocks that don't compress as they are, a block whose compressed size equals its size is stored.
+        if ( dst.size()>=size ) dst.assign( _src.data()+start, size );
+        return true;
+    }
+
+    const BlockCompressor&      _compressor;
+    const std::string&          _src;
+    std::vector<std::string>&   _blocks;
+
+protected:
+    CompressBlocksOperation& operator = (const CompressBlocksOperation&) { return *this; }
+};
+
+bool decompressOrCopyBlock( const BlockCompressor& compressor, const char* src, const BlockCompressor::BlockInfo& block, char* dst )
+{
+    if ( block._compressedSize==block._uncompressedSize )
+    {
+        memcpy( dst, src, block._uncompressedSize );
+        return true;
+    }
+    return compressor.decompressBlock( src, block._compressedSize, dst, block._uncompressedSize );
+}
+
+struct DecompressBlocksOperation : public BlockOperation
+{
+    DecompressBlocksOperation( const BlockCompressor& compressor, const BlockCompressor::BlockTable& blocks, const std::string& src, char* dst ):
+        _compressor(compressor), _blocks(blocks), _src(src), _dst(dst) {}
+
+    virtual bool operator() ( unsigned int block )
+    {
+        const BlockCompressor::BlockInfo& info = _blocks[block];
+        std::string::size_type dstOffset = std::string::size_type(block)*_blocks[0]._uncompressedSize;
+        return decompressOrCopyBlock( _compressor, _src.data()+info._offset, info, _dst+dstOffset );
+    }
+
+    const BlockCompressor&              _compressor;
+    const BlockCompressor::BlockTable&  _blocks;
+    const std::string&                  _src;
+    char*                               _dst;
+
+protected:
+    DecompressBlocksOperation& operator = (const DecompressBlocksOperation&) { return *this; }
+};
+}
+
+BlockCompressor::BlockCompressor():
+    _blockSize(1024*1024),
+    _numThreads(0)
+{
+}
+
+bool BlockCompressor::compress( std::ostream& fout, const std::string& src )
+{
+    unsigned int blockSize = _blockSize;
+    std::string::size_type numBlocks = (src.size()+blockSize-1)/blockSize;
+    if ( numBlocks>0xffffffffu )
+    {
+        OSG_WARN << "BlockCompressor::compress(): too much data for the block size." << std::endl;
+        return false;
+    }
+
+    std::vector<std::string> blocks( numBlocks );
+    CompressBlocksOperation operation( *this, src, blocks );
+    if ( !runBlockOperation(operation, static_cast<unsigned int>(numBlocks), _numThreads) ) return false;
+
+    // header, then the size of each block before and after compression, then the blocks.
+    writeUInt32( fout, BLOCK_FORMAT_VERSION );
+    writeUInt32( fout, blockSize );
+    writeUInt32( fout, static_cast<unsigned int>(numBlocks) );
+    for ( std::string::size_type i=0; i<numBlocks; ++i )
+    {
+        writeUInt32( fout, static_cast<unsigned int>(osg::minimum<std::string::size_type>(blockSize, src.size()-i*blockSize)) );
+        writeUInt32( fout, static_cast<unsigned int>(blocks[i].size()) );
+    }
+
+    for ( std::vector<std::string>::iterator itr=blocks.begin(); itr!=blocks.end(); ++itr )
+    {
+        fout.write( itr->data(), itr->size() );
+    }
+    return !fout.fail();
+}
+
+bool BlockCompressor::readBlockTable( std::istream& fin, BlockTable& blocks )
+{
+    unsigned int version = 0, blockSize = 0, numBlocks = 0;
+    if ( !readUInt32(fin, version) || !readUInt32(fin, blockSize) || !readUInt32(fin, numBlocks) ) return false;
+    if ( version!=BLOCK_FORMAT_VERSION )
+    {
+        OSG_WARN << "BlockCompressor::readBlockTable(): unsupported block format version " << version << std::endl;
+        return false;
+    }
+
+    blocks.clear();
+    unsigned long long offset = 0;
+    for ( unsigned int i=0; i<numBlocks; ++i )
+    {
+        BlockInfo block;
+        if ( !readUInt32(fin, block._uncompressedSize) || !readUInt32(fin, block._compressedSize) ) return false;
+
+        // every block but the last is a whole block.
+        if ( block._uncompressedSize>blockSize || (i+1<numBlocks && block._uncompressedSize!=blockSize) ) return false;
+
+        block._offset = offset;
+        offset += block._compressedSize;
+        blocks.push_back( block );
+    }
+    return true;
+}
+
+bool BlockCompressor::readBlock( std::istream& fin, std::streampos dataStart, const BlockInfo& block, std::string& target )
+{
+    std::string src( block._compressedSize, 0 );
+    fin.seekg( dataStart + std::streamoff(block._offset) );
+    if ( block._compressedSize>0 ) fin.read( &src[0], block._compressedSize );
+    if ( fin.fail() ) return false;
+
+    target.resize( block._uncompressedSize );
+    if ( block._uncompressedSize==0 ) return true;
+    return decompressOrCopyBlock( *this, src.data(), block, &target[0] );
+}
+
+bool BlockCompressor::decompress( std::istream& fin, std::string& target )
+{
+    BlockTable blocks;
+    if ( !readBlockTable(fin, blocks) ) return false;
+    if ( blocks.empty() ) return true;
+
+    std::string::size_type compressedSize = blocks.back()._offset + blocks.back()._compressedSize;
+    std::string::size_type uncompressedSize = std::string::size_type(blocks.size()-1)*blocks[0]._uncompressedSize + blocks.back()._uncompressedSize;
+
+    std::string src( compressedSize, 0 );
+    if ( compressedSize>0 )
+    {
+        fin.read( &src[0], compressedSize );
+        if ( std::string::size_type(fin.gcount())!=compressedSize ) return false;
+    }
+
+    std::string::size_type start = target.size();
+    target.resize( start+uncompressedSize );
+    if ( uncompressedSize==0 ) return true;
+
+    DecompressBlocksOperation operation( *this, blocks, src, &target[start] );
+    return runBlockOperation( operation, static_cast<unsigned int>(blocks.size()), _numThreads );
+}
+
+// LZ4 block format codec, fast to compress and very fast to decompress at a lower ratio than zlib.
+// Blocks are compatible with LZ4_decompress_safe() so the data can be read by other tools.
+class LZ4Compressor : public BlockCompressor
+{
+public:
+    LZ4Compressor() {}
+
+    virtual bool compressBlock( const char* source, unsigned int size, std::string& dst ) const
+    {
+        const unsigned char* src = reinterpret_cast<const unsigned char*>(source);
+        const unsigned int hashBits = 14;
+        std::vector<int> table( 1<<hashBits, -1 );
+
+        dst.clear();
+        dst.reserve( size + size/255 + 16 );
+
+        unsigned int anchor = 0;
+
+        // the format requires the last match to start 12 bytes and end 5 bytes before the end of the block.
+        if ( size>=13 )
+        {
+            const unsigned int matchStartLimit = size-12;
+            const unsigned int matchEndLimit = size-5;
+            unsigned int ip = 0;
+            while ( ip<matchStartLimit )
+            {
+                unsigned int sequence = readSequence( src+ip );
+                unsigned int hash = (sequence*2654435761u)>>(32-hashBits);
+                int ref = table[hash];
+                table[hash] = int(ip);
+
+                if ( ref<0 || ip-unsigned(ref)>65535 || readSequence(src+ref)!=sequence )
+                {
+                    // skip faster through data that isn't compressing.
+                    ip += 1 + ((ip-anchor)>>6);
+                    continue;
+                }
+
+                unsigned int matchLength = 4;
+                while ( ip+matchLength<matchEndLimit && src[ref+matchLength]==src[ip+matchLength] ) ++matchLength;
+
+                unsigned int literalLength = ip-anchor;
+                writeToken( dst, literalLength, matchLength-4 );
+                if ( literalLength>=15 ) writeLength( dst, literalLength-15 );
+                dst.append( source+anchor, literalLength );
+
+                unsigned int offset = ip-unsigned(ref);
+                dst.push_back( char(offset&0xff) );
+                dst.push_back( char(offset>>8) );
+                if ( matchLength-4>=15 ) writeLength( dst, matchLength-4-15 );
+
+                ip += matchLength;
+                anchor = ip;
+            }
+        }
+
+        unsigned int literalLength = size-anchor;
+        writeToken( dst, literalLength, 0 );
+        if ( literalLength>=15 ) writeLength( dst, literalLength-15 );
+        dst.append( source+anchor, literalLength );
+        return true;
+    }
+
+    virtual bool decompressBlock( const char* source, unsigned int srcSize, char* destination, unsigned int dstSize ) const
+    {
+        const unsigned char* src = reinterpret_cast<const unsigned char*>(source);
+        unsigned char* dst = reinterpret_cast<unsigned char*>(destination);
+        unsigned int ip = 0, op = 0;
+        while ( ip<srcSize )
+        {
+            unsigned int token = src[ip++];
+
+            unsigned int literalLength = token>>4;
+            if ( literalLength==15 && !readLength(src, srcSize, ip, literalLength) ) return false;
+            if ( literalLength>srcSize-ip || literalLength>dstSize-op ) return false;
+            memcpy( dst+op, src+ip, literalLength );
+            ip += literalLength;
+            op += literalLength;
+
+            // the last sequence has literals only.
+            if ( ip==srcSize ) break;
+
+            if ( srcSize-ip<2 ) return false;
+            unsigned int offset = src[ip] | (src[ip+1]<<8);
+            ip += 2;
+            if ( offset==0 || offset>op ) return false;
+
+            unsigned int matchLength = token&15;
+            if ( matchLength==15 && !readLength(src, srcSize, ip, matchLength) ) return false;
+            matchLength += 4;
+            if ( matchLength>dstSize-op ) return false;
+
+            // matches may overlap the bytes they produce, repeating the last offset bytes, so copy
+            // the repeating pattern in chunks that double in size and never overlap their source.
+            const unsigned char* match = dst+op-offset;
+            unsigned int copied = 0;
+            while ( copied<matchLength )
+            {
+                unsigned int size = osg::minimum( matchLength-copied, offset+copied );
+                memcpy( dst+op+copied, match, size );
+                copied += size;
+            }
+            op += matchLength;
+        }
+        return op==dstSize;
+    }
+
+protected:
+    static unsigned int readSequence( const unsigned char* ptr )
+    {
+        unsigned int value;
+        memcpy( &value, ptr, 4 );
+        return value;
+    }
+
+    static void writeToken( std::string& dst, unsigned int literalLength, unsigned int matchLength )
+    {
+        dst.push_back( char(((literalLength<15 ? literalLength : 15)<<4) | (matchLength<15 ? matchLength : 15)) );
+    }
+
+    static void writeLength( std::string& dst, unsigned int length )
+    {
+        while ( length>=255 ) { dst.push_back( char(255) ); length -= 255; }
+        dst.push_back( char(length) );
+    }
+
+    static bool readLength( const unsigned char* src, unsigned int srcSize, unsigned int& ip, unsigned int& length )
+    {
+        unsigned int value = 255;
+        while ( value==255 )
+        {
+            if ( ip>=srcSize ) return false;
+            value = src[ip++];
+            length += value;
+        }
+        return true;
+    }
+};
+
+REGISTER_COMPRESSOR( "lz4", LZ4Compressor )
+
 #ifdef USE_ZLIB
 
 #include <zlib.h>
@@ -173,4 +533,28 @@ public:
 
 REGISTER_COMPRESSOR( "zlib", ZLibCompressor )
 
+// ZLib compression of independent blocks, the ratio of "zlib" but compressed and decompressed in parallel.
+class ZLibBlockCompressor : public BlockCompressor
+{
+public:
+    ZLibBlockCompressor() {}
+
+    virtual bool compressBlock( const char* src, unsigned int size, std::string& dst ) const
+    {
+        uLongf dstSize = compressBound( size );
+        dst.resize( dstSize );
+        if ( compress2((Bytef*)&dst[0], &dstSize, (const Bytef*)src, size, 6)!=Z_OK ) return false;
+        dst.resize( dstSize );
+        return true;
+    }
+
+    virtual bool decompressBlock( const char* src, unsigned int srcSize, char* dst, unsigned int dstSize ) const
+    {
+        uLongf size = dstSize;
+        return uncompress( (Bytef*)dst, &size, (const Bytef*)src, srcSize )==Z_OK && size==dstSize;
+    }
+};
+
+REGISTER_COMPRESSOR( "zlibblocks", ZLibBlockCompressor )
+
 #endif
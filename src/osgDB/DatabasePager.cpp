@@ -16,13 +16,16 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
+#include <osgDB/ObjectCache>
 
 #include <osg/Geode>
+#include <osg/Geometry>
 #include <osg/Timer>
 #include <osg/Texture>
 #include <osg/Notify>
 #include <osg/ProxyNode>
 #include <osg/ApplicationUsage>
+#include <osg/CullStack>
 
 #include <OpenThreads/ScopedLock>
 
@@ -45,8 +48,13 @@ using namespace OpenThreads;
 
 static osg::ApplicationUsageProxy DatabasePager_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DO_PRE_COMPILE <ON/OFF>","Switch on or off the pre compile of OpenGL object database pager.");
 static osg::ApplicationUsageProxy DatabasePager_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_DRAWABLE <mode>","Set the drawable policy for setting of loaded drawable to specified type.  mode can be one of DoNotModify, DisplayList, VBO or VertexArrays>.");
+static osg::ApplicationUsageProxy DatabasePager_e5(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_SCHEDULER <mode>","Set how file requests are scheduled across the database threads.  mode can be one of List or WorkStealing.");
+static osg::ApplicationUsageProxy DatabasePager_e16(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_REQUEST_EXPIRY_FRAMES <num>","Set the number of frames a pending file request stays current after it was last requested, default 1.");
 static osg::ApplicationUsageProxy DatabasePager_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PRIORITY <mode>", "Set the thread priority to DEFAULT, MIN, LOW, NOMINAL, HIGH or MAX.");
 static osg::ApplicationUsageProxy DatabasePager_e11(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD <num>","Set the target maximum number of PagedLOD to maintain.");
+static osg::ApplicationUsageProxy DatabasePager_e13(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_MERGE_TIME <us>","Set the maximum time in microseconds spent merging loaded subgraphs into the scene graph each frame.");
+static osg::ApplicationUsageProxy DatabasePager_e15(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DATABASE_PAGER_PREFETCH_TIME <seconds>","Set how many seconds ahead of the camera's motion PagedLOD children are prefetched.");
+static osg::ApplicationUsageProxy DatabasePager_e14(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_MAX_PAGEDLOD_MEMORY <MB>","Set the target maximum number of megabytes of paged subgraphs to maintain.");
 static osg::ApplicationUsageProxy DatabasePager_e12(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_ASSIGN_PBO_TO_IMAGES <ON/OFF>","Set whether PixelBufferObjects should be assigned to Images to aid download to the GPU.");
 
 
@@ -130,6 +138,56 @@ private:
     }
 };
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  ReleaseResidentBytesVisitor
+//
+class ReleaseResidentBytesVisitor : public osg::NodeVisitor
+{
+public:
+    ReleaseResidentBytesVisitor(DatabasePager::ResidentBytesMap& residentBytesMap):
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        _residentBytesMap(residentBytesMap),
+        _bytesReleased(0)
+    {
+    }
+
+    META_NodeVisitor("osgDB","ReleaseResidentBytesVisitor")
+
+    virtual void apply(osg::Node& node)
+    {
+        // entries are ordered by the node's ObserverSet, so nodes without one can't have an entry, and
+        // looking them up mustn't create one.
+        if (node.getObserverSet())
+        {
+            DatabasePager::ResidentBytesMap::iterator itr = _residentBytesMap.find(osg::observer_ptr<osg::Node>(&node));
+            if (itr != _residentBytesMap.end())
+            {
+                _bytesReleased += itr->second;
+                _residentBytesMap.erase(itr);
+            }
+        }
+
+        traverse(node);
+    }
+
+    DatabasePager::ResidentBytesMap&    _residentBytesMap;
+    unsigned long long                  _bytesReleased;
+
+protected:
+
+    ReleaseResidentBytesVisitor& operator = (const ReleaseResidentBytesVisitor&) { return *this; }
+};
+
+unsigned long long DatabasePager::releaseResidentBytes(osg::Node* subgraph, ResidentBytesMap& residentBytesMap)
+{
+    if (!subgraph || residentBytesMap.empty()) return 0;
+
+    ReleaseResidentBytesVisitor rrbv(residentBytesMap);
+    subgraph->accept(rrbv);
+    return rrbv._bytesReleased;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  SetBasedPagedLODList
@@ -197,6 +255,63 @@ public:
         }
     }
 
+    virtual unsigned long long removeLeastRecentlyUsedChildren(
+        unsigned long long numBytesToRemove, double expiryTime, unsigned int expiryFrame,
+        DatabasePager::ObjectList& childrenRemoved, DatabasePager::ResidentBytesMap& residentBytesMap)
+    {
+        // order the inactive PagedLODs so that the least recently traversed are visited first.
+        typedef std::vector< std::pair<unsigned int, osg::ref_ptr<osg::PagedLOD> > > LeastRecentlyUsedList;
+        LeastRecentlyUsedList lruList;
+        for(PagedLODs::iterator itr = _pagedLODs.begin();
+            itr!=_pagedLODs.end();
+            ++itr)
+        {
+            osg::ref_ptr<osg::PagedLOD> plod;
+            if (itr->lock(plod) && plod->getFrameNumberOfLastTraversal() <= expiryFrame)
+            {
+                lruList.push_back(std::make_pair(plod->getFrameNumberOfLastTraversal(), plod));
+            }
+        }
+
+        std::sort(lruList.begin(), lruList.end());
+
+        unsigned long long bytesRemoved = 0;
+        for(LeastRecentlyUsedList::iterator itr = lruList.begin();
+            itr != lruList.end() && bytesRemoved < numBytesToRemove;
+            ++itr)
+        {
+            osg::PagedLOD* plod = itr->second.get();
+
+            // skip PagedLODs that have been removed as part of an earlier PagedLOD's expired children.
+            if (_pagedLODs.count(osg::observer_ptr<osg::PagedLOD>(plod))==0) continue;
+
+            DatabasePager::ExpirePagedLODsVisitor expirePagedLODsVisitor;
+            osg::NodeList expiredChildren;
+            expirePagedLODsVisitor.removeExpiredChildrenAndFindPagedLODs(
+                plod, expiryTime, expiryFrame, expiredChildren);
+
+            for (DatabasePager::ExpirePagedLODsVisitor::PagedLODset::iterator
+                     citr = expirePagedLODsVisitor._childPagedLODs.begin(),
+                     end = expirePagedLODsVisitor._childPagedLODs.end();
+                 citr != end;
+                ++citr)
+            {
+                _pagedLODs.erase(osg::observer_ptr<osg::PagedLOD>(*citr));
+            }
+
+            for(osg::NodeList::iterator citr = expiredChildren.begin();
+                citr != expiredChildren.end();
+                ++citr)
+            {
+                bytesRemoved += DatabasePager::releaseResidentBytes(citr->get(), residentBytesMap);
+            }
+
+            std::copy(expiredChildren.begin(), expiredChildren.end(), std::back_inserter(childrenRemoved));
+        }
+
+        return bytesRemoved;
+    }
+
     virtual void removeNodes(osg::NodeList& nodesToRemove)
     {
         for(osg::NodeList::iterator itr = nodesToRemove.begin();
@@ -352,7 +467,8 @@ struct DatabasePager::SortFileRequestFunctor
 {
     bool operator() (const osg::ref_ptr<DatabasePager::DatabaseRequest>& lhs,const osg::ref_ptr<DatabasePager::DatabaseRequest>& rhs) const
     {
-        if (lhs->_timestampLastRequest>rhs->_timestampLastRequest) return true;
+        if (lhs->_prefetch!=rhs->_prefetch) return rhs->_prefetch;
+        else if (lhs->_timestampLastRequest>rhs->_timestampLastRequest) return true;
         else if (lhs->_timestampLastRequest<rhs->_timestampLastRequest) return false;
         else return (lhs->_priorityLastRequest>rhs->_priorityLastRequest);
     }
@@ -360,6 +476,19 @@ struct DatabasePager::SortFileRequestFunctor
 
 
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  SortMergeRequestFunctor
+//
+struct DatabasePager::SortMergeRequestFunctor
+{
+    bool operator() (const osg::ref_ptr<DatabasePager::DatabaseRequest>& lhs,const osg::ref_ptr<DatabasePager::DatabaseRequest>& rhs) const
+    {
+        return lhs->_timestampFirstRequest<rhs->_timestampFirstRequest;
+    }
+};
+
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  DatabaseRequest
@@ -404,6 +533,7 @@ void DatabasePager::RequestQueue::invalidate(DatabaseRequest* dr)
         _pager->getIncrementalCompileOperation()->remove(compileSet.get());
     }
 
+    if (dr->_prefetch && dr->_valid) ++(_pager->_numPrefetchesWasted);
 
     dr->invalidate();
 }
@@ -421,7 +551,7 @@ bool DatabasePager::RequestQueue::pruneOldRequestsAndCheckIfEmpty()
             )
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-            if ((*citr)->isRequestCurrent(frameNumber))
+            if ((*citr)->isRequestCurrent(frameNumber, _pager->_requestExpiryFrames))
             {
                 ++citr;
             }
@@ -528,7 +658,7 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
             )
         {
             OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
-            if ((*citr)->isRequestCurrent(frameNumber))
+            if ((*citr)->isRequestCurrent(frameNumber, _pager->_requestExpiryFrames))
             {
                 if (selected_itr==_requestList.end() || highPriority(*citr, *selected_itr))
                 {
@@ -564,6 +694,221 @@ void DatabasePager::RequestQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& datab
     }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  WorkStealingRequestScheduler
+//
+//  Requests are distributed round robin across one priority heap per database thread, each heap
+//  guarded by its own mutex so threads only contend when stealing.  Heap entries hold a snapshot of
+//  the request's frame number and priority, as these are updated by the cull traversal without
+//  the queue being aware, so stale entries are refreshed and pushed back when they reach the top.
+//  Requests that are no longer current are discarded as they are popped, with a full prune
+//  of a heap made at most once a frame.
+//
+struct DatabasePager::WorkStealingRequestScheduler : public DatabasePager::RequestScheduler
+{
+    struct Entry
+    {
+        Entry(): _prefetch(false), _frameNumber(0), _priority(0.0f) {}
+
+        Entry(DatabaseRequest* dr):
+            _prefetch(dr->_prefetch),
+            _frameNumber(dr->_frameNumberLastRequest),
+            _priority(dr->_priorityLastRequest),
+            _request(dr) {}
+
+        bool operator < (const Entry& rhs) const
+        {
+            if (_prefetch!=rhs._prefetch) return _prefetch;
+            else if (_frameNumber<rhs._frameNumber) return true;
+            else if (rhs._frameNumber<_frameNumber) return false;
+            else return _priority<rhs._priority;
+        }
+
+        bool                            _prefetch;
+        unsigned int                    _frameNumber;
+        float                           _priority;
+        osg::ref_ptr<DatabaseRequest>   _request;
+    };
+
+    typedef std::vector<Entry> EntryHeap;
+
+    struct Shard : public osg::Referenced
+    {
+        Shard(): _frameNumberLastPruned(osg::UNINITIALIZED_FRAME_NUMBER) {}
+
+        OpenThreads::Mutex  _mutex;
+        EntryHeap           _heap;
+        unsigned int        _frameNumberLastPruned;
+    };
+
+    typedef std::vector< osg::ref_ptr<Shard> > Shards;
+
+    WorkStealingRequestScheduler(ReadQueue* queue, unsigned int numShards):
+        RequestScheduler(queue)
+    {
+        if (numShards==0) numShards = 1;
+        for(unsigned int i=0; i<numShards; ++i)
+        {
+            _shards.push_back(new Shard);
+        }
+    }
+
+    virtual void add(DatabaseRequest* databaseRequest)
+    {
+        Entry entry;
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_queue->_pager->_dr_mutex);
+            entry = Entry(databaseRequest);
+        }
+
+        Shard* shard = _shards[(++_nextShard) % _shards.size()].get();
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard->_mutex);
+        shard->_heap.push_back(entry);
+        std::push_heap(shard->_heap.begin(), shard->_heap.end());
+        ++_size;
+    }
+
+    virtual void takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest, unsigned int threadIndex)
+    {
+        unsigned int frameNumber = _queue->_pager->_frameNumber;
+        unsigned int home = threadIndex % _shards.size();
+
+        if (takeFirst(*_shards[home], frameNumber, databaseRequest)) return;
+
+        // our own heap is empty so steal from the other heaps, highest priority first.
+        typedef std::vector< std::pair<Entry, unsigned int> > Candidates;
+        Candidates candidates;
+        for(unsigned int i=1; i<_shards.size(); ++i)
+        {
+            unsigned int index = (home+i) % _shards.size();
+            Shard* shard = _shards[index].get();
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard->_mutex);
+            if (!shard->_heap.empty()) candidates.push_back(std::make_pair(shard->_heap.front(), index));
+        }
+
+        std::sort(candidates.begin(), candidates.end(), HigherPriorityCandidate());
+
+        for(Candidates::iterator itr = candidates.begin();
+            itr != candidates.end();
+            ++itr)
+        {
+            if (takeFirst(*_shards[itr->second], frameNumber, databaseRequest)) return;
+        }
+    }
+
+    virtual void clear()
+    {
+        for(Shards::iterator sitr = _shards.begin();
+            sitr != _shards.end();
+            ++sitr)
+        {
+            Shard* shard = sitr->get();
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard->_mutex);
+            for(EntryHeap::iterator itr = shard->_heap.begin();
+                itr != shard->_heap.end();
+                ++itr)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_queue->_pager->_dr_mutex);
+                _queue->invalidate(itr->_request.get());
+                --_size;
+            }
+            shard->_heap.clear();
+        }
+    }
+
+    virtual unsigned int size() const { return _size; }
+
+protected:
+
+    virtual ~WorkStealingRequestScheduler()
+    {
+        clear();
+    }
+
+    struct HigherPriorityCandidate
+    {
+        bool operator() (const std::pair<Entry, unsigned int>& lhs, const std::pair<Entry, unsigned int>& rhs) const
+        {
+            return rhs.first < lhs.first;
+        }
+    };
+
+    bool takeFirst(Shard& shard, unsigned int frameNumber, osg::ref_ptr<DatabaseRequest>& databaseRequest)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(shard._mutex);
+
+        if (shard._frameNumberLastPruned != frameNumber)
+        {
+            unsigned int numBefore = shard._heap.size();
+            EntryHeap::iterator end = shard._heap.begin();
+            for(EntryHeap::iterator itr = shard._heap.begin();
+                itr != shard._heap.end();
+                ++itr)
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_queue->_pager->_dr_mutex);
+                if (itr->_request->isRequestCurrent(frameNumber, _queue->_pager->_requestExpiryFrames))
+                {
+                    if (itr!=end) *end = *itr;
+                    ++end;
+                }
+                else
+                {
+                    OSG_INFO<<"DatabasePager::WorkStealingRequestScheduler::takeFirst(): Pruning "<<itr->_request.get()<<std::endl;
+                    _queue->invalidate(itr->_request.get());
+                }
+            }
+            shard._heap.erase(end, shard._heap.end());
+
+            if (shard._heap.size()!=numBefore)
+            {
+                std::make_heap(shard._heap.begin(), shard._heap.end());
+                for(unsigned int i=shard._heap.size(); i<numBefore; ++i) --_size;
+            }
+
+            shard._frameNumberLastPruned = frameNumber;
+        }
+
+        while(!shard._heap.empty())
+        {
+            std::pop_heap(shard._heap.begin(), shard._heap.end());
+            Entry& entry = shard._heap.back();
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_queue->_pager->_dr_mutex);
+            DatabaseRequest* dr = entry._request.get();
+            if (!dr->isRequestCurrent(frameNumber, _queue->_pager->_requestExpiryFrames))
+            {
+                _queue->invalidate(dr);
+                shard._heap.pop_back();
+                --_size;
+            }
+            else if (entry._prefetch!=dr->_prefetch || entry._frameNumber!=dr->_frameNumberLastRequest || entry._priority!=dr->_priorityLastRequest)
+            {
+                // request has been updated since it was added, so reposition it using its current frame number and priority.
+                entry._prefetch = dr->_prefetch;
+                entry._frameNumber = dr->_frameNumberLastRequest;
+                entry._priority = dr->_priorityLastRequest;
+                std::push_heap(shard._heap.begin(), shard._heap.end());
+            }
+            else
+            {
+                databaseRequest = dr;
+                shard._heap.pop_back();
+                --_size;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    Shards                  _shards;
+    OpenThreads::Atomic     _nextShard;
+    OpenThreads::Atomic     _size;
+};
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  ReadQueue
@@ -577,10 +922,77 @@ DatabasePager::ReadQueue::ReadQueue(DatabasePager* pager, const std::string& nam
 
 void DatabasePager::ReadQueue::updateBlock()
 {
-    _block->set((!_requestList.empty() || !_childrenToDeleteList.empty()) &&
+    bool requestsPending = _scheduler.valid() ? _scheduler->size()!=0 : !_requestList.empty();
+    _block->set((requestsPending || !_childrenToDeleteList.empty()) &&
                 !_pager->_databasePagerThreadPaused);
 }
 
+void DatabasePager::ReadQueue::setRequestScheduler(RequestScheduler* scheduler)
+{
+    if (_scheduler==scheduler) return;
+
+    clear();
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    _scheduler = scheduler;
+}
+
+void DatabasePager::ReadQueue::addNoLock(DatabaseRequest* databaseRequest)
+{
+    if (!_scheduler)
+    {
+        RequestQueue::addNoLock(databaseRequest);
+        return;
+    }
+
+    _scheduler->add(databaseRequest);
+    updateBlock();
+}
+
+void DatabasePager::ReadQueue::takeFirst(osg::ref_ptr<DatabaseRequest>& databaseRequest, unsigned int threadIndex)
+{
+    if (!_scheduler)
+    {
+        RequestQueue::takeFirst(databaseRequest);
+        return;
+    }
+
+    // the scheduler does its own locking so only hold the queue's mutex whilst updating the block.
+    _scheduler->takeFirst(databaseRequest, threadIndex);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+    updateBlock();
+}
+
+bool DatabasePager::ReadQueue::empty()
+{
+    if (!_scheduler) return RequestQueue::empty();
+    return _scheduler->size()==0;
+}
+
+unsigned int DatabasePager::ReadQueue::size()
+{
+    if (!_scheduler) return RequestQueue::size();
+    return _scheduler->size();
+}
+
+void DatabasePager::ReadQueue::clear()
+{
+    if (!_scheduler)
+    {
+        RequestQueue::clear();
+        return;
+    }
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_requestMutex);
+
+    _scheduler->clear();
+
+    _frameNumberLastPruned = _pager->_frameNumber;
+
+    updateBlock();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
 //  DatabaseThread
@@ -663,6 +1075,15 @@ void DatabasePager::DatabaseThread::run()
             break;
     }
 
+    // index of this thread amongst those servicing the same queue, used by the RequestScheduler to select this thread's requests.
+    unsigned int threadIndex = 0;
+    for(DatabaseThreadList::const_iterator dt_itr = _pager->_databaseThreads.begin();
+        dt_itr != _pager->_databaseThreads.end() && dt_itr->get()!=this;
+        ++dt_itr)
+    {
+        if (((*dt_itr)->_mode==HANDLE_ONLY_HTTP) == (_mode==HANDLE_ONLY_HTTP)) ++threadIndex;
+    }
+
 
     do
     {
@@ -702,7 +1123,7 @@ void DatabasePager::DatabaseThread::run()
         // load any subgraphs that are required.
         //
         osg::ref_ptr<DatabaseRequest> databaseRequest;
-        read_queue->takeFirst(databaseRequest);
+        read_queue->takeFirst(databaseRequest, threadIndex);
 
         bool readFromFileCache = false;
 
@@ -886,6 +1307,9 @@ void DatabasePager::DatabaseThread::run()
             {
                 loadedModel->getBound();
 
+                // estimate the memory used by the subgraph here so the update thread doesn't have to.
+                unsigned long long residentBytes = ObjectCache::estimateNumBytes(loadedModel.get());
+
                 bool loadedObjectsNeedToBeCompiled = false;
                 osg::ref_ptr<osgUtil::IncrementalCompileOperation::CompileSet> compileSet = 0;
                 if (!rr.loadedFromCache())
@@ -920,6 +1344,7 @@ void DatabasePager::DatabaseThread::run()
                     OpenThreads::ScopedLock<OpenThreads::Mutex> drLock(_pager->_dr_mutex);
                     databaseRequest->_loadedModel = loadedModel;
                     databaseRequest->_compileSet = compileSet;
+                    databaseRequest->_residentBytes = residentBytes;
                 }
                 // Dereference the databaseRequest while the queue is
                 // locked. This prevents the request from being
@@ -1040,6 +1465,15 @@ DatabasePager::DatabasePager()
     }
 
 
+    _targetMaximumResidentBytes = 0;
+    if( (str = getenv("OSG_MAX_PAGEDLOD_MEMORY")) != 0)
+    {
+        _targetMaximumResidentBytes = static_cast<unsigned long long>(osg::asciiToDouble(str)*1024.0*1024.0);
+        OSG_INFO<<"_targetMaximumResidentBytes = "<<_targetMaximumResidentBytes<<std::endl;
+    }
+
+    _residentBytes = 0;
+
     _doPreCompile = true;
     if( (str = getenv("OSG_DO_PRE_COMPILE")) != 0)
     {
@@ -1047,11 +1481,45 @@ DatabasePager::DatabasePager()
                         strcmp(str,"on")==0 || strcmp(str,"ON")==0;
     }
 
+    _maximumMergeTimePerFrame = 0.0;
+    if( (str = getenv("OSG_DATABASE_PAGER_MERGE_TIME")) != 0)
+    {
+        _maximumMergeTimePerFrame = osg::asciiToDouble(str);
+    }
+
+    _prefetchTime = 0.0;
+    if( (str = getenv("OSG_DATABASE_PAGER_PREFETCH_TIME")) != 0)
+    {
+        _prefetchTime = osg::asciiToDouble(str);
+    }
+
     // initialize the stats variables
     resetStats();
 
+    _requestSchedulingPolicy = SCHEDULE_BY_SCANNING_LIST;
+    if( (str = getenv("OSG_DATABASE_PAGER_SCHEDULER")) != 0)
+    {
+        if (strcmp(str,"List")==0)
+        {
+            _requestSchedulingPolicy = SCHEDULE_BY_SCANNING_LIST;
+        }
+        else if (strcmp(str,"WorkStealing")==0)
+        {
+            _requestSchedulingPolicy = SCHEDULE_BY_PRIORITY_WITH_WORK_STEALING;
+        }
+    }
+
+    _requestExpiryFrames = 1;
+    if( (str = getenv("OSG_DATABASE_PAGER_REQUEST_EXPIRY_FRAMES")) != 0)
+    {
+        int numFrames = atoi(str);
+        if (numFrames>0) _requestExpiryFrames = numFrames;
+        else OSG_NOTICE<<"Warning: OSG_DATABASE_PAGER_REQUEST_EXPIRY_FRAMES value \""<<str<<"\" ignored, must be 1 or more."<<std::endl;
+    }
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
+    assignRequestSchedulers();
 
     _dataToCompileList = new RequestQueue(this);
     _dataToMergeList = new RequestQueue(this);
@@ -1120,10 +1588,21 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
 
     _targetMaximumNumberOfPageLOD = rhs._targetMaximumNumberOfPageLOD;
 
+    _targetMaximumResidentBytes = rhs._targetMaximumResidentBytes;
+    _residentBytes = 0;
+
     _doPreCompile = rhs._doPreCompile;
 
+    _maximumMergeTimePerFrame = rhs._maximumMergeTimePerFrame;
+
+    _prefetchTime = rhs._prefetchTime;
+
+    _requestSchedulingPolicy = rhs._requestSchedulingPolicy;
+    _requestExpiryFrames = rhs._requestExpiryFrames;
+
     _fileRequestQueue = new ReadQueue(this,"fileRequestQueue");
     _httpRequestQueue = new ReadQueue(this,"httpRequestQueue");
+    assignRequestSchedulers();
 
     _dataToCompileList = new RequestQueue(this);
     _dataToMergeList = new RequestQueue(this);
@@ -1152,6 +1631,43 @@ DatabasePager::DatabasePager(const DatabasePager& rhs)
 }
 
 
+void DatabasePager::setRequestSchedulingPolicy(RequestSchedulingPolicy policy)
+{
+    if (_requestSchedulingPolicy==policy) return;
+
+    _requestSchedulingPolicy = policy;
+
+    assignRequestSchedulers();
+}
+
+void DatabasePager::assignRequestSchedulers()
+{
+    // size the schedulers to match the threads that setUpThreads() will create by default.
+    osg::DisplaySettings* ds = osg::DisplaySettings::instance().get();
+    unsigned int numHttpThreads = ds->getNumOfHttpDatabaseThreadsHint();
+    unsigned int numFileThreads = numHttpThreads < ds->getNumOfDatabaseThreadsHint() ?
+        ds->getNumOfDatabaseThreadsHint() - numHttpThreads :
+        1;
+
+    osg::ref_ptr<RequestScheduler> fileScheduler = createRequestScheduler(_fileRequestQueue.get(), numFileThreads);
+    _fileRequestQueue->setRequestScheduler(fileScheduler.get());
+
+    osg::ref_ptr<RequestScheduler> httpScheduler = createRequestScheduler(_httpRequestQueue.get(), numHttpThreads);
+    _httpRequestQueue->setRequestScheduler(httpScheduler.get());
+}
+
+DatabasePager::RequestScheduler* DatabasePager::createRequestScheduler(ReadQueue* queue, unsigned int numThreads)
+{
+    switch(_requestSchedulingPolicy)
+    {
+        case(SCHEDULE_BY_PRIORITY_WITH_WORK_STEALING):
+            return new WorkStealingRequestScheduler(queue, numThreads);
+        case(SCHEDULE_BY_SCANNING_LIST):
+        default:
+            return 0;
+    }
+}
+
 void DatabasePager::setIncrementalCompileOperation(osgUtil::IncrementalCompileOperation* ico)
 {
     _incrementalCompileOperation = ico;
@@ -1319,6 +1835,12 @@ void DatabasePager::clear()
     // note, no need to use a mutex as the list is only accessed from the update thread.
     _activePagedLODList->clear();
 
+    _residentBytesMap.clear();
+    _residentBytes = 0;
+
+    _prefetchedSubgraphs.clear();
+    _prefetchHistoryMap.clear();
+
     // ??
     // _activeGraphicsContexts
 }
@@ -1326,10 +1848,28 @@ void DatabasePager::clear()
 void DatabasePager::resetStats()
 {
     // initialize the stats variables
+    _mergeTimeLastFrame = 0.0;
+    _mergeBacklog = 0;
     _minimumTimeToMergeTile = DBL_MAX;
     _maximumTimeToMergeTile = -DBL_MAX;
     _totalTimeToMergeTiles = 0.0;
     _numTilesMerges = 0;
+    _numPrefetchRequests.exchange(0);
+    _numPrefetchHits.exchange(0);
+    _numPrefetchesWasted.exchange(0);
+}
+
+void DatabasePager::reportStats(unsigned int frameNumber, osg::Stats& stats) const
+{
+    stats.setAttribute(frameNumber, "DatabasePager merge time", _mergeTimeLastFrame);
+    stats.setAttribute(frameNumber, "DatabasePager merge backlog", static_cast<double>(_mergeBacklog));
+    stats.setAttribute(frameNumber, "DatabasePager resident bytes", static_cast<double>(_residentBytes));
+    if (_prefetchTime>0.0)
+    {
+        stats.setAttribute(frameNumber, "DatabasePager prefetch requests", static_cast<double>(_numPrefetchRequests));
+        stats.setAttribute(frameNumber, "DatabasePager prefetch hits", static_cast<double>(_numPrefetchHits));
+        stats.setAttribute(frameNumber, "DatabasePager prefetches wasted", static_cast<double>(_numPrefetchesWasted));
+    }
 }
 
 bool DatabasePager::getRequestsInProgress() const
@@ -1354,6 +1894,22 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                                     float priority, const osg::FrameStamp* framestamp,
                                     osg::ref_ptr<osg::Referenced>& databaseRequestRef,
                                     const osg::Referenced* options)
+{
+    addDatabaseRequest(fileName, nodePath, priority, framestamp, databaseRequestRef, options, false);
+}
+
+void DatabasePager::requestPrefetchNodeFile(const std::string& fileName, osg::NodePath& nodePath,
+                                            float priority, const osg::FrameStamp* framestamp,
+                                            osg::ref_ptr<osg::Referenced>& databaseRequestRef,
+                                            const osg::Referenced* options)
+{
+    addDatabaseRequest(fileName, nodePath, priority, framestamp, databaseRequestRef, options, true);
+}
+
+void DatabasePager::addDatabaseRequest(const std::string& fileName, osg::NodePath& nodePath,
+                                       float priority, const osg::FrameStamp* framestamp,
+                                       osg::ref_ptr<osg::Referenced>& databaseRequestRef,
+                                       const osg::Referenced* options, bool prefetch)
 {
     osgDB::Options* loadOptions = dynamic_cast<osgDB::Options*>(const_cast<osg::Referenced*>(options));
     if (!loadOptions)
@@ -1423,10 +1979,17 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
                 OSG_INFO<<"DatabaseRequest has been previously invalidated whilst still attached to scene graph."<<std::endl;
                 databaseRequest = 0;
             }
+            else if (prefetch && !databaseRequest->_prefetch && databaseRequest->isRequestCurrent(frameNumber, _requestExpiryFrames))
+            {
+                // a prefetch mustn't demote a request the cull traversal still wants.
+                foundEntry = true;
+            }
             else
             {
                 OSG_INFO<<"DatabasePager::requestNodeFile("<<fileName<<") updating already assigned."<<std::endl;
 
+                if (databaseRequest->_prefetch && !prefetch) ++_numPrefetchHits;
+                databaseRequest->_prefetch = prefetch;
 
                 databaseRequest->_valid = true;
                 databaseRequest->_frameNumberLastRequest = frameNumber;
@@ -1480,6 +2043,9 @@ void DatabasePager::requestNodeFile(const std::string& fileName, osg::NodePath&
             databaseRequest->_terrain = terrain;
             databaseRequest->_loadOptions = loadOptions;
             databaseRequest->_objectCache = 0;
+            databaseRequest->_prefetch = prefetch;
+
+            if (prefetch) ++_numPrefetchRequests;
 
             _fileRequestQueue->addNoLock(databaseRequest.get());
         }
@@ -1579,6 +2145,8 @@ void DatabasePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
 
         addLoadedDataToSceneGraph(frameStamp);
 
+        updatePrefetchStats();
+
 #if UPDATE_TIMING
         timeFor_addLoadedDataToSceneGraph = timer.elapsedTime_m() - timeFor_removeExpiredSubgraphs;
 #endif
@@ -1599,6 +2167,185 @@ void DatabasePager::updateSceneGraph(const osg::FrameStamp& frameStamp)
 #endif
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  PrefetchVisitor
+//
+//  Culls the scene graph from a predicted viewpoint, in the same manner as the CollectOccludersVisitor, so that
+//  the PagedLOD nodes it traverses issue their requests via requestPrefetchNodeFile() rather than requestNodeFile().
+//  As it isn't a CullVisitor the PagedLOD's timestamps are left untouched and don't hold back expiry.
+//
+class DatabasePager::PrefetchVisitor : public osg::NodeVisitor, public osg::CullStack
+{
+public:
+
+    class PrefetchRequestHandler : public osg::NodeVisitor::DatabaseRequestHandler
+    {
+    public:
+        PrefetchRequestHandler(DatabasePager* pager): _pager(pager) {}
+
+        virtual void requestNodeFile(const std::string& fileName, osg::NodePath& nodePath, float priority, const osg::FrameStamp* framestamp, osg::ref_ptr<osg::Referenced>& databaseRequest, const osg::Referenced* options)
+        {
+            _pager->requestPrefetchNodeFile(fileName, nodePath, priority, framestamp, databaseRequest, options);
+        }
+
+    protected:
+        DatabasePager* _pager;
+    };
+
+    PrefetchVisitor(DatabasePager* pager):
+        osg::NodeVisitor(osg::NodeVisitor::NODE_VISITOR, osg::NodeVisitor::TRAVERSE_ACTIVE_CHILDREN)
+    {
+        // near and far planes will have been computed for the current viewpoint so don't cull against them.
+        setCullingMode(VIEW_FRUSTUM_CULLING|SMALL_FEATURE_CULLING);
+        setDatabaseRequestHandler(new PrefetchRequestHandler(pager));
+    }
+
+    META_NodeVisitor(osgDB, PrefetchVisitor)
+
+    virtual osg::CullStack* asCullStack() { return static_cast<osg::CullStack*>(this); }
+    virtual const osg::CullStack* asCullStack() const { return static_cast<const osg::CullStack*>(this); }
+
+    virtual osg::Vec3 getEyePoint() const { return getEyeLocal(); }
+    virtual osg::Vec3 getViewPoint() const { return getViewPointLocal(); }
+
+    virtual float getDistanceToEyePoint(const osg::Vec3& pos, bool withLODScale) const
+    {
+        if (withLODScale) return (pos-getEyeLocal()).length()*getLODScale();
+        else return (pos-getEyeLocal()).length();
+    }
+
+    virtual float getDistanceToViewPoint(const osg::Vec3& pos, bool withLODScale) const
+    {
+        if (withLODScale) return (pos-getViewPointLocal()).length()*getLODScale();
+        else return (pos-getViewPointLocal()).length();
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        if (isCulled(node)) return;
+
+        pushCurrentMask();
+        traverse(node);
+        popCurrentMask();
+    }
+
+    virtual void apply(osg::Transform& node)
+    {
+        if (isCulled(node)) return;
+
+        pushCurrentMask();
+
+        osg::ref_ptr<osg::RefMatrix> matrix = createOrReuseMatrix(*getModelViewMatrix());
+        node.computeLocalToWorldMatrix(*matrix,this);
+        pushModelViewMatrix(matrix.get(), node.getReferenceFrame());
+
+        traverse(node);
+
+        popModelViewMatrix();
+        popCurrentMask();
+    }
+
+    // nothing below a Geode or Drawable can request paging.
+    virtual void apply(osg::Geode&) {}
+    virtual void apply(osg::Drawable&) {}
+
+    // nested cameras have their own views so aren't extrapolated along with the view's camera.
+    virtual void apply(osg::Camera&) {}
+};
+
+void DatabasePager::prefetch(osg::Node* subgraph, const osg::Camera* camera, const osg::FrameStamp* framestamp)
+{
+    if (!subgraph || !camera || !framestamp || _prefetchTime<=0.0 || !_acceptNewRequests) return;
+
+    unsigned int frameNumber = framestamp->getFrameNumber();
+    double time = framestamp->getReferenceTime();
+
+    // forget cameras that are no longer being prefetched for.
+    for(PrefetchHistoryMap::iterator itr = _prefetchHistoryMap.begin();
+        itr != _prefetchHistoryMap.end();
+        )
+    {
+        if (itr->first!=camera && frameNumber-itr->second._frameNumberLastUpdated > 1) _prefetchHistoryMap.erase(itr++);
+        else ++itr;
+    }
+
+    const unsigned int maxNumSamples = 8;
+
+    PrefetchHistory& history = _prefetchHistoryMap[camera];
+    osg::Vec3d eye = camera->getInverseViewMatrix().getTrans();
+    if (history._samples.empty() || history._samples.back()._time<time)
+    {
+        history._samples.push_back(PrefetchSample(time, eye));
+        if (history._samples.size()>maxNumSamples) history._samples.pop_front();
+    }
+    history._frameNumberLastUpdated = frameNumber;
+
+    if (history._samples.size()<2) return;
+
+    // estimate the camera's velocity across the recent samples to smooth out per frame jitter.
+    const PrefetchSample& first = history._samples.front();
+    const PrefetchSample& last = history._samples.back();
+    double dt = last._time-first._time;
+    if (dt<=0.0) return;
+
+    osg::Vec3d delta = (last._eye-first._eye) * (_prefetchTime/dt);
+
+    // a stationary camera is already requesting everything it needs.
+    if (delta.length2()==0.0) return;
+
+    if (!_prefetchVisitor) _prefetchVisitor = new PrefetchVisitor(this);
+
+    PrefetchVisitor& pv = static_cast<PrefetchVisitor&>(*_prefetchVisitor);
+    pv.osg::CullStack::reset();
+    pv.setFrameStamp(const_cast<osg::FrameStamp*>(framestamp));
+    pv.setTraversalNumber(frameNumber);
+    pv.setTraversalMask(camera->getCullMask());
+    pv.setLODScale(camera->getLODScale());
+    pv.setSmallFeatureCullingPixelSize(camera->getSmallFeatureCullingPixelSize());
+
+    // the pixel size of PagedLOD in PIXEL_SIZE_ON_SCREEN mode needs a viewport, cameras without one fall back to a nominal size.
+    osg::ref_ptr<osg::Viewport> viewport = const_cast<osg::Viewport*>(camera->getViewport());
+    if (!viewport) viewport = new osg::Viewport(0,0,1024,1024);
+
+    pv.pushViewport(viewport.get());
+    pv.pushProjectionMatrix(new osg::RefMatrix(camera->getProjectionMatrix()));
+    pv.pushModelViewMatrix(new osg::RefMatrix(osg::Matrixd::translate(-delta)*camera->getViewMatrix()), osg::Transform::ABSOLUTE_RF);
+
+    subgraph->accept(pv);
+
+    pv.popModelViewMatrix();
+    pv.popProjectionMatrix();
+    pv.popViewport();
+
+    pv.setFrameStamp(0);
+}
+
+void DatabasePager::updatePrefetchStats()
+{
+    for(PrefetchedSubgraphList::iterator itr = _prefetchedSubgraphs.begin();
+        itr != _prefetchedSubgraphs.end();
+        )
+    {
+        osg::ref_ptr<osg::PagedLOD> plod;
+        if (!itr->_pagedLOD.lock(plod) || itr->_childNo>=plod->getNumChildren())
+        {
+            // expired before ever being culled in.
+            ++_numPrefetchesWasted;
+            itr = _prefetchedSubgraphs.erase(itr);
+        }
+        else if (plod->getFrameNumber(itr->_childNo)>itr->_frameNumberMerged)
+        {
+            ++_numPrefetchHits;
+            itr = _prefetchedSubgraphs.erase(itr);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+}
+
 bool DatabasePager::requiresRedraw() const
 {
     return (getDataToCompileListSize()>0);
@@ -1616,13 +2363,27 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
     // get the data from the _dataToMergeList, leaving it empty via a std::vector<>.swap.
     _dataToMergeList->swap(localFileLoadedList);
 
+    // when limited in how much can be merged make sure that the oldest requests are merged first.
+    if (_maximumMergeTimePerFrame>0.0 && localFileLoadedList.size()>1)
+    {
+        localFileLoadedList.sort(SortMergeRequestFunctor());
+    }
+
     mid = osg::Timer::instance()->tick();
 
     // add the loaded data into the scene graph.
-    for(RequestQueue::RequestList::iterator itr=localFileLoadedList.begin();
+    RequestQueue::RequestList::iterator itr=localFileLoadedList.begin();
+    for(;
         itr!=localFileLoadedList.end();
         ++itr)
     {
+        if (_maximumMergeTimePerFrame>0.0 &&
+            itr!=localFileLoadedList.begin() &&
+            osg::Timer::instance()->delta_u(mid, osg::Timer::instance()->tick())>=_maximumMergeTimePerFrame)
+        {
+            break;
+        }
+
         DatabaseRequest* databaseRequest = itr->get();
 
         // No need to take _dr_mutex. The pager threads are done with
@@ -1640,6 +2401,12 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
                 plod->setTimeStamp(plod->getNumChildren(), timeStamp);
                 plod->setFrameNumber(plod->getNumChildren(), frameNumber);
                 plod->getDatabaseRequest(plod->getNumChildren()) = 0;
+
+                // keep track of subgraphs that only prefetch() asked for so we can tell whether they get used.
+                if (databaseRequest->_prefetch)
+                {
+                    _prefetchedSubgraphs.push_back(PrefetchedSubgraph(plod, plod->getNumChildren(), frameNumber));
+                }
             }
             else
             {
@@ -1657,6 +2424,17 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
 
             group->addChild(databaseRequest->_loadedModel.get());
 
+            // release any entry left by an earlier merge of this subgraph before inserting its new size.
+            osg::observer_ptr<osg::Node> residentKey(databaseRequest->_loadedModel.get());
+            ResidentBytesMap::iterator rbitr = _residentBytesMap.find(residentKey);
+            if (rbitr != _residentBytesMap.end())
+            {
+                _residentBytes -= rbitr->second;
+                _residentBytesMap.erase(rbitr);
+            }
+            _residentBytesMap.insert(ResidentBytesMap::value_type(residentKey, databaseRequest->_residentBytes));
+            _residentBytes += databaseRequest->_residentBytes;
+
             // Check if parent plod was already registered if not start visitor from parent
             if( plod &&
                 !_activePagedLODList->containsPagedLOD( plod ) )
@@ -1681,6 +2459,8 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
         else
         {
             OSG_INFO<<"DatabasePager::addLoadedDataToSceneGraph() node in parental chain deleted, discarding subgaph."<<std::endl;
+
+            if (databaseRequest->_prefetch) ++_numPrefetchesWasted;
         }
 
 
@@ -1696,8 +2476,22 @@ void DatabasePager::addLoadedDataToSceneGraph(const osg::FrameStamp &frameStamp)
         // OSG_NOTICE<<"curr = "<<timeToMerge<<" min "<<getMinimumTimeToMergeTile()*1000.0<<" max = "<<getMaximumTimeToMergeTile()*1000.0<<" average = "<<getAverageTimToMergeTiles()*1000.0<<std::endl;
     }
 
+    // return any requests we haven't had time to merge to the front of the merge list, ready for the next frame.
+    _mergeBacklog = 0;
+    if (itr!=localFileLoadedList.end())
+    {
+        RequestQueue::RequestList backlog;
+        backlog.splice(backlog.begin(), localFileLoadedList, itr, localFileLoadedList.end());
+        _mergeBacklog = backlog.size();
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_dataToMergeList->_requestMutex);
+        _dataToMergeList->_requestList.splice(_dataToMergeList->_requestList.begin(), backlog);
+    }
+
     last = osg::Timer::instance()->tick();
 
+    _mergeTimeLastFrame = osg::Timer::instance()->delta_s(mid,last);
+
     if (!localFileLoadedList.empty())
     {
         OSG_INFO<<"Done DatabasePager::addLoadedDataToSceneGraph"<<
@@ -1746,7 +2540,26 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
     if (s_total_max_stage_a<time_a) s_total_max_stage_a = time_a;
 
 
-    if (numPagedLODs <= _targetMaximumNumberOfPageLOD)
+    // discard the entries of subgraphs that have been deleted without passing through the pager, so that
+    // _residentBytes doesn't keep counting them.
+    for(ResidentBytesMap::iterator itr = _residentBytesMap.begin();
+        itr != _residentBytesMap.end();
+        )
+    {
+        if (!itr->first.valid())
+        {
+            _residentBytes -= itr->second;
+            _residentBytesMap.erase(itr++);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+
+    bool overResidentBytesTarget = _targetMaximumResidentBytes>0 && _residentBytes>_targetMaximumResidentBytes;
+
+    if (numPagedLODs <= _targetMaximumNumberOfPageLOD && !overResidentBytesTarget)
     {
         // nothing to do
         return;
@@ -1771,6 +2584,20 @@ void DatabasePager::removeExpiredSubgraphs(const osg::FrameStamp& frameStamp)
         _activePagedLODList->removeExpiredChildren(
             numToPrune, expiryTime, expiryFrame, childrenRemoved, true);
 
+    // account for the subgraphs removed above, then if still over the memory target remove the least recently used subgraphs.
+    for(ObjectList::iterator itr = childrenRemoved.begin();
+        itr != childrenRemoved.end();
+        ++itr)
+    {
+        _residentBytes -= releaseResidentBytes(dynamic_cast<osg::Node*>(itr->get()), _residentBytesMap);
+    }
+
+    if (overResidentBytesTarget && _residentBytes>_targetMaximumResidentBytes)
+    {
+        _residentBytes -= _activePagedLODList->removeLeastRecentlyUsedChildren(
+            _residentBytes-_targetMaximumResidentBytes, expiryTime, expiryFrame, childrenRemoved, _residentBytesMap);
+    }
+
     osg::Timer_t end_b_Tick = osg::Timer::instance()->tick();
     double time_b = osg::Timer::instance()->delta_m(end_a_Tick,end_b_Tick);
 
@@ -16,25 +16,361 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReadFile>
 #include <osgDB/WriteFile>
+#include <osgDB/fstream>
+
+#include <osg/Timer>
+
+#include <OpenThreads/ScopedLock>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <sstream>
+#include <vector>
+#include <algorithm>
 
 using namespace osgDB;
 
+namespace FileCacheUtils
+{
+
+#ifdef USE_ZLIB
+
+// CRC-32, continuing from the checksum of the preceding data.
+unsigned int crc32(unsigned int crc, const char* data, size_t size)
+{
+    // zlib takes the length as a uInt, so pass very large buffers in pieces.
+    const size_t maxBlockSize = 1<<30;
+    while(size>0)
+    {
+        size_t blockSize = osg::minimum(size, maxBlockSize);
+        crc = static_cast<unsigned int>(::crc32(crc, reinterpret_cast<const Bytef*>(data), static_cast<uInt>(blockSize)));
+        data += blockSize;
+        size -= blockSize;
+    }
+    return crc;
+}
+
+#else
+
+struct CRC32Table
+{
+    CRC32Table()
+    {
+        for(unsigned int i=0; i<256; ++i)
+        {
+            unsigned int c = i;
+            for(unsigned int k=0; k<8; ++k) c = (c&1) ? (0xedb88320u ^ (c>>1)) : (c>>1);
+            table[0][i] = c;
+        }
+
+        // tables for the bytes further back in each four byte word.
+        for(unsigned int i=0; i<256; ++i)
+        {
+            for(unsigned int k=1; k<4; ++k) table[k][i] = (table[k-1][i]>>8) ^ table[0][table[k-1][i] & 0xff];
+        }
+    }
+
+    unsigned int table[4][256];
+};
+
+static const CRC32Table s_crc32Table;
+
+// CRC-32 as used by zlib, continuing from the checksum of the preceding data.
+unsigned int crc32(unsigned int crc, const char* data, size_t size)
+{
+    const unsigned int (&table)[4][256] = s_crc32Table.table;
+    const unsigned char* ptr = reinterpret_cast<const unsigned char*>(data);
+
+    crc = ~crc;
+
+    // four bytes a step, assembled from the bytes so that it doesn't depend on the endianness or alignment.
+    for(; size>=4; size-=4, ptr+=4)
+    {
+        crc ^= static_cast<unsigned int>(ptr[0]) | (static_cast<unsigned int>(ptr[1])<<8) |
+               (static_cast<unsigned int>(ptr[2])<<16) | (static_cast<unsigned int>(ptr[3])<<24);
+        crc = table[3][crc & 0xff] ^ table[2][(crc>>8) & 0xff] ^ table[1][(crc>>16) & 0xff] ^ table[0][crc>>24];
+    }
+
+    for(; size>0; --size, ++ptr)
+    {
+        crc = table[0][(crc ^ *ptr) & 0xff] ^ (crc>>8);
+    }
+    return ~crc;
+}
+
+#endif
+
+bool checksumFile(const std::string& fileName, unsigned int& checksum)
+{
+    osgDB::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) return false;
+
+    std::vector<char> buffer(1<<20);
+    checksum = 0;
+    while(fin)
+    {
+        fin.read(&buffer[0], buffer.size());
+        checksum = crc32(checksum, &buffer[0], static_cast<size_t>(fin.gcount()));
+    }
+    return fin.eof();
+}
+
+// plugins that can only read from a file report the stream read as not implemented or not handled.
+bool readFromStreamNotSupported(const ReaderWriter::ReadResult& result)
+{
+    return result.status()==ReaderWriter::ReadResult::NOT_IMPLEMENTED ||
+           result.status()==ReaderWriter::ReadResult::FILE_NOT_HANDLED;
+}
+
+bool readFile(const std::string& fileName, std::string& data)
+{
+    osgDB::ifstream fin(fileName.c_str(), std::ios::in | std::ios::binary);
+    if (!fin) return false;
+
+    fin.seekg(0, std::ios::end);
+    std::streamoff size = fin.tellg();
+    fin.seekg(0, std::ios::beg);
+    if (size<0) return false;
+
+    data.resize(static_cast<size_t>(size));
+    if (size>0) fin.read(&data[0], size);
+    return fin.gcount()==size;
+}
+
+bool readChecksum(const std::string& fileName, unsigned int& checksum)
+{
+    osgDB::ifstream fin(fileName.c_str());
+    if (!fin) return false;
+
+    fin>>std::hex>>checksum;
+    return !fin.fail();
+}
+
+bool writeChecksum(const std::string& fileName, unsigned int checksum)
+{
+    osgDB::ofstream fout(fileName.c_str());
+    if (!fout) return false;
+
+    fout<<std::hex<<checksum<<std::endl;
+    fout.close();
+    return !fout.fail();
+}
+
+bool getFileStatus(const std::string& fileName, unsigned long long& size, double& modified)
+{
+    struct stat statbuf;
+    if (stat(fileName.c_str(), &statbuf)!=0) return false;
+
+    size = static_cast<unsigned long long>(statbuf.st_size);
+    modified = static_cast<double>(statbuf.st_mtime);
+    return true;
+}
+
+// rename over an existing file, atomic where the OS supports it.
+bool renameFile(const std::string& from, const std::string& to)
+{
+    if (rename(from.c_str(), to.c_str())==0) return true;
+
+#ifdef _WIN32
+    // rename doesn't replace an existing file on Windows.
+    remove(to.c_str());
+    return rename(from.c_str(), to.c_str())==0;
+#else
+    return false;
+#endif
+}
+
+bool isTemporaryFile(const std::string& fileName)
+{
+    return fileName.find(".partial")!=std::string::npos;
+}
+
+typedef std::pair<std::string, std::pair<unsigned long long, double> > FileStatus;
+typedef std::vector<FileStatus> FileStatusList;
+
+void collectFiles(const std::string& directory, FileStatusList& files)
+{
+    osgDB::DirectoryContents contents = osgDB::getDirectoryContents(directory);
+    for(osgDB::DirectoryContents::iterator itr = contents.begin();
+        itr != contents.end();
+        ++itr)
+    {
+        if (*itr=="." || *itr=="..") continue;
+
+        std::string fileName = osgDB::concatPaths(directory, *itr);
+        osgDB::FileType type = osgDB::fileType(fileName);
+        if (type==osgDB::DIRECTORY)
+        {
+            collectFiles(fileName, files);
+        }
+        else if (type==osgDB::REGULAR_FILE && osgDB::getLowerCaseFileExtension(fileName)!="crc" && !isTemporaryFile(fileName))
+        {
+            FileStatus status(fileName, std::pair<unsigned long long, double>(0, 0.0));
+            if (getFileStatus(fileName, status.second.first, status.second.second)) files.push_back(status);
+        }
+    }
+}
+
+} // FileCacheUtils
+
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// FileCache::WriteThread
+//
+class FileCache::WriteThread : public osg::Referenced, public OpenThreads::Thread
+{
+public:
+
+    WriteThread(FileCache* fileCache):
+        _fileCache(fileCache) {}
+
+    virtual void run()
+    {
+        FileCache* fc = _fileCache;
+        for(;;)
+        {
+            std::string cacheFileName;
+            osg::ref_ptr<PendingData> pendingData;
+            bool scan = false;
+            bool removeFiles = false;
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(fc->_mutex);
+                while(!fc->_done && fc->_pendingWrites.empty() && !fc->_cacheSizeExceeded &&
+                      !(fc->_maximumCacheSize>0 && !fc->_cachedFilesScanned))
+                {
+                    fc->_condition.wait(&fc->_mutex);
+                }
+
+                // finish the pending writes before exiting.
+                if (fc->_done && fc->_pendingWrites.empty()) return;
+
+                if (!fc->_pendingWrites.empty())
+                {
+                    PendingWrite& pendingWrite = fc->_pendingWrites.front();
+                    pendingWrite.inProgress = true;
+                    cacheFileName = pendingWrite.cacheFileName;
+                    pendingData = pendingWrite.data;
+                }
+
+                scan = fc->_maximumCacheSize>0 && !fc->_cachedFilesScanned;
+            }
+
+            if (scan) fc->scanCachedFiles();
+
+            if (pendingData.valid())
+            {
+                // the entry isn't replaced or removed by other threads while in progress, so stays at the front.
+                fc->writePendingData(cacheFileName, pendingData->data);
+
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(fc->_mutex);
+                fc->_pendingBytes -= pendingData->data.size();
+                fc->_pendingWrites.pop_front();
+                fc->_condition.broadcast();
+            }
+
+            {
+                OpenThreads::ScopedLock<OpenThreads::Mutex> lock(fc->_mutex);
+                removeFiles = fc->_cacheSizeExceeded;
+            }
+
+            if (removeFiles) fc->removeLeastRecentlyUsedFiles();
+        }
+    }
+
+protected:
+
+    virtual ~WriteThread() {}
+
+    FileCache* _fileCache;
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 // FileCache
 //
 FileCache::FileCache(const std::string& path):
     osg::Referenced(true),
-    _fileCachePath(path)
+    _fileCachePath(path),
+    _writeBehind(false),
+    _maximumPendingBytes(64*1024*1024),
+    _useChecksums(false),
+    _maximumCacheSize(0),
+    _pendingBytes(0),
+    _cacheSize(0),
+    _cacheSizeExceeded(false),
+    _cachedFilesScanned(false),
+    _done(false)
 {
     OSG_INFO<<"Constructed FileCache : "<<path<<std::endl;
 }
 
 FileCache::~FileCache()
 {
+    stopWriteThread();
+
     OSG_INFO<<"Destructed FileCache "<<std::endl;
 }
 
+void FileCache::setWriteBehind(bool flag)
+{
+    _writeBehind = flag;
+
+    if (_writeBehind) startWriteThread();
+    else if (getMaximumCacheSize()==0) stopWriteThread();
+}
+
+void FileCache::setMaximumCacheSize(unsigned long long numBytes)
+{
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _maximumCacheSize = numBytes;
+        if (_maximumCacheSize==0)
+        {
+            // without a limit there is no need to track the files.
+            _cachedFiles.clear();
+            _cacheSize = 0;
+            _cacheSizeExceeded = false;
+            _cachedFilesScanned = false;
+        }
+        else
+        {
+            _cacheSizeExceeded = _cacheSize>_maximumCacheSize;
+        }
+        _condition.broadcast();
+    }
+
+    if (numBytes>0) startWriteThread();
+    else if (!_writeBehind) stopWriteThread();
+}
+
+unsigned long long FileCache::getMaximumCacheSize() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return _maximumCacheSize;
+}
+
+unsigned int FileCache::getNumPendingWrites() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    return static_cast<unsigned int>(_pendingWrites.size());
+}
+
+void FileCache::flush() const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+    while(!_pendingWrites.empty())
+    {
+        _condition.wait(&_mutex);
+    }
+}
+
 bool FileCache::isFileAppropriateForFileCache(const std::string& originalFileName) const
 {
     return osgDB::containsServerAddress(originalFileName);
@@ -54,7 +390,15 @@ std::string FileCache::createCacheFileName(const std::string& originalFileName)
 
 bool FileCache::existsInCache(const std::string& originalFileName) const
 {
-    if (osgDB::fileExists(createCacheFileName(originalFileName)))
+    std::string cacheFileName = createCacheFileName(originalFileName);
+
+    bool pending = false;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        pending = findPendingData(cacheFileName)!=0;
+    }
+
+    if (pending || osgDB::fileExists(cacheFileName))
     {
         return !isCachedFileBlackListed(originalFileName);
     }
@@ -64,9 +408,28 @@ bool FileCache::existsInCache(const std::string& originalFileName) const
 ReaderWriter::ReadResult FileCache::readObject(const std::string& originalFileName, const osgDB::Options* options) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    if (cacheFileName.empty()) return 0;
+
+    osg::ref_ptr<PendingData> data;
+    std::string cachedData;
+    ReaderWriter* rw = getPendingData(cacheFileName, data);
+    if (rw)
+    {
+        OSG_INFO<<"FileCache::readObjectFromCache("<<originalFileName<<") from pending write of "<<cacheFileName<<std::endl;
+        std::istringstream iss(data->data, std::ios::in | std::ios::binary);
+        return rw->readObject(iss, options);
+    }
+    else if (checkCachedFile(cacheFileName, cachedData))
     {
         OSG_INFO<<"FileCache::readObjectFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+        rw = getCachedDataReaderWriter(cacheFileName, cachedData);
+        if (rw)
+        {
+            std::istringstream iss(cachedData, std::ios::in | std::ios::binary);
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            ReaderWriter::ReadResult result = rw->readObject(iss, streamOptions.get());
+            if (!FileCacheUtils::readFromStreamNotSupported(result)) return result;
+        }
         return osgDB::Registry::instance()->readObject(cacheFileName, options);
     }
     else
@@ -89,7 +452,24 @@ ReaderWriter::WriteResult FileCache::writeObject(const osg::Object& object, cons
         }
 
         OSG_INFO<<"FileCache::writeObjectToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeObject(object, cacheFileName, options);
+        ReaderWriter::WriteResult result;
+
+        ReaderWriter* rw = getWriteBehindReaderWriter(cacheFileName);
+        if (rw)
+        {
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            std::ostringstream oss(std::ios::out | std::ios::binary);
+            result = rw->writeObject(object, oss, streamOptions.get());
+            if (result.success()) queueWrite(cacheFileName, oss.str());
+        }
+
+        if (!result.success())
+        {
+            std::string temporaryFileName = createTemporaryFileName(cacheFileName);
+            result = osgDB::Registry::instance()->writeObject(object, temporaryFileName, options);
+            if (result.success()) result = commitWrittenFile(temporaryFileName, cacheFileName);
+        }
+
         if (result.success())
         {
             removeFileFromBlackListed(originalFileName);
@@ -102,9 +482,28 @@ ReaderWriter::WriteResult FileCache::writeObject(const osg::Object& object, cons
 ReaderWriter::ReadResult FileCache::readImage(const std::string& originalFileName, const osgDB::Options* options) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    if (cacheFileName.empty()) return 0;
+
+    osg::ref_ptr<PendingData> data;
+    std::string cachedData;
+    ReaderWriter* rw = getPendingData(cacheFileName, data);
+    if (rw)
+    {
+        OSG_INFO<<"FileCache::readImageFromCache("<<originalFileName<<") from pending write of "<<cacheFileName<<std::endl;
+        std::istringstream iss(data->data, std::ios::in | std::ios::binary);
+        return rw->readImage(iss, options);
+    }
+    else if (checkCachedFile(cacheFileName, cachedData))
     {
         OSG_INFO<<"FileCache::readImageFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+        rw = getCachedDataReaderWriter(cacheFileName, cachedData);
+        if (rw)
+        {
+            std::istringstream iss(cachedData, std::ios::in | std::ios::binary);
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            ReaderWriter::ReadResult result = rw->readImage(iss, streamOptions.get());
+            if (!FileCacheUtils::readFromStreamNotSupported(result)) return result;
+        }
         return osgDB::Registry::instance()->readImage(cacheFileName, options);
     }
     else
@@ -127,7 +526,24 @@ ReaderWriter::WriteResult FileCache::writeImage(const osg::Image& image, const s
         }
 
         OSG_INFO<<"FileCache::writeImageToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeImage(image, cacheFileName, options);
+        ReaderWriter::WriteResult result;
+
+        ReaderWriter* rw = getWriteBehindReaderWriter(cacheFileName);
+        if (rw)
+        {
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            std::ostringstream oss(std::ios::out | std::ios::binary);
+            result = rw->writeImage(image, oss, streamOptions.get());
+            if (result.success()) queueWrite(cacheFileName, oss.str());
+        }
+
+        if (!result.success())
+        {
+            std::string temporaryFileName = createTemporaryFileName(cacheFileName);
+            result = osgDB::Registry::instance()->writeImage(image, temporaryFileName, options);
+            if (result.success()) result = commitWrittenFile(temporaryFileName, cacheFileName);
+        }
+
         if (result.success())
         {
             removeFileFromBlackListed(originalFileName);
@@ -140,9 +556,28 @@ ReaderWriter::WriteResult FileCache::writeImage(const osg::Image& image, const s
 ReaderWriter::ReadResult FileCache::readHeightField(const std::string& originalFileName, const osgDB::Options* options) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    if (cacheFileName.empty()) return 0;
+
+    osg::ref_ptr<PendingData> data;
+    std::string cachedData;
+    ReaderWriter* rw = getPendingData(cacheFileName, data);
+    if (rw)
+    {
+        OSG_INFO<<"FileCache::readHeightFieldFromCache("<<originalFileName<<") from pending write of "<<cacheFileName<<std::endl;
+        std::istringstream iss(data->data, std::ios::in | std::ios::binary);
+        return rw->readHeightField(iss, options);
+    }
+    else if (checkCachedFile(cacheFileName, cachedData))
     {
         OSG_INFO<<"FileCache::readHeightFieldFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+        rw = getCachedDataReaderWriter(cacheFileName, cachedData);
+        if (rw)
+        {
+            std::istringstream iss(cachedData, std::ios::in | std::ios::binary);
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            ReaderWriter::ReadResult result = rw->readHeightField(iss, streamOptions.get());
+            if (!FileCacheUtils::readFromStreamNotSupported(result)) return result;
+        }
         return osgDB::Registry::instance()->readHeightField(cacheFileName, options);
     }
     else
@@ -165,7 +600,24 @@ ReaderWriter::WriteResult FileCache::writeHeightField(const osg::HeightField& hf
         }
 
         OSG_INFO<<"FileCache::writeHeightFieldToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeHeightField(hf, cacheFileName, options);
+        ReaderWriter::WriteResult result;
+
+        ReaderWriter* rw = getWriteBehindReaderWriter(cacheFileName);
+        if (rw)
+        {
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            std::ostringstream oss(std::ios::out | std::ios::binary);
+            result = rw->writeHeightField(hf, oss, streamOptions.get());
+            if (result.success()) queueWrite(cacheFileName, oss.str());
+        }
+
+        if (!result.success())
+        {
+            std::string temporaryFileName = createTemporaryFileName(cacheFileName);
+            result = osgDB::Registry::instance()->writeHeightField(hf, temporaryFileName, options);
+            if (result.success()) result = commitWrittenFile(temporaryFileName, cacheFileName);
+        }
+
         if (result.success())
         {
             removeFileFromBlackListed(originalFileName);
@@ -178,9 +630,32 @@ ReaderWriter::WriteResult FileCache::writeHeightField(const osg::HeightField& hf
 ReaderWriter::ReadResult FileCache::readNode(const std::string& originalFileName, const osgDB::Options* options, bool buildKdTreeIfRequired) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    if (cacheFileName.empty()) return 0;
+
+    osg::ref_ptr<PendingData> data;
+    std::string cachedData;
+    ReaderWriter* rw = getPendingData(cacheFileName, data);
+    if (rw)
+    {
+        OSG_INFO<<"FileCache::readNodeFromCache("<<originalFileName<<") from pending write of "<<cacheFileName<<std::endl;
+        std::istringstream iss(data->data, std::ios::in | std::ios::binary);
+        return rw->readNode(iss, options);
+    }
+    else if (checkCachedFile(cacheFileName, cachedData))
     {
         OSG_INFO<<"FileCache::readNodeFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+        rw = getCachedDataReaderWriter(cacheFileName, cachedData);
+        if (rw)
+        {
+            std::istringstream iss(cachedData, std::ios::in | std::ios::binary);
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            ReaderWriter::ReadResult result = rw->readNode(iss, streamOptions.get());
+            if (!FileCacheUtils::readFromStreamNotSupported(result))
+            {
+                if (buildKdTreeIfRequired) osgDB::Registry::instance()->_buildKdTreeIfRequired(result, options);
+                return result;
+            }
+        }
         return osgDB::Registry::instance()->readNode(cacheFileName, options, buildKdTreeIfRequired);
     }
     else
@@ -203,7 +678,24 @@ ReaderWriter::WriteResult FileCache::writeNode(const osg::Node& node, const std:
         }
 
         OSG_INFO<<"FileCache::writeNodeToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeNode(node, cacheFileName, options);
+        ReaderWriter::WriteResult result;
+
+        ReaderWriter* rw = getWriteBehindReaderWriter(cacheFileName);
+        if (rw)
+        {
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            std::ostringstream oss(std::ios::out | std::ios::binary);
+            result = rw->writeNode(node, oss, streamOptions.get());
+            if (result.success()) queueWrite(cacheFileName, oss.str());
+        }
+
+        if (!result.success())
+        {
+            std::string temporaryFileName = createTemporaryFileName(cacheFileName);
+            result = osgDB::Registry::instance()->writeNode(node, temporaryFileName, options);
+            if (result.success()) result = commitWrittenFile(temporaryFileName, cacheFileName);
+        }
+
         if (result.success())
         {
             removeFileFromBlackListed(originalFileName);
@@ -213,13 +705,31 @@ ReaderWriter::WriteResult FileCache::writeNode(const osg::Node& node, const std:
     return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
 }
 
-
 ReaderWriter::ReadResult FileCache::readShader(const std::string& originalFileName, const osgDB::Options* options) const
 {
     std::string cacheFileName = createCacheFileName(originalFileName);
-    if (!cacheFileName.empty() && osgDB::fileExists(cacheFileName))
+    if (cacheFileName.empty()) return 0;
+
+    osg::ref_ptr<PendingData> data;
+    std::string cachedData;
+    ReaderWriter* rw = getPendingData(cacheFileName, data);
+    if (rw)
+    {
+        OSG_INFO<<"FileCache::readShaderFromCache("<<originalFileName<<") from pending write of "<<cacheFileName<<std::endl;
+        std::istringstream iss(data->data, std::ios::in | std::ios::binary);
+        return rw->readShader(iss, options);
+    }
+    else if (checkCachedFile(cacheFileName, cachedData))
     {
         OSG_INFO<<"FileCache::readShaderFromCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
+        rw = getCachedDataReaderWriter(cacheFileName, cachedData);
+        if (rw)
+        {
+            std::istringstream iss(cachedData, std::ios::in | std::ios::binary);
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            ReaderWriter::ReadResult result = rw->readShader(iss, streamOptions.get());
+            if (!FileCacheUtils::readFromStreamNotSupported(result)) return result;
+        }
         return osgDB::Registry::instance()->readShader(cacheFileName, options);
     }
     else
@@ -242,7 +752,24 @@ ReaderWriter::WriteResult FileCache::writeShader(const osg::Shader& shader, cons
         }
 
         OSG_INFO<<"FileCache::writeShaderToCache("<<originalFileName<<") as "<<cacheFileName<<std::endl;
-        ReaderWriter::WriteResult result = osgDB::Registry::instance()->writeShader(shader, cacheFileName, options);
+        ReaderWriter::WriteResult result;
+
+        ReaderWriter* rw = getWriteBehindReaderWriter(cacheFileName);
+        if (rw)
+        {
+            osg::ref_ptr<osgDB::Options> streamOptions = createStreamOptions(cacheFileName, options);
+            std::ostringstream oss(std::ios::out | std::ios::binary);
+            result = rw->writeShader(shader, oss, streamOptions.get());
+            if (result.success()) queueWrite(cacheFileName, oss.str());
+        }
+
+        if (!result.success())
+        {
+            std::string temporaryFileName = createTemporaryFileName(cacheFileName);
+            result = osgDB::Registry::instance()->writeShader(shader, temporaryFileName, options);
+            if (result.success()) result = commitWrittenFile(temporaryFileName, cacheFileName);
+        }
+
         if (result.success())
         {
             removeFileFromBlackListed(originalFileName);
@@ -252,7 +779,6 @@ ReaderWriter::WriteResult FileCache::writeShader(const osg::Shader& shader, cons
     return ReaderWriter::WriteResult::FILE_NOT_HANDLED;
 }
 
-
 bool FileCache::isCachedFileBlackListed(const std::string& originalFileName) const
 {
     for(DatabaseRevisionsList::const_iterator itr = _databaseRevisionsList.begin();
@@ -482,3 +1008,346 @@ FileList* FileCache::readFileList(const std::string& originalFileName) const
     }
     return fileList.release();
 }
+
+void FileCache::startWriteThread()
+{
+    if (_writeThread.valid()) return;
+
+    _done = false;
+    _writeThread = new WriteThread(this);
+    _writeThread->start();
+}
+
+void FileCache::stopWriteThread()
+{
+    if (!_writeThread) return;
+
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _done = true;
+        _condition.broadcast();
+    }
+
+    _writeThread->join();
+    _writeThread = 0;
+}
+
+ReaderWriter* FileCache::getWriteBehindReaderWriter(const std::string& cacheFileName) const
+{
+    if (!_writeBehind || !_writeThread) return 0;
+    return osgDB::Registry::instance()->getReaderWriterForExtension(osgDB::getLowerCaseFileExtension(cacheFileName));
+}
+
+osgDB::Options* FileCache::createStreamOptions(const std::string& cacheFileName, const osgDB::Options* options) const
+{
+    osg::ref_ptr<osgDB::Options> local_opt = options ? static_cast<osgDB::Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new osgDB::Options;
+    local_opt->getDatabasePathList().push_front(osgDB::getFilePath(cacheFileName));
+
+    // the native format's stream writers take the file type from the options rather than the file extension.
+    std::string ext = osgDB::getLowerCaseFileExtension(cacheFileName);
+    if (ext=="osgt") local_opt->setPluginStringData("fileType", "Ascii");
+    else if (ext=="osgx") local_opt->setPluginStringData("fileType", "XML");
+    else if (ext=="osgb") local_opt->setPluginStringData("fileType", "Binary");
+
+    return local_opt.release();
+}
+
+FileCache::PendingData* FileCache::findPendingData(const std::string& cacheFileName) const
+{
+    for(PendingWriteList::const_reverse_iterator itr = _pendingWrites.rbegin();
+        itr != _pendingWrites.rend();
+        ++itr)
+    {
+        if (itr->cacheFileName==cacheFileName) return itr->data.get();
+    }
+    return 0;
+}
+
+ReaderWriter* FileCache::getPendingData(const std::string& cacheFileName, osg::ref_ptr<PendingData>& data) const
+{
+    {
+        // only take a reference to the data under the lock, it isn't modified once queued so is read without it.
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        data = findPendingData(cacheFileName);
+        if (!data) return 0;
+    }
+
+    return osgDB::Registry::instance()->getReaderWriterForExtension(osgDB::getLowerCaseFileExtension(cacheFileName));
+}
+
+void FileCache::queueWrite(const std::string& cacheFileName, const std::string& data) const
+{
+    // copy the data before taking the lock.
+    osg::ref_ptr<PendingData> pendingData = new PendingData(data);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // bound the memory held by pending writes by waiting for the background thread to catch up.
+    while(!_pendingWrites.empty() && _pendingBytes+data.size()>_maximumPendingBytes)
+    {
+        _condition.wait(&_mutex);
+    }
+
+    // replace an earlier write of the same file that hasn't been started, readers may still hold the data it replaces.
+    for(PendingWriteList::reverse_iterator itr = _pendingWrites.rbegin();
+        itr != _pendingWrites.rend();
+        ++itr)
+    {
+        if (itr->cacheFileName==cacheFileName && !itr->inProgress)
+        {
+            _pendingBytes -= itr->data->data.size();
+            itr->data = pendingData;
+            _pendingBytes += data.size();
+            return;
+        }
+    }
+
+    _pendingWrites.push_back(PendingWrite());
+    _pendingWrites.back().cacheFileName = cacheFileName;
+    _pendingWrites.back().data = pendingData;
+    _pendingBytes += data.size();
+
+    _condition.broadcast();
+}
+
+std::string FileCache::createTemporaryFileName(const std::string& cacheFileName) const
+{
+    // keep the extension so the file can be written by the osgDB::Registry, the tick distinguishes processes sharing the cache.
+    std::ostringstream oss;
+    oss<<osgDB::getNameLessExtension(cacheFileName)<<".partial"<<osg::Timer::instance()->tick()<<"_"<<(++_numTemporaryFiles);
+
+    std::string ext = osgDB::getFileExtension(cacheFileName);
+    if (!ext.empty()) oss<<"."<<ext;
+
+    return oss.str();
+}
+
+bool FileCache::commitFile(const std::string& temporaryFileName, const std::string& cacheFileName, unsigned int checksum, unsigned long long size) const
+{
+    // the checksum of an earlier version of the file no longer applies, files without one are treated as not cached.
+    std::string checksumFileName = cacheFileName + ".crc";
+    if (osgDB::fileExists(checksumFileName))
+    {
+        remove(checksumFileName.c_str());
+    }
+
+    if (!FileCacheUtils::renameFile(temporaryFileName, cacheFileName))
+    {
+        OSG_NOTICE<<"FileCache : could not rename "<<temporaryFileName<<" to "<<cacheFileName<<std::endl;
+        remove(temporaryFileName.c_str());
+        return false;
+    }
+
+    // write the checksum once the file is in place, so a checksum never exists without the file it describes.
+    if (_useChecksums)
+    {
+        std::string temporaryChecksumFileName = createTemporaryFileName(checksumFileName);
+        if (!FileCacheUtils::writeChecksum(temporaryChecksumFileName, checksum) ||
+            !FileCacheUtils::renameFile(temporaryChecksumFileName, checksumFileName))
+        {
+            OSG_NOTICE<<"FileCache : could not write checksum file "<<checksumFileName<<std::endl;
+            remove(temporaryChecksumFileName.c_str());
+        }
+    }
+
+    recordAccess(cacheFileName, size, true);
+    return true;
+}
+
+ReaderWriter::WriteResult FileCache::commitWrittenFile(const std::string& temporaryFileName, const std::string& cacheFileName) const
+{
+    unsigned long long size = 0;
+    double modified = 0.0;
+    FileCacheUtils::getFileStatus(temporaryFileName, size, modified);
+
+    unsigned int checksum = 0;
+    if (_useChecksums && !FileCacheUtils::checksumFile(temporaryFileName, checksum))
+    {
+        remove(temporaryFileName.c_str());
+        return ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE;
+    }
+
+    return commitFile(temporaryFileName, cacheFileName, checksum, size) ?
+        ReaderWriter::WriteResult(ReaderWriter::WriteResult::FILE_SAVED) :
+        ReaderWriter::WriteResult(ReaderWriter::WriteResult::ERROR_IN_WRITING_FILE);
+}
+
+bool FileCache::writePendingData(const std::string& cacheFileName, const std::string& data) const
+{
+    std::string temporaryFileName = createTemporaryFileName(cacheFileName);
+
+    osgDB::ofstream fout(temporaryFileName.c_str(), std::ios::out | std::ios::binary);
+    if (fout)
+    {
+        fout.write(data.data(), data.size());
+        fout.close();
+    }
+
+    if (!fout)
+    {
+        OSG_NOTICE<<"FileCache : could not write "<<temporaryFileName<<std::endl;
+        remove(temporaryFileName.c_str());
+        return false;
+    }
+
+    unsigned int checksum = _useChecksums ? FileCacheUtils::crc32(0, data.data(), data.size()) : 0;
+    return commitFile(temporaryFileName, cacheFileName, checksum, data.size());
+}
+
+bool FileCache::checkCachedFile(const std::string& cacheFileName, std::string& data) const
+{
+    if (!osgDB::fileExists(cacheFileName)) return false;
+
+    unsigned long long size = 0;
+    if (_useChecksums)
+    {
+        std::string checksumFileName = cacheFileName + ".crc";
+
+        // files without a checksum were cached before checksums were enabled or lost it, so can't be trusted.
+        unsigned int expected = 0;
+        if (!FileCacheUtils::readChecksum(checksumFileName, expected))
+        {
+            OSG_INFO<<"FileCache : "<<cacheFileName<<" has no checksum, treating it as not cached."<<std::endl;
+            return false;
+        }
+
+        // read the file once, the caller parses the same data that the checksum is computed over.
+        if (!FileCacheUtils::readFile(cacheFileName, data) ||
+            FileCacheUtils::crc32(0, data.data(), data.size())!=expected)
+        {
+            OSG_WARN<<"FileCache : "<<cacheFileName<<" failed its checksum, removing it from the cache."<<std::endl;
+            data.clear();
+            remove(cacheFileName.c_str());
+            remove(checksumFileName.c_str());
+
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            CachedFileMap::iterator itr = _cachedFiles.find(cacheFileName);
+            if (itr!=_cachedFiles.end())
+            {
+                _cacheSize -= itr->second.size;
+                _cachedFiles.erase(itr);
+            }
+            return false;
+        }
+        size = data.size();
+    }
+    else
+    {
+        double modified = 0.0;
+        FileCacheUtils::getFileStatus(cacheFileName, size, modified);
+    }
+
+    recordAccess(cacheFileName, size, false);
+
+    return true;
+}
+
+ReaderWriter* FileCache::getCachedDataReaderWriter(const std::string& cacheFileName, const std::string& data) const
+{
+    // without checksums the file isn't read in advance, so is read by name.
+    if (data.empty()) return 0;
+    return osgDB::Registry::instance()->getReaderWriterForExtension(osgDB::getLowerCaseFileExtension(cacheFileName));
+}
+
+void FileCache::recordAccess(const std::string& cacheFileName, unsigned long long size, bool written) const
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // files are only tracked when the size of the cache is limited.
+    if (_maximumCacheSize==0) return;
+
+    CachedFile& cachedFile = _cachedFiles[cacheFileName];
+    if (written || cachedFile.size==0)
+    {
+        _cacheSize = _cacheSize - cachedFile.size + size;
+        cachedFile.size = size;
+    }
+    cachedFile.lastAccess = static_cast<double>(time(0));
+
+    if (_cacheSize>_maximumCacheSize)
+    {
+        _cacheSizeExceeded = true;
+        _condition.broadcast();
+    }
+}
+
+void FileCache::scanCachedFiles()
+{
+    OSG_INFO<<"FileCache : scanning "<<_fileCachePath<<std::endl;
+
+    FileCacheUtils::FileStatusList files;
+    FileCacheUtils::collectFiles(_fileCachePath, files);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+
+    // merge with the files accessed while scanning, the modification time standing in for the last access of the others.
+    for(FileCacheUtils::FileStatusList::iterator itr = files.begin();
+        itr != files.end();
+        ++itr)
+    {
+        CachedFile& cachedFile = _cachedFiles[itr->first];
+        cachedFile.size = itr->second.first;
+        cachedFile.lastAccess = osg::maximum(cachedFile.lastAccess, itr->second.second);
+    }
+
+    _cacheSize = 0;
+    for(CachedFileMap::iterator itr = _cachedFiles.begin();
+        itr != _cachedFiles.end();
+        ++itr)
+    {
+        _cacheSize += itr->second.size;
+    }
+
+    _cachedFilesScanned = true;
+    _cacheSizeExceeded = _maximumCacheSize>0 && _cacheSize>_maximumCacheSize;
+
+    OSG_INFO<<"FileCache : "<<_cachedFiles.size()<<" files, "<<_cacheSize<<" bytes in the cache"<<std::endl;
+}
+
+void FileCache::removeLeastRecentlyUsedFiles()
+{
+    typedef std::vector< std::pair<double, std::string> > FilesByAccess;
+    FilesByAccess filesByAccess;
+    unsigned long long targetSize = 0;
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+        _cacheSizeExceeded = false;
+        if (_maximumCacheSize==0 || _cacheSize<=_maximumCacheSize) return;
+
+        // remove down to 90% of the limit so that files aren't removed on every write.
+        targetSize = _maximumCacheSize - _maximumCacheSize/10;
+
+        filesByAccess.reserve(_cachedFiles.size());
+        for(CachedFileMap::iterator itr = _cachedFiles.begin();
+            itr != _cachedFiles.end();
+            ++itr)
+        {
+            filesByAccess.push_back(std::pair<double, std::string>(itr->second.lastAccess, itr->first));
+        }
+    }
+
+    std::sort(filesByAccess.begin(), filesByAccess.end());
+
+    unsigned int numRemoved = 0;
+    for(FilesByAccess::iterator itr = filesByAccess.begin();
+        itr != filesByAccess.end();
+        ++itr)
+    {
+        {
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_mutex);
+            if (_cacheSize<=targetSize) break;
+
+            CachedFileMap::iterator citr = _cachedFiles.find(itr->second);
+            if (citr==_cachedFiles.end()) continue;
+
+            _cacheSize -= citr->second.size;
+            _cachedFiles.erase(citr);
+        }
+
+        remove(itr->second.c_str());
+        remove((itr->second+".crc").c_str());
+        ++numRemoved;
+    }
+
+    OSG_INFO<<"FileCache : removed "<<numRemoved<<" least recently used files, "<<_cacheSize<<" bytes in the cache"<<std::endl;
+}
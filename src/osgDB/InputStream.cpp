@@ -20,13 +20,14 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ObjectWrapper>
 #include <osgDB/ConvertBase64>
+#include <osgDB/MappedFile>
 
 using namespace osgDB;
 
 static std::string s_lastSchema;
 
 InputStream::InputStream( const osgDB::Options* options )
-    :   _fileVersion(0), _useSchemaData(false), _forceReadingImage(false), _dataDecompress(0)
+    :   _fileVersion(0), _useSchemaData(false), _alignedArrays(false), _forceReadingImage(false), _decompressedBuffer(0), _dataDecompress(0)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -76,6 +77,8 @@ InputStream::~InputStream()
 {
     if (_dataDecompress)
         delete _dataDecompress;
+    if (_decompressedBuffer)
+        delete _decompressedBuffer;
 }
 
 int InputStream::getFileVersion( const std::string& d ) const
@@ -990,6 +993,7 @@ InputStream::ReadType InputStream::start( InputIterator* inIterator )
         unsigned int attributes; *this >> attributes;
         if ( attributes&0x4 ) inIterator->setSupportBinaryBrackets( true );
         if ( attributes&0x2 ) _useSchemaData = true;
+        _alignedArrays = ( attributes&0x8 )!=0;
 
         // Record custom domains
         if ( attributes&0x1 )
@@ -1028,6 +1032,23 @@ InputStream::ReadType InputStream::start( InputIterator* inIterator )
     return type;
 }
 
+void InputStream::readArrayAlignment()
+{
+    if ( !_alignedArrays ) return;
+
+    unsigned char padding = 0;
+    _in->readUChar( padding );
+    if ( padding>=ARRAY_ALIGNMENT )
+    {
+        throwException( "InputStream: Invalid array alignment." );
+        return;
+    }
+
+    char buffer[ARRAY_ALIGNMENT];
+    _in->readCharArray( buffer, padding );
+    checkStream();
+}
+
 void InputStream::decompress()
 {
     if ( !isBinary() ) return;
@@ -1036,7 +1057,6 @@ void InputStream::decompress()
     std::string compressorName; *this >> compressorName;
     if ( compressorName!="0" )
     {
-        std::string data;
         _fields.push_back( "Decompression" );
 
         BaseCompressor* compressor = Registry::instance()->getObjectWrapperManager()->findCompressor(compressorName);
@@ -1046,11 +1066,12 @@ void InputStream::decompress()
             return;
         }
 
-        if ( !compressor->decompress(*(_in->getStream()), data) )
+        if ( !compressor->decompress(*(_in->getStream()), _decompressedData) )
             throwException( "InputStream: Failed to decompress stream." );
         if ( getException() ) return;
 
-        _dataDecompress = new std::stringstream(data);
+        _decompressedBuffer = new MemoryStreamBuffer( _decompressedData.data(), _decompressedData.size() );
+        _dataDecompress = new std::istream( _decompressedBuffer );
         _in->setStream( _dataDecompress );
         _fields.pop_back();
     }
@@ -1120,7 +1141,6 @@ void InputStream::readArrayImplementation( T* a, unsigned int numComponentsPerEl
         if ( isBinary() )
         {
             readComponentArray( (char*)&((*a)[0]), size, numComponentsPerElements, componentSizeInBytes );
-            checkStream();
         }
         else
         {
@@ -0,0 +1,150 @@
+/* -*-c++-*- OpenSceneGraph - Copyright (C) 1998-2008 Robert Osfield
+ *
+ * This library is open source and may be redistributed and/or modified under
+ * the terms of the OpenSceneGraph Public License (OSGPL) version 0.0 or
+ * (at your option) any later version.  The full license is in LICENSE file
+ * included with this distribution, and on the openscenegraph.org website.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * OpenSceneGraph Public License for more details.
+*/
+
+#include <osgDB/MappedFile>
+#include <osgDB/ConvertUTF>
+#include <osg/Notify>
+
+#include <osg/Config>
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/types.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+using namespace osgDB;
+
+MappedFile::MappedFile(const std::string& filename):
+    _data(0),
+    _size(0),
+    _opened(false)
+#ifdef _WIN32
+    ,_fileHandle(INVALID_HANDLE_VALUE),
+    _mappingHandle(0)
+#endif
+{
+#ifdef _WIN32
+    #ifdef OSG_USE_UTF8_FILENAME
+    HANDLE fileHandle = CreateFileW(convertUTF8toUTF16(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    #else
+    HANDLE fileHandle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    #endif
+    if (fileHandle==INVALID_HANDLE_VALUE) return;
+    _fileHandle = fileHandle;
+    _opened = true;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart==0) return;
+    _size = static_cast<size_t>(fileSize.QuadPart);
+
+    HANDLE mappingHandle = CreateFileMapping(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mappingHandle)
+    {
+        OSG_INFO<<"MappedFile::MappedFile() unable to map "<<filename<<std::endl;
+        _size = 0;
+        _opened = false;
+        return;
+    }
+    _mappingHandle = mappingHandle;
+
+    _data = static_cast<const char*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!_data)
+    {
+        _size = 0;
+        _opened = false;
+    }
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd<0) return;
+
+    struct stat statbuf;
+    if (fstat(fd, &statbuf)==0)
+    {
+        _opened = true;
+        _size = static_cast<size_t>(statbuf.st_size);
+        if (_size>0)
+        {
+            void* ptr = mmap(0, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr!=MAP_FAILED)
+            {
+                _data = static_cast<const char*>(ptr);
+            }
+            else
+            {
+                OSG_INFO<<"MappedFile::MappedFile() unable to map "<<filename<<std::endl;
+                _size = 0;
+                _opened = false;
+            }
+        }
+    }
+
+    // the mapping keeps its own reference to the file.
+    ::close(fd);
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (_data) UnmapViewOfFile(_data);
+    if (_mappingHandle) CloseHandle(static_cast<HANDLE>(_mappingHandle));
+    if (_fileHandle!=INVALID_HANDLE_VALUE) CloseHandle(static_cast<HANDLE>(_fileHandle));
+#else
+    if (_data) munmap(const_cast<char*>(_data), _size);
+#endif
+}
+
+MemoryStreamBuffer::MemoryStreamBuffer(const char* data, size_t size)
+{
+    // the get area is never written to, std::streambuf just doesn't have a const interface.
+    char* begin = const_cast<char*>(data);
+    setg(begin, begin, begin+size);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+
+    off_type position = 0;
+    switch(dir)
+    {
+        case(std::ios_base::beg): position = off; break;
+        case(std::ios_base::cur): position = (gptr()-eback()) + off; break;
+        case(std::ios_base::end): position = (egptr()-eback()) + off; break;
+        default: return pos_type(off_type(-1));
+    }
+
+    if (position<0 || position>(egptr()-eback())) return pos_type(off_type(-1));
+
+    setg(eback(), eback()+position, egptr());
+    return pos_type(position);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+std::streamsize MemoryStreamBuffer::showmanyc()
+{
+    std::streamsize remaining = egptr()-gptr();
+    return remaining>0 ? remaining : -1;
+}
@@ -12,9 +12,12 @@
 */
 
 #include <osg/Texture>
+#include <osg/Geometry>
 #include <osgDB/ObjectCache>
 #include <osgDB/Options>
 
+#include <set>
+
 using namespace osgDB;
 
 bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair& lhs, const ObjectCache::FileNameOptionsPair& rhs) const
@@ -37,12 +40,108 @@ bool ObjectCache::ClassComp::operator() (const ObjectCache::FileNameOptionsPair&
     return lhs.second < rhs.second;
 }
 
+namespace ObjectCacheUtils
+{
+
+// estimate of the memory used by the data an object holds, the Images, Arrays and PrimitiveSets that make up
+// the bulk of loaded files.
+struct EstimateNumBytes : public osg::NodeVisitor
+{
+    EstimateNumBytes() :
+        osg::NodeVisitor(osg::NodeVisitor::TRAVERSE_ALL_CHILDREN),
+        numBytes(0)
+    {}
+
+    unsigned long long numBytes;
+    std::set<const osg::BufferData*> visited;
+
+    void add(const osg::BufferData* data)
+    {
+        if (data && visited.insert(data).second) numBytes += data->getTotalDataSize();
+    }
+
+    void add(const osg::StateAttribute* sa)
+    {
+        const osg::Texture* texture = sa ? sa->asTexture() : 0;
+        if (texture)
+        {
+            for(unsigned int i=0; i<texture->getNumImages(); ++i)
+            {
+                add(texture->getImage(i));
+            }
+        }
+    }
+
+    void add(const osg::StateSet* stateset)
+    {
+        if (!stateset) return;
+
+        const osg::StateSet::TextureAttributeList& tal = stateset->getTextureAttributeList();
+        for(osg::StateSet::TextureAttributeList::const_iterator titr = tal.begin();
+            titr != tal.end();
+            ++titr)
+        {
+            for(osg::StateSet::AttributeList::const_iterator aitr = titr->begin();
+                aitr != titr->end();
+                ++aitr)
+            {
+                add(aitr->second.first.get());
+            }
+        }
+    }
+
+    unsigned long long estimate(osg::Object* object)
+    {
+        numBytes = 0;
+        visited.clear();
+
+        if (object->asNode()) object->asNode()->accept(*this);
+        else if (object->asStateSet()) add(object->asStateSet());
+        else if (object->asStateAttribute()) add(object->asStateAttribute());
+        else add(dynamic_cast<const osg::BufferData*>(object));
+
+        return numBytes;
+    }
+
+    virtual void apply(osg::Node& node)
+    {
+        add(node.getStateSet());
+        traverse(node);
+    }
+
+    virtual void apply(osg::Geometry& geometry)
+    {
+        osg::Geometry::ArrayList arrays;
+        geometry.getArrayList(arrays);
+        for(osg::Geometry::ArrayList::iterator itr = arrays.begin();
+            itr != arrays.end();
+            ++itr)
+        {
+            add(itr->get());
+        }
+
+        osg::Geometry::PrimitiveSetList& primitives = geometry.getPrimitiveSetList();
+        for(osg::Geometry::PrimitiveSetList::iterator itr = primitives.begin();
+            itr != primitives.end();
+            ++itr)
+        {
+            add(itr->get());
+        }
+
+        apply(static_cast<osg::Node&>(geometry));
+    }
+};
+
+} // ObjectCacheUtils
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 //
 // ObjectCache
 //
 ObjectCache::ObjectCache():
-    osg::Referenced(true)
+    osg::Referenced(true),
+    _maximumNumberOfObjects(0),
+    _maximumNumberOfBytes(0)
 {
 //    OSG_NOTICE<<"Constructed ObjectCache"<<std::endl;
 }
@@ -52,54 +151,211 @@ ObjectCache::~ObjectCache()
 //    OSG_NOTICE<<"Destructed ObjectCache"<<std::endl;
 }
 
+ObjectCache::Stripe& ObjectCache::getStripe(const std::string& fileName)
+{
+    // FNV-1a hash of the file name, so all the entries for a file are in one stripe.
+    unsigned int hash = 2166136261u;
+    for(std::string::const_iterator itr = fileName.begin(); itr != fileName.end(); ++itr)
+    {
+        hash ^= static_cast<unsigned char>(*itr);
+        hash *= 16777619u;
+    }
+    return _stripes[hash % NUM_STRIPES];
+}
+
+void ObjectCache::setMaximumNumberOfObjects(unsigned int numObjects)
+{
+    _maximumNumberOfObjects = numObjects;
+
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_stripes[i].mutex);
+        applyLimits(_stripes[i]);
+    }
+}
+
+void ObjectCache::setMaximumNumberOfBytes(unsigned long long numBytes)
+{
+    _maximumNumberOfBytes = numBytes;
+
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_stripes[i].mutex);
+        applyLimits(_stripes[i]);
+    }
+}
+
+unsigned int ObjectCache::getNumObjects() const
+{
+    unsigned int numObjects = 0;
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(const_cast<OpenThreads::Mutex&>(_stripes[i].mutex));
+        numObjects += static_cast<unsigned int>(_stripes[i].objectCache.size());
+    }
+    return numObjects;
+}
+
+unsigned long long ObjectCache::getNumBytes() const
+{
+    unsigned long long numBytes = 0;
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(const_cast<OpenThreads::Mutex&>(_stripes[i].mutex));
+        numBytes += _stripes[i].numBytes;
+    }
+    return numBytes;
+}
+
+void ObjectCache::resetStats()
+{
+    _numHits.exchange(0);
+    _numMisses.exchange(0);
+    _numEvictions.exchange(0);
+}
+
+void ObjectCache::reportStats(unsigned int frameNumber, osg::Stats& stats) const
+{
+    stats.setAttribute(frameNumber, "ObjectCache objects", static_cast<double>(getNumObjects()));
+    stats.setAttribute(frameNumber, "ObjectCache bytes", static_cast<double>(getNumBytes()));
+    stats.setAttribute(frameNumber, "ObjectCache hits", static_cast<double>(_numHits));
+    stats.setAttribute(frameNumber, "ObjectCache misses", static_cast<double>(_numMisses));
+    stats.setAttribute(frameNumber, "ObjectCache evictions", static_cast<double>(_numEvictions));
+}
+
+void ObjectCache::addEntry(Stripe& stripe, const FileNameOptionsPair& key, osg::Object* object, double timestamp, unsigned long long numBytes)
+{
+    ObjectCacheMap::iterator itr = stripe.objectCache.find(key);
+    if (itr!=stripe.objectCache.end()) removeEntry(stripe, itr);
+
+    CacheEntry& entry = stripe.objectCache[key];
+    entry.object = object;
+    entry.timestamp = timestamp;
+    entry.numBytes = numBytes;
+    entry.lruPosition = stripe.lruList.insert(stripe.lruList.begin(), key);
+
+    stripe.numBytes += numBytes;
+}
+
+void ObjectCache::removeEntry(Stripe& stripe, ObjectCacheMap::iterator itr)
+{
+    stripe.numBytes -= itr->second.numBytes;
+    stripe.lruList.erase(itr->second.lruPosition);
+    stripe.objectCache.erase(itr);
+}
+
+void ObjectCache::applyLimits(Stripe& stripe)
+{
+    // each stripe gets an equal share of the limits, rounded up.
+    unsigned int maxObjects = (_maximumNumberOfObjects+NUM_STRIPES-1)/NUM_STRIPES;
+    unsigned long long maxBytes = (_maximumNumberOfBytes+NUM_STRIPES-1)/NUM_STRIPES;
+
+    bool overObjects = maxObjects>0 && stripe.objectCache.size()>maxObjects;
+    bool overBytes = maxBytes>0 && stripe.numBytes>maxBytes;
+    if (!overObjects && !overBytes) return;
+
+    // first remove least recently used objects that nothing else references, removing those still in use
+    // doesn't free their memory, only if that isn't enough are the least recently used removed regardless.
+    for(unsigned int pass=0; pass<2 && (overObjects || overBytes); ++pass)
+    {
+        LRUList::iterator litr = stripe.lruList.end();
+        while(litr!=stripe.lruList.begin() && (overObjects || overBytes))
+        {
+            --litr;
+            ObjectCacheMap::iterator itr = stripe.objectCache.find(*litr);
+            if (pass==0 && itr->second.object->referenceCount()>1) continue;
+
+            // step past the entry before it is removed, as removal invalidates its LRU position.
+            ++litr;
+            removeEntry(stripe, itr);
+            ++_numEvictions;
+
+            overObjects = maxObjects>0 && stripe.objectCache.size()>maxObjects;
+            overBytes = maxBytes>0 && stripe.numBytes>maxBytes;
+        }
+    }
+}
+
 void ObjectCache::addObjectCache(ObjectCache* objectCache)
 {
     // don't allow a cache to be added to itself.
     if (objectCache==this) return;
 
-    // lock both ObjectCache to prevent their contents from being modified by other threads while we merge.
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(_objectCacheMutex);
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(objectCache->_objectCacheMutex);
+    // both caches use the same striping, so lock the matching stripes of both to prevent their contents
+    // from being modified by other threads while we merge.
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
+    {
+        Stripe& stripe = _stripes[i];
+        Stripe& otherStripe = objectCache->_stripes[i];
+
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock1(stripe.mutex);
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock2(otherStripe.mutex);
 
-    OSG_DEBUG<<"Inserting objects to main ObjectCache "<<objectCache->_objectCache.size()<<std::endl;
+        OSG_DEBUG<<"Inserting objects to main ObjectCache "<<otherStripe.objectCache.size()<<std::endl;
+
+        // add the other cache's least recently used first so that its order is kept, existing entries take precedence.
+        for(LRUList::reverse_iterator litr = otherStripe.lruList.rbegin();
+            litr != otherStripe.lruList.rend();
+            ++litr)
+        {
+            if (stripe.objectCache.count(*litr)!=0) continue;
+
+            const CacheEntry& entry = otherStripe.objectCache[*litr];
+            addEntry(stripe, *litr, entry.object.get(), entry.timestamp, entry.numBytes);
+        }
 
-    _objectCache.insert(objectCache->_objectCache.begin(), objectCache->_objectCache.end());
+        applyLimits(stripe);
+    }
 }
 
 
+unsigned long long ObjectCache::estimateNumBytes(osg::Object* object)
+{
+    if (!object) return 0;
+
+    ObjectCacheUtils::EstimateNumBytes enb;
+    return enb.estimate(object);
+}
+
 void ObjectCache::addEntryToObjectCache(const std::string& filename, osg::Object* object, double timestamp, const Options *options)
 {
     if (!object) return;
 
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache[FileNameOptionsPair(filename, options ? osg::clone(options) : 0)] = ObjectTimeStampPair(object,timestamp);
+    // estimate the size before taking the lock, the cost is small compared to loading the object.
+    unsigned long long numBytes = estimateNumBytes(object);
+
+    FileNameOptionsPair key(filename, options ? osg::clone(options) : 0);
+
+    Stripe& stripe = getStripe(filename);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stripe.mutex);
+    addEntry(stripe, key, object, timestamp, numBytes);
+    applyLimits(stripe);
     OSG_DEBUG<<"Adding "<<filename<<" with options '"<<(options ? options->getOptionString() : "")<<"' to ObjectCache "<<this<<std::endl;
 }
 
-ObjectCache::ObjectCacheMap::iterator ObjectCache::find(const std::string& fileName, const osgDB::Options* options)
+ObjectCache::ObjectCacheMap::iterator ObjectCache::find(Stripe& stripe, const std::string& fileName, const osgDB::Options* options)
 {
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
+    // entries are ordered by file name, those without Options first.
+    for(ObjectCacheMap::iterator itr = stripe.objectCache.lower_bound(FileNameOptionsPair(fileName, 0));
+        itr != stripe.objectCache.end() && itr->first.first==fileName;
         ++itr)
     {
-        if (itr->first.first==fileName)
+        if (itr->first.second.valid())
         {
-            if (itr->first.second.valid())
-            {
-                if (options && *(itr->first.second)==*options) return itr;
-            }
-            else if (!options) return itr;
+            if (options && *(itr->first.second)==*options) return itr;
         }
+        else if (!options) return itr;
     }
-    return _objectCache.end();
+    return stripe.objectCache.end();
 }
 
 
 osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    Stripe& stripe = getStripe(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stripe.mutex);
+    ObjectCacheMap::iterator itr = find(stripe, fileName, options);
+    if (itr!=stripe.objectCache.end())
     {
         osg::ref_ptr<const osgDB::Options> o = itr->first.second;
         if (o.valid())
@@ -110,16 +366,23 @@ osg::Object* ObjectCache::getFromObjectCache(const std::string& fileName, const
         {
             OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
         }
-        return itr->second.first.get();
+        stripe.lruList.splice(stripe.lruList.begin(), stripe.lruList, itr->second.lruPosition);
+        ++_numHits;
+        return itr->second.object.get();
+    }
+    else
+    {
+        ++_numMisses;
+        return 0;
     }
-    else return 0;
 }
 
 osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end())
+    Stripe& stripe = getStripe(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stripe.mutex);
+    ObjectCacheMap::iterator itr = find(stripe, fileName, options);
+    if (itr!=stripe.objectCache.end())
     {
         osg::ref_ptr<const osgDB::Options> o = itr->first.second;
         if (o.valid())
@@ -130,63 +393,80 @@ osg::ref_ptr<osg::Object> ObjectCache::getRefFromObjectCache(const std::string&
         {
             OSG_DEBUG<<"Found "<<fileName<<" in ObjectCache "<<this<<std::endl;
         }
-        return itr->second.first.get();
+        stripe.lruList.splice(stripe.lruList.begin(), stripe.lruList, itr->second.lruPosition);
+        ++_numHits;
+        return itr->second.object.get();
+    }
+    else
+    {
+        ++_numMisses;
+        return 0;
     }
-    else return 0;
 }
 
 void ObjectCache::updateTimeStampOfObjectsInCacheWithExternalReferences(double referenceTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // look for objects with external references and update their time stamp.
-    for(ObjectCacheMap::iterator itr=_objectCache.begin();
-        itr!=_objectCache.end();
-        ++itr)
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
     {
-        // if ref count is greater the 1 the object has an external reference.
-        if (itr->second.first->referenceCount()>1)
+        Stripe& stripe = _stripes[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stripe.mutex);
+
+        // look for objects with external references and update their time stamp.
+        for(ObjectCacheMap::iterator itr=stripe.objectCache.begin();
+            itr!=stripe.objectCache.end();
+            ++itr)
         {
-            // so update it time stamp.
-            itr->second.second = referenceTime;
+            // if ref count is greater the 1 the object has an external reference.
+            if (itr->second.object->referenceCount()>1)
+            {
+                // so update it time stamp.
+                itr->second.timestamp = referenceTime;
+            }
         }
     }
 }
 
 void ObjectCache::removeExpiredObjectsInCache(double expiryTime)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
-    // Remove expired entries from object cache
-    ObjectCacheMap::iterator oitr = _objectCache.begin();
-    while(oitr != _objectCache.end())
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
     {
-        if (oitr->second.second<=expiryTime)
-        {
-#if __cplusplus > 199711L
-            oitr = _objectCache.erase(oitr);
-#else
-            _objectCache.erase(oitr++);
-#endif
-        }
-        else
+        Stripe& stripe = _stripes[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stripe.mutex);
+
+        // Remove expired entries from object cache
+        ObjectCacheMap::iterator oitr = stripe.objectCache.begin();
+        while(oitr != stripe.objectCache.end())
         {
-            ++oitr;
+            if (oitr->second.timestamp<=expiryTime)
+            {
+                removeEntry(stripe, oitr++);
+            }
+            else
+            {
+                ++oitr;
+            }
         }
     }
 }
 
 void ObjectCache::removeFromObjectCache(const std::string& fileName, const Options *options)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    ObjectCacheMap::iterator itr = find(fileName, options);
-    if (itr!=_objectCache.end()) _objectCache.erase(itr);
+    Stripe& stripe = getStripe(fileName);
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stripe.mutex);
+    ObjectCacheMap::iterator itr = find(stripe, fileName, options);
+    if (itr!=stripe.objectCache.end()) removeEntry(stripe, itr);
 }
 
 void ObjectCache::clear()
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-    _objectCache.clear();
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
+    {
+        Stripe& stripe = _stripes[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stripe.mutex);
+        stripe.objectCache.clear();
+        stripe.lruList.clear();
+        stripe.numBytes = 0;
+    }
 }
 
 namespace ObjectCacheUtils
@@ -256,28 +536,32 @@ struct ContainsUnreffedTextures : public osg::NodeVisitor
 
 void ObjectCache::releaseGLObjects(osg::State* state)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_objectCacheMutex);
-
     ObjectCacheUtils::ContainsUnreffedTextures cut;
 
-    for(ObjectCacheMap::iterator itr = _objectCache.begin();
-        itr != _objectCache.end();
-        )
+    for(unsigned int i=0; i<NUM_STRIPES; ++i)
     {
-        ObjectCacheMap::iterator curr_itr = itr;
+        Stripe& stripe = _stripes[i];
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(stripe.mutex);
+
+        for(ObjectCacheMap::iterator itr = stripe.objectCache.begin();
+            itr != stripe.objectCache.end();
+            )
+        {
+            ObjectCacheMap::iterator curr_itr = itr;
 
-        // get object and advance iterator to next item
-        osg::Object* object = itr->second.first.get();
+            // get object and advance iterator to next item
+            osg::Object* object = itr->second.object.get();
 
-        bool needToRemoveEntry = cut.check(itr->second.first.get());
+            bool needToRemoveEntry = cut.check(itr->second.object.get());
 
-        object->releaseGLObjects(state);
+            object->releaseGLObjects(state);
 
-        ++itr;
+            ++itr;
 
-        if (needToRemoveEntry)
-        {
-            _objectCache.erase(curr_itr);
+            if (needToRemoveEntry)
+            {
+                removeEntry(stripe, curr_itr);
+            }
         }
     }
 }
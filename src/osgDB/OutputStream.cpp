@@ -26,7 +26,7 @@
 using namespace osgDB;
 
 OutputStream::OutputStream( const osgDB::Options* options )
-:   _writeImageHint(WRITE_USE_IMAGE_HINT), _useSchemaData(false), _useRobustBinaryFormat(true), _targetFileVersion(OPENSCENEGRAPH_SOVERSION)
+:   _writeImageHint(WRITE_USE_IMAGE_HINT), _useSchemaData(false), _useRobustBinaryFormat(true), _alignArrays(false), _targetFileVersion(OPENSCENEGRAPH_SOVERSION)
 {
     BEGIN_BRACKET.set( "{", +INDENT_VALUE );
     END_BRACKET.set( "}", -INDENT_VALUE );
@@ -38,6 +38,8 @@ OutputStream::OutputStream( const osgDB::Options* options )
         _useRobustBinaryFormat = false;
     if ( options->getPluginStringData("SchemaData")=="true" )
         _useSchemaData = true;
+    if ( options->getPluginStringData("AlignArrays")=="true" )
+        _alignArrays = true;
     if ( !options->getPluginStringData("SchemaFile").empty() )
         _schemaName = options->getPluginStringData("SchemaFile");
     if ( !options->getPluginStringData("Compressor").empty() )
@@ -787,6 +789,15 @@ void OutputStream::start( OutputIterator* outIterator, OutputStream::WriteType t
             outIterator->setSupportBinaryBrackets( true );
             attributes |= 0x4;
         }
+
+        // Array data is only aligned in the file when it is written straight to it, rather than
+        // through a compressor or after the inbuilt schema data
+        if ( _alignArrays && (_useSchemaData || !_compressorName.empty()) )
+        {
+            OSG_NOTICE << "OutputStream::start(): AlignArrays is ignored with SchemaData or a Compressor." << std::endl;
+            _alignArrays = false;
+        }
+        if ( _alignArrays ) attributes |= 0x8;
         *this << attributes;
 
         // Record all custom versions
@@ -902,6 +913,21 @@ void OutputStream::compress( std::ostream* ostream )
     }
 }
 
+void OutputStream::writeArrayAlignment()
+{
+    if ( !_alignArrays ) return;
+
+    // the number of padding bytes is written first, so readers don't need to know the position in the file
+    std::ostream* out = _out->getStream();
+    std::streamoff position = out ? static_cast<std::streamoff>(out->tellp()) : std::streamoff(-1);
+    unsigned char padding = 0;
+    if ( position>=0 ) padding = static_cast<unsigned char>( (ARRAY_ALIGNMENT - (position+1)%ARRAY_ALIGNMENT) % ARRAY_ALIGNMENT );
+
+    char zeros[ARRAY_ALIGNMENT] = { 0 };
+    _out->writeUChar( padding );
+    if ( padding>0 ) _out->writeCharArray( zeros, padding );
+}
+
 void OutputStream::writeSchema( std::ostream& fout )
 {
     // Write to external ascii stream
@@ -63,6 +63,13 @@ static osg::ApplicationUsageProxy Registry_e1(osg::ApplicationUsage::ENVIRONMENT
 #endif
 
 static osg::ApplicationUsageProxy Registry_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_BUILD_KDTREES on/off","Enable/disable the automatic building of KdTrees for each loaded Geometry.");
+static osg::ApplicationUsageProxy Registry_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_KDTREE_SPLIT Midpoint/SAH","Set whether KdTree nodes are divided at the midpoint of their longest axis or by the surface area heuristic.");
+static osg::ApplicationUsageProxy Registry_e4(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_KDTREE_THREADS <num>","Set the number of threads used to build KdTrees, 0 uses one thread per processor.");
+static osg::ApplicationUsageProxy Registry_e5(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OBJECT_CACHE_MAX_OBJECTS <num>","Set the maximum number of objects held in the ObjectCache, least recently used objects are removed first.");
+static osg::ApplicationUsageProxy Registry_e6(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OBJECT_CACHE_MAX_MEMORY <MB>","Set the maximum estimated memory used by the objects held in the ObjectCache, least recently used objects are removed first.");
+static osg::ApplicationUsageProxy Registry_e7(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_FILE_CACHE_WRITE_BEHIND on/off","Enable/disable writing files to the OSG_FILE_CACHE from a background thread.");
+static osg::ApplicationUsageProxy Registry_e8(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_FILE_CACHE_CHECKSUMS on/off","Enable/disable checksums of the files in the OSG_FILE_CACHE, checked before they are read.");
+static osg::ApplicationUsageProxy Registry_e9(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_FILE_CACHE_MAX_SIZE <MB>","Set the maximum size of the OSG_FILE_CACHE, least recently used files are removed first.");
 
 
 // from MimeTypes.cpp
@@ -72,9 +79,9 @@ extern const char* builtinMimeTypeExtMappings[];
 class Registry::AvailableReaderWriterIterator
 {
 public:
-    AvailableReaderWriterIterator(Registry::ReaderWriterList& rwList, OpenThreads::ReentrantMutex& pluginMutex):
-        _rwList(rwList),
-        _pluginMutex(pluginMutex) {}
+    AvailableReaderWriterIterator(const Registry::Snapshot<Registry::ReaderWriterSnapshot>& rwSnapshot):
+        _rwSnapshot(rwSnapshot),
+        _current(0) {}
 
 
     ReaderWriter& operator * () { return *get(); }
@@ -85,6 +92,7 @@ public:
     void operator ++()
     {
         _rwUsed.insert(get());
+        _current = 0;
     }
 
 
@@ -92,20 +100,25 @@ protected:
 
     AvailableReaderWriterIterator& operator = (const AvailableReaderWriterIterator&) { return *this; }
 
-    Registry::ReaderWriterList&     _rwList;
-    OpenThreads::ReentrantMutex&    _pluginMutex;
+    const Registry::Snapshot<Registry::ReaderWriterSnapshot>&   _rwSnapshot;
+    ReaderWriter*                                               _current;
 
     std::set<ReaderWriter*>         _rwUsed;
 
     ReaderWriter* get()
     {
-        OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_pluginMutex);
-        Registry::ReaderWriterList::iterator itr=_rwList.begin();
-        for(;itr!=_rwList.end();++itr)
+        if (_current) return _current;
+
+        // search the latest snapshot so that ReaderWriters added by loading a plugin are found.
+        Registry::Snapshot<Registry::ReaderWriterSnapshot>::Reader rwList(_rwSnapshot);
+        for(Registry::ReaderWriterSnapshot::const_iterator itr=rwList->begin();
+            itr!=rwList->end();
+            ++itr)
         {
-            if (_rwUsed.find(itr->get())==_rwUsed.end())
+            if (_rwUsed.find(*itr)==_rwUsed.end())
             {
-                return itr->get();
+                _current = *itr;
+                return _current;
             }
         }
         return 0;
@@ -116,9 +129,8 @@ protected:
 class Registry::AvailableArchiveIterator
 {
 public:
-    AvailableArchiveIterator(Registry::ArchiveCache& archives, OpenThreads::ReentrantMutex& mutex):
-        _archives(archives),
-        _mutex(mutex) {}
+    AvailableArchiveIterator(const Registry::Snapshot<Registry::ArchiveCache>& archiveSnapshot):
+        _archiveSnapshot(archiveSnapshot) {}
 
 
     Archive& operator * () { return *get(); }
@@ -129,6 +141,7 @@ public:
     void operator ++()
     {
         _archivesUsed.insert(get());
+        _current = 0;
     }
 
 
@@ -136,20 +149,25 @@ protected:
 
     AvailableArchiveIterator& operator = (const AvailableArchiveIterator&) { return *this; }
 
-    Registry::ArchiveCache&         _archives;
-    OpenThreads::ReentrantMutex&    _mutex;
+    const Registry::Snapshot<Registry::ArchiveCache>&   _archiveSnapshot;
+
+    // keep the archive referenced while it is in use in case it is removed from the cache.
+    osg::ref_ptr<Archive>           _current;
 
     std::set<Archive*>              _archivesUsed;
 
     Archive* get()
     {
-        OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_mutex);
-        Registry::ArchiveCache::iterator itr=_archives.begin();
-        for(;itr!=_archives.end();++itr)
+        if (_current.valid()) return _current.get();
+
+        Registry::Snapshot<Registry::ArchiveCache>::Reader archives(_archiveSnapshot);
+        Registry::ArchiveCache::const_iterator itr=archives->begin();
+        for(;itr!=archives->end();++itr)
         {
             if (_archivesUsed.find(itr->second.get())==_archivesUsed.end())
             {
-                return itr->second.get();
+                _current = itr->second;
+                return _current.get();
             }
         }
         return 0;
@@ -235,6 +253,17 @@ Registry::Registry()
         else _buildKdTreesHint = Options::BUILD_KDTREES;
     }
 
+    if ((kdtree_str = getenv("OSG_KDTREE_SPLIT")) != 0)
+    {
+        if (strcmp(kdtree_str, "SAH")==0 || strcmp(kdtree_str, "sah")==0) _kdTreeBuilder->_buildOptions._splitMethod = osg::KdTree::BuildOptions::SPLIT_BY_SAH;
+        else _kdTreeBuilder->_buildOptions._splitMethod = osg::KdTree::BuildOptions::SPLIT_AT_MIDPOINT;
+    }
+
+    if ((kdtree_str = getenv("OSG_KDTREE_THREADS")) != 0)
+    {
+        _kdTreeBuilder->_buildOptions._numThreads = atoi(kdtree_str);
+    }
+
     const char* ptr=0;
 
     _expiryDelay = 10.0;
@@ -248,11 +277,38 @@ Registry::Registry()
     if (fileCachePath)
     {
         _fileCache = new FileCache(fileCachePath);
+
+        if( (ptr = getenv("OSG_FILE_CACHE_WRITE_BEHIND")) != 0)
+        {
+            _fileCache->setWriteBehind(strcmp(ptr,"on")==0 || strcmp(ptr,"ON")==0);
+        }
+
+        if( (ptr = getenv("OSG_FILE_CACHE_CHECKSUMS")) != 0)
+        {
+            _fileCache->setUseChecksums(strcmp(ptr,"on")==0 || strcmp(ptr,"ON")==0);
+        }
+
+        if( (ptr = getenv("OSG_FILE_CACHE_MAX_SIZE")) != 0)
+        {
+            _fileCache->setMaximumCacheSize(static_cast<unsigned long long>(osg::asciiToDouble(ptr)*1024.0*1024.0));
+        }
     }
 
     // assign ObjectCache.
     _objectCache = new ObjectCache;
 
+    if( (ptr = getenv("OSG_OBJECT_CACHE_MAX_OBJECTS")) != 0)
+    {
+        _objectCache->setMaximumNumberOfObjects(atoi(ptr));
+        OSG_INFO<<"Registry : ObjectCache maximum number of objects = "<<_objectCache->getMaximumNumberOfObjects()<<std::endl;
+    }
+
+    if( (ptr = getenv("OSG_OBJECT_CACHE_MAX_MEMORY")) != 0)
+    {
+        _objectCache->setMaximumNumberOfBytes(static_cast<unsigned long long>(osg::asciiToDouble(ptr)*1024.0*1024.0));
+        OSG_INFO<<"Registry : ObjectCache maximum memory = "<<_objectCache->getMaximumNumberOfBytes()<<" bytes"<<std::endl;
+    }
+
     _createNodeFromImage = false;
     _openingLibrary = false;
 
@@ -614,6 +670,7 @@ void Registry::addReaderWriter(ReaderWriter* rw)
 
     _rwList.push_back(rw);
 
+    publishReaderWriterSnapshot();
 }
 
 
@@ -629,8 +686,27 @@ void Registry::removeReaderWriter(ReaderWriter* rw)
     if (rwitr!=_rwList.end())
     {
         _rwList.erase(rwitr);
+
+        publishReaderWriterSnapshot();
+    }
+
+}
+
+void Registry::publishReaderWriterSnapshot()
+{
+    // called with _pluginMutex held.
+    ReaderWriterSnapshot* rwSnapshot = new ReaderWriterSnapshot;
+    rwSnapshot->reserve(_rwList.size());
+    for(ReaderWriterList::iterator itr=_rwList.begin();
+        itr!=_rwList.end();
+        ++itr)
+    {
+        rwSnapshot->push_back(itr->get());
     }
+    _rwSnapshot.publish(rwSnapshot);
 
+    // the ReaderWriter chosen for an extension may change, so start the extension lookups afresh.
+    _rwExtensionSnapshot.publish(new ReaderWriterExtensionMap);
 }
 
 ImageProcessor* Registry::getImageProcessor()
@@ -870,6 +946,15 @@ DynamicLibrary* Registry::getLibrary(const std::string& fileName)
 
 ReaderWriter* Registry::getReaderWriterForExtension(const std::string& ext)
 {
+    std::string lowercase_ext = convertToLowerCase(ext);
+
+    // look up extensions already resolved without taking the _pluginMutex.
+    {
+        Snapshot<ReaderWriterExtensionMap>::Reader rwExtensionMap(_rwExtensionSnapshot);
+        ReaderWriterExtensionMap::const_iterator itr = rwExtensionMap->find(lowercase_ext);
+        if (itr!=rwExtensionMap->end()) return itr->second;
+    }
+
     // record the existing reader writer.
     std::set<ReaderWriter*> rwOriginal;
 
@@ -881,7 +966,13 @@ ReaderWriter* Registry::getReaderWriterForExtension(const std::string& ext)
         ++itr)
     {
         rwOriginal.insert(itr->get());
-        if((*itr)->acceptsExtension(ext)) return (*itr).get();
+        if((*itr)->acceptsExtension(ext))
+        {
+            ReaderWriterExtensionMap* rwExtensionMap = new ReaderWriterExtensionMap(_rwExtensionSnapshot.current());
+            (*rwExtensionMap)[lowercase_ext] = itr->get();
+            _rwExtensionSnapshot.publish(rwExtensionMap);
+            return (*itr).get();
+        }
     }
 
     // now look for a plug-in to load the file.
@@ -895,7 +986,13 @@ ReaderWriter* Registry::getReaderWriterForExtension(const std::string& ext)
         {
             if (rwOriginal.find(itr->get())==rwOriginal.end())
             {
-                if((*itr)->acceptsExtension(ext)) return (*itr).get();
+                if((*itr)->acceptsExtension(ext))
+                {
+                    ReaderWriterExtensionMap* rwExtensionMap = new ReaderWriterExtensionMap(_rwExtensionSnapshot.current());
+                    (*rwExtensionMap)[lowercase_ext] = itr->get();
+                    _rwExtensionSnapshot.publish(rwExtensionMap);
+                    return (*itr).get();
+                }
             }
         }
     }
@@ -1187,7 +1284,7 @@ ReaderWriter::ReadResult Registry::read(const ReadFunctor& readFunctor)
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(_rwSnapshot);
     for(;itr.valid();++itr)
     {
         ReaderWriter::ReadResult rr = readFunctor.doRead(*itr);
@@ -1196,7 +1293,7 @@ ReaderWriter::ReadResult Registry::read(const ReadFunctor& readFunctor)
     }
 
     // check loaded archives.
-    AvailableArchiveIterator aaitr(_archiveCache, _archiveCacheMutex);
+    AvailableArchiveIterator aaitr(_archiveCacheSnapshot);
     for(;aaitr.valid();++aaitr)
     {
         ReaderWriter::ReadResult rr = readFunctor.doRead(*aaitr);
@@ -1343,7 +1440,7 @@ ReaderWriter::WriteResult Registry::writeObjectImplementation(const Object& obj,
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(_rwSnapshot);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeObject(obj,fileName,options);
@@ -1389,7 +1486,7 @@ ReaderWriter::WriteResult Registry::writeImageImplementation(const Image& image,
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(_rwSnapshot);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeImage(image,fileName,options);
@@ -1434,7 +1531,7 @@ ReaderWriter::WriteResult Registry::writeHeightFieldImplementation(const HeightF
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(_rwSnapshot);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeHeightField(HeightField,fileName,options);
@@ -1491,7 +1588,7 @@ ReaderWriter::WriteResult Registry::writeNodeImplementation(const Node& node,con
     Results results;
 
     // first attempt to write the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(_rwSnapshot);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeNode(node,fileName,options);
@@ -1537,7 +1634,7 @@ ReaderWriter::WriteResult Registry::writeShaderImplementation(const Shader& shad
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(_rwSnapshot);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeShader(shader,fileName,options);
@@ -1584,7 +1681,7 @@ ReaderWriter::WriteResult Registry::writeScriptImplementation(const Script& imag
     Results results;
 
     // first attempt to load the file from existing ReaderWriter's
-    AvailableReaderWriterIterator itr(_rwList, _pluginMutex);
+    AvailableReaderWriterIterator itr(_rwSnapshot);
     for(;itr.valid();++itr)
     {
         ReaderWriter::WriteResult rr = itr->writeScript(image,fileName,options);
@@ -1656,6 +1753,7 @@ void Registry::addToArchiveCache(const std::string& fileName, osgDB::Archive* ar
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_archiveCacheMutex);
     _archiveCache[fileName] = archive;
+    _archiveCacheSnapshot.publish(new ArchiveCache(_archiveCache));
 }
 
 /** Remove archive from cache.*/
@@ -1666,22 +1764,23 @@ void Registry::removeFromArchiveCache(const std::string& fileName)
     if (itr!=_archiveCache.end())
     {
         _archiveCache.erase(itr);
+        _archiveCacheSnapshot.publish(new ArchiveCache(_archiveCache));
     }
 }
 
 osgDB::Archive* Registry::getFromArchiveCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_archiveCacheMutex);
-    ArchiveCache::iterator itr = _archiveCache.find(fileName);
-    if (itr!=_archiveCache.end()) return itr->second.get();
+    Snapshot<ArchiveCache>::Reader archives(_archiveCacheSnapshot);
+    ArchiveCache::const_iterator itr = archives->find(fileName);
+    if (itr!=archives->end()) return itr->second.get();
     else return 0;
 }
 
 osg::ref_ptr<osgDB::Archive> Registry::getRefFromArchiveCache(const std::string& fileName)
 {
-    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_archiveCacheMutex);
-    ArchiveCache::iterator itr = _archiveCache.find(fileName);
-    if (itr!=_archiveCache.end()) return itr->second;
+    Snapshot<ArchiveCache>::Reader archives(_archiveCacheSnapshot);
+    ArchiveCache::const_iterator itr = archives->find(fileName);
+    if (itr!=archives->end()) return itr->second;
     else return 0;
 }
 
@@ -1689,6 +1788,7 @@ void Registry::clearArchiveCache()
 {
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_archiveCacheMutex);
     _archiveCache.clear();
+    _archiveCacheSnapshot.publish(new ArchiveCache);
 }
 
 void Registry::releaseGLObjects(osg::State* state)
@@ -45,7 +45,7 @@ void SharedStateManager::prune()
     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
     for(sitr=_sharedStateSetList.begin(); sitr!=_sharedStateSetList.end();)
     {
-        if ((*sitr)->referenceCount()<=1)
+        if (sitr->second->referenceCount()<=1)
             _sharedStateSetList.erase(sitr++);
         else
             ++sitr;
@@ -54,7 +54,7 @@ void SharedStateManager::prune()
     TextureSet::iterator titr;
     for(titr=_sharedTextureList.begin(); titr!=_sharedTextureList.end();)
     {
-        if ((*titr)->referenceCount()<=1)
+        if (titr->second->referenceCount()<=1)
             _sharedTextureList.erase(titr++);
         else
             ++titr;
@@ -124,22 +124,24 @@ bool SharedStateManager::isShared(osg::Texture* texture)
 // from which they are called is doing the writing to the lists.
 osg::StateSet *SharedStateManager::find(osg::StateSet *ss)
 {
-    StateSetSet::iterator result
-        = _sharedStateSetList.find(osg::ref_ptr<osg::StateSet>(ss));
-    if (result == _sharedStateSetList.end())
-        return NULL;
-    else
-        return result->get();
+    std::pair<StateSetSet::iterator, StateSetSet::iterator> range
+        = _sharedStateSetList.equal_range(ss->computeHash(true));
+    for(StateSetSet::iterator itr = range.first; itr != range.second; ++itr)
+    {
+        if (itr->second->compare(*ss, true)==0) return itr->second.get();
+    }
+    return NULL;
 }
 
 osg::StateAttribute *SharedStateManager::find(osg::StateAttribute *sa)
 {
-    TextureSet::iterator result
-        = _sharedTextureList.find(osg::ref_ptr<osg::StateAttribute>(sa));
-    if (result == _sharedTextureList.end())
-        return NULL;
-    else
-        return result->get();
+    std::pair<TextureSet::iterator, TextureSet::iterator> range
+        = _sharedTextureList.equal_range(sa->computeHash());
+    for(TextureSet::iterator itr = range.first; itr != range.second; ++itr)
+    {
+        if (*(itr->second)==*sa) return itr->second.get();
+    }
+    return NULL;
 }
 
 
@@ -190,7 +192,7 @@ void SharedStateManager::shareTextures(osg::StateSet* ss)
                     // Add to _sharedAttributeList. Not needed to be
                     // shared all next times.
                     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-                    _sharedTextureList.insert(texture);
+                    _sharedTextureList.insert(TextureSet::value_type(texture->computeHash(), texture));
                     tmpSharedTextureList[texture] = TextureSharePair(texture, false);
                 }
             }
@@ -236,7 +238,7 @@ void SharedStateManager::process(osg::StateSet* ss, osg::Object* parent)
                 // Add to sharedStateSetList. Not needed to be shared all next times.
                 {
                     OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_listMutex);
-                    _sharedStateSetList.insert(ss);
+                    _sharedStateSetList.insert(StateSetSet::value_type(ss->computeHash(true), ss));
                     tmpSharedStateSetList[ss]
                         = StateSetSharePair(ss, false);
                 }
@@ -270,9 +272,9 @@ void SharedStateManager::releaseGLObjects(osg::State* state) const
         TextureSet::const_iterator it;
         for ( it = _sharedTextureList.begin(); it != _sharedTextureList.end(); ++it )
         {
-            if ( it->valid() )
+            if ( it->second.valid() )
             {
-                it->get()->releaseGLObjects(state);
+                it->second->releaseGLObjects(state);
             }
         }
     }
@@ -281,9 +283,9 @@ void SharedStateManager::releaseGLObjects(osg::State* state) const
         StateSetSet::const_iterator it;
         for( it = _sharedStateSetList.begin(); it != _sharedStateSetList.end(); ++it )
         {
-            if ( it->valid() )
+            if ( it->second.valid() )
             {
-                it->get()->releaseGLObjects(state);
+                it->second->releaseGLObjects(state);
             }
         }
     }
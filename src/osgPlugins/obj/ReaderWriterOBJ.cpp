@@ -41,6 +41,7 @@
 #include <osgDB/ReadFile>
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
+#include <osgDB/MappedFile>
 
 #include <osgUtil/MeshOptimizers>
 #include <osgUtil/SmoothingVisitor>
@@ -63,6 +64,8 @@ public:
         supportsOption("noTriStripPolygons","Do not do the default tri stripping of polygons");
         supportsOption("generateFacetNormals","generate facet normals for vertices without normals");
         supportsOption("noReverseFaces","avoid to reverse faces when normals and triangles orientation are reversed");
+        supportsOption("noMemoryMapping","Read the file a line at a time through a stream rather than memory mapped and parsed in parallel");
+        supportsOption("numThreads=<num>","Number of threads parsing a memory mapped file, default one per processor");
 
         supportsOption("DIFFUSE=<unit>", "Set texture unit for diffuse texture");
         supportsOption("AMBIENT=<unit>", "Set texture unit for ambient texture");
@@ -170,6 +173,8 @@ protected:
         int precision;
         bool outputTextureFiles;
         int specularExponent;
+        bool noMemoryMapping;
+        unsigned int numThreads;
 
         ObjOptionsStruct()
         {
@@ -182,6 +187,8 @@ protected:
             precision = std::numeric_limits<double>::digits10 + 2;
             outputTextureFiles = false;
             specularExponent = -1;
+            noMemoryMapping = false;
+            numThreads = 0;
         }
     };
 
@@ -658,9 +665,14 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
     {
         unsigned int startPos = vertices->size();
 
+        // collect the primitive sets and assign them in one go, adding them one at a time dirties the
+        // geometry's existing primitive sets on each call which is quadratic in the number of faces.
+        osg::Geometry::PrimitiveSetList primitives = geometry->getPrimitiveSetList();
+        primitives.reserve(primitives.size()+numPolygonElements);
+
         #ifdef USE_DRAWARRAYLENGTHS
             osg::DrawArrayLengths* drawArrayLengths = new osg::DrawArrayLengths(GL_POLYGON,startPos);
-            geometry->addPrimitiveSet(drawArrayLengths);
+            primitives.push_back(drawArrayLengths);
         #endif
 
         for(itr=elementList.begin();
@@ -677,13 +689,13 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
                     {
                         osg::DrawArrays* drawArrays = new osg::DrawArrays(GL_POLYGON,startPos,element.vertexIndices.size());
                         startPos += element.vertexIndices.size();
-                        geometry->addPrimitiveSet(drawArrays);
+                        primitives.push_back(drawArrays);
                     }
                     else
                     {
                         osg::DrawArrays* drawArrays = new osg::DrawArrays(GL_TRIANGLE_FAN,startPos,element.vertexIndices.size());
                         startPos += element.vertexIndices.size();
-                        geometry->addPrimitiveSet(drawArrays);
+                        primitives.push_back(drawArrays);
                     }
                 #endif
 
@@ -761,6 +773,8 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
                 }
             }
         }
+
+        geometry->setPrimitiveSetList(primitives);
     }
 
     if(hasReversedFaces)
@@ -771,6 +785,20 @@ osg::Geometry* ReaderWriterOBJ::convertElementListToGeometry(obj::Model& model,
     return geometry;
 }
 
+// true if the geometry has any GL_POLYGON primitive sets, the rest are passed through by the Tessellator one
+// addPrimitiveSet() at a time so it is only worth running when there is something to tessellate.
+static bool hasPolygonPrimitives(const osg::Geometry& geometry)
+{
+    const osg::Geometry::PrimitiveSetList& primitives = geometry.getPrimitiveSetList();
+    for(osg::Geometry::PrimitiveSetList::const_iterator itr = primitives.begin();
+        itr != primitives.end();
+        ++itr)
+    {
+        if ((*itr)->getMode()==osg::PrimitiveSet::POLYGON) return true;
+    }
+    return false;
+}
+
 osg::Node* ReaderWriterOBJ::convertModelToSceneGraph(obj::Model& model, ObjOptionsStruct& localOptions, const Options* options) const
 {
 
@@ -804,8 +832,8 @@ osg::Node* ReaderWriterOBJ::convertModelToSceneGraph(obj::Model& model, ObjOptio
             osg::StateSet* stateset = materialToStateSetMap[es.materialName].get();
             geometry->setStateSet(stateset);
 
-            // tesseleate any large polygons
-            if (!localOptions.noTesselateLargePolygons)
+            // tesseleate any large polygons, the Tessellator only retessellates GL_POLYGON primitive sets.
+            if (!localOptions.noTesselateLargePolygons && hasPolygonPrimitives(*geometry))
             {
                 osgUtil::Tessellator tessellator;
                 tessellator.retessellatePolygons(*geometry);
@@ -898,6 +926,14 @@ ReaderWriterOBJ::ObjOptionsStruct ReaderWriterOBJ::parseOptions(const osgDB::Rea
             {
                 localOptions.outputTextureFiles = true;
             }
+            else if (pre_equals == "noMemoryMapping")
+            {
+                localOptions.noMemoryMapping = true;
+            }
+            else if (pre_equals == "numThreads")
+            {
+                localOptions.numThreads = atoi(post_equals.c_str());
+            }
             else if (pre_equals == "precision")
             {
                 int val = std::atoi(post_equals.c_str());
@@ -948,19 +984,36 @@ osgDB::ReaderWriter::ReadResult ReaderWriterOBJ::readNode(const std::string& fil
     std::string fileName = osgDB::findDataFile( file, options );
     if (fileName.empty()) return ReadResult::FILE_NOT_FOUND;
 
+    ObjOptionsStruct localOptions = parseOptions(options);
+
+    // code for setting up the database path so that internally referenced file are searched for on relative paths.
+    osg::ref_ptr<Options> local_opt = options ? static_cast<Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new Options;
+    local_opt->getDatabasePathList().push_front(osgDB::getFilePath(fileName));
+
+    if (!localOptions.noMemoryMapping)
+    {
+        osg::ref_ptr<osgDB::MappedFile> mappedFile = new osgDB::MappedFile(fileName);
+        if (mappedFile->valid())
+        {
+            obj::Model model;
+            model.setDatabasePath(osgDB::getFilePath(fileName.c_str()));
+            model.readOBJ(mappedFile->data(), mappedFile->size(), local_opt.get(), localOptions.numThreads);
+
+            // the text is no longer needed while the scene graph is built.
+            mappedFile = 0;
+
+            osg::Node* node = convertModelToSceneGraph(model, localOptions, local_opt.get());
+            return node;
+        }
+    }
+
     osgDB::ifstream fin(fileName.c_str());
     if (fin)
     {
-        // code for setting up the database path so that internally referenced file are searched for on relative paths.
-        osg::ref_ptr<Options> local_opt = options ? static_cast<Options*>(options->clone(osg::CopyOp::SHALLOW_COPY)) : new Options;
-        local_opt->getDatabasePathList().push_front(osgDB::getFilePath(fileName));
-
         obj::Model model;
         model.setDatabasePath(osgDB::getFilePath(fileName.c_str()));
         model.readOBJ(fin, local_opt.get());
 
-        ObjOptionsStruct localOptions = parseOptions(options);
-
         osg::Node* node = convertModelToSceneGraph(model, localOptions, local_opt.get());
         return node;
     }
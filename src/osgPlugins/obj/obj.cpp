@@ -21,11 +21,17 @@
 #include "obj.h"
 
 #include <osg/Notify>
+#include <osg/ParallelTask>
 
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 
+#include <OpenThreads/Thread>
+
 #include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
 
 using namespace obj;
 
@@ -696,99 +702,31 @@ bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* optio
 
                 }
 
-                if (!element->normalIndices.empty() && element->normalIndices.size() != element->vertexIndices.size())
-                {
-                    element->normalIndices.clear();
-                }
-
-                if (!element->texCoordIndices.empty() && element->texCoordIndices.size() != element->vertexIndices.size())
-                {
-                    element->texCoordIndices.clear();
-                }
-
-                if (!element->vertexIndices.empty())
-                {
-                    Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
-                    if (coordateCombination!=currentElementState.coordinateCombination)
-                    {
-                        currentElementState.coordinateCombination = coordateCombination;
-                        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                    }
-                    addElement(element);
-                }
-                else
-                {
-                    // empty element, don't both adding, just unref to delete it.
-                    element->unref();
-                }
-
+                addParsedElement(element);
             }
             else if (strncmp(line,"usemtl ",7)==0)
             {
-                std::string materialName( line+7 );
-                if (currentElementState.materialName != materialName)
-                {
-                    currentElementState.materialName = materialName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                setCurrentMaterialName( line+7 );
             }
             else if (strncmp(line,"mtllib ",7)==0)
             {
-                std::string materialFileName = trim( line+7 );
-                std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
-                if (!fullPathFileName.empty())
-                {
-                    osgDB::ifstream mfin( fullPathFileName.c_str() );
-                    if (mfin)
-                    {
-                        OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
-                        readMTL(mfin);
-                    }
-                    else
-                    {
-                        OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
-                    }
-                }
-                else
-                {
-                    OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
-                }
+                readMaterialLibrary( trim( line+7 ), options );
             }
             else if (strncmp(line,"o ",2)==0)
             {
-                std::string objectName(line+2);
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                setCurrentObjectName( line+2 );
             }
             else if (strcmp(line,"o")==0)
             {
-                std::string objectName(""); // empty name
-                if (currentElementState.objectName != objectName)
-                {
-                    currentElementState.objectName = objectName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                setCurrentObjectName( "" ); // empty name
             }
             else if (strncmp(line,"g ",2)==0)
             {
-                std::string groupName(line+2);
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                setCurrentGroupName( line+2 );
             }
             else if (strcmp(line,"g")==0)
             {
-                std::string groupName(""); // empty name
-                if (currentElementState.groupName != groupName)
-                {
-                    currentElementState.groupName = groupName;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                setCurrentGroupName( "" ); // empty name
             }
             else if (strncmp(line,"s ",2)==0)
             {
@@ -803,11 +741,7 @@ bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* optio
                     }
                 }
 
-                if (currentElementState.smoothingGroup != smoothingGroup)
-                {
-                    currentElementState.smoothingGroup = smoothingGroup;
-                    currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
-                }
+                setCurrentSmoothingGroup( smoothingGroup );
             }
             else
             {
@@ -844,6 +778,645 @@ bool Model::readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* optio
 }
 
 
+namespace obj
+{
+
+// parse an int in the style of sscanf's %d, returning false if there are no digits.
+static inline bool parseInt(const char*& ptr, int& value)
+{
+    const char* p = ptr;
+    bool negative = false;
+    if (*p=='-') { negative = true; ++p; }
+    else if (*p=='+') ++p;
+
+    if (*p<'0' || *p>'9') return false;
+
+    int result = 0;
+    while(*p>='0' && *p<='9')
+    {
+        result = result*10 + (*p-'0');
+        ++p;
+    }
+
+    value = negative ? -result : result;
+    ptr = p;
+    return true;
+}
+
+// parse a float in the C locale, much faster than sscanf for the plain decimal numbers OBJ files are made of,
+// falling back to strtod for anything else such as inf and nan.
+static inline bool parseFloat(const char*& ptr, float& value)
+{
+    static const double s_powersOfTen[] =
+    {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char* p = ptr;
+    bool negative = false;
+    if (*p=='-') { negative = true; ++p; }
+    else if (*p=='+') ++p;
+
+    unsigned long long mantissa = 0;
+    int numSignificantDigits = 0;
+    int exponent = 0;
+    bool hasDigits = false;
+
+    // only the first 19 significant digits fit in the mantissa, the rest only affect the exponent.
+    for(; *p>='0' && *p<='9'; ++p)
+    {
+        hasDigits = true;
+        if (numSignificantDigits<19)
+        {
+            mantissa = mantissa*10 + (*p-'0');
+            if (mantissa!=0) ++numSignificantDigits;
+        }
+        else ++exponent;
+    }
+
+    if (*p=='.')
+    {
+        for(++p; *p>='0' && *p<='9'; ++p)
+        {
+            hasDigits = true;
+            if (numSignificantDigits<19)
+            {
+                mantissa = mantissa*10 + (*p-'0');
+                if (mantissa!=0) ++numSignificantDigits;
+                --exponent;
+            }
+        }
+    }
+
+    if (!hasDigits)
+    {
+        char* end = 0;
+        double result = strtod(ptr, &end);
+        if (end==ptr) return false;
+        value = static_cast<float>(result);
+        ptr = end;
+        return true;
+    }
+
+    if (*p=='e' || *p=='E')
+    {
+        const char* e = p+1;
+        int exponentValue = 0;
+        if (parseInt(e, exponentValue))
+        {
+            exponent += exponentValue;
+            p = e;
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (exponent>=0 && exponent<=22) result *= s_powersOfTen[exponent];
+    else if (exponent<0 && exponent>=-22) result /= s_powersOfTen[-exponent];
+    else result *= pow(10.0, exponent);
+
+    value = static_cast<float>(negative ? -result : result);
+    ptr = p;
+    return true;
+}
+
+// a face, polyline or point list as parsed by a chunk. Index triples that weren't present in the file are set to
+// INDEX_NOT_SET, and the chunk's counts of each array are recorded so that relative indices can be resolved on merging.
+struct ParsedElement
+{
+    Element::DataType   dataType;
+    unsigned int        firstIndex;
+    unsigned int        numIndices;
+    unsigned int        numVertices;
+    unsigned int        numNormals;
+    unsigned int        numTexCoords;
+};
+
+// a change of state, or a line that needs to be handled when merging, along with the number of elements before it.
+struct ParsedCommand
+{
+    enum Type
+    {
+        MATERIAL_NAME,
+        MATERIAL_LIBRARY,
+        OBJECT_NAME,
+        GROUP_NAME,
+        SMOOTHING_GROUP,
+        NOT_HANDLED
+    };
+
+    ParsedCommand(Type t, unsigned int elementPosition, const std::string& v):
+        type(t), position(elementPosition), value(v), smoothingGroup(0) {}
+
+    Type            type;
+    unsigned int    position;
+    std::string     value;
+    int             smoothingGroup;
+};
+
+class ParsedChunk
+{
+public:
+
+    static const int INDEX_NOT_SET = INT_MIN;
+
+    ParsedChunk(): begin(0), end(0) {}
+
+    const char*                 begin;
+    const char*                 end;
+
+    Model::Vec3Array            vertices;
+    Model::Vec4Array            colors;
+    Model::Vec3Array            normals;
+    Model::Vec2Array            texcoords;
+
+    std::vector<int>            indices;
+    std::vector<ParsedElement>  elements;
+    std::vector<ParsedCommand>  commands;
+
+    void parse();
+    void parseLine(char* line);
+
+    void clear()
+    {
+        Model::Vec3Array().swap(vertices);
+        Model::Vec4Array().swap(colors);
+        Model::Vec3Array().swap(normals);
+        Model::Vec2Array().swap(texcoords);
+        std::vector<int>().swap(indices);
+        std::vector<ParsedElement>().swap(elements);
+        std::vector<ParsedCommand>().swap(commands);
+    }
+
+    void addCommand(ParsedCommand::Type type, const std::string& value)
+    {
+        commands.push_back(ParsedCommand(type, static_cast<unsigned int>(elements.size()), value));
+    }
+};
+
+void ParsedChunk::parse()
+{
+    std::vector<char> line;
+    line.reserve(256);
+
+    // the same line handling as Model::readline(), backslash continuations, unix, dos and mac line endings,
+    // leading white space removed, trailing spaces stripped and tabs changed to spaces.
+    const char* ptr = begin;
+    while(ptr<end)
+    {
+        line.clear();
+
+        bool eatWhiteSpaceAtStart = true;
+        bool skipNewline = false;
+        while(ptr<end)
+        {
+            char c = *ptr++;
+            if (c=='\r')
+            {
+                if (ptr<end && *ptr=='\n') ++ptr;
+                if (!skipNewline) break;
+                skipNewline = false;
+                line.push_back(' ');
+            }
+            else if (c=='\n')
+            {
+                if (!skipNewline) break;
+                line.push_back(' ');
+            }
+            else if (c=='\\' && ptr<end && (*ptr=='\r' || *ptr=='\n'))
+            {
+                skipNewline = true;
+            }
+            else
+            {
+                skipNewline = false;
+                if (!eatWhiteSpaceAtStart || (c!=' ' && c!='\t'))
+                {
+                    eatWhiteSpaceAtStart = false;
+                    line.push_back(c);
+                }
+            }
+        }
+
+        while(!line.empty() && line.back()==' ') line.pop_back();
+
+        for(std::vector<char>::iterator itr = line.begin(); itr != line.end(); ++itr)
+        {
+            if (*itr=='\t') *itr = ' ';
+        }
+
+        line.push_back(0);
+        parseLine(&line[0]);
+    }
+}
+
+void ParsedChunk::parseLine(char* line)
+{
+    if ((line[0]=='#' && !isZBrushColorField(line)) || line[0]=='$' || line[0]==0)
+    {
+        // comment or empty line
+    }
+    else if (isZBrushColorField(line))
+    {
+        // #MRGB MMRRGGBB MMRRGGBB ..., skipping the MM component of each.
+        const char* ptr = line + 6;
+        size_t length = strlen(ptr);
+        while(length>=8)
+        {
+            char component[3] = { 0, 0, 0 };
+            float rgb[3];
+            for(int i=0; i<3; ++i)
+            {
+                component[0] = ptr[2+i*2];
+                component[1] = ptr[3+i*2];
+                rgb[i] = static_cast<float>(strtol(component, NULL, 16)) / 255.0f;
+            }
+            colors.push_back(osg::Vec4(rgb[0], rgb[1], rgb[2], 1.0f));
+            ptr += 8;
+            length -= 8;
+        }
+    }
+    else if (line[0]=='v' && line[1]==' ')
+    {
+        float values[7];
+        unsigned int fieldsRead = 0;
+        const char* ptr = line+2;
+        while(fieldsRead<7)
+        {
+            while(*ptr==' ') ++ptr;
+            if (!parseFloat(ptr, values[fieldsRead])) break;
+            ++fieldsRead;
+        }
+
+        if (fieldsRead==1)
+            vertices.push_back(osg::Vec3(values[0],0.0f,0.0f));
+        else if (fieldsRead==2)
+            vertices.push_back(osg::Vec3(values[0],values[1],0.0f));
+        else if (fieldsRead==3)
+            vertices.push_back(osg::Vec3(values[0],values[1],values[2]));
+        else if (fieldsRead == 4)
+            vertices.push_back(osg::Vec3(values[0]/values[3],values[1]/values[3],values[2]/values[3]));
+        else if (fieldsRead == 6)
+        {
+            vertices.push_back(osg::Vec3(values[0],values[1],values[2]));
+            colors.push_back(osg::Vec4(values[3],values[4],values[5],1.0f));
+        }
+        else if (fieldsRead == 7)
+        {
+            vertices.push_back(osg::Vec3(values[0],values[1],values[2]));
+            colors.push_back(osg::Vec4(values[3],values[4],values[5],values[6]));
+        }
+    }
+    else if (line[0]=='v' && (line[1]=='n' || line[1]=='t') && line[2]==' ')
+    {
+        float values[3];
+        unsigned int fieldsRead = 0;
+        const char* ptr = line+3;
+        while(fieldsRead<3)
+        {
+            while(*ptr==' ') ++ptr;
+            if (!parseFloat(ptr, values[fieldsRead])) break;
+            ++fieldsRead;
+        }
+
+        if (line[1]=='n')
+        {
+            if (fieldsRead==1) normals.push_back(osg::Vec3(values[0],0.0f,0.0f));
+            else if (fieldsRead==2) normals.push_back(osg::Vec3(values[0],values[1],0.0f));
+            else if (fieldsRead==3) normals.push_back(osg::Vec3(values[0],values[1],values[2]));
+        }
+        else
+        {
+            if (fieldsRead==1) texcoords.push_back(osg::Vec2(values[0],0.0f));
+            else if (fieldsRead>=2) texcoords.push_back(osg::Vec2(values[0],values[1]));
+        }
+    }
+    else if ((line[0]=='f' || line[0]=='l' || line[0]=='p') && line[1]==' ')
+    {
+        ParsedElement element;
+        element.dataType = (line[0]=='p') ? Element::POINTS :
+                           (line[0]=='l') ? Element::POLYLINE :
+                           Element::POLYGON;
+        element.firstIndex = static_cast<unsigned int>(indices.size());
+        element.numIndices = 0;
+        element.numVertices = static_cast<unsigned int>(vertices.size());
+        element.numNormals = static_cast<unsigned int>(normals.size());
+        element.numTexCoords = static_cast<unsigned int>(texcoords.size());
+
+        // vertex/texcoord/normal, vertex//normal, vertex/texcoord or vertex, as matched by Model::readOBJ().
+        const char* ptr = line+2;
+        while(*ptr!=0)
+        {
+            while(*ptr==' ') ++ptr;
+
+            int vi = 0, ti = INDEX_NOT_SET, ni = INDEX_NOT_SET;
+            if (parseInt(ptr, vi))
+            {
+                if (*ptr=='/')
+                {
+                    const char* slash = ptr+1;
+                    int value = 0;
+                    if (*slash=='/')
+                    {
+                        ++slash;
+                        if (parseInt(slash, value)) ni = value;
+                    }
+                    else if (parseInt(slash, value))
+                    {
+                        ti = value;
+                        if (*slash=='/')
+                        {
+                            ++slash;
+                            if (parseInt(slash, value)) ni = value;
+                        }
+                    }
+                    ptr = slash;
+                }
+
+                indices.push_back(vi);
+                indices.push_back(ti);
+                indices.push_back(ni);
+                ++element.numIndices;
+            }
+
+            // skip to white space or end of line
+            while(*ptr!=' ' && *ptr!=0) ++ptr;
+        }
+
+        elements.push_back(element);
+    }
+    else if (strncmp(line,"usemtl ",7)==0)
+    {
+        addCommand(ParsedCommand::MATERIAL_NAME, line+7);
+    }
+    else if (strncmp(line,"mtllib ",7)==0)
+    {
+        addCommand(ParsedCommand::MATERIAL_LIBRARY, trim(line+7));
+    }
+    else if (strncmp(line,"o ",2)==0)
+    {
+        addCommand(ParsedCommand::OBJECT_NAME, line+2);
+    }
+    else if (strcmp(line,"o")==0)
+    {
+        addCommand(ParsedCommand::OBJECT_NAME, "");
+    }
+    else if (strncmp(line,"g ",2)==0)
+    {
+        addCommand(ParsedCommand::GROUP_NAME, line+2);
+    }
+    else if (strcmp(line,"g")==0)
+    {
+        addCommand(ParsedCommand::GROUP_NAME, "");
+    }
+    else if (strncmp(line,"s ",2)==0)
+    {
+        int smoothingGroup = 0;
+        const char* ptr = line+2;
+        if (strncmp(ptr,"off",3)!=0)
+        {
+            while(*ptr==' ') ++ptr;
+            if (!parseInt(ptr, smoothingGroup)) addCommand(ParsedCommand::NOT_HANDLED, "*** error reading smoothing group ***");
+        }
+        addCommand(ParsedCommand::SMOOTHING_GROUP, "");
+        commands.back().smoothingGroup = smoothingGroup;
+    }
+    else
+    {
+        addCommand(ParsedCommand::NOT_HANDLED, std::string("*** line not handled *** :")+line);
+    }
+}
+
+class ParseChunksTask : public osg::ParallelTask
+{
+public:
+    ParseChunksTask(std::vector<ParsedChunk>& chunks):
+        osg::ParallelTask(static_cast<unsigned int>(chunks.size())), _chunks(chunks) {}
+
+    virtual void process(unsigned int i)
+    {
+        _chunks[i].parse();
+    }
+
+protected:
+    ParseChunksTask& operator = (const ParseChunksTask&) { return *this; }
+
+    std::vector<ParsedChunk>&   _chunks;
+};
+
+}
+
+bool Model::readOBJ(const char* data, size_t size, const osgDB::ReaderWriter::Options* options, unsigned int numThreads)
+{
+    OSG_INFO<<"Reading OBJ file in parallel"<<std::endl;
+
+    if (numThreads==0) numThreads = static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    // several chunks per thread to balance the load, but not so small that the per chunk overhead shows.
+    const size_t minimumChunkSize = 1024*1024;
+    size_t numChunks = osg::minimum<size_t>(numThreads*4, size/minimumChunkSize+1);
+
+    // split after the last of a run of line endings, unless the run follows a line continuation backslash
+    // as Model::readline() carries a continued line over blank lines.
+    std::vector<ParsedChunk> chunks(numChunks);
+    const char* end = data+size;
+    const char* ptr = data;
+    for(size_t i=0; i<numChunks; ++i)
+    {
+        const char* chunkEnd = (i+1==numChunks) ? end : data + size/numChunks*(i+1);
+        if (chunkEnd<ptr) chunkEnd = ptr;
+        while(chunkEnd<end)
+        {
+            while(chunkEnd<end && *chunkEnd!='\n') ++chunkEnd;
+            if (chunkEnd==end) break;
+
+            ++chunkEnd;
+            if (chunkEnd<end && (*chunkEnd=='\n' || *chunkEnd=='\r')) continue;
+
+            const char* previous = chunkEnd-1;
+            while(previous>data && (*(previous-1)=='\n' || *(previous-1)=='\r')) --previous;
+            if (previous==data || *(previous-1)!='\\') break;
+        }
+
+        chunks[i].begin = ptr;
+        chunks[i].end = chunkEnd;
+        ptr = chunkEnd;
+    }
+
+    osg::ref_ptr<ParseChunksTask> task = new ParseChunksTask(chunks);
+    osg::ParallelTaskThreadPool::instance()->run(task.get(), numThreads);
+
+    // reserve the arrays up front, then merge the chunks in file order.
+    size_t numVertices = 0, numColors = 0, numNormals = 0, numTexCoords = 0;
+    for(std::vector<ParsedChunk>::iterator itr = chunks.begin(); itr != chunks.end(); ++itr)
+    {
+        numVertices += itr->vertices.size();
+        numColors += itr->colors.size();
+        numNormals += itr->normals.size();
+        numTexCoords += itr->texcoords.size();
+    }
+
+    vertices.reserve(vertices.size()+numVertices);
+    colors.reserve(colors.size()+numColors);
+    normals.reserve(normals.size()+numNormals);
+    texcoords.reserve(texcoords.size()+numTexCoords);
+
+    for(std::vector<ParsedChunk>::iterator itr = chunks.begin(); itr != chunks.end(); ++itr)
+    {
+        ParsedChunk& chunk = *itr;
+
+        int vertexOffset = static_cast<int>(vertices.size());
+        int normalOffset = static_cast<int>(normals.size());
+        int texCoordOffset = static_cast<int>(texcoords.size());
+
+        vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+        colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+        normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+        texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+
+        std::vector<ParsedCommand>::iterator citr = chunk.commands.begin();
+        for(unsigned int e=0; e<=chunk.elements.size(); ++e)
+        {
+            for(; citr != chunk.commands.end() && citr->position==e; ++citr)
+            {
+                switch(citr->type)
+                {
+                    case(ParsedCommand::MATERIAL_NAME): setCurrentMaterialName(citr->value); break;
+                    case(ParsedCommand::MATERIAL_LIBRARY): readMaterialLibrary(citr->value, options); break;
+                    case(ParsedCommand::OBJECT_NAME): setCurrentObjectName(citr->value); break;
+                    case(ParsedCommand::GROUP_NAME): setCurrentGroupName(citr->value); break;
+                    case(ParsedCommand::SMOOTHING_GROUP): setCurrentSmoothingGroup(citr->smoothingGroup); break;
+                    case(ParsedCommand::NOT_HANDLED): OSG_NOTICE<<citr->value<<std::endl; break;
+                }
+            }
+
+            if (e==chunk.elements.size()) break;
+
+            // resolve the indices against the arrays as they were when the element was read, as Model::readOBJ() does.
+            const ParsedElement& parsed = chunk.elements[e];
+            int numVerticesRead = vertexOffset + static_cast<int>(parsed.numVertices);
+            int numNormalsRead = normalOffset + static_cast<int>(parsed.numNormals);
+            int numTexCoordsRead = texCoordOffset + static_cast<int>(parsed.numTexCoords);
+
+            Element* element = new Element(parsed.dataType);
+            element->vertexIndices.reserve(parsed.numIndices);
+
+            const int* index = parsed.numIndices>0 ? &chunk.indices[parsed.firstIndex] : 0;
+            for(unsigned int i=0; i<parsed.numIndices; ++i, index+=3)
+            {
+                int vi = index[0], ti = index[1], ni = index[2];
+                element->vertexIndices.push_back((vi<0) ? numVerticesRead+vi : vi-1);
+
+                if (ni!=ParsedChunk::INDEX_NOT_SET && numNormalsRead>0)
+                {
+                    int remapped = (ni<0) ? numNormalsRead+ni : ni-1;
+                    if (remapped<numNormalsRead) element->normalIndices.push_back(remapped);
+                }
+
+                if (ti!=ParsedChunk::INDEX_NOT_SET && numTexCoordsRead>0)
+                {
+                    int remapped = (ti<0) ? numTexCoordsRead+ti : ti-1;
+                    if (remapped<numTexCoordsRead) element->texCoordIndices.push_back(remapped);
+                }
+            }
+
+            addParsedElement(element);
+        }
+
+        // release the chunk's memory as soon as it has been merged.
+        chunk.clear();
+    }
+
+    return true;
+}
+
+void Model::readMaterialLibrary(const std::string& materialFileName, const osgDB::ReaderWriter::Options* options)
+{
+    std::string fullPathFileName = osgDB::findDataFile( materialFileName, options );
+    if (!fullPathFileName.empty())
+    {
+        osgDB::ifstream mfin( fullPathFileName.c_str() );
+        if (mfin)
+        {
+            OSG_INFO << "Obj reading mtllib '" << fullPathFileName << "'\n";
+            readMTL(mfin);
+        }
+        else
+        {
+            OSG_WARN << "Obj unable to load mtllib '" << fullPathFileName << "'\n";
+        }
+    }
+    else
+    {
+        OSG_WARN << "Obj unable to find mtllib '" << materialFileName << "'\n";
+    }
+}
+
+void Model::setCurrentMaterialName(const std::string& materialName)
+{
+    if (currentElementState.materialName != materialName)
+    {
+        currentElementState.materialName = materialName;
+        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+    }
+}
+
+void Model::setCurrentObjectName(const std::string& objectName)
+{
+    if (currentElementState.objectName != objectName)
+    {
+        currentElementState.objectName = objectName;
+        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+    }
+}
+
+void Model::setCurrentGroupName(const std::string& groupName)
+{
+    if (currentElementState.groupName != groupName)
+    {
+        currentElementState.groupName = groupName;
+        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+    }
+}
+
+void Model::setCurrentSmoothingGroup(int smoothingGroup)
+{
+    if (currentElementState.smoothingGroup != smoothingGroup)
+    {
+        currentElementState.smoothingGroup = smoothingGroup;
+        currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+    }
+}
+
+void Model::addParsedElement(Element* element)
+{
+    if (!element->normalIndices.empty() && element->normalIndices.size() != element->vertexIndices.size())
+    {
+        element->normalIndices.clear();
+    }
+
+    if (!element->texCoordIndices.empty() && element->texCoordIndices.size() != element->vertexIndices.size())
+    {
+        element->texCoordIndices.clear();
+    }
+
+    if (!element->vertexIndices.empty())
+    {
+        Element::CoordinateCombination coordateCombination = element->getCoordinateCombination();
+        if (coordateCombination!=currentElementState.coordinateCombination)
+        {
+            currentElementState.coordinateCombination = coordateCombination;
+            currentElementList = 0; // reset the element list to force a recompute of which ElementList to use
+        }
+        addElement(element);
+    }
+    else
+    {
+        // empty element, don't both adding, just unref to delete it.
+        element->unref();
+    }
+}
+
 void Model::addElement(Element* element)
 {
     if (!currentElementList)
@@ -198,6 +198,20 @@ public:
     bool readMTL(std::istream& fin);
     bool readOBJ(std::istream& fin, const osgDB::ReaderWriter::Options* options);
 
+    /** Read an OBJ file held in memory, such as a memory mapped file. The data is split into line aligned chunks
+      * that are parsed by numThreads threads, 0 for one per processor, and the chunks then merged in file order.*/
+    bool readOBJ(const char* data, size_t size, const osgDB::ReaderWriter::Options* options, unsigned int numThreads);
+
+    void readMaterialLibrary(const std::string& materialFileName, const osgDB::ReaderWriter::Options* options);
+
+    void setCurrentMaterialName(const std::string& name);
+    void setCurrentObjectName(const std::string& name);
+    void setCurrentGroupName(const std::string& name);
+    void setCurrentSmoothingGroup(int smoothingGroup);
+
+    /** Finish reading an element, checking its indices are consistent and adding it to the current ElementList.*/
+    void addParsedElement(Element* element);
+
     bool readline(std::istream& fin, char* line, const int LINE_SIZE);
     void addElement(Element* element);
 
@@ -16,6 +16,7 @@
 #include <osgDB/FileUtils>
 #include <osgDB/Registry>
 #include <osgDB/ObjectWrapper>
+#include <osgDB/MappedFile>
 #include <stdlib.h>
 #include "AsciiStreamOperator.h"
 #include "BinaryStreamOperator.h"
@@ -128,9 +129,11 @@ public:
         supportsOption( "Ascii", "Import/Export option: Force reading/writing ascii file" );
         supportsOption( "XML", "Import/Export option: Force reading/writing XML file" );
         supportsOption( "ForceReadingImage", "Import option: Load an empty image instead if required file missed" );
+        supportsOption( "NoMemoryMapping", "Import option: Read files through a std::ifstream rather than memory mapping them" );
         supportsOption( "SchemaData", "Export option: Record inbuilt schema data into a binary file" );
+        supportsOption( "AlignArrays", "Export option: Align the array data of binary files without a compressor or schema data to 16 bytes, such files can't be read by earlier versions" );
         supportsOption( "SchemaFile=<file>", "Import/Export option: Use/Record an ascii schema file" );
-        supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor" );
+        supportsOption( "Compressor=<name>", "Export option: Use an inbuilt or user-defined compressor, inbuilt are zlib, and the block parallel zlibblocks and lz4" );
         supportsOption( "WriteImageHint=<hint>", "Export option: Hint of writing image to stream: "
                         "<IncludeData> writes Image::data() directly; "
                         "<IncludeFile> writes the image file itself to stream; "
@@ -174,6 +177,26 @@ public:
         return local_opt.release();
     }
 
+    typedef ReadResult (ReaderWriterOSG2::*StreamReadFunction)( std::istream&, const Options* ) const;
+
+    /// read from a memory mapping of the file, so the data doesn't pass through an ifstream buffer and arrays are copied straight out of the mapping.
+    ReadResult readFile( StreamReadFunction readFunction, const std::string& fileName, std::ios::openmode mode, const Options* options ) const
+    {
+        if ( options->getOptionString().find("NoMemoryMapping")==std::string::npos )
+        {
+            osg::ref_ptr<MappedFile> mappedFile = new MappedFile( fileName );
+            if ( mappedFile->valid() )
+            {
+                MemoryStreamBuffer buffer( mappedFile->data(), mappedFile->size() );
+                std::istream istream( &buffer );
+                return (this->*readFunction)( istream, options );
+            }
+        }
+
+        osgDB::ifstream istream( fileName.c_str(), mode );
+        return (this->*readFunction)( istream, options );
+    }
+
     virtual ReadResult readObject( const std::string& file, const Options* options ) const
     {
         ReadResult result = ReadResult::FILE_LOADED;
@@ -182,8 +205,7 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
-        osgDB::ifstream istream( fileName.c_str(), mode );
-        return readObject( istream, local_opt );
+        return readFile( &ReaderWriterOSG2::readObject, fileName, mode, local_opt );
     }
 
     virtual ReadResult readObject( std::istream& fin, const Options* options ) const
@@ -213,8 +235,7 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
-        osgDB::ifstream istream( fileName.c_str(), mode );
-        return readImage( istream, local_opt );
+        return readFile( &ReaderWriterOSG2::readImage, fileName, mode, local_opt );
     }
 
     virtual ReadResult readImage( std::istream& fin, const Options* options ) const
@@ -244,8 +265,7 @@ public:
         Options* local_opt = prepareReading( result, fileName, mode, options );
         if ( !result.success() ) return result;
 
-        osgDB::ifstream istream( fileName.c_str(), mode );
-        return readNode( istream, local_opt );
+        return readFile( &ReaderWriterOSG2::readNode, fileName, mode, local_opt );
     }
 
     virtual ReadResult readNode( std::istream& fin, const Options* options ) const
@@ -4,6 +4,8 @@
 #include <osgDB/Registry>
 #include <osgDB/FileNameUtils>
 
+#include <sstream>
+
 #include "OSGA_Archive.h"
 
 using namespace osgDB;
@@ -318,9 +320,308 @@ void OSGA_Archive::IndexBlock::setPositionNextIndexBlock(pos_type position)
     _requiresWrite = true;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+const float HASHED_INDEX_VERSION = 1.0f;
+
+// position in the version 1.0 header of the position of the hashed index, after the identifier, endian test word and version.
+const OSGA_Archive::pos_type HASHED_INDEX_POSITION_OFFSET = 12;
+
+const unsigned int NO_MASTER_ENTRY = 0xffffffff;
+
+OSGA_Archive::HashedIndex::HashedIndex()
+{
+    clear();
+}
+
+void OSGA_Archive::HashedIndex::clear()
+{
+    _buffer.clear();
+    _data = 0;
+    _buckets = 0;
+    _entries = 0;
+    _names = 0;
+    _numBuckets = 0;
+    _numEntries = 0;
+    _masterEntry = NO_MASTER_ENTRY;
+    _namesSize = 0;
+}
+
+unsigned int OSGA_Archive::HashedIndex::hash(const std::string& filename)
+{
+    // 32 bit FNV-1a
+    unsigned int value = 2166136261u;
+    for(std::string::const_iterator itr = filename.begin(); itr != filename.end(); ++itr)
+    {
+        value ^= static_cast<unsigned char>(*itr);
+        value *= 16777619u;
+    }
+    return value;
+}
+
+void OSGA_Archive::HashedIndex::write(std::ostream& out, const FileReferenceList& fileReferences, const std::string& masterFileName)
+{
+    // Requests for files will be in unix style even on Win32 so need unix style names in the index.
+    unsigned int numReferences = static_cast<unsigned int>(fileReferences.size());
+    std::vector<std::string> names(numReferences);
+    std::vector<unsigned int> hashes(numReferences);
+    for(unsigned int i=0; i<numReferences; ++i)
+    {
+        names[i] = osgDB::convertFileNameToUnixStyle(fileReferences[i].fileName);
+        hashes[i] = hash(names[i]);
+    }
+
+    // aim for two entries per bucket, cheap to scan and a small bucket table.
+    unsigned int numBuckets = osg::maximum(numReferences/2, 1u);
+
+    // order the references by bucket, keeping the order they were added within each bucket.
+    std::vector<unsigned int> bucketStart(numBuckets+1, 0);
+    for(unsigned int i=0; i<numReferences; ++i) ++bucketStart[hashes[i]%numBuckets+1];
+    for(unsigned int b=0; b<numBuckets; ++b) bucketStart[b+1] += bucketStart[b];
+
+    std::vector<unsigned int> order(numReferences);
+    std::vector<unsigned int> next(bucketStart.begin(), bucketStart.end()-1);
+    for(unsigned int i=0; i<numReferences; ++i) order[next[hashes[i]%numBuckets]++] = i;
+
+    // a file written to the archive more than once is replaced, so only keep the last reference of each name.
+    std::vector<unsigned int> entries;
+    std::vector<unsigned int> buckets(numBuckets+1, 0);
+    entries.reserve(numReferences);
+    for(unsigned int b=0; b<numBuckets; ++b)
+    {
+        buckets[b] = static_cast<unsigned int>(entries.size());
+        for(unsigned int i=bucketStart[b]; i<bucketStart[b+1]; ++i)
+        {
+            bool replaced = false;
+            for(unsigned int j=i+1; j<bucketStart[b+1] && !replaced; ++j)
+            {
+                replaced = (names[order[j]]==names[order[i]]);
+            }
+            if (!replaced) entries.push_back(order[i]);
+        }
+    }
+    buckets[numBuckets] = static_cast<unsigned int>(entries.size());
+
+    unsigned int numEntries = static_cast<unsigned int>(entries.size());
+    unsigned int masterEntry = NO_MASTER_ENTRY;
+    std::string unixMasterFileName = osgDB::convertFileNameToUnixStyle(masterFileName);
+    size_type namesSize = 0;
+    for(unsigned int e=0; e<numEntries; ++e)
+    {
+        if (masterEntry==NO_MASTER_ENTRY && names[entries[e]]==unixMasterFileName) masterEntry = e;
+        namesSize += names[entries[e]].size();
+    }
+
+    unsigned int padding = 0;
+    out.write(reinterpret_cast<const char*>(&numBuckets), sizeof(numBuckets));
+    out.write(reinterpret_cast<const char*>(&numEntries), sizeof(numEntries));
+    out.write(reinterpret_cast<const char*>(&masterEntry), sizeof(masterEntry));
+    out.write(reinterpret_cast<const char*>(&padding), sizeof(padding));
+    out.write(reinterpret_cast<const char*>(&namesSize), sizeof(namesSize));
+
+    if (!buckets.empty()) out.write(reinterpret_cast<const char*>(&buckets.front()), buckets.size()*sizeof(unsigned int));
+
+    size_type nameOffset = 0;
+    for(unsigned int e=0; e<numEntries; ++e)
+    {
+        const FileReference& fileReference = fileReferences[entries[e]];
+        const std::string& name = names[entries[e]];
+        unsigned int nameLength = static_cast<unsigned int>(name.size());
+        out.write(reinterpret_cast<const char*>(&fileReference.position), sizeof(pos_type));
+        out.write(reinterpret_cast<const char*>(&fileReference.size), sizeof(size_type));
+        out.write(reinterpret_cast<const char*>(&hashes[entries[e]]), sizeof(unsigned int));
+        out.write(reinterpret_cast<const char*>(&nameLength), sizeof(unsigned int));
+        out.write(reinterpret_cast<const char*>(&nameOffset), sizeof(size_type));
+        nameOffset += nameLength;
+    }
+
+    for(unsigned int e=0; e<numEntries; ++e)
+    {
+        const std::string& name = names[entries[e]];
+        out.write(name.data(), name.size());
+    }
+}
+
+bool OSGA_Archive::HashedIndex::setData(const char* data, size_type size)
+{
+    clear();
+
+    if (!data || size<size_type(HEADER_SIZE)) return false;
+
+    unsigned int numBuckets, numEntries, masterEntry;
+    size_type namesSize;
+    _read(data, numBuckets);
+    _read(data+sizeof(unsigned int), numEntries);
+    _read(data+2*sizeof(unsigned int), masterEntry);
+    _read(data+4*sizeof(unsigned int), namesSize);
+
+    // check each part against the size separately so corrupt counts can't overflow the total.
+    size_type bucketsSize = size_type(numBuckets+1)*sizeof(unsigned int);
+    size_type entriesSize = size_type(numEntries)*ENTRY_SIZE;
+    if (numBuckets==0 || namesSize<0 || namesSize>size || bucketsSize>size || entriesSize>size ||
+        size_type(HEADER_SIZE)+bucketsSize+entriesSize+namesSize>size)
+    {
+        OSG_WARN<<"OSGA_Archive::HashedIndex::setData() invalid archive index."<<std::endl;
+        return false;
+    }
+
+    _data = data;
+    _buckets = data+HEADER_SIZE;
+    _entries = _buckets+bucketsSize;
+    _names = _entries+entriesSize;
+    _numBuckets = numBuckets;
+    _numEntries = numEntries;
+    _masterEntry = masterEntry;
+    _namesSize = namesSize;
+    return true;
+}
+
+bool OSGA_Archive::HashedIndex::read(std::istream& in, bool doEndianSwap)
+{
+    clear();
+
+    // the index runs to the end of the archive, so the counts in its header can't ask for more than is left in the file.
+    std::istream::pos_type start = in.tellg();
+    in.seekg(0, std::ios_base::end);
+    std::istream::pos_type end = in.tellg();
+    in.seekg(start);
+    if (!in || start<std::istream::pos_type(0) || end<start) return false;
+    size_type available = size_type(end-start);
+
+    std::vector<char> buffer(HEADER_SIZE);
+    if (available<size_type(HEADER_SIZE) || !in.read(&buffer.front(), HEADER_SIZE)) return false;
+
+    char* ptr = &buffer.front();
+    if (doEndianSwap)
+    {
+        for(unsigned int i=0; i<4; ++i) osg::swapBytes(ptr+i*sizeof(unsigned int), sizeof(unsigned int));
+        osg::swapBytes(ptr+4*sizeof(unsigned int), sizeof(size_type));
+    }
+
+    unsigned int numBuckets, numEntries;
+    size_type namesSize;
+    _read(ptr, numBuckets);
+    _read(ptr+sizeof(unsigned int), numEntries);
+    _read(ptr+4*sizeof(unsigned int), namesSize);
+
+    size_type bucketsSize = size_type(numBuckets+1)*sizeof(unsigned int);
+    size_type entriesSize = size_type(numEntries)*ENTRY_SIZE;
+    size_type totalSize = size_type(HEADER_SIZE)+bucketsSize+entriesSize+namesSize;
+    if (numBuckets==0 || namesSize<0 || namesSize>available || bucketsSize>available || entriesSize>available ||
+        totalSize>available || totalSize!=size_type(size_t(totalSize)))
+    {
+        OSG_WARN<<"OSGA_Archive::HashedIndex::read() invalid archive index."<<std::endl;
+        return false;
+    }
+
+    buffer.resize(static_cast<size_t>(totalSize));
+    if (!in.read(&buffer[HEADER_SIZE], static_cast<std::streamsize>(totalSize-HEADER_SIZE))) return false;
+
+    if (doEndianSwap)
+    {
+        ptr = &buffer[HEADER_SIZE];
+        for(unsigned int b=0; b<=numBuckets; ++b, ptr += sizeof(unsigned int))
+        {
+            osg::swapBytes(ptr, sizeof(unsigned int));
+        }
+
+        for(unsigned int e=0; e<numEntries; ++e)
+        {
+            osg::swapBytes(ptr, sizeof(pos_type));
+            ptr += sizeof(pos_type);
+            osg::swapBytes(ptr, sizeof(size_type));
+            ptr += sizeof(size_type);
+            osg::swapBytes(ptr, sizeof(unsigned int));
+            ptr += sizeof(unsigned int);
+            osg::swapBytes(ptr, sizeof(unsigned int));
+            ptr += sizeof(unsigned int);
+            osg::swapBytes(ptr, sizeof(size_type));
+            ptr += sizeof(size_type);
+        }
+    }
+
+    if (!setData(&buffer.front(), totalSize)) return false;
+
+    // keep the buffer, the vector's storage doesn't move when swapped.
+    _buffer.swap(buffer);
+    return true;
+}
+
+bool OSGA_Archive::HashedIndex::find(const std::string& filename, PositionSizePair& positionSize) const
+{
+    if (!_data || _numEntries==0) return false;
+
+    unsigned int value = hash(filename);
+    unsigned int bucket = value % _numBuckets;
+
+    unsigned int begin, end;
+    _read(_buckets+bucket*sizeof(unsigned int), begin);
+    _read(_buckets+(bucket+1)*sizeof(unsigned int), end);
+    if (end>_numEntries) end = _numEntries;
+
+    for(unsigned int i=begin; i<end; ++i)
+    {
+        const char* ptr = entry(i);
+
+        unsigned int entryHash, nameLength;
+        _read(ptr+sizeof(pos_type)+sizeof(size_type), entryHash);
+        if (entryHash!=value) continue;
+
+        _read(ptr+sizeof(pos_type)+sizeof(size_type)+sizeof(unsigned int), nameLength);
+        if (nameLength!=filename.size()) continue;
+
+        size_type nameOffset;
+        _read(ptr+sizeof(pos_type)+sizeof(size_type)+2*sizeof(unsigned int), nameOffset);
+        if (nameOffset<0 || nameOffset+nameLength>_namesSize) continue;
+
+        if (filename.compare(0, nameLength, _names+nameOffset, nameLength)==0)
+        {
+            _read(ptr, positionSize.first);
+            _read(ptr+sizeof(pos_type), positionSize.second);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string OSGA_Archive::HashedIndex::getFileName(unsigned int i) const
+{
+    if (i>=_numEntries) return std::string();
+
+    const char* ptr = entry(i);
+
+    unsigned int nameLength;
+    size_type nameOffset;
+    _read(ptr+sizeof(pos_type)+sizeof(size_type)+sizeof(unsigned int), nameLength);
+    _read(ptr+sizeof(pos_type)+sizeof(size_type)+2*sizeof(unsigned int), nameOffset);
+    if (nameOffset<0 || nameOffset+nameLength>_namesSize) return std::string();
+
+    return std::string(_names+nameOffset, nameLength);
+}
+
+std::string OSGA_Archive::HashedIndex::getMasterFileName() const
+{
+    return getFileName(_masterEntry);
+}
+
+void OSGA_Archive::HashedIndex::getFileReferences(FileReferenceList& fileReferences) const
+{
+    fileReferences.reserve(fileReferences.size()+_numEntries);
+    for(unsigned int i=0; i<_numEntries; ++i)
+    {
+        FileReference fileReference;
+        _read(entry(i), fileReference.position);
+        _read(entry(i)+sizeof(pos_type), fileReference.size);
+        fileReference.fileName = getFileName(i);
+        fileReferences.push_back(fileReference);
+    }
+}
+
 OSGA_Archive::OSGA_Archive():
     _version(0.0f),
-    _status(READ)
+    _status(READ),
+    _useHashedIndex(false),
+    _hashedIndexPosition(0),
+    _useMemoryMapping(true)
 {
 }
 
@@ -331,6 +632,12 @@ OSGA_Archive::~OSGA_Archive()
 
 
 bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSize)
+{
+    OpenThreads::ScopedWriteLock openLock(_openMutex);
+    return _open(filename, status, indexBlockSize);
+}
+
+bool OSGA_Archive::_open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSize)
 {
     SERIALIZER();
 
@@ -341,12 +648,57 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
         _status = status;
         _input.open(filename.c_str(), std::ios_base::binary | std::ios_base::in);
 
-        return _open(_input);
+        if (_useMemoryMapping && _input)
+        {
+            // only map archives that comfortably fit in the address space, leaving room for
+            // everything else on 32 bit builds, larger archives are read through the stream pool.
+            _input.seekg( 0, std::ios_base::end );
+            pos_type file_size = ARCHIVE_POS( _input.tellg() );
+            pos_type max_size = sizeof(void*)<8 ? pos_type(1)<<30 : pos_type(1)<<46;
+            if (file_size>0 && file_size<max_size)
+            {
+                _mappedFile = new osgDB::MappedFile(filename);
+                if (!_mappedFile->valid() || pos_type(_mappedFile->size())!=file_size) _mappedFile = 0;
+            }
+            _input.seekg( 0, std::ios_base::beg );
+
+            OSG_INFO<<"OSGA_Archive::open("<<filename<<") memory mapped="<<_mappedFile.valid()<<std::endl;
+        }
+
+        if (!_open(_input))
+        {
+            _mappedFile = 0;
+            return false;
+        }
+
+        return true;
     }
     else
     {
-        if (status==WRITE && open(filename,READ))
+        if (status==WRITE && _open(filename,READ,indexBlockSize))
         {
+            if (_version>=HASHED_INDEX_VERSION)
+            {
+                // new files are appended after the existing hashed index, which stays intact and referenced by the
+                // header until close() has written the new index with the existing and new entries after them.
+                _hashedIndex.getFileReferences(_fileReferences);
+                _hashedIndex.clear();
+
+                _input.seekg( 0, std::ios_base::end );
+                pos_type file_size = ARCHIVE_POS( _input.tellg() );
+
+                _input.close();
+                _mappedFile = 0;
+                _status = WRITE;
+
+                osgDB::open(_output, filename.c_str(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+                _output.seekp( STREAM_POS( file_size ) );
+
+                OSG_INFO<<"OSGA_Archive::open("<<filename<<") open for writing, hashed index"<<std::endl;
+
+                return true;
+            }
+
             pos_type file_size( 0 );
             _input.seekg( 0, std::ios_base::end );
             file_size = ARCHIVE_POS( _input.tellg() );
@@ -375,6 +727,7 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
                 }
             }
             _input.close();
+            _mappedFile = 0;
             _status = WRITE;
 
             osgDB::open(_output, filename.c_str(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
@@ -398,6 +751,17 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
             osgDB::open(_output, filename.c_str(), std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
             _output<<"osga";
             _output.write(reinterpret_cast<const char*>(&ENDIAN_TEST_NUMBER),4);
+
+            if (_useHashedIndex)
+            {
+                // the position of the hashed index is filled in when the archive is closed.
+                _version = HASHED_INDEX_VERSION;
+                _hashedIndexPosition = 0;
+                _output.write(reinterpret_cast<char*>(&_version),sizeof(float));
+                _output.write(reinterpret_cast<char*>(&_hashedIndexPosition),sizeof(pos_type));
+                return true;
+            }
+
             _output.write(reinterpret_cast<char*>(&s_currentSupportedVersion),sizeof(float));
 
             IndexBlock *indexBlock = new IndexBlock(indexBlockSize);
@@ -417,6 +781,7 @@ bool OSGA_Archive::open(const std::string& filename, ArchiveStatus status, unsig
 
 bool OSGA_Archive::open(std::istream& fin)
 {
+    OpenThreads::ScopedWriteLock openLock(_openMutex);
     SERIALIZER();
 
     _archiveFileName = "";
@@ -450,6 +815,38 @@ bool OSGA_Archive::_open(std::istream& input)
             OSG_INFO<<"OSGA_Archive::open() doEndianSwap="<<doEndianSwap<<std::endl;
             OSG_INFO<<"OSGA_Archive::open() Version="<<_version<<std::endl;
 
+            if (_version>=HASHED_INDEX_VERSION)
+            {
+                input.read(reinterpret_cast<char*>(&_hashedIndexPosition),sizeof(_hashedIndexPosition));
+                if (doEndianSwap)
+                {
+                    osg::swapBytes(reinterpret_cast<char*>(&_hashedIndexPosition),sizeof(_hashedIndexPosition));
+                }
+
+                if (!input || _hashedIndexPosition<=HASHED_INDEX_POSITION_OFFSET)
+                {
+                    OSG_WARN<<"OSGA_Archive::open() archive has no index, it may not have been closed after writing."<<std::endl;
+                    return false;
+                }
+
+                // search the index in place when the archive is mapped, otherwise it is read in one go.
+                if (_mappedFile.valid() && !doEndianSwap && _hashedIndexPosition<pos_type(_mappedFile->size()))
+                {
+                    if (!_hashedIndex.setData(_mappedFile->data()+_hashedIndexPosition, pos_type(_mappedFile->size())-_hashedIndexPosition)) return false;
+                }
+                else
+                {
+                    input.seekg( STREAM_POS( _hashedIndexPosition ) );
+                    if (!_hashedIndex.read(input, doEndianSwap)) return false;
+                }
+
+                _masterFileName = _hashedIndex.getMasterFileName();
+
+                OSG_INFO<<"OSGA_Archive::open() hashed index of "<<_hashedIndex.getNumEntries()<<" files"<<std::endl;
+
+                return true;
+            }
+
             IndexBlock *indexBlock = 0;
 
             while ( (indexBlock=OSGA_Archive::IndexBlock::read(input, doEndianSwap)) != 0)
@@ -491,13 +888,19 @@ bool OSGA_Archive::_open(std::istream& input)
 
 void OSGA_Archive::close()
 {
+    OpenThreads::ScopedWriteLock openLock(_openMutex);
     SERIALIZER();
 
     _input.close();
 
+    _hashedIndex.clear();
+    _mappedFile = 0;
+    clearInputStreamPool();
+
     if (_status==WRITE)
     {
-        writeIndexBlocks();
+        if (_version>=HASHED_INDEX_VERSION) writeHashedIndex();
+        else writeIndexBlocks();
         _output.close();
     }
 }
@@ -509,15 +912,30 @@ std::string OSGA_Archive::getMasterFileName() const
 
 osgDB::FileType OSGA_Archive::getFileType(const std::string& filename) const
 {
-    if (_indexMap.count(filename)!=0) return osgDB::REGULAR_FILE;
+    OpenThreads::ScopedReadLock openLock(_openMutex);
+
+    PositionSizePair positionSize;
+    if (findFileReference(filename, positionSize)) return osgDB::REGULAR_FILE;
     return osgDB::FILE_NOT_FOUND;
 }
 
 bool OSGA_Archive::getFileNames(FileNameList& fileNameList) const
 {
+    OpenThreads::ScopedReadLock openLock(_openMutex);
     SERIALIZER();
 
     fileNameList.clear();
+
+    if (_hashedIndex.valid())
+    {
+        fileNameList.reserve(_hashedIndex.getNumEntries());
+        for(unsigned int i=0; i<_hashedIndex.getNumEntries(); ++i)
+        {
+            fileNameList.push_back(_hashedIndex.getFileName(i));
+        }
+        return !fileNameList.empty();
+    }
+
     fileNameList.reserve(_indexMap.size());
     for(FileNamePositionMap::const_iterator itr=_indexMap.begin();
         itr!=_indexMap.end();
@@ -546,9 +964,43 @@ void OSGA_Archive::writeIndexBlocks()
     }
 }
 
+void OSGA_Archive::writeHashedIndex()
+{
+    SERIALIZER();
+
+    if (_status==WRITE && _output.is_open())
+    {
+        // files are appended at the output position, so the index follows the last of them.
+        _hashedIndexPosition = ARCHIVE_POS( _output.tellp() );
+
+        HashedIndex::write(_output, _fileReferences, _masterFileName);
+
+        // only point the header at the new index once it has been written, so the previous index stays valid until then.
+        _output.flush();
+        _output.seekp( STREAM_POS( HASHED_INDEX_POSITION_OFFSET ) );
+        _output.write(reinterpret_cast<char*>(&_hashedIndexPosition),sizeof(pos_type));
+
+        OSG_INFO<<"OSGA_Archive::writeHashedIndex() "<<_fileReferences.size()<<" files at "<<_hashedIndexPosition<<std::endl;
+    }
+}
+
+bool OSGA_Archive::findFileReference(const std::string& filename, PositionSizePair& positionSize) const
+{
+    if (_hashedIndex.valid()) return _hashedIndex.find(filename, positionSize);
+
+    FileNamePositionMap::const_iterator itr = _indexMap.find(filename);
+    if (itr==_indexMap.end()) return false;
+
+    positionSize = itr->second;
+    return true;
+}
+
 bool OSGA_Archive::fileExists(const std::string& filename) const
 {
-    return (_indexMap.count(filename)!=0);
+    OpenThreads::ScopedReadLock openLock(_openMutex);
+
+    PositionSizePair positionSize;
+    return findFileReference(filename, positionSize);
 }
 
 bool OSGA_Archive::addFileReference(pos_type position, size_type size, const std::string& fileName)
@@ -571,6 +1023,12 @@ bool OSGA_Archive::addFileReference(pos_type position, size_type size, const std
     // if the masterFileName isn't set yet use this fileName
     if (_masterFileName.empty()) _masterFileName = fileName;
 
+    if (_version>=HASHED_INDEX_VERSION)
+    {
+        _fileReferences.push_back(FileReference(position, size, fileName));
+        return true;
+    }
+
 
     // get an IndexBlock with space available if possible
     unsigned int blockSize = 4096;
@@ -724,18 +1182,73 @@ struct OSGA_Archive::ReadShaderFunctor : public OSGA_Archive::ReadFunctor
     virtual ReaderWriter::ReadResult doRead(ReaderWriter& rw, std::istream& input) const { return rw.readShader(input, _options); }
 };
 
-ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
+// pool of file handles so concurrent reads each get their own file position, a handle is only
+// owned by one read at a time, the pool mutex is held just for taking and returning handles.
+
+osgDB::ifstream* OSGA_Archive::acquireInputStream()
 {
-    SERIALIZER();
+    {
+        OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_inputStreamPoolMutex);
+        if (!_inputStreamPool.empty())
+        {
+            osgDB::ifstream* input = _inputStreamPool.back();
+            _inputStreamPool.pop_back();
+            return input;
+        }
+    }
+
+    osgDB::ifstream* input = new osgDB::ifstream(_archiveFileName.c_str(), std::ios_base::binary | std::ios_base::in);
+    if (!input->is_open())
+    {
+        delete input;
+        return 0;
+    }
+    return input;
+}
+
+void OSGA_Archive::releaseInputStream(osgDB::ifstream* input)
+{
+    input->clear();
 
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_inputStreamPoolMutex);
+    _inputStreamPool.push_back(input);
+}
+
+void OSGA_Archive::clearInputStreamPool()
+{
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(_inputStreamPoolMutex);
+    for(InputStreamPool::iterator itr = _inputStreamPool.begin();
+        itr != _inputStreamPool.end();
+        ++itr)
+    {
+        delete *itr;
+    }
+    _inputStreamPool.clear();
+}
+
+class OSGA_Archive::InputStreamHandle
+{
+public:
+    InputStreamHandle(OSGA_Archive* archive): _archive(archive), _input(archive->acquireInputStream()) {}
+    ~InputStreamHandle() { if (_input) _archive->releaseInputStream(_input); }
+
+    OSGA_Archive*       _archive;
+    osgDB::ifstream*    _input;
+};
+
+ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
+{
     if (_status!=READ)
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, archive opened as write only."<<std::endl;
         return ReadResult(ReadResult::FILE_NOT_HANDLED);
     }
 
-    FileNamePositionMap::const_iterator itr = _indexMap.find(readFunctor._filename);
-    if (itr==_indexMap.end())
+    // hold off close() and open() until the read has finished with the index, mapping and streams.
+    OpenThreads::ScopedReadLock openLock(_openMutex);
+
+    PositionSizePair positionSize;
+    if (!findFileReference(readFunctor._filename, positionSize))
     {
         OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<") failed, file not found in archive"<<std::endl;
         return ReadResult(ReadResult::FILE_NOT_FOUND);
@@ -750,11 +1263,36 @@ ReaderWriter::ReadResult OSGA_Archive::read(const ReadFunctor& readFunctor)
 
     OSG_INFO<<"OSGA_Archive::readObject(obj, "<<readFunctor._filename<<")"<<std::endl;
 
-    _input.seekg( STREAM_POS( itr->second.first ) );
+    // the index is not modified by reads, so archives opened by filename only need the shared _openMutex.
+    if (_mappedFile.valid() && positionSize.first>=0 && positionSize.second>=0 &&
+        positionSize.first+positionSize.second<=pos_type(_mappedFile->size()))
+    {
+        osgDB::MemoryStreamBuffer buffer(_mappedFile->data()+positionSize.first, static_cast<size_t>(positionSize.second));
+        std::istream ins(&buffer);
+        return readFunctor.doRead(*rw, ins);
+    }
+
+    if (!_archiveFileName.empty())
+    {
+        InputStreamHandle handle(this);
+        if (handle._input)
+        {
+            handle._input->seekg( STREAM_POS( positionSize.first ) );
+
+            proxy_streambuf mystreambuf(handle._input->rdbuf(),positionSize.second);
+            std::istream ins(&mystreambuf);
+            return readFunctor.doRead(*rw, ins);
+        }
+    }
+
+    // archives opened from a user supplied stream share the one stream.
+    SERIALIZER();
+
+    _input.seekg( STREAM_POS( positionSize.first ) );
 
     // set up proxy stream buffer to provide the faked ending.
     std::istream& ins = _input;
-    proxy_streambuf mystreambuf(ins.rdbuf(),itr->second.second);
+    proxy_streambuf mystreambuf(ins.rdbuf(),positionSize.second);
     ins.rdbuf(&mystreambuf);
 
     ReaderWriter::ReadResult result = readFunctor.doRead(*rw, _input);
@@ -842,8 +1380,6 @@ struct OSGA_Archive::WriteShaderFunctor : public OSGA_Archive::WriteFunctor
 
 ReaderWriter::WriteResult OSGA_Archive::write(const WriteFunctor& writeFunctor)
 {
-    SERIALIZER();
-
     if (_status!=WRITE)
     {
         OSG_INFO<<"OSGA_Archive::write(obj, "<<writeFunctor._filename<<") failed, archive opened as read only."<<std::endl;
@@ -859,23 +1395,28 @@ ReaderWriter::WriteResult OSGA_Archive::write(const WriteFunctor& writeFunctor)
 
     OSG_INFO<<"OSGA_Archive::write(obj, "<<writeFunctor._filename<<")"<<std::endl;
 
-    pos_type position = ARCHIVE_POS( _output.tellp() );
-
-    WriteResult result = writeFunctor.doWrite(*rw,_output);
-
-    pos_type final_position = ARCHIVE_POS( _output.tellp() );
-    size_type size = size_type( final_position-position );
+    // serialize the file before taking the lock so that several threads can write into the archive at once,
+    // only appending the result to the archive is serialized.
+    std::ostringstream buffer(std::ios_base::out | std::ios_base::binary);
+    WriteResult result = writeFunctor.doWrite(*rw,buffer);
 
-    if (result.success())
-    {
-        OSG_INFO<<"Adding file "<<writeFunctor._filename<<" reference to archive."<<std::endl;
-        addFileReference(position, size, writeFunctor._filename);
-    }
-    else
+    if (!result.success())
     {
         OSG_INFO<<"writeFunctor unsuccessful."<<std::endl;
+        return result;
     }
 
+    std::string data = buffer.str();
+
+    SERIALIZER();
+
+    pos_type position = ARCHIVE_POS( _output.tellp() );
+
+    _output.write(data.data(), data.size());
+
+    OSG_INFO<<"Adding file "<<writeFunctor._filename<<" reference to archive."<<std::endl;
+    addFileReference(position, size_type(data.size()), writeFunctor._filename);
+
     return result;
 }
 
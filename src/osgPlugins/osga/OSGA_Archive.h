@@ -14,9 +14,12 @@
 #include <osg/Notify>
 #include <osgDB/Archive>
 #include <osgDB/FileNameUtils>
+#include <osgDB/MappedFile>
 
 #include <OpenThreads/ScopedLock>
+#include <OpenThreads/Mutex>
 #include <OpenThreads/ReentrantMutex>
+#include <OpenThreads/ReadWriteMutex>
 
 #define SERIALIZER() OpenThreads::ScopedLock<OpenThreads::ReentrantMutex> lock(_serializerMutex)
 
@@ -35,6 +38,19 @@ class OSGA_Archive : public osgDB::Archive
             return osgDB::equalCaseInsensitive(extension,"osga");
         }
 
+        /** Set whether archives opened for reading by filename are memory mapped, on by default. When mapped, files
+          * are read straight from the mapping, otherwise each concurrent read uses its own file handle from a pool.
+          * Archives too large for the address space are never mapped. Must be set before open().*/
+        void setUseMemoryMapping(bool flag) { _useMemoryMapping = flag; }
+        bool getUseMemoryMapping() const { return _useMemoryMapping; }
+
+        /** Set whether newly created archives use the version 1.0 hashed index rather than the linked list of index blocks,
+          * off by default as older versions of the plugin can't read them. The hashed index is written once when the
+          * archive is closed and is searched in place, so opening an archive with millions of files doesn't have to
+          * read every entry. Appending to an existing archive keeps its index version. Must be set before open().*/
+        void setUseHashedIndex(bool flag) { _useHashedIndex = flag; }
+        bool getUseHashedIndex() const { return _useHashedIndex; }
+
         /** open the archive.*/
         virtual bool open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSizeHint=4096);
 
@@ -101,6 +117,17 @@ class OSGA_Archive : public osgDB::Archive
         typedef std::pair<pos_type, size_type> PositionSizePair;
         typedef std::map<std::string, PositionSizePair> FileNamePositionMap;
 
+        struct FileReference
+        {
+            FileReference(): position(0), size(0) {}
+            FileReference(pos_type p, size_type s, const std::string& fn): position(p), size(s), fileName(fn) {}
+
+            pos_type    position;
+            size_type   size;
+            std::string fileName;
+        };
+        typedef std::vector<FileReference> FileReferenceList;
+
     protected:
 
         mutable OpenThreads::ReentrantMutex _serializerMutex;
@@ -158,6 +185,68 @@ class OSGA_Archive : public osgDB::Archive
             char*           _data;
         };
 
+        class HashedIndex;
+        friend class HashedIndex;
+
+        /** On disk hash table of the version 1.0 archive index, searched in place, either in the memory mapping
+          * of the archive or in a single buffer read from the file. The layout, in the archive's byte order, is:
+          * a header of numBuckets, numEntries, masterEntry, padding (unsigned int) and the size of the name table (size_type),
+          * numBuckets+1 unsigned int indices of the first entry of each bucket,
+          * numEntries entries of position, size (pos_type, size_type), hash, name length (unsigned int) and name offset (size_type),
+          * then the file names. Entries are ordered by bucket, the bucket being the FNV-1a hash of the name modulo numBuckets.*/
+        class HashedIndex
+        {
+        public:
+            HashedIndex();
+
+            static unsigned int hash(const std::string& filename);
+
+            /** Write the table for fileReferences, masterFileName being the file recorded as the master file.*/
+            static void write(std::ostream& out, const FileReferenceList& fileReferences, const std::string& masterFileName);
+
+            /** Use table data that remains valid for the lifetime of the HashedIndex, such as the memory mapped archive,
+              * size being the number of bytes available from data onwards.*/
+            bool setData(const char* data, size_type size);
+
+            /** Read the table from the current position of the stream into a buffer owned by the HashedIndex, swapping bytes if required.*/
+            bool read(std::istream& in, bool doEndianSwap);
+
+            void clear();
+
+            bool valid() const { return _data!=0; }
+
+            unsigned int getNumEntries() const { return _numEntries; }
+
+            bool find(const std::string& filename, PositionSizePair& positionSize) const;
+
+            std::string getFileName(unsigned int entry) const;
+            std::string getMasterFileName() const;
+
+            void getFileReferences(FileReferenceList& fileReferences) const;
+
+        protected:
+
+            static const unsigned int HEADER_SIZE = 4*sizeof(unsigned int)+sizeof(size_type);
+            static const unsigned int ENTRY_SIZE = sizeof(pos_type)+sizeof(size_type)+2*sizeof(unsigned int)+sizeof(size_type);
+
+            const char* entry(unsigned int i) const { return _entries + i*ENTRY_SIZE; }
+
+            std::vector<char>   _buffer;
+            const char*         _data;
+            const char*         _buckets;
+            const char*         _entries;
+            const char*         _names;
+            unsigned int        _numBuckets;
+            unsigned int        _numEntries;
+            unsigned int        _masterEntry;
+            size_type           _namesSize;
+
+        private:
+
+            HashedIndex(const HashedIndex&);
+            HashedIndex& operator = (const HashedIndex&);
+        };
+
     public:
         /** Functor used in internal implementations.*/
         struct ReadFunctor
@@ -207,8 +296,20 @@ class OSGA_Archive : public osgDB::Archive
 
         typedef std::list< osg::ref_ptr<IndexBlock> >   IndexBlockList;
 
+        bool _open(const std::string& filename, ArchiveStatus status, unsigned int indexBlockSize);
         bool _open(std::istream& fin);
 
+        bool findFileReference(const std::string& filename, PositionSizePair& positionSize) const;
+
+        void writeHashedIndex();
+
+        class InputStreamHandle;
+        friend class InputStreamHandle;
+
+        osgDB::ifstream* acquireInputStream();
+        void releaseInputStream(osgDB::ifstream* input);
+        void clearInputStreamPool();
+
         void writeIndexBlocks();
 
         bool addFileReference(pos_type position, size_type size, const std::string& fileName);
@@ -224,6 +325,26 @@ class OSGA_Archive : public osgDB::Archive
         IndexBlockList      _indexBlockList;
         FileNamePositionMap _indexMap;
 
+        // version 1.0 archives, _hashedIndex when reading, _fileReferences collects the entries while writing
+        // and the table is written at _hashedIndexPosition when the archive is closed.
+        bool                _useHashedIndex;
+        HashedIndex         _hashedIndex;
+        FileReferenceList   _fileReferences;
+        pos_type            _hashedIndexPosition;
+
+        // concurrent read support for archives opened for reading by filename, the index is immutable
+        // once opened so reads only need their own view of the file rather than the _serializerMutex.
+        // Reads hold _openMutex shared and open()/close() hold it exclusively, so the index, the mapping
+        // and the pooled streams can't be released while a read is using them.
+        typedef std::vector<osgDB::ifstream*> InputStreamPool;
+
+        mutable OpenThreads::ReadWriteMutex _openMutex;
+
+        bool                                _useMemoryMapping;
+        osg::ref_ptr<osgDB::MappedFile>     _mappedFile;
+        OpenThreads::Mutex                  _inputStreamPoolMutex;
+        InputStreamPool                     _inputStreamPool;
+
 
         template <typename T>
         static inline void _write(char* ptr, const T& value)
@@ -232,7 +353,7 @@ class OSGA_Archive : public osgDB::Archive
         }
 
         template <typename T>
-        static inline void _read(char* ptr, T& value)
+        static inline void _read(const char* ptr, T& value)
         {
             std::copy(ptr,ptr+sizeof(value),reinterpret_cast<char*>(&value));
         }
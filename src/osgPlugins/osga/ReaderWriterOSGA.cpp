@@ -12,6 +12,8 @@ public:
     ReaderWriterOSGA()
     {
         supportsExtension("osga","OpenSceneGraph Archive format");
+        supportsOption("NoMemoryMapping","Import option: read files from the archive through a pool of file streams rather than a memory mapping of the archive.");
+        supportsOption("HashedIndex","Export option: create the archive with the version 1.0 hashed index, for fast opening of archives holding many files.");
     }
 
     virtual const char* className() const { return "OpenSceneGraph Archive Reader/Writer"; }
@@ -30,6 +32,17 @@ public:
         }
 
         osg::ref_ptr<OSGA_Archive> archive = new OSGA_Archive;
+
+        if (options && options->getOptionString().find("NoMemoryMapping")!=std::string::npos)
+        {
+            archive->setUseMemoryMapping(false);
+        }
+
+        if (options && options->getOptionString().find("HashedIndex")!=std::string::npos)
+        {
+            archive->setUseHashedIndex(true);
+        }
+
         if (!archive->open(fileName, status, indexBlockSize))
         {
             return ReadResult(ReadResult::FILE_NOT_HANDLED);
@@ -61,7 +74,7 @@ public:
 
     virtual ReadResult readMasterFile(ReadType type, const std::string& file, const Options* options) const
     {
-        ReadResult result = openArchive(file, osgDB::Archive::READ);
+        ReadResult result = openArchive(file, osgDB::Archive::READ, 4096, options);
 
         if (!result.validArchive()) return result;
 
@@ -23,6 +23,8 @@
 #include <osgDB/FileUtils>
 #include <osgDB/FileNameUtils>
 
+#include <sstream>
+#include <stdlib.h>
 
 #include "vertexData.h"
 
@@ -42,6 +44,8 @@ public:
     ReaderWriterPLY()
     {
         supportsExtension("ply","Stanford Triangle Format");
+        supportsOption("noMemoryMapping","Read binary files a property at a time rather than decoding them memory mapped");
+        supportsOption("numThreads=<num>","Number of threads decoding the vertices of binary files, default one per processor");
     }
 
     virtual const char* className() const { return "ReaderWriterPLY"; }
@@ -78,6 +82,23 @@ osgDB::ReaderWriter::ReadResult ReaderWriterPLY::readNode(const std::string& fil
 
     //Instance of vertex data which will read the ply file and convert in to osg::Node
     ply::VertexData vertexData;
+
+    if (options)
+    {
+        std::istringstream iss(options->getOptionString());
+        std::string opt;
+        while (iss >> opt)
+        {
+            if (opt == "noMemoryMapping")
+            {
+                vertexData.useGenericReader();
+            }
+            else if (opt.compare(0, 11, "numThreads=") == 0)
+            {
+                vertexData.setNumThreads(atoi(opt.c_str()+11));
+            }
+        }
+    }
     osg::Node* node = vertexData.readPlyFile(fileName.c_str());
 
     if (node)
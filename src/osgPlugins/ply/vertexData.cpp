@@ -13,7 +13,11 @@
 #include "ply.h"
 
 #include <cstdlib>
+#include <cstring>
+#include <stdio.h>
+#include <sys/types.h>
 #include <algorithm>
+#include <osg/Endian>
 #include <osg/Geometry>
 #include <osg/Geode>
 #include <osg/io_utils>
@@ -23,6 +27,7 @@
 #include <osgDB/FileNameUtils>
 #include <osgDB/ReadFile>
 #include <osg/Texture2D>
+#include <osg/ParallelTask>
 
 using namespace std;
 using namespace ply;
@@ -30,7 +35,9 @@ using namespace ply;
 
 /*  Constructor.  */
 VertexData::VertexData()
-    : _invertFaces( false )
+    : _invertFaces( false ),
+      _useGenericReader( false ),
+      _numThreads( 0 )
 {
     // Initialize the members
     _vertices = NULL;
@@ -268,6 +275,453 @@ void VertexData::readTriangles( PlyFile* file, const int nFaces )
 }
 
 
+namespace ply
+{
+    // the vertex properties the binary decoder handles, in the order of the
+    // vertexProps table in VertexData::readVertices()
+    enum VertexProperty
+    {
+        X, Y, Z, NX, NY, NZ,
+        RED, GREEN, BLUE, ALPHA,
+        AMBIENT_RED, AMBIENT_GREEN, AMBIENT_BLUE,
+        DIFFUSE_RED, DIFFUSE_GREEN, DIFFUSE_BLUE,
+        SPECULAR_RED, SPECULAR_GREEN, SPECULAR_BLUE,
+        TEXTURE_U, TEXTURE_V,
+        NUM_VERTEX_PROPERTIES
+    };
+
+    const char* vertexPropertyNames[NUM_VERTEX_PROPERTIES] =
+    {
+        "x", "y", "z", "nx", "ny", "nz",
+        "red", "green", "blue", "alpha",
+        "ambient_red", "ambient_green", "ambient_blue",
+        "diffuse_red", "diffuse_green", "diffuse_blue",
+        "specular_red", "specular_green", "specular_blue",
+        "texture_u", "texture_v"
+    };
+
+    int scalarSize( int type )
+    {
+        switch( type )
+        {
+            case PLY_CHAR:
+            case PLY_UCHAR:
+            case PLY_UINT8:     return 1;
+            case PLY_SHORT:
+            case PLY_USHORT:    return 2;
+            case PLY_INT:
+            case PLY_UINT:
+            case PLY_FLOAT:
+            case PLY_FLOAT32:
+            case PLY_INT32:     return 4;
+            case PLY_DOUBLE:    return 8;
+            default:            return 0;
+        }
+    }
+
+    bool isFloatType( int type ) { return type == PLY_FLOAT || type == PLY_FLOAT32 || type == PLY_DOUBLE; }
+    bool isUCharType( int type ) { return type == PLY_UCHAR || type == PLY_UINT8; }
+
+    inline float readFloat( const char* ptr, int type, bool swap )
+    {
+        if( type == PLY_DOUBLE )
+        {
+            double value;
+            memcpy( &value, ptr, sizeof( value ) );
+            if( swap ) osg::swapBytes8( reinterpret_cast< char* >( &value ) );
+            return static_cast< float >( value );
+        }
+
+        float value;
+        memcpy( &value, ptr, sizeof( value ) );
+        if( swap ) osg::swapBytes4( reinterpret_cast< char* >( &value ) );
+        return value;
+    }
+
+    // reads an integer scalar as get_binary_item() does, returns false for
+    // floating point types
+    inline bool readInt( const char* ptr, int type, bool swap, int& value )
+    {
+        switch( type )
+        {
+            case PLY_CHAR:
+                value = *reinterpret_cast< const signed char* >( ptr );
+                return true;
+            case PLY_UCHAR:
+            case PLY_UINT8:
+                value = *reinterpret_cast< const unsigned char* >( ptr );
+                return true;
+            case PLY_SHORT:
+            {
+                short s;
+                memcpy( &s, ptr, sizeof( s ) );
+                if( swap ) osg::swapBytes2( reinterpret_cast< char* >( &s ) );
+                value = s;
+                return true;
+            }
+            case PLY_USHORT:
+            {
+                unsigned short s;
+                memcpy( &s, ptr, sizeof( s ) );
+                if( swap ) osg::swapBytes2( reinterpret_cast< char* >( &s ) );
+                value = s;
+                return true;
+            }
+            case PLY_INT:
+            case PLY_UINT:
+            case PLY_INT32:
+            {
+                int i;
+                memcpy( &i, ptr, sizeof( i ) );
+                if( swap ) osg::swapBytes4( reinterpret_cast< char* >( &i ) );
+                value = i;
+                return true;
+            }
+            default:
+                return false;
+        }
+    }
+
+    // file positions that reach past 2GB, where ftell() and fseek() are
+    // limited by a 32 bit long
+#if defined( _WIN32 )
+    typedef __int64 FilePosition;
+    inline FilePosition tellFile( FILE* fp ) { return _ftelli64( fp ); }
+    inline int seekFile( FILE* fp, FilePosition position, int origin ) { return _fseeki64( fp, position, origin ); }
+#else
+    typedef off_t FilePosition;
+    inline FilePosition tellFile( FILE* fp ) { return ftello( fp ); }
+    inline int seekFile( FILE* fp, FilePosition position, int origin ) { return fseeko( fp, position, origin ); }
+#endif
+
+    // moves the file position past data decoded from the mapping
+    bool skipBytes( FILE* fp, size_t numBytes )
+    {
+        return seekFile( fp, static_cast< FilePosition >( numBytes ), SEEK_CUR ) == 0;
+    }
+
+    // Decodes a range of fixed size binary vertex records in to the osg arrays,
+    // each thread working on its own range of the presized arrays.
+    struct VertexDecoder
+    {
+        const char*     data;
+        unsigned int    stride;
+        unsigned int    first;
+        int             offsets[NUM_VERTEX_PROPERTIES];
+        int             types[NUM_VERTEX_PROPERTIES];
+        bool            swap;
+
+        osg::Vec3Array*     vertices;
+        osg::Vec3Array*     normals;
+        osg::Vec4Array*     colors;
+        bool                hasAlpha;
+        osg::Vec4Array*     ambient;
+        osg::Vec4Array*     diffuse;
+        osg::Vec4Array*     specular;
+        osg::Vec2Array*     texcoord;
+
+        // whether a run of float properties are packed the same as in memory
+        // so can be copied with a single memcpy
+        bool isPacked( int property, int num ) const
+        {
+            if( swap ) return false;
+            for( int i = 0; i < num; ++i )
+            {
+                if( types[property+i] != PLY_FLOAT && types[property+i] != PLY_FLOAT32 ) return false;
+                if( offsets[property+i] != offsets[property] + i * 4 ) return false;
+            }
+            return true;
+        }
+
+        osg::Vec4 readColor( const char* record, int property ) const
+        {
+            return osg::Vec4( (unsigned int) (unsigned char) record[offsets[property]] / 255.0,
+                              (unsigned int) (unsigned char) record[offsets[property+1]] / 255.0,
+                              (unsigned int) (unsigned char) record[offsets[property+2]] / 255.0, 1.0 );
+        }
+
+        void decode( unsigned int begin, unsigned int end ) const
+        {
+            const bool packedVertices = isPacked( X, 3 );
+            const bool packedNormals = normals && isPacked( NX, 3 );
+
+            const char* record = data + static_cast< size_t >( begin ) * stride;
+            for( unsigned int i = first + begin; i < first + end; ++i, record += stride )
+            {
+                if( packedVertices )
+                    memcpy( (*vertices)[i].ptr(), record + offsets[X], 3 * sizeof( float ) );
+                else
+                    (*vertices)[i].set( readFloat( record + offsets[X], types[X], swap ),
+                                        readFloat( record + offsets[Y], types[Y], swap ),
+                                        readFloat( record + offsets[Z], types[Z], swap ) );
+
+                if( packedNormals )
+                    memcpy( (*normals)[i].ptr(), record + offsets[NX], 3 * sizeof( float ) );
+                else if( normals )
+                    (*normals)[i].set( readFloat( record + offsets[NX], types[NX], swap ),
+                                       readFloat( record + offsets[NY], types[NY], swap ),
+                                       readFloat( record + offsets[NZ], types[NZ], swap ) );
+
+                if( colors )
+                {
+                    (*colors)[i] = readColor( record, RED );
+                    if( hasAlpha ) (*colors)[i].a() = (unsigned int) (unsigned char) record[offsets[ALPHA]] / 255.0;
+                }
+
+                if( ambient ) (*ambient)[i] = readColor( record, AMBIENT_RED );
+                if( diffuse ) (*diffuse)[i] = readColor( record, DIFFUSE_RED );
+                if( specular ) (*specular)[i] = readColor( record, SPECULAR_RED );
+
+                if( texcoord )
+                    (*texcoord)[i].set( readFloat( record + offsets[TEXTURE_U], types[TEXTURE_U], swap ),
+                                        readFloat( record + offsets[TEXTURE_V], types[TEXTURE_V], swap ) );
+            }
+        }
+    };
+
+    class DecodeVerticesTask : public osg::ParallelTask
+    {
+    public:
+        DecodeVerticesTask( const VertexDecoder& decoder, unsigned int nVertices, unsigned int blockSize ):
+            osg::ParallelTask( ( nVertices + blockSize - 1 ) / blockSize ),
+            _decoder( decoder ), _nVertices( nVertices ), _blockSize( blockSize ) {}
+
+        virtual void process( unsigned int block )
+        {
+            unsigned int begin = block * _blockSize;
+            _decoder.decode( begin, std::min( begin + _blockSize, _nVertices ) );
+        }
+
+    protected:
+        DecodeVerticesTask& operator = ( const DecodeVerticesTask& ) { return *this; }
+
+        const VertexDecoder&    _decoder;
+        unsigned int            _nVertices;
+        unsigned int            _blockSize;
+    };
+}
+
+
+/*  Decode the vertex and (if available/wanted) color data of a binary file
+    straight from the memory mapped file.  */
+bool VertexData::readVerticesBinary( PlyFile* file, const osgDB::MappedFile* mappedFile,
+                                     PlyProperty** props, const int nProps,
+                                     const int nVertices, const int fields )
+{
+    VertexDecoder decoder;
+    decoder.stride = 0;
+    for( int i = 0; i < NUM_VERTEX_PROPERTIES; ++i )
+    {
+        decoder.offsets[i] = -1;
+        decoder.types[i] = 0;
+    }
+
+    // the layout of the fixed size vertex record
+    for( int j = 0; j < nProps; ++j )
+    {
+        if( props[j]->is_list ) return false;
+
+        for( int i = 0; i < NUM_VERTEX_PROPERTIES; ++i )
+        {
+            if( decoder.offsets[i] < 0 && equal_strings( props[j]->name, vertexPropertyNames[i] ) )
+            {
+                decoder.offsets[i] = decoder.stride;
+                decoder.types[i] = props[j]->external_type;
+            }
+        }
+
+        int size = scalarSize( props[j]->external_type );
+        if( size == 0 ) return false;
+        decoder.stride += size;
+    }
+
+    // the properties readVertices() would read, which must all be present and
+    // of the types the decoder handles
+    bool wanted[NUM_VERTEX_PROPERTIES];
+    for( int i = 0; i < NUM_VERTEX_PROPERTIES; ++i )
+    {
+        wanted[i] = ( i <= Z ) ||
+                    ( ( fields & NORMALS ) && i >= NX && i <= NZ ) ||
+                    ( ( fields & RGB ) && i >= RED && i <= BLUE ) ||
+                    ( ( fields & RGBA ) && i == ALPHA ) ||
+                    ( ( fields & AMBIENT ) && i >= AMBIENT_RED && i <= AMBIENT_BLUE ) ||
+                    ( ( fields & DIFFUSE ) && i >= DIFFUSE_RED && i <= DIFFUSE_BLUE ) ||
+                    ( ( fields & SPECULAR ) && i >= SPECULAR_RED && i <= SPECULAR_BLUE ) ||
+                    ( ( fields & TEXCOORD ) && i >= TEXTURE_U );
+
+        if( !wanted[i] ) continue;
+        if( decoder.offsets[i] < 0 ) return false;
+
+        bool isColor = ( i >= RED && i <= SPECULAR_BLUE );
+        if( isColor ? !isUCharType( decoder.types[i] ) : !isFloatType( decoder.types[i] ) ) return false;
+    }
+
+    // alpha without red, green and blue is left to readVertices()
+    if( ( fields & RGBA ) && !( fields & RGB ) ) return false;
+
+    FilePosition position = tellFile( file->fp );
+    if( position < 0 || nVertices < 0 ) return false;
+
+    size_t numBytes = static_cast< size_t >( nVertices ) * decoder.stride;
+    if( static_cast< size_t >( position ) > mappedFile->size() ||
+        numBytes > mappedFile->size() - static_cast< size_t >( position ) ) return false;
+
+    decoder.data = mappedFile->data() + position;
+    decoder.swap = ( file->file_type == PLY_BINARY_LE ) != ( osg::getCpuByteOrder() == osg::LittleEndian );
+
+    if( !_vertices.valid() )
+        _vertices = new osg::Vec3Array;
+    if( ( fields & NORMALS ) && !_normals.valid() )
+        _normals = new osg::Vec3Array;
+    if( ( fields & RGB ) && !_colors.valid() )
+        _colors = new osg::Vec4Array;
+    if( ( fields & AMBIENT ) && !_ambient.valid() )
+        _ambient = new osg::Vec4Array;
+    if( ( fields & DIFFUSE ) && !_diffuse.valid() )
+        _diffuse = new osg::Vec4Array;
+    if( ( fields & SPECULAR ) && !_specular.valid() )
+        _specular = new osg::Vec4Array;
+    if( ( fields & TEXCOORD ) && !_texcoord.valid() )
+        _texcoord = new osg::Vec2Array;
+
+    // move the file on to the next element before decoding anything, so the
+    // generic reader can still take over if that fails
+    if( !skipBytes( file->fp, numBytes ) )
+    {
+        seekFile( file->fp, position, SEEK_SET );
+        return false;
+    }
+
+    // the vertices are appended, like readVertices() does
+    decoder.first = _vertices->size();
+    unsigned int newSize = decoder.first + nVertices;
+    decoder.vertices = _vertices.get();
+    decoder.normals = ( fields & NORMALS ) ? _normals.get() : 0;
+    decoder.colors = ( fields & RGB ) ? _colors.get() : 0;
+    decoder.hasAlpha = ( fields & RGBA ) != 0;
+    decoder.ambient = ( fields & AMBIENT ) ? _ambient.get() : 0;
+    decoder.diffuse = ( fields & DIFFUSE ) ? _diffuse.get() : 0;
+    decoder.specular = ( fields & SPECULAR ) ? _specular.get() : 0;
+    decoder.texcoord = ( fields & TEXCOORD ) ? _texcoord.get() : 0;
+
+    decoder.vertices->resize( newSize );
+    if( decoder.normals ) decoder.normals->resize( newSize );
+    if( decoder.colors ) decoder.colors->resize( newSize );
+    if( decoder.ambient ) decoder.ambient->resize( newSize );
+    if( decoder.diffuse ) decoder.diffuse->resize( newSize );
+    if( decoder.specular ) decoder.specular->resize( newSize );
+    if( decoder.texcoord ) decoder.texcoord->resize( newSize );
+
+    // blocks of vertices small enough to balance the threads' load, large
+    // enough that handing them out doesn't show
+    const unsigned int blockSize = 64 * 1024;
+
+    osg::ref_ptr< DecodeVerticesTask > task = new DecodeVerticesTask( decoder, nVertices, blockSize );
+    osg::ParallelTaskThreadPool::instance()->run( task.get(), _numThreads );
+
+    return true;
+}
+
+
+/*  Decode the index data of a binary file straight from the memory mapped file.  */
+bool VertexData::readTrianglesBinary( PlyFile* file, const osgDB::MappedFile* mappedFile,
+                                      PlyProperty** props, const int nProps,
+                                      const int nFaces )
+{
+    // the index list readTriangles() would read, other properties are skipped
+    const char* indexPropertyNames[] = { "vertex_indices", "vertex_index" };
+    int indexProp = -1;
+    for( int n = 0; n < 2 && indexProp < 0; ++n )
+    {
+        for( int j = 0; j < nProps && indexProp < 0; ++j )
+        {
+            if( equal_strings( props[j]->name, indexPropertyNames[n] ) )
+                indexProp = j;
+        }
+    }
+
+    if( indexProp < 0 || !props[indexProp]->is_list || isFloatType( props[indexProp]->external_type ) )
+        return false;
+
+    for( int j = 0; j < nProps; ++j )
+    {
+        if( scalarSize( props[j]->external_type ) == 0 ) return false;
+        if( props[j]->is_list && ( scalarSize( props[j]->count_external ) == 0 ||
+                                   isFloatType( props[j]->count_external ) ) ) return false;
+    }
+
+    FilePosition position = tellFile( file->fp );
+    if( position < 0 || nFaces < 0 || static_cast< size_t >( position ) > mappedFile->size() ) return false;
+
+    const char* start = mappedFile->data() + position;
+    const char* end = mappedFile->data() + mappedFile->size();
+    const char* ptr = start;
+    const bool swap = ( file->file_type == PLY_BINARY_LE ) != ( osg::getCpuByteOrder() == osg::LittleEndian );
+
+    if( !_triangles.valid() )
+        _triangles = new osg::DrawElementsUInt( osg::PrimitiveSet::TRIANGLES );
+
+    if( !_quads.valid() )
+        _quads = new osg::DrawElementsUInt( osg::PrimitiveSet::QUADS );
+
+    unsigned int numTriangleIndices = _triangles->size();
+    unsigned int numQuadIndices = _quads->size();
+
+    bool valid = true;
+    for( int i = 0; i < nFaces && valid; ++i )
+    {
+        for( int j = 0; j < nProps; ++j )
+        {
+            const PlyProperty* prop = props[j];
+            size_t itemSize = scalarSize( prop->external_type );
+            if( !prop->is_list )
+            {
+                if( static_cast< size_t >( end - ptr ) < itemSize ) { valid = false; break; }
+                ptr += itemSize;
+                continue;
+            }
+
+            size_t countSize = scalarSize( prop->count_external );
+            int count = 0;
+            if( static_cast< size_t >( end - ptr ) < countSize ) { valid = false; break; }
+            readInt( ptr, prop->count_external, swap, count );
+            ptr += countSize;
+
+            if( count < 0 || static_cast< size_t >( end - ptr ) / itemSize < static_cast< size_t >( count ) ) { valid = false; break; }
+
+            if( j == indexProp )
+            {
+                // the count is stored in an unsigned char, as readTriangles() does
+                unsigned char nVertices = static_cast< unsigned char >( count );
+                if( nVertices == 3 || nVertices == 4 )
+                {
+                    osg::DrawElementsUInt* elements = ( nVertices == 4 ) ? _quads.get() : _triangles.get();
+                    for( int k = 0; k < nVertices; ++k )
+                    {
+                        int index = 0;
+                        int item = _invertFaces ? nVertices - 1 - k : k;
+                        readInt( ptr + item * itemSize, prop->external_type, swap, index );
+                        elements->push_back( index );
+                    }
+                }
+            }
+
+            ptr += count * itemSize;
+        }
+    }
+
+    if( !valid || !skipBytes( file->fp, ptr - start ) )
+    {
+        seekFile( file->fp, position, SEEK_SET );
+        _triangles->resize( numTriangleIndices );
+        _quads->resize( numQuadIndices );
+        return false;
+    }
+
+    return true;
+}
+
+
 /*  Open a PLY file and read vertex, color and index data. and returns the node  */
 osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColors )
 {
@@ -303,6 +757,15 @@ osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColor
 
     MESHASSERT( elemNames != 0 );
 
+    // binary element data is decoded straight from the file mapped in to memory
+    // when its layout allows, falling back to reading a property at a time
+    osg::ref_ptr<osgDB::MappedFile> mappedFile;
+    if( fileType != PLY_ASCII && !_useGenericReader )
+    {
+        mappedFile = new osgDB::MappedFile( filename );
+        if( !mappedFile->valid() ) mappedFile = 0;
+    }
+
 
     nComments = file->num_comments;
     comments = file->comments;
@@ -392,7 +855,9 @@ osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColor
 
             try {
                 // Read vertices and store in a std::vector array
-                readVertices( file, nElems, fields );
+                if( !mappedFile.valid() ||
+                    !readVerticesBinary( file, mappedFile.get(), props, nProps, nElems, fields ) )
+                    readVertices( file, nElems, fields );
                 // Check whether all vertices are loaded or not
                 MESHASSERT( _vertices->size() == static_cast< size_t >( nElems ) );
 
@@ -439,7 +904,9 @@ osg::Node* VertexData::readPlyFile( const char* filename, const bool ignoreColor
         try
         {
             // Read Triangles
-            readTriangles( file, nElems );
+            if( !mappedFile.valid() ||
+                !readTrianglesBinary( file, mappedFile.get(), props, nProps, nElems ) )
+                readTriangles( file, nElems );
             // Check whether all face elements read or not
 #if DEBUG
             unsigned int nbTriangles = (_triangles.valid() ? _triangles->size() / 3 : 0) ;
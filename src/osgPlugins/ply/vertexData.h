@@ -15,6 +15,7 @@
 
 #include <osg/Node>
 #include <osg/PrimitiveSet>
+#include <osgDB/MappedFile>
 
 #include <vector>
 
@@ -27,6 +28,7 @@
 
 // defined elsewhere
 struct PlyFile;
+struct PlyProperty;
 
 namespace ply
 {
@@ -44,6 +46,12 @@ namespace ply
         // to set the flag for using inverted face
         void useInvertedFaces() { _invertFaces = true; }
 
+        // to read binary files through the per property reader rather than decoding them memory mapped
+        void useGenericReader() { _useGenericReader = true; }
+
+        // to set the number of threads decoding binary vertices, 0 for one per processor
+        void setNumThreads( unsigned int numThreads ) { _numThreads = numThreads; }
+
     private:
 
         enum VertexFields
@@ -67,7 +75,21 @@ namespace ply
         // Reads the triangle indices from the ply file
         void readTriangles( PlyFile* file, const int nFaces );
 
+        // Decodes the vertices of a binary file straight from the memory mapped
+        // file, in parallel, returns false if their layout isn't handled
+        bool readVerticesBinary( PlyFile* file, const osgDB::MappedFile* mappedFile,
+                                 PlyProperty** props, const int nProps,
+                                 const int nVertices, const int vertexFields );
+
+        // Decodes the triangle indices of a binary file straight from the memory
+        // mapped file, returns false if their layout isn't handled
+        bool readTrianglesBinary( PlyFile* file, const osgDB::MappedFile* mappedFile,
+                                  PlyProperty** props, const int nProps,
+                                  const int nFaces );
+
         bool        _invertFaces;
+        bool        _useGenericReader;
+        unsigned int _numThreads;
 
         // Vertex array in osg format
         osg::ref_ptr<osg::Vec3Array>   _vertices;
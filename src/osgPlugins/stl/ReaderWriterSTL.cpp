@@ -55,6 +55,8 @@ struct STLOptionsStruct {
     bool separateFiles;
     bool dontSaveNormals;
     bool noTriStripPolygons;
+    bool weld;
+    float weldEpsilon;
 };
 
 STLOptionsStruct parseOptions(const osgDB::ReaderWriter::Options* options)  {
@@ -64,6 +66,8 @@ STLOptionsStruct parseOptions(const osgDB::ReaderWriter::Options* options)  {
     localOptions.separateFiles = false;
     localOptions.dontSaveNormals = false;
     localOptions.noTriStripPolygons = false;
+    localOptions.weld = false;
+    localOptions.weldEpsilon = 0.0f;
 
     if (options != NULL)
     {
@@ -87,6 +91,14 @@ STLOptionsStruct parseOptions(const osgDB::ReaderWriter::Options* options)  {
             {
                 localOptions.noTriStripPolygons = true;
             }
+            else if (opt == "weld")
+            {
+                localOptions.weld = true;
+            }
+            else if (opt.compare(0, 12, "weldEpsilon=") == 0)
+            {
+                localOptions.weldEpsilon = osg::asciiToFloat(opt.c_str()+12);
+            }
         }
     }
 
@@ -106,6 +118,8 @@ public:
         supportsOption("smooth", "Run SmoothingVisitor");
         supportsOption("separateFiles", "Save each geode in a different file. Can result in a huge amount of files!");
         supportsOption("dontSaveNormals", "Set all normals to [0 0 0] when saving to a file.");
+        supportsOption("weld", "Weld the vertices of binary files as they are read, into indexed triangles rather than unindexed ones.");
+        supportsOption("weldEpsilon=<distance>", "With weld, weld vertices that are within this distance on each axis, default 0, only identical vertices.");
     }
 
     virtual const char* className() const
@@ -151,6 +165,17 @@ private:
 
             geom->setVertexArray(_vertex.get());
 
+            if (_triangles.valid())
+            {
+                // welded vertices, the normals and colours are already per vertex. The mesh is already indexed,
+                // so isn't passed through optimizeMesh, which would index it again.
+                if (_normal.valid()) geom->setNormalArray(_normal.get(), osg::Array::BIND_PER_VERTEX);
+                if (_color.valid()) geom->setColorArray(_color.get(), osg::Array::BIND_PER_VERTEX);
+                geom->addPrimitiveSet(_triangles.get());
+
+                return geom;
+            }
+
             if (_normal.valid())
             {
                 // need to convert per triangle normals to per vertex
@@ -216,6 +241,7 @@ private:
         osg::ref_ptr<osg::Vec3Array> _vertex;
         osg::ref_ptr<osg::Vec3Array> _normal;
         osg::ref_ptr<osg::Vec4Array> _color;
+        osg::ref_ptr<osg::DrawElementsUInt> _triangles;
 
         void clear()
         {
@@ -224,6 +250,7 @@ private:
             _vertex = osg::ref_ptr<osg::Vec3Array>();
             _normal = osg::ref_ptr<osg::Vec3Array>();
             _color = osg::ref_ptr<osg::Vec4Array>();
+            _triangles = osg::ref_ptr<osg::DrawElementsUInt>();
         }
     };
 
@@ -243,14 +270,29 @@ private:
     public:
         BinaryReaderObject(unsigned int expectNumFacets, bool noTriStripPolygons, bool generateNormals = true)
             : ReaderObject(noTriStripPolygons, generateNormals),
-            _expectNumFacets(expectNumFacets)
+            _expectNumFacets(expectNumFacets),
+            _weld(false),
+            _weldEpsilon(0.0f),
+            _weldNormals(true)
+        {
+        }
+
+        /** Weld vertices within epsilon of each other on each axis as the facets are read, into indexed triangles.
+          * When weldNormals is false the normals are left to be regenerated, so vertices weld whatever their facet's normal.*/
+        void setWeld(bool weld, float epsilon, bool weldNormals)
         {
+            _weld = weld;
+            _weldEpsilon = epsilon;
+            _weldNormals = weldNormals;
         }
 
         ReadResult read(FILE *fp);
 
     protected:
         unsigned int _expectNumFacets;
+        bool _weld;
+        float _weldEpsilon;
+        bool _weldNormals;
     };
 
     class CreateStlVisitor : public osg::NodeVisitor
@@ -365,15 +407,15 @@ private:
                 osg::Vec3 vV1V3 = v3 - v1;
                 osg::Vec3 vNormal = vV1V2.operator ^(vV1V3);
                 if (m_dontSaveNormals)
-                    *m_stream << "facet normal 0 0 0" << std::endl;
+                    *m_stream << "facet normal 0 0 0\n";
                 else
-                    *m_stream << "facet normal " << vNormal[0] << " " << vNormal[1] << " " << vNormal[2] << std::endl;
-                *m_stream << "outer loop" << std::endl;
-                *m_stream << "vertex " << v1[0] << " " << v1[1] << " " << v1[2] << std::endl;
-                *m_stream << "vertex " << v2[0] << " " << v2[1] << " " << v2[2] << std::endl;
-                *m_stream << "vertex " << v3[0] << " " << v3[1] << " " << v3[2] << std::endl;
-                *m_stream << "endloop" << std::endl;
-                *m_stream << "endfacet" << std::endl;
+                    *m_stream << "facet normal " << vNormal[0] << " " << vNormal[1] << " " << vNormal[2] << "\n";
+                *m_stream << "outer loop\n";
+                *m_stream << "vertex " << v1[0] << " " << v1[1] << " " << v1[2] << "\n";
+                *m_stream << "vertex " << v2[0] << " " << v2[1] << " " << v2[2] << "\n";
+                *m_stream << "vertex " << v3[0] << " " << v3[1] << " " << v3[2] << "\n";
+                *m_stream << "endloop\n";
+                *m_stream << "endfacet\n";
             }
         };
     };
@@ -405,6 +447,142 @@ const unsigned short StlHasColor = 0x8000;
 const unsigned short StlColorSize = 0x1f;        // 5 bit
 const float StlColorDepth = float(StlColorSize); // 2^5 - 1
 
+const unsigned int StlNoVertex = 0xffffffff;
+
+// Welds the vertices of facets as they are read using a hash grid, with cells the size of the weld epsilon or of
+// the exact positions when the epsilon is 0. Vertices only weld when their normals and colours match as well, as
+// with osgUtil::IndexMeshVisitor, unless the normals are to be regenerated.
+class StlVertexWelder : public osg::Referenced
+{
+public:
+    StlVertexWelder(float epsilon, bool weldNormals, unsigned int numFacets):
+        _epsilon(epsilon),
+        _invEpsilon(epsilon>0.0f ? 1.0/double(epsilon) : 0.0),
+        _vertices(new osg::Vec3Array),
+        _normals(weldNormals ? new osg::Vec3Array : 0)
+    {
+        // closed meshes have around half as many vertices as facets, grow from there.
+        unsigned int numBuckets = 1024;
+        while(numBuckets<numFacets) numBuckets *= 2;
+        _buckets.resize(numBuckets, StlNoVertex);
+        _next.reserve(numBuckets);
+        _vertices->reserve(numBuckets);
+        if (_normals.valid()) _normals->reserve(numBuckets);
+        _colors.reserve(numBuckets);
+    }
+
+    unsigned int addVertex(const osg::Vec3& position, const osg::Vec3& normal, unsigned short color)
+    {
+        if (_epsilon>0.0f)
+        {
+            // a vertex within epsilon on each axis is in one of the neighbouring cells.
+            long long cx = cell(position.x()), cy = cell(position.y()), cz = cell(position.z());
+            for(long long x=cx-1; x<=cx+1; ++x)
+            {
+                for(long long y=cy-1; y<=cy+1; ++y)
+                {
+                    for(long long z=cz-1; z<=cz+1; ++z)
+                    {
+                        unsigned int index = find(hash(x, y, z), position, normal, color);
+                        if (index!=StlNoVertex) return index;
+                    }
+                }
+            }
+        }
+        else
+        {
+            unsigned int index = find(bucket(position), position, normal, color);
+            if (index!=StlNoVertex) return index;
+        }
+
+        unsigned int index = _vertices->size();
+        _vertices->push_back(position);
+        if (_normals.valid()) _normals->push_back(normal);
+        _colors.push_back(color);
+
+        if (_vertices->size()>_buckets.size())
+        {
+            rehash(_buckets.size()*2);
+        }
+        else
+        {
+            unsigned int b = bucket(position);
+            _next.push_back(_buckets[b]);
+            _buckets[b] = index;
+        }
+
+        return index;
+    }
+
+    osg::Vec3Array* getVertices() { return _vertices.get(); }
+    osg::Vec3Array* getNormals() { return _normals.get(); }
+    const std::vector<unsigned short>& getColors() const { return _colors; }
+
+protected:
+    long long cell(float value) const { return static_cast<long long>(floor(double(value)*_invEpsilon)); }
+
+    unsigned int hash(long long x, long long y, long long z) const
+    {
+        unsigned long long h = static_cast<unsigned long long>(x)*73856093ULL ^
+                               static_cast<unsigned long long>(y)*19349663ULL ^
+                               static_cast<unsigned long long>(z)*83492791ULL;
+        h ^= h >> 29;
+        return static_cast<unsigned int>(h & (_buckets.size()-1));
+    }
+
+    unsigned int bucket(const osg::Vec3& position) const
+    {
+        if (_epsilon>0.0f) return hash(cell(position.x()), cell(position.y()), cell(position.z()));
+
+        // hash the bit patterns, adding 0 so -0 and 0 hash the same as they compare equal.
+        unsigned int bits[3];
+        float values[3] = { position.x()+0.0f, position.y()+0.0f, position.z()+0.0f };
+        memcpy(bits, values, sizeof(bits));
+        return hash(bits[0], bits[1], bits[2]);
+    }
+
+    unsigned int find(unsigned int b, const osg::Vec3& position, const osg::Vec3& normal, unsigned short color) const
+    {
+        for(unsigned int index = _buckets[b]; index!=StlNoVertex; index = _next[index])
+        {
+            const osg::Vec3& v = (*_vertices)[index];
+            if (_epsilon>0.0f)
+            {
+                if (fabs(v.x()-position.x())>_epsilon ||
+                    fabs(v.y()-position.y())>_epsilon ||
+                    fabs(v.z()-position.z())>_epsilon) continue;
+            }
+            else if (v!=position) continue;
+
+            if (_normals.valid() && (*_normals)[index]!=normal) continue;
+            if (_colors[index]!=color) continue;
+
+            return index;
+        }
+        return StlNoVertex;
+    }
+
+    void rehash(unsigned int numBuckets)
+    {
+        _buckets.assign(numBuckets, StlNoVertex);
+        _next.resize(_vertices->size());
+        for(unsigned int index=0; index<_vertices->size(); ++index)
+        {
+            unsigned int b = bucket((*_vertices)[index]);
+            _next[index] = _buckets[b];
+            _buckets[b] = index;
+        }
+    }
+
+    float                           _epsilon;
+    double                          _invEpsilon;
+    std::vector<unsigned int>       _buckets;
+    std::vector<unsigned int>       _next;
+    osg::ref_ptr<osg::Vec3Array>    _vertices;
+    osg::ref_ptr<osg::Vec3Array>    _normals;
+    std::vector<unsigned short>     _colors;
+};
+
 // Check if the file comes from magics, and retrieve the corresponding data
 // Magics files have a header with a "COLOR=" field giving the color of the whole model
 bool fileComesFromMagics(FILE *fp, osg::Vec4& magicsColor)
@@ -437,6 +615,25 @@ bool fileComesFromMagics(FILE *fp, osg::Vec4& magicsColor)
     return false;
 }
 
+// Decode a facet's RGB555 colour, magics files use RGB rather than BGR and the header colour when the last bit is set.
+osg::Vec4 decodeColor(unsigned short color, bool comesFromMagics, const osg::Vec4& magicsHeaderColor)
+{
+    if (comesFromMagics)
+    {
+        if (color & StlHasColor) return magicsHeaderColor;
+
+        float b = ((color >> 10) & StlColorSize) / StlColorDepth;
+        float g = ((color >> 5) & StlColorSize) / StlColorDepth;
+        float r = (color & StlColorSize) / StlColorDepth;
+        return osg::Vec4(r, g, b, 1.0f);
+    }
+
+    float r = ((color >> 10) & StlColorSize) / StlColorDepth;
+    float g = ((color >> 5) & StlColorSize) / StlColorDepth;
+    float b = (color & StlColorSize) / StlColorDepth;
+    return osg::Vec4(r, g, b, 1.0f);
+}
+
 osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& file, const osgDB::ReaderWriter::Options* options) const
 {
     std::string ext = osgDB::getLowerCaseFileExtension(file);
@@ -532,7 +729,11 @@ osgDB::ReaderWriter::ReadResult ReaderWriterSTL::readNode(const std::string& fil
     ReaderObject *readerObject;
 
     if (isBinary)
-        readerObject = new BinaryReaderObject(expectFacets, localOptions.noTriStripPolygons);
+    {
+        BinaryReaderObject* binaryReaderObject = new BinaryReaderObject(expectFacets, localOptions.noTriStripPolygons);
+        binaryReaderObject->setWeld(localOptions.weld, localOptions.weldEpsilon, !localOptions.smooth);
+        readerObject = binaryReaderObject;
+    }
     else
         readerObject = new AsciiReaderObject(localOptions.noTriStripPolygons);
 
@@ -707,80 +908,144 @@ ReaderWriterSTL::ReaderObject::ReadResult ReaderWriterSTL::BinaryReaderObject::r
         return ReadError;
     }
 
+    // facets are read in blocks rather than one fread per facet, and welded as they are decoded
+    const unsigned int numFacetsPerBlock = 65536;
+    std::vector<char> block(numFacetsPerBlock*sizeof_StlFacet);
+    bool swapBytes = osg::getCpuByteOrder()==osg::BigEndian;
+
+    osg::ref_ptr<StlVertexWelder> welder;
+    osg::ref_ptr<osg::DrawElementsUInt> triangles;
+    unsigned int numColoredFacets = 0;
+    if (_weld)
+    {
+        welder = new StlVertexWelder(_weldEpsilon, _weldNormals, _expectNumFacets);
+        triangles = new osg::DrawElementsUInt(GL_TRIANGLES);
+        triangles->reserve(_expectNumFacets*3);
+    }
+    else
+    {
+        _vertex = new osg::Vec3Array;
+        _vertex->reserve(_expectNumFacets*3);
+        _normal = new osg::Vec3Array;
+        _normal->reserve(_expectNumFacets);
+        _color = new osg::Vec4Array;
+    }
+
     StlFacet facet;
-    for (unsigned int i = 0; i < _expectNumFacets; ++i)
+    for (unsigned int first = 0; first < _expectNumFacets; first += numFacetsPerBlock)
     {
-        if (::fread((void*) &facet, sizeof_StlFacet, 1, fp) != 1)
+        unsigned int numFacets = osg::minimum(numFacetsPerBlock, _expectNumFacets-first);
+        size_t numRead = ::fread((void*) &block[0], sizeof_StlFacet, numFacets, fp);
+        if (numRead != numFacets)
         {
-            OSG_FATAL << "ReaderWriterSTL::readStlBinary: Failed to read facet " << i << std::endl;
+            OSG_FATAL << "ReaderWriterSTL::readStlBinary: Failed to read facet " << first+numRead << std::endl;
             return ReadError;
         }
 
-        // vertices
-        if (!_vertex.valid())
-            _vertex = new osg::Vec3Array;
-
-        osg::Vec3 v0(facet.vertex[0].x, facet.vertex[0].y, facet.vertex[0].z);
-        osg::Vec3 v1(facet.vertex[1].x, facet.vertex[1].y, facet.vertex[1].z);
-        osg::Vec3 v2(facet.vertex[2].x, facet.vertex[2].y, facet.vertex[2].z);
-        _vertex->push_back(v0);
-        _vertex->push_back(v1);
-        _vertex->push_back(v2);
-
-        // per-facet normal
-        osg::Vec3 normal;
-        if (_generateNormal)
-        {
-            osg::Vec3 d01 = v1 - v0;
-            osg::Vec3 d02 = v2 - v0;
-            normal = d01 ^ d02;
-            normal.normalize();
-        }
-        else
+        for (unsigned int i = 0; i < numFacets; ++i)
         {
-            normal.set(facet.normal.x, facet.normal.y, facet.normal.z);
-        }
+            // the facets are packed to 50 bytes so copy out of the block rather than casting into it
+            const char* data = &block[i*sizeof_StlFacet];
+            memcpy(&facet.normal, data, 12);
+            memcpy(&facet.vertex[0], data+12, 36);
+            memcpy(&facet.color, data+48, 2);
 
-        if (!_normal.valid())
-            _normal = new osg::Vec3Array;
-        _normal->push_back(normal);
+            if (swapBytes)
+            {
+                osg::swapBytes4((char*) &facet.normal.x);
+                osg::swapBytes4((char*) &facet.normal.y);
+                osg::swapBytes4((char*) &facet.normal.z);
+                for(unsigned int v = 0; v < 3; ++v)
+                {
+                    osg::swapBytes4((char*) &facet.vertex[v].x);
+                    osg::swapBytes4((char*) &facet.vertex[v].y);
+                    osg::swapBytes4((char*) &facet.vertex[v].z);
+                }
+                osg::swapBytes2((char*) &facet.color);
+            }
 
-        /*
-         * color extension
-         * RGB555 with most-significat bit indicating if color is present
-         *
-         * The magics files may use whether per-face or per-object colors
-         * for a given face, according to the value of the last bit (0 = per-face, 1 = per-object)
-         * Moreover, magics uses RGB instead of BGR (as the other software)
-         */
-        if (!_color.valid())
-        {
-            _color = new osg::Vec4Array;
-        }
+            osg::Vec3 v0(facet.vertex[0].x, facet.vertex[0].y, facet.vertex[0].z);
+            osg::Vec3 v1(facet.vertex[1].x, facet.vertex[1].y, facet.vertex[1].z);
+            osg::Vec3 v2(facet.vertex[2].x, facet.vertex[2].y, facet.vertex[2].z);
 
-        // Case of a Magics file
-        if(comesFromMagics)
-        {
-            if(facet.color & StlHasColor) // The last bit is 1, the per-object color is used
+            // per-facet normal
+            osg::Vec3 normal;
+            if (_generateNormal)
             {
-                _color->push_back(magicsHeaderColor);
+                osg::Vec3 d01 = v1 - v0;
+                osg::Vec3 d02 = v2 - v0;
+                normal = d01 ^ d02;
+                normal.normalize();
             }
-            else // the last bit is 0, the facet has its own unique color
+            else
             {
-                float b = ((facet.color >> 10) & StlColorSize) / StlColorDepth;
-                float g = ((facet.color >> 5) & StlColorSize) / StlColorDepth;
-                float r = (facet.color & StlColorSize) / StlColorDepth;
-                _color->push_back(osg::Vec4(r, g, b, 1.0f));
+                normal.set(facet.normal.x, facet.normal.y, facet.normal.z);
+            }
+
+            /*
+             * color extension
+             * RGB555 with most-significat bit indicating if color is present
+             *
+             * The magics files may use whether per-face or per-object colors
+             * for a given face, according to the value of the last bit (0 = per-face, 1 = per-object)
+             * Moreover, magics uses RGB instead of BGR (as the other software)
+             */
+            bool hasColor = comesFromMagics || (facet.color & StlHasColor);
+
+            if (welder.valid())
+            {
+                // vertices of facets with different colours don't weld, facets without a colour all share 0
+                unsigned short color = 0;
+                if (comesFromMagics) color = (facet.color & StlHasColor) ? StlHasColor : facet.color;
+                else if (hasColor) color = facet.color;
+                if (hasColor) ++numColoredFacets;
+
+                unsigned int i0 = welder->addVertex(v0, normal, color);
+                unsigned int i1 = welder->addVertex(v1, normal, color);
+                unsigned int i2 = welder->addVertex(v2, normal, color);
+
+                // drop facets that collapse once their vertices are welded
+                if (i0!=i1 && i1!=i2 && i2!=i0)
+                {
+                    triangles->push_back(i0);
+                    triangles->push_back(i1);
+                    triangles->push_back(i2);
+                }
+                continue;
+            }
+
+            _vertex->push_back(v0);
+            _vertex->push_back(v1);
+            _vertex->push_back(v2);
+            _normal->push_back(normal);
+
+            if (hasColor)
+            {
+                _color->push_back(decodeColor(facet.color, comesFromMagics, magicsHeaderColor));
             }
         }
-        // Case of a generic file
-        else if (facet.color & StlHasColor) // The color is valid if the last bit is 1
+    }
+
+    if (welder.valid())
+    {
+        _vertex = welder->getVertices();
+        _normal = welder->getNormals();
+        _triangles = triangles;
+
+        // as with the unwelded facets, colours are only used when every facet has one
+        if (numColoredFacets==_expectNumFacets && _expectNumFacets>0)
+        {
+            OSG_INFO << "STL file with color" << std::endl;
+            const std::vector<unsigned short>& colors = welder->getColors();
+            _color = new osg::Vec4Array;
+            _color->reserve(colors.size());
+            for(std::vector<unsigned short>::const_iterator itr = colors.begin();
+                itr != colors.end();
+                ++itr)
             {
-                float r = ((facet.color >> 10) & StlColorSize) / StlColorDepth;
-                float g = ((facet.color >> 5) & StlColorSize) / StlColorDepth;
-                float b = (facet.color & StlColorSize) / StlColorDepth;
-                _color->push_back(osg::Vec4(r, g, b, 1.0f));
+                _color->push_back(decodeColor(*itr, comesFromMagics, magicsHeaderColor));
             }
+        }
     }
 
     return ReadEOF;
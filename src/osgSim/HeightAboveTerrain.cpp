@@ -22,6 +22,7 @@ using namespace osgSim;
 HeightAboveTerrain::HeightAboveTerrain()
 {
     _lowestHeight = -1000.0;
+    _usePacketIntersections = false;
 
     setDatabaseCacheReadCallback(new DatabaseCacheReadCallback);
 }
@@ -43,7 +44,7 @@ void HeightAboveTerrain::computeIntersections(osg::Node* scene, osg::Node::NodeM
     osg::CoordinateSystemNode* csn = dynamic_cast<osg::CoordinateSystemNode*>(scene);
     osg::EllipsoidModel* em = csn ? csn->getEllipsoidModel() : 0;
 
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = _usePacketIntersections ? new osgUtil::LineSegmentIntersectorGroup() : new osgUtil::IntersectorGroup();
 
     for(HATList::iterator itr = _HATList.begin();
         itr != _HATList.end();
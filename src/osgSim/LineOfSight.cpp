@@ -87,7 +87,8 @@ osg::ref_ptr<osg::Node> DatabaseCacheReadCallback::readNodeFile(const std::strin
     return node;
 }
 
-LineOfSight::LineOfSight()
+LineOfSight::LineOfSight():
+    _usePacketIntersections(false)
 {
     setDatabaseCacheReadCallback(new DatabaseCacheReadCallback);
 }
@@ -106,7 +107,7 @@ unsigned int LineOfSight::addLOS(const osg::Vec3d& start, const osg::Vec3d& end)
 
 void LineOfSight::computeIntersections(osg::Node* scene, osg::Node::NodeMask traversalMask)
 {
-    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = new osgUtil::IntersectorGroup();
+    osg::ref_ptr<osgUtil::IntersectorGroup> intersectorGroup = _usePacketIntersections ? new osgUtil::LineSegmentIntersectorGroup() : new osgUtil::IntersectorGroup();
 
     for(LOSList::iterator itr = _LOSList.begin();
         itr != _LOSList.end();
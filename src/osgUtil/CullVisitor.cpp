@@ -27,17 +27,26 @@
 #include <osg/TemplatePrimitiveFunctor>
 #include <osg/Geometry>
 #include <osg/io_utils>
+#include <osg/ParallelTask>
+#include <osg/ApplicationUsage>
+#include <osg/os_utils>
 
 #include <osgUtil/CullVisitor>
 
+#include <OpenThreads/ScopedLock>
+#include <OpenThreads/Thread>
+
 #include <float.h>
 #include <algorithm>
+#include <typeinfo>
 
 #include <osg/Timer>
 
 using namespace osg;
 using namespace osgUtil;
 
+static osg::ApplicationUsageProxy CullVisitor_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_NUM_CULL_THREADS <int>","Number of threads each CullVisitor culls the scene graph with, 0 for one per processor, default 1.");
+
 inline float MAX_F(float a, float b)
     { return a>b?a:b; }
 inline int EQUAL_F(float a, float b)
@@ -52,9 +61,24 @@ CullVisitor::CullVisitor():
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
-    _numberOfEncloseOverrideRenderBinDetails(0)
+    _numAllocations(0),
+    _numberOfEncloseOverrideRenderBinDetails(0),
+    _numThreads(1),
+    _minNumChildrenForParallelTraversal(8),
+    _parallelCullTime(0.0),
+    _parallelCullTaskTime(0.0),
+    _minNumChildrenForBatchedCulling(0)
 {
     _identifier = new Identifier;
+
+    // parse as signed so that negative or malformed values are ignored rather than wrapping to huge thread counts.
+    int numThreads = 0;
+    if (osg::getEnvVar("OSG_NUM_CULL_THREADS", numThreads))
+    {
+        int maxNumThreads = 4*osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
+        if (numThreads>=0) _numThreads = osg::minimum(numThreads, maxNumThreads);
+        else OSG_NOTICE<<"Warning: OSG_NUM_CULL_THREADS value "<<numThreads<<" ignored, must be 0 or more."<<std::endl;
+    }
 }
 
 CullVisitor::CullVisitor(const CullVisitor& rhs):
@@ -67,8 +91,14 @@ CullVisitor::CullVisitor(const CullVisitor& rhs):
     _computed_zfar(-FLT_MAX),
     _traversalOrderNumber(0),
     _currentReuseRenderLeafIndex(0),
+    _numAllocations(0),
     _numberOfEncloseOverrideRenderBinDetails(0),
-    _identifier(rhs._identifier)
+    _identifier(rhs._identifier),
+    _numThreads(rhs._numThreads),
+    _minNumChildrenForParallelTraversal(rhs._minNumChildrenForParallelTraversal),
+    _parallelCullTime(0.0),
+    _parallelCullTaskTime(0.0),
+    _minNumChildrenForBatchedCulling(rhs._minNumChildrenForBatchedCulling)
 {
 }
 
@@ -101,6 +131,9 @@ void CullVisitor::reset()
 
     _renderBinStack.clear();
 
+    _batchedCullFrames.clear();
+    _batchedCullResults.clear();
+
     _numberOfEncloseOverrideRenderBinDetails = 0;
 
     // reset the traversal order number
@@ -130,9 +163,25 @@ void CullVisitor::reset()
 
     // reset the resuse lists.
     _currentReuseRenderLeafIndex = 0;
+    _numAllocations = 0;
 
     _nearPlaneCandidateMap.clear();
     _farPlaneCandidateMap.clear();
+
+    for(CullVisitorList::iterator itr = _parallelCullVisitors.begin();
+        itr != _parallelCullVisitors.end();
+        ++itr)
+    {
+        (*itr)->reset();
+    }
+
+    _parallelCullTime = 0.0;
+    _parallelCullTaskTime = 0.0;
+}
+
+unsigned int CullVisitor::getNumAllocations() const
+{
+    return _numAllocations + (_rootStateGraph.valid() ? _rootStateGraph->getNumAllocatedStateGraphs() : 0);
 }
 
 float CullVisitor::getDistanceToEyePoint(const Vec3& pos, bool withLODScale) const
@@ -891,7 +940,15 @@ void CullVisitor::apply(Geode& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    if (!node.getCullCallback() && pushBatchedCullResults(node))
+    {
+        traverse(node);
+        popBatchedCullResults();
+    }
+    else
+    {
+        handle_cull_callbacks_and_traverse(node);
+    }
 
     // pop the node's state off the geostate stack.
     if (node_state) popStateSet();
@@ -919,7 +976,11 @@ void CullVisitor::apply(osg::Drawable& drawable)
         }
     }
 
-    if (drawable.isCullingActive() && isCulled(bb)) return;
+    if (drawable.isCullingActive())
+    {
+        int batchedResult = getBatchedCullResult(drawable);
+        if (batchedResult>0 || (batchedResult<0 && isCulled(bb))) return;
+    }
 
 
     if (_computeNearFar && bb.valid())
@@ -1145,7 +1206,19 @@ void CullVisitor::apply(Group& node)
     StateSet* node_state = node.getStateSet();
     if (node_state) pushStateSet(node_state);
 
-    handle_cull_callbacks_and_traverse(node);
+    if (_numThreads==1 || node.getCullCallback() || !cullInParallel(node))
+    {
+        // only plain groups are batched as subclasses may select which children to traverse.
+        if (!node.getCullCallback() && typeid(node)==typeid(osg::Group) && pushBatchedCullResults(node))
+        {
+            traverse(node);
+            popBatchedCullResults();
+        }
+        else
+        {
+            handle_cull_callbacks_and_traverse(node);
+        }
+    }
 
     // pop the node's state off the render graph stack.
     if (node_state) popStateSet();
@@ -1169,7 +1242,15 @@ void CullVisitor::apply(Transform& node)
     node.computeLocalToWorldMatrix(*matrix,this);
     pushModelViewMatrix(matrix, node.getReferenceFrame());
 
-    handle_cull_callbacks_and_traverse(node);
+    if (!node.getCullCallback() && pushBatchedCullResults(node))
+    {
+        traverse(node);
+        popBatchedCullResults();
+    }
+    else
+    {
+        handle_cull_callbacks_and_traverse(node);
+    }
 
     popModelViewMatrix();
 
@@ -1500,8 +1581,15 @@ void CullVisitor::apply(osg::Camera& camera)
         osg::ref_ptr<osgUtil::RenderStageCache> rsCache = dynamic_cast<osgUtil::RenderStageCache*>(camera.getRenderingCache());
         if (!rsCache)
         {
-            rsCache = new osgUtil::RenderStageCache;
-            camera.setRenderingCache(rsCache.get());
+            // the workers of a parallel cull may reach the same Camera at once.
+            OpenThreads::ScopedLock<OpenThreads::Mutex> lock(*(camera.getDataChangeMutex()));
+
+            rsCache = dynamic_cast<osgUtil::RenderStageCache*>(camera.getRenderingCache());
+            if (!rsCache)
+            {
+                rsCache = new osgUtil::RenderStageCache;
+                camera.setRenderingCache(rsCache.get());
+            }
         }
 
         osg::ref_ptr<osgUtil::RenderStage> rtts = rsCache->getRenderStage(this);
@@ -1746,3 +1834,506 @@ void CullVisitor::apply(osg::OcclusionQueryNode& node)
     popCurrentMask();
 }
 
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Batched cull support
+//
+namespace
+{
+
+/** Test a block of bounds in one batched call, copying the results to the entries they were gathered for.*/
+template<class Batch, class Results>
+bool cullBatch(osg::CullingSet& cullingSet, Batch& batch, const unsigned int* indices, Results& results)
+{
+    const unsigned int maxBlockSize = 64;
+    bool culled[maxBlockSize];
+    osg::Polytope::ClippingMask frustumMasks[maxBlockSize];
+
+    unsigned int size = batch.size();
+    bool tested = cullingSet.isCulled(batch, culled, frustumMasks);
+    if (tested)
+    {
+        for(unsigned int i=0; i<size; ++i)
+        {
+            results[indices[i]]._culled = culled[i] ? 1 : 0;
+            results[indices[i]]._frustumMask = frustumMasks[i];
+        }
+    }
+    batch.clear();
+    return tested;
+}
+
+}
+
+bool CullVisitor::pushBatchedCullResults(osg::Group& group)
+{
+    unsigned int numChildren = group.getNumChildren();
+    if (_minNumChildrenForBatchedCulling==0 || numChildren<_minNumChildrenForBatchedCulling) return false;
+    if (_nodePath.empty() || _nodePath.back()!=&group) return false;
+
+    // only worth batching when there are view frustum planes left to test against.
+    osg::CullingSet& cullingSet = getCurrentCullingSet();
+    if (!(cullingSet.getCullingMask()&osg::CullingSet::VIEW_FRUSTUM_CULLING) || cullingSet.getFrustum().getCurrentMask()==0) return false;
+
+    BatchedCullFrame frame;
+    frame._group = &group;
+    frame._cullingSet = &cullingSet;
+    frame._cullingMask = cullingSet.getCullingMask();
+    frame._frustumMask = cullingSet.getFrustum().getCurrentMask();
+    frame._begin = static_cast<unsigned int>(_batchedCullResults.size());
+    frame._end = frame._begin+numChildren;
+    frame._next = frame._begin;
+
+    _batchedCullResults.resize(frame._end);
+
+    // a Geode's drawables are culled by their bounding boxes, as in apply(Drawable&), other children by their bounding spheres.
+    bool cullBoxes = group.asGeode()!=0;
+
+    const unsigned int blockSize = 64;
+    unsigned int indices[blockSize];
+    unsigned int numInBlock = 0;
+    unsigned int numBatched = 0;
+    bool tested = true;
+
+    for(unsigned int i=0; i<numChildren && tested; ++i)
+    {
+        osg::Node* child = group.getChild(i);
+
+        BatchedCullResult& result = _batchedCullResults[frame._begin+i];
+        result._node = child;
+        result._culled = -1;
+        result._frustumMask = 0;
+
+        // children that aren't culled by their bounds alone are left to the unbatched tests.
+        osg::Drawable* drawable = child->asDrawable();
+        if (cullBoxes)
+        {
+            if (!drawable || !drawable->isCullingActive() || drawable->getCullCallback()) continue;
+
+            const osg::BoundingBox& bb = drawable->getBoundingBox();
+            if (!bb.valid()) continue;
+
+            _batchedCullBoxes.push_back(bb);
+        }
+        else
+        {
+            if (drawable || !child->isCullingActive()) continue;
+
+            _batchedCullSpheres.push_back(child->getBound());
+        }
+
+        indices[numInBlock++] = frame._begin+i;
+        ++numBatched;
+
+        if (numInBlock==blockSize)
+        {
+            tested = cullBoxes ? cullBatch(cullingSet, _batchedCullBoxes, indices, _batchedCullResults) :
+                                 cullBatch(cullingSet, _batchedCullSpheres, indices, _batchedCullResults);
+            numInBlock = 0;
+        }
+    }
+
+    if (tested && numInBlock>0)
+    {
+        tested = cullBoxes ? cullBatch(cullingSet, _batchedCullBoxes, indices, _batchedCullResults) :
+                             cullBatch(cullingSet, _batchedCullSpheres, indices, _batchedCullResults);
+    }
+
+    // the culling set can't be batch tested, or there was nothing to test.
+    if (!tested || numBatched==0)
+    {
+        _batchedCullSpheres.clear();
+        _batchedCullBoxes.clear();
+        _batchedCullResults.resize(frame._begin);
+        return false;
+    }
+
+    _batchedCullFrames.push_back(frame);
+    return true;
+}
+
+void CullVisitor::popBatchedCullResults()
+{
+    _batchedCullResults.resize(_batchedCullFrames.back()._begin);
+    _batchedCullFrames.pop_back();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Parallel cull support
+//
+namespace
+{
+
+/** A contiguous range of a group's children culled by one of the worker CullVisitors.*/
+struct ParallelCullTask
+{
+    ParallelCullTask():
+        _begin(0),
+        _end(0),
+        _time(0.0) {}
+
+    osg::ref_ptr<CullVisitor>   _visitor;
+    unsigned int                _begin;
+    unsigned int                _end;
+    double                      _time;
+};
+
+class ParallelCull : public osg::ParallelTask
+{
+public:
+
+    ParallelCull(osg::Group& group, unsigned int numTasks):
+        osg::ParallelTask(numTasks),
+        _group(&group),
+        _tasks(numTasks) {}
+
+    /** Cull a single task, called by the calling thread and the pool threads alike.*/
+    virtual void process(unsigned int i)
+    {
+        ParallelCullTask& task = _tasks[i];
+
+        osg::Timer_t start = osg::Timer::instance()->tick();
+
+        for(unsigned int c=task._begin; c<task._end; ++c)
+        {
+            _group->getChild(c)->accept(*task._visitor);
+        }
+
+        task._time = osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+    }
+
+    osg::ref_ptr<osg::Group>                _group;
+    std::vector<ParallelCullTask>           _tasks;
+};
+
+/** Moves the RenderLeafs of the StateGraphs in a worker's RenderStage into the matching StateGraphs of the main CullVisitor's
+  * StateGraph tree, renumbering them to follow on from the leaves already culled.  StateGraphs from the separate trees of render
+  * to texture Cameras stay where they are, only their leaves are renumbered.*/
+class ParallelCullStateGraphMerger
+{
+public:
+
+    ParallelCullStateGraphMerger(StateGraph* from, StateGraph* to, unsigned int traversalOrderOffset):
+        _from(from),
+        _to(to),
+        _traversalOrderOffset(traversalOrderOffset) {}
+
+    StateGraph* map(StateGraph* sg)
+    {
+        if (sg==_from) return _to;
+
+        // the root of a separate StateGraph tree.
+        if (!sg->_parent) return 0;
+
+        StateGraphMap::iterator itr = _stateGraphMap.find(sg);
+        if (itr!=_stateGraphMap.end()) return itr->second;
+
+        StateGraph* parent = map(sg->_parent);
+        StateGraph* mapped = parent ? parent->find_or_insert(sg->getStateSet()) : 0;
+        _stateGraphMap[sg] = mapped;
+        return mapped;
+    }
+
+    void apply(RenderStage& stage)
+    {
+        for(RenderStage::RenderStageList::iterator itr = stage.getPreRenderList().begin();
+            itr != stage.getPreRenderList().end();
+            ++itr)
+        {
+            apply(*(itr->second));
+        }
+
+        apply(static_cast<RenderBin&>(stage));
+
+        for(RenderStage::RenderStageList::iterator itr = stage.getPostRenderList().begin();
+            itr != stage.getPostRenderList().end();
+            ++itr)
+        {
+            apply(*(itr->second));
+        }
+    }
+
+    void apply(RenderBin& bin)
+    {
+        RenderBin::StateGraphList& stateGraphList = bin.getStateGraphList();
+        RenderBin::StateGraphList::iterator output = stateGraphList.begin();
+        for(RenderBin::StateGraphList::iterator itr = stateGraphList.begin();
+            itr != stateGraphList.end();
+            ++itr)
+        {
+            StateGraph* sg = *itr;
+            StateGraph* mapped = map(sg);
+            if (mapped)
+            {
+                // as with CullVisitor::addDrawable(), the StateGraph joins the bin when it gets its first leaf.
+                if (mapped->leaves_empty()) *(output++) = mapped;
+
+                for(StateGraph::LeafList::iterator litr = sg->_leaves.begin();
+                    litr != sg->_leaves.end();
+                    ++litr)
+                {
+                    (*litr)->_traversalOrderNumber += _traversalOrderOffset;
+                    mapped->addLeaf(litr->get());
+                }
+                sg->_leaves.clear();
+            }
+            else
+            {
+                for(StateGraph::LeafList::iterator litr = sg->_leaves.begin();
+                    litr != sg->_leaves.end();
+                    ++litr)
+                {
+                    (*litr)->_traversalOrderNumber += _traversalOrderOffset;
+                }
+                *(output++) = sg;
+            }
+        }
+        stateGraphList.erase(output, stateGraphList.end());
+
+        for(RenderBin::RenderBinList::iterator itr = bin.getRenderBinList().begin();
+            itr != bin.getRenderBinList().end();
+            ++itr)
+        {
+            apply(*(itr->second));
+        }
+    }
+
+protected:
+
+    typedef std::map<StateGraph*, StateGraph*> StateGraphMap;
+
+    StateGraph*     _from;
+    StateGraph*     _to;
+    unsigned int    _traversalOrderOffset;
+    StateGraphMap   _stateGraphMap;
+};
+
+}
+
+bool CullVisitor::cullInParallel(osg::Group& group)
+{
+    // only plain groups are split as subclasses may select which children to traverse.
+    if (typeid(group)!=typeid(osg::Group) || !_rootStateGraph || !_currentStateGraph || !_currentRenderBin) return false;
+
+    unsigned int numChildren = group.getNumChildren();
+    if (numChildren<osg::maximum(_minNumChildrenForParallelTraversal, 2u)) return false;
+
+    unsigned int numThreads = _numThreads>0 ? _numThreads : static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+    if (numThreads<=1) return false;
+
+    osg::Timer_t start = osg::Timer::instance()->tick();
+
+    // use several tasks per thread to even out the differing costs of each child's subgraph.
+    unsigned int numTasks = osg::minimum(numChildren, numThreads*4);
+
+    osg::ref_ptr<ParallelCull> parallelCull = new ParallelCull(group, numTasks);
+    for(unsigned int i=0; i<numTasks; ++i)
+    {
+        // the worker CullVisitors are kept from frame to frame so that their RenderLeafs, matrices and StateGraphs are reused.
+        if (i>=_parallelCullVisitors.size())
+        {
+            osg::ref_ptr<CullVisitor> cv = clone();
+            cv->setNumThreads(1);
+            cv->setStateGraph(new StateGraph);
+            cv->setRenderStage(_rootRenderStage.valid() ? osg::cloneType(_rootRenderStage.get()) : new RenderStage);
+            _parallelCullVisitors.push_back(cv);
+        }
+
+        ParallelCullTask& task = parallelCull->_tasks[i];
+        task._begin = (numChildren*i)/numTasks;
+        task._end = (numChildren*(i+1))/numTasks;
+        task._visitor = _parallelCullVisitors[i];
+
+        initParallelCullVisitor(*task._visitor);
+    }
+
+    // compute the bounds of the whole subgraph up front, as the lazy bound computation isn't thread safe.
+    for(unsigned int i=0; i<numChildren; ++i)
+    {
+        group.getChild(i)->getBound();
+    }
+
+    RenderStage* stage = _currentRenderBin->getStage();
+    osg::Vec4 clearColor = stage->getClearColor();
+    GLbitfield clearMask = stage->getClearMask();
+
+    // the calling thread takes part too, returning once all the tasks have been culled.
+    osg::ParallelTaskThreadPool::instance()->run(parallelCull.get(), numThreads);
+
+    // merge in scene graph order so that the StateGraphs, bins and traversal order numbers are those of a serial cull.
+    for(unsigned int i=0; i<numTasks; ++i)
+    {
+        ParallelCullTask& task = parallelCull->_tasks[i];
+        mergeParallelCullVisitor(*task._visitor, clearColor, clearMask);
+        _parallelCullTaskTime += task._time;
+    }
+
+    _parallelCullTime += osg::Timer::instance()->delta_s(start, osg::Timer::instance()->tick());
+
+    return true;
+}
+
+void CullVisitor::initParallelCullVisitor(CullVisitor& cv)
+{
+    cv.setTraversalMode(getTraversalMode());
+    cv.setTraversalMask(getTraversalMask());
+    cv.setNodeMaskOverride(getNodeMaskOverride());
+    cv.setTraversalNumber(getTraversalNumber());
+    cv.setFrameStamp(const_cast<osg::FrameStamp*>(getFrameStamp()));
+    cv.setDatabaseRequestHandler(getDatabaseRequestHandler());
+    cv.setImageRequestHandler(getImageRequestHandler());
+    cv.setUserDataContainer(getUserDataContainer());
+    cv._nodePath = _nodePath;
+
+    cv.setCullSettings(*this);
+
+    // copy the CullStack, the modelview CullingSets are copied element by element so the worker's own storage is reused.
+    cv._occluderList = _occluderList;
+    cv._projectionStack = _projectionStack;
+    cv._modelviewStack = _modelviewStack;
+    cv._MVPW_Stack = _MVPW_Stack;
+    cv._viewportStack = _viewportStack;
+    cv._referenceViewPoints = _referenceViewPoints;
+    cv._eyePointStack = _eyePointStack;
+    cv._viewPointStack = _viewPointStack;
+    cv._clipspaceCullingStack = _clipspaceCullingStack;
+    cv._projectionCullingStack = _projectionCullingStack;
+
+    if (cv._modelviewCullingStack.size()<_index_modelviewCullingStack) cv._modelviewCullingStack.resize(_index_modelviewCullingStack);
+    for(unsigned int i=0; i<_index_modelviewCullingStack; ++i)
+    {
+        cv._modelviewCullingStack[i] = _modelviewCullingStack[i];
+    }
+    cv._index_modelviewCullingStack = _index_modelviewCullingStack;
+    cv._back_modelviewCullingStack = _index_modelviewCullingStack>0 ? &(cv._modelviewCullingStack[_index_modelviewCullingStack-1]) : 0;
+
+    cv._frustumVolume = _frustumVolume;
+    cv._bbCornerNear = _bbCornerNear;
+    cv._bbCornerFar = _bbCornerFar;
+
+    cv._renderBinStack.clear();
+    cv._numberOfEncloseOverrideRenderBinDetails = _numberOfEncloseOverrideRenderBinDetails;
+    cv._renderInfo = _renderInfo;
+    cv._identifier = _identifier;
+
+    // starting from the current near and far keeps the worker from collecting candidates that can't affect the result.
+    cv._computed_znear = _computed_znear;
+    cv._computed_zfar = _computed_zfar;
+    cv._nearPlaneCandidateMap.clear();
+    cv._farPlaneCandidateMap.clear();
+
+    // leaves are numbered from zero and offset when they are merged.
+    cv._traversalOrderNumber = 0;
+
+    // replicate the path from the root StateGraph to the current one.
+    {
+        typedef std::vector<StateGraph*> StateGraphStack;
+        StateGraphStack stateGraphParentalChain;
+        for(StateGraph* sg = _currentStateGraph; sg!=_rootStateGraph.get() && sg; sg = sg->_parent)
+        {
+            stateGraphParentalChain.push_back(sg);
+        }
+
+        StateGraph* root = cv._rootStateGraph.get();
+        root->clean();
+        root->setStateSet(_rootStateGraph->getStateSet());
+
+        cv._currentStateGraph = root;
+        for(StateGraphStack::reverse_iterator ritr = stateGraphParentalChain.rbegin();
+            ritr != stateGraphParentalChain.rend();
+            ++ritr)
+        {
+            cv._currentStateGraph = cv._currentStateGraph->find_or_insert((*ritr)->getStateSet());
+        }
+    }
+
+    // replicate the current RenderStage and the nesting of bins within it down to the current bin.
+    {
+        RenderStage* stage = _currentRenderBin->getStage();
+        RenderStage* cvStage = cv._rootRenderStage.get();
+
+        cvStage->reset();
+        cvStage->setCamera(stage->getCamera());
+        cvStage->setViewport(stage->getViewport());
+        cvStage->setInitialViewMatrix(stage->getInitialViewMatrix());
+        cvStage->setClearColor(stage->getClearColor());
+        cvStage->setClearMask(stage->getClearMask());
+        cvStage->setClearDepth(stage->getClearDepth());
+        cvStage->setClearAccum(stage->getClearAccum());
+        cvStage->setClearStencil(stage->getClearStencil());
+        cvStage->setColorMask(stage->getColorMask());
+        cvStage->setDrawBuffer(stage->getDrawBuffer(), stage->getDrawBufferApplyMask());
+        cvStage->setReadBuffer(stage->getReadBuffer(), stage->getReadBufferApplyMask());
+
+        typedef std::vector<RenderBin*> RenderBinStack;
+        RenderBinStack renderBinParentalChain;
+        for(RenderBin* rb = _currentRenderBin; rb!=stage && rb; rb = rb->getParent())
+        {
+            renderBinParentalChain.push_back(rb);
+        }
+
+        cv._currentRenderBin = cvStage;
+        for(RenderBinStack::reverse_iterator ritr = renderBinParentalChain.rbegin();
+            ritr != renderBinParentalChain.rend();
+            ++ritr)
+        {
+            // the bin type doesn't matter as the contents are merged into the original bin.
+            cv._currentRenderBin = cv._currentRenderBin->find_or_insert((*ritr)->getBinNum(), "RenderBin");
+        }
+    }
+}
+
+void CullVisitor::mergeParallelCullVisitor(CullVisitor& cv, const osg::Vec4& clearColor, GLbitfield clearMask)
+{
+    RenderStage* stage = _currentRenderBin->getStage();
+    RenderStage* cvStage = cv._rootRenderStage.get();
+
+    ParallelCullStateGraphMerger merger(cv._rootStateGraph.get(), _rootStateGraph.get(), _traversalOrderNumber);
+    merger.apply(*cvStage);
+
+    // Cameras that inherited the clear color or mask the worker started with see those left by an osg::ClearNode in an earlier task.
+    if (stage->getClearColor()!=clearColor || stage->getClearMask()!=clearMask)
+    {
+        RenderStage::RenderStageList* renderStageLists[2] = { &(cvStage->getPreRenderList()), &(cvStage->getPostRenderList()) };
+        for(unsigned int i=0; i<2; ++i)
+        {
+            for(RenderStage::RenderStageList::iterator itr = renderStageLists[i]->begin();
+                itr != renderStageLists[i]->end();
+                ++itr)
+            {
+                RenderStage* rs = itr->second.get();
+                osg::Camera* camera = rs->getCamera();
+                if (!camera || rs==cvStage) continue;
+
+                if ((camera->getInheritanceMask() & CLEAR_COLOR) && rs->getClearColor()==clearColor) rs->setClearColor(stage->getClearColor());
+                if ((camera->getInheritanceMask() & CLEAR_MASK) && rs->getClearMask()==clearMask) rs->setClearMask(stage->getClearMask());
+            }
+        }
+    }
+
+    stage->mergeRenderStage(*cvStage);
+
+    // pass on any changes made by an osg::ClearNode.
+    if (cvStage->getClearColor()!=clearColor) stage->setClearColor(cvStage->getClearColor());
+    if (cvStage->getClearMask()!=clearMask) stage->setClearMask(cvStage->getClearMask());
+
+    _traversalOrderNumber += cv._traversalOrderNumber;
+
+    // the worker's StateGraph count restarts with each task, its RenderLeaf count with each frame.
+    _numAllocations += cv.getNumAllocations();
+    cv._numAllocations = 0;
+
+    if (cv._computed_znear<_computed_znear) _computed_znear = cv._computed_znear;
+    if (cv._computed_zfar>_computed_zfar) _computed_zfar = cv._computed_zfar;
+
+    _nearPlaneCandidateMap.insert(cv._nearPlaneCandidateMap.begin(), cv._nearPlaneCandidateMap.end());
+    _farPlaneCandidateMap.insert(cv._farPlaneCandidateMap.begin(), cv._farPlaneCandidateMap.end());
+    cv._nearPlaneCandidateMap.clear();
+    cv._farPlaneCandidateMap.clear();
+
+    cv._rootStateGraph->prune();
+}
@@ -23,8 +23,13 @@
 #include <osg/Billboard>
 #include <osg/Geometry>
 #include <osg/Notify>
+#include <osg/ParallelTask>
 #include <osg/io_utils>
 
+#include <OpenThreads/ScopedLock>
+
+#include <typeinfo>
+
 using namespace osgUtil;
 
 
@@ -145,6 +150,93 @@ bool IntersectorGroup::containsIntersections()
     return false;
 }
 
+Intersector* IntersectorGroup::cloneForParallelTraversal()
+{
+    osg::ref_ptr<IntersectorGroup> ig = new IntersectorGroup;
+    if (!cloneIntersectorsForParallelTraversal(*ig)) return 0;
+    return ig.release();
+}
+
+bool IntersectorGroup::cloneIntersectorsForParallelTraversal(IntersectorGroup& ig)
+{
+    ig._coordinateFrame = _coordinateFrame;
+    ig._intersectionLimit = _intersectionLimit;
+    ig._disabledCount = _disabledCount;
+    ig._precisionHint = _precisionHint;
+
+    // copy across all the intersectors, including the disabled ones, so that they can be paired up again when merging.
+    for(Intersectors::iterator itr = _intersectors.begin();
+        itr != _intersectors.end();
+        ++itr)
+    {
+        Intersector* intersector = (*itr)->cloneForParallelTraversal();
+        if (!intersector) return false;
+
+        ig.addIntersector(intersector);
+    }
+
+    return true;
+}
+
+void IntersectorGroup::mergeParallelTraversal(Intersector* intersector)
+{
+    IntersectorGroup* ig = dynamic_cast<IntersectorGroup*>(intersector);
+    if (!ig || ig->_intersectors.size()!=_intersectors.size()) return;
+
+    for(unsigned int i=0; i<_intersectors.size(); ++i)
+    {
+        _intersectors[i]->mergeParallelTraversal(ig->_intersectors[i].get());
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Parallel traversal support
+//
+namespace
+{
+
+/** A contiguous range of a group's children traversed by its own IntersectionVisitor and Intersector copies.*/
+struct ParallelTraversalTask
+{
+    ParallelTraversalTask():
+        _begin(0),
+        _end(0) {}
+
+    osg::ref_ptr<IntersectionVisitor>   _visitor;
+    osg::ref_ptr<Intersector>           _front;
+    osg::ref_ptr<Intersector>           _back;
+    unsigned int                        _begin;
+    unsigned int                        _end;
+};
+
+class ParallelTraversal : public osg::ParallelTask
+{
+public:
+
+    ParallelTraversal(osg::Group& group, unsigned int numTasks):
+        osg::ParallelTask(numTasks),
+        _group(&group),
+        _tasks(numTasks) {}
+
+    /** Traverse a single task, called by the calling thread and the pool threads alike.*/
+    virtual void process(unsigned int i)
+    {
+        ParallelTraversalTask& task = _tasks[i];
+        for(unsigned int c=task._begin; c<task._end; ++c)
+        {
+            _group->getChild(c)->accept(*task._visitor);
+        }
+    }
+
+    osg::ref_ptr<osg::Group>                _group;
+    std::vector<ParallelTraversalTask>      _tasks;
+    OpenThreads::Mutex                      _readMutex;
+};
+
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 //
@@ -157,6 +249,10 @@ IntersectionVisitor::IntersectionVisitor(Intersector* intersector, ReadCallback*
     _useKdTreesWhenAvailable = true;
     _dummyTraversal = false;
 
+    _numThreads = 1;
+    _minNumChildrenForParallelTraversal = 8;
+    _parallelTraversalReadMutex = 0;
+
     _lodSelectionMode = USE_HIGHEST_LEVEL_OF_DETAIL;
     _eyePointDirty = true;
 
@@ -216,7 +312,7 @@ void IntersectionVisitor::apply(osg::Group& group)
 {
     if (!enter(group)) return;
 
-    traverse(group);
+    if (!traverseInParallel(group)) traverse(group);
 
     leave();
 }
@@ -352,7 +448,7 @@ void IntersectionVisitor::apply(osg::PagedLOD& plod)
                 if (plod.getNumFileNames() <= childIndex)
                     validIndex = plod.getNumFileNames()-1;
 
-                child = _readCallback->readNodeFile( plod.getDatabasePath() + plod.getFileName( validIndex ) );
+                child = readNodeFile( plod.getDatabasePath() + plod.getFileName( validIndex ) );
             }
 
             if ( !child.valid() && plod.getNumChildren()>0)
@@ -374,7 +470,7 @@ void IntersectionVisitor::apply(osg::PagedLOD& plod)
 
         if (plod.getNumFileNames() != plod.getNumChildren() && _readCallback.valid())
         {
-            highestResChild = _readCallback->readNodeFile( plod.getDatabasePath() + plod.getFileName(plod.getNumFileNames()-1) );
+            highestResChild = readNodeFile( plod.getDatabasePath() + plod.getFileName(plod.getNumFileNames()-1) );
         }
 
         if ( !highestResChild.valid() && plod.getNumChildren()>0)
@@ -393,6 +489,108 @@ void IntersectionVisitor::apply(osg::PagedLOD& plod)
 }
 
 
+osg::ref_ptr<osg::Node> IntersectionVisitor::readNodeFile(const std::string& filename)
+{
+    if (!_readCallback) return 0;
+
+    if (!_parallelTraversalReadMutex) return _readCallback->readNodeFile(filename);
+
+    OpenThreads::ScopedLock<OpenThreads::Mutex> lock(*_parallelTraversalReadMutex);
+
+    osg::ref_ptr<osg::Node> node = _readCallback->readNodeFile(filename);
+
+    // compute the bounds while still serialized, as the ReadCallback may hand the same cached subgraph to other tasks.
+    if (node.valid()) node->getBound();
+
+    return node;
+}
+
+bool IntersectionVisitor::traverseInParallel(osg::Group& group)
+{
+    // tasks are always traversed serially, and only plain groups are split as subclasses may select which children to traverse.
+    if (_parallelTraversalReadMutex || _intersectorStack.empty() || typeid(group)!=typeid(osg::Group)) return false;
+
+    unsigned int numChildren = group.getNumChildren();
+    if (numChildren<osg::maximum(_minNumChildrenForParallelTraversal, 2u)) return false;
+
+    unsigned int numThreads = _numThreads>0 ? _numThreads : static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+    if (numThreads<=1) return false;
+
+    Intersector* front = _intersectorStack.front().get();
+    Intersector* back = _intersectorStack.back().get();
+
+    // use several tasks per thread to even out the differing costs of each child's subgraph.
+    unsigned int numTasks = osg::minimum(numChildren, numThreads*4);
+
+    osg::ref_ptr<ParallelTraversal> traversal = new ParallelTraversal(group, numTasks);
+    for(unsigned int i=0; i<numTasks; ++i)
+    {
+        ParallelTraversalTask& task = traversal->_tasks[i];
+        task._begin = (numChildren*i)/numTasks;
+        task._end = (numChildren*(i+1))/numTasks;
+
+        task._front = front->cloneForParallelTraversal();
+        if (!task._front) return false;
+
+        if (back!=front)
+        {
+            task._back = back->cloneForParallelTraversal();
+            if (!task._back) return false;
+        }
+
+        osg::ref_ptr<IntersectionVisitor> iv = new IntersectionVisitor;
+        iv->setTraversalMode(getTraversalMode());
+        iv->setTraversalMask(getTraversalMask());
+        iv->setNodeMaskOverride(getNodeMaskOverride());
+        iv->setTraversalNumber(getTraversalNumber());
+        iv->setFrameStamp(const_cast<osg::FrameStamp*>(getFrameStamp()));
+        iv->setDatabaseRequestHandler(getDatabaseRequestHandler());
+        iv->setImageRequestHandler(getImageRequestHandler());
+        iv->_nodePath = _nodePath;
+
+        iv->_intersectorStack.push_back(task._front);
+        if (task._back.valid()) iv->_intersectorStack.push_back(task._back);
+
+        iv->_useKdTreesWhenAvailable = _useKdTreesWhenAvailable;
+        iv->_dummyTraversal = _dummyTraversal;
+        iv->_readCallback = _readCallback;
+        iv->_parallelTraversalReadMutex = &(traversal->_readMutex);
+
+        iv->_windowStack = _windowStack;
+        iv->_projectionStack = _projectionStack;
+        iv->_viewStack = _viewStack;
+        iv->_modelStack = _modelStack;
+
+        iv->_referenceEyePoint = _referenceEyePoint;
+        iv->_referenceEyePointCoordinateFrame = _referenceEyePointCoordinateFrame;
+        iv->_lodSelectionMode = _lodSelectionMode;
+        iv->_eyePointDirty = true;
+
+        task._visitor = iv;
+    }
+
+    // compute the bounds of the whole subgraph up front, as the lazy bound computation isn't thread safe.
+    for(unsigned int i=0; i<numChildren; ++i)
+    {
+        group.getChild(i)->getBound();
+    }
+
+    // the calling thread takes part too, returning once all the tasks have been traversed.
+    osg::ParallelTaskThreadPool::instance()->run(traversal.get(), numThreads);
+
+    // merge the intersections in scene graph order so that the results are independent of the order tasks complete.
+    for(unsigned int i=0; i<numTasks; ++i)
+    {
+        ParallelTraversalTask& task = traversal->_tasks[i];
+        if (task._back.valid()) back->mergeParallelTraversal(task._back.get());
+        front->mergeParallelTraversal(task._front.get());
+
+        task._visitor = 0;
+    }
+
+    return true;
+}
+
 void IntersectionVisitor::apply(osg::Transform& transform)
 {
     if (!enter(transform)) return;
@@ -23,6 +23,14 @@
 #include <osg/TexMat>
 #include <osg/TemplatePrimitiveFunctor>
 
+#include <algorithm>
+#include <math.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=1)
+    #include <xmmintrin.h>
+    #define OSGUTIL_LINESEGMENTINTERSECTOR_USE_SSE
+#endif
+
 using namespace osgUtil;
 
 namespace LineSegmentIntersectorUtils
@@ -402,6 +410,330 @@ struct IntersectFunctor
     }
 };
 
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  Packet intersection, four segments at a time, used by LineSegmentIntersectorGroup
+//
+
+// four floats operated on together, mapped onto SSE when it's available.
+struct Float4
+{
+#ifdef OSGUTIL_LINESEGMENTINTERSECTOR_USE_SSE
+    __m128 _v;
+
+    Float4() {}
+    Float4(__m128 v): _v(v) {}
+    explicit Float4(float f): _v(_mm_set1_ps(f)) {}
+    Float4(float a, float b, float c, float d): _v(_mm_setr_ps(a, b, c, d)) {}
+
+    inline Float4 operator + (const Float4& rhs) const { return Float4(_mm_add_ps(_v, rhs._v)); }
+    inline Float4 operator - (const Float4& rhs) const { return Float4(_mm_sub_ps(_v, rhs._v)); }
+    inline Float4 operator * (const Float4& rhs) const { return Float4(_mm_mul_ps(_v, rhs._v)); }
+    inline Float4 operator / (const Float4& rhs) const { return Float4(_mm_div_ps(_v, rhs._v)); }
+
+    // comparisons return a bit mask, one bit per lane.
+    inline unsigned int operator < (const Float4& rhs) const { return _mm_movemask_ps(_mm_cmplt_ps(_v, rhs._v)); }
+    inline unsigned int operator <= (const Float4& rhs) const { return _mm_movemask_ps(_mm_cmple_ps(_v, rhs._v)); }
+    inline unsigned int operator >= (const Float4& rhs) const { return _mm_movemask_ps(_mm_cmpge_ps(_v, rhs._v)); }
+
+    static inline Float4 minimum(const Float4& lhs, const Float4& rhs) { return Float4(_mm_min_ps(lhs._v, rhs._v)); }
+    static inline Float4 maximum(const Float4& lhs, const Float4& rhs) { return Float4(_mm_max_ps(lhs._v, rhs._v)); }
+    static inline Float4 absolute(const Float4& f) { return Float4(_mm_andnot_ps(_mm_set1_ps(-0.0f), f._v)); }
+#else
+    float _v[4];
+
+    Float4() {}
+    explicit Float4(float f) { _v[0] = _v[1] = _v[2] = _v[3] = f; }
+    Float4(float a, float b, float c, float d) { _v[0] = a; _v[1] = b; _v[2] = c; _v[3] = d; }
+
+    inline Float4 operator + (const Float4& rhs) const { return Float4(_v[0]+rhs._v[0], _v[1]+rhs._v[1], _v[2]+rhs._v[2], _v[3]+rhs._v[3]); }
+    inline Float4 operator - (const Float4& rhs) const { return Float4(_v[0]-rhs._v[0], _v[1]-rhs._v[1], _v[2]-rhs._v[2], _v[3]-rhs._v[3]); }
+    inline Float4 operator * (const Float4& rhs) const { return Float4(_v[0]*rhs._v[0], _v[1]*rhs._v[1], _v[2]*rhs._v[2], _v[3]*rhs._v[3]); }
+    inline Float4 operator / (const Float4& rhs) const { return Float4(_v[0]/rhs._v[0], _v[1]/rhs._v[1], _v[2]/rhs._v[2], _v[3]/rhs._v[3]); }
+
+    inline unsigned int operator < (const Float4& rhs) const { return (_v[0]<rhs._v[0] ? 1 : 0) | (_v[1]<rhs._v[1] ? 2 : 0) | (_v[2]<rhs._v[2] ? 4 : 0) | (_v[3]<rhs._v[3] ? 8 : 0); }
+    inline unsigned int operator <= (const Float4& rhs) const { return (_v[0]<=rhs._v[0] ? 1 : 0) | (_v[1]<=rhs._v[1] ? 2 : 0) | (_v[2]<=rhs._v[2] ? 4 : 0) | (_v[3]<=rhs._v[3] ? 8 : 0); }
+    inline unsigned int operator >= (const Float4& rhs) const { return (_v[0]>=rhs._v[0] ? 1 : 0) | (_v[1]>=rhs._v[1] ? 2 : 0) | (_v[2]>=rhs._v[2] ? 4 : 0) | (_v[3]>=rhs._v[3] ? 8 : 0); }
+
+    static inline Float4 minimum(const Float4& lhs, const Float4& rhs) { return Float4(osg::minimum(lhs._v[0],rhs._v[0]), osg::minimum(lhs._v[1],rhs._v[1]), osg::minimum(lhs._v[2],rhs._v[2]), osg::minimum(lhs._v[3],rhs._v[3])); }
+    static inline Float4 maximum(const Float4& lhs, const Float4& rhs) { return Float4(osg::maximum(lhs._v[0],rhs._v[0]), osg::maximum(lhs._v[1],rhs._v[1]), osg::maximum(lhs._v[2],rhs._v[2]), osg::maximum(lhs._v[3],rhs._v[3])); }
+    static inline Float4 absolute(const Float4& f) { return Float4(fabsf(f._v[0]), fabsf(f._v[1]), fabsf(f._v[2]), fabsf(f._v[3])); }
+#endif
+};
+
+struct PacketIntersectFunctor
+{
+    typedef IntersectFunctor<osg::Vec3d, double> DoubleFunctor;
+    typedef IntersectFunctor<osg::Vec3f, float> FloatFunctor;
+
+    enum { PACKET_SIZE = 4 };
+
+    // the exact per segment functors used to confirm the candidate hits found by the packet tests.
+    Settings        _settings[PACKET_SIZE];
+    DoubleFunctor   _doubleFunctors[PACKET_SIZE];
+    FloatFunctor    _floatFunctors[PACKET_SIZE];
+    bool            _useDouble[PACKET_SIZE];
+
+    // segments relative to _center, which keeps the single precision packet tests accurate for large coordinates.
+    osg::Vec3d      _center;
+    Float4          _sx, _sy, _sz;
+    Float4          _dx, _dy, _dz;
+    Float4          _invDx, _invDy, _invDz;
+    Float4          _length;
+
+    unsigned int    _numSegments;
+    unsigned int    _activeMask;
+
+    std::vector<unsigned int> _maskStack;
+
+    unsigned int    _primitiveIndex;
+
+    PacketIntersectFunctor():
+        _numSegments(0),
+        _activeMask(0),
+        _primitiveIndex(0) {}
+
+    void reset()
+    {
+        _numSegments = 0;
+        _activeMask = 0;
+        _primitiveIndex = 0;
+    }
+
+    void addSegment(const osg::Vec3d& s, const osg::Vec3d& e, osgUtil::LineSegmentIntersector* lsi, osgUtil::IntersectionVisitor* iv, osg::Drawable* drawable, osg::Vec3Array* vertices)
+    {
+        unsigned int i = _numSegments++;
+
+        // the functors are reused from packet to packet, so clear out what the last segment left behind.
+        _doubleFunctors[i]._startEndStack.clear();
+        _doubleFunctors[i]._hit = false;
+        _floatFunctors[i]._startEndStack.clear();
+        _floatFunctors[i]._hit = false;
+
+        _settings[i]._lineSegIntersector = lsi;
+        _settings[i]._iv = iv;
+        _settings[i]._drawable = drawable;
+        _settings[i]._vertices = vertices;
+        _settings[i]._limitOneIntersection = (lsi->getIntersectionLimit() == osgUtil::Intersector::LIMIT_ONE_PER_DRAWABLE || lsi->getIntersectionLimit() == osgUtil::Intersector::LIMIT_ONE);
+
+        _useDouble[i] = lsi->getPrecisionHint()==osgUtil::Intersector::USE_DOUBLE_CALCULATIONS;
+        if (_useDouble[i]) _doubleFunctors[i].set(s, e, &_settings[i]);
+        else _floatFunctors[i].set(s, e, &_settings[i]);
+
+        _activeMask |= (1u<<i);
+    }
+
+    // pack the segments into the SIMD lanes, padding unused lanes with copies of the first segment.
+    void setUpPacket(const osg::Vec3d& center)
+    {
+        _center = center;
+
+        float sx[PACKET_SIZE], sy[PACKET_SIZE], sz[PACKET_SIZE];
+        float dx[PACKET_SIZE], dy[PACKET_SIZE], dz[PACKET_SIZE];
+        float length[PACKET_SIZE];
+
+        for(unsigned int i=0; i<PACKET_SIZE; ++i)
+        {
+            unsigned int si = i<_numSegments ? i : 0;
+            osg::Vec3d s = _useDouble[si] ? osg::Vec3d(_doubleFunctors[si]._start) : osg::Vec3d(_floatFunctors[si]._start);
+            osg::Vec3d d = _useDouble[si] ? osg::Vec3d(_doubleFunctors[si]._d) : osg::Vec3d(_floatFunctors[si]._d);
+            double l = _useDouble[si] ? _doubleFunctors[si]._length : _floatFunctors[si]._length;
+
+            s -= center;
+            sx[i] = s.x(); sy[i] = s.y(); sz[i] = s.z();
+            dx[i] = d.x(); dy[i] = d.y(); dz[i] = d.z();
+            length[i] = l;
+        }
+
+        _sx = Float4(sx[0], sx[1], sx[2], sx[3]);
+        _sy = Float4(sy[0], sy[1], sy[2], sy[3]);
+        _sz = Float4(sz[0], sz[1], sz[2], sz[3]);
+        _dx = Float4(dx[0], dx[1], dx[2], dx[3]);
+        _dy = Float4(dy[0], dy[1], dy[2], dy[3]);
+        _dz = Float4(dz[0], dz[1], dz[2], dz[3]);
+        _length = Float4(length[0], length[1], length[2], length[3]);
+
+        // axis aligned directions get a very large inverse rather than infinity so the slab tests never see 0*inf.
+        const float large = 1e30f;
+        _invDx = Float4(dx[0]!=0.0f ? 1.0f/dx[0] : large, dx[1]!=0.0f ? 1.0f/dx[1] : large, dx[2]!=0.0f ? 1.0f/dx[2] : large, dx[3]!=0.0f ? 1.0f/dx[3] : large);
+        _invDy = Float4(dy[0]!=0.0f ? 1.0f/dy[0] : large, dy[1]!=0.0f ? 1.0f/dy[1] : large, dy[2]!=0.0f ? 1.0f/dy[2] : large, dy[3]!=0.0f ? 1.0f/dy[3] : large);
+        _invDz = Float4(dz[0]!=0.0f ? 1.0f/dz[0] : large, dz[1]!=0.0f ? 1.0f/dz[1] : large, dz[2]!=0.0f ? 1.0f/dz[2] : large, dz[3]!=0.0f ? 1.0f/dz[3] : large);
+
+        _maskStack.clear();
+        _maskStack.push_back(_activeMask);
+    }
+
+    inline unsigned int currentMask() const { return _maskStack.back() & _activeMask; }
+
+    // conservative slab test of all the segments against the bounding box.
+    bool enter(const osg::BoundingBox& bb)
+    {
+        unsigned int mask = currentMask();
+        if (!mask) return false;
+
+        osg::Vec3 bbMin = osg::Vec3(osg::Vec3d(bb._min) - _center);
+        osg::Vec3 bbMax = osg::Vec3(osg::Vec3d(bb._max) - _center);
+        osg::Vec3 tolerance = (bbMax-bbMin)*1e-4f + osg::Vec3(1e-5f, 1e-5f, 1e-5f);
+        bbMin -= tolerance;
+        bbMax += tolerance;
+
+        Float4 t0 = (Float4(bbMin.x())-_sx)*_invDx;
+        Float4 t1 = (Float4(bbMax.x())-_sx)*_invDx;
+        Float4 tmin = Float4::minimum(t0, t1);
+        Float4 tmax = Float4::maximum(t0, t1);
+
+        t0 = (Float4(bbMin.y())-_sy)*_invDy;
+        t1 = (Float4(bbMax.y())-_sy)*_invDy;
+        tmin = Float4::maximum(tmin, Float4::minimum(t0, t1));
+        tmax = Float4::minimum(tmax, Float4::maximum(t0, t1));
+
+        t0 = (Float4(bbMin.z())-_sz)*_invDz;
+        t1 = (Float4(bbMax.z())-_sz)*_invDz;
+        tmin = Float4::maximum(tmin, Float4::minimum(t0, t1));
+        tmax = Float4::minimum(tmax, Float4::maximum(t0, t1));
+
+        tmin = Float4::maximum(tmin, Float4(0.0f));
+        tmax = Float4::minimum(tmax, _length);
+
+        mask &= (tmin <= tmax);
+        if (!mask) return false;
+
+        _maskStack.push_back(mask);
+        return true;
+    }
+
+    void leave()
+    {
+        _maskStack.pop_back();
+    }
+
+    // test all the segments against the triangle at once, passing the candidates on to the exact per segment tests.
+    void intersect(const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2)
+    {
+        unsigned int mask = currentMask();
+        if (!mask) return;
+
+        osg::Vec3 lv0 = osg::Vec3(osg::Vec3d(v0) - _center);
+        osg::Vec3 e1 = v1-v0;
+        osg::Vec3 e2 = v2-v0;
+
+        // P = d ^ e2
+        Float4 px = _dy*Float4(e2.z()) - _dz*Float4(e2.y());
+        Float4 py = _dz*Float4(e2.x()) - _dx*Float4(e2.z());
+        Float4 pz = _dx*Float4(e2.y()) - _dy*Float4(e2.x());
+
+        Float4 det = px*Float4(e1.x()) + py*Float4(e1.y()) + pz*Float4(e1.z());
+
+        // T = s - v0
+        Float4 tx = _sx - Float4(lv0.x());
+        Float4 ty = _sy - Float4(lv0.y());
+        Float4 tz = _sz - Float4(lv0.z());
+
+        // Q = T ^ e1
+        Float4 qx = ty*Float4(e1.z()) - tz*Float4(e1.y());
+        Float4 qy = tz*Float4(e1.x()) - tx*Float4(e1.z());
+        Float4 qz = tx*Float4(e1.y()) - ty*Float4(e1.x());
+
+        Float4 u = px*tx + py*ty + pz*tz;
+        Float4 v = qx*_dx + qy*_dy + qz*_dz;
+        Float4 t = qx*Float4(e2.x()) + qy*Float4(e2.y()) + qz*Float4(e2.z());
+
+        // near degenerate determinants are left for the exact test to decide.
+        float triangleScale = e1.length()*e2.length();
+        Float4 absDet = Float4::absolute(det);
+        unsigned int uncertain = absDet <= Float4(triangleScale*1e-6f);
+
+        Float4 invDet = Float4(1.0f) / Float4::maximum(absDet, Float4(1e-30f));
+        // fold the sign of det into u, v and t so the tests below hold for both windings.
+        Float4 sign = det / Float4::maximum(absDet, Float4(1e-30f));
+        u = u*sign*invDet;
+        v = v*sign*invDet;
+        t = t*sign*invDet;
+
+        const float tolerance = 1e-3f;
+        Float4 lengthTolerance = Float4(tolerance)*(_length + Float4(e1.length()+e2.length()));
+
+        unsigned int candidates = (u >= Float4(-tolerance)) &
+                                  (v >= Float4(-tolerance)) &
+                                  ((u+v) <= Float4(1.0f+tolerance)) &
+                                  (t >= Float4(0.0f)-lengthTolerance) &
+                                  (t <= _length+lengthTolerance);
+
+        candidates = (candidates | uncertain) & mask;
+
+        for(unsigned int i=0; candidates!=0; ++i, candidates >>= 1)
+        {
+            if ((candidates & 1)==0) continue;
+
+            bool hit = false;
+            if (_useDouble[i])
+            {
+                _doubleFunctors[i]._primitiveIndex = _primitiveIndex;
+                _doubleFunctors[i].intersect(v0, v1, v2);
+                hit = _doubleFunctors[i]._hit;
+            }
+            else
+            {
+                _floatFunctors[i]._primitiveIndex = _primitiveIndex;
+                _floatFunctors[i].intersect(v0, v1, v2);
+                hit = _floatFunctors[i]._hit;
+            }
+
+            // segments limited to one intersection per drawable take no further part once they've hit.
+            if (hit && _settings[i]._limitOneIntersection) _activeMask &= ~(1u<<i);
+        }
+    }
+
+    // handle lines
+    void operator()(const osg::Vec3&, bool /*treatVertexDataAsTemporary*/)
+    {
+        ++_primitiveIndex;
+    }
+
+    void operator()(const osg::Vec3&, const osg::Vec3&, bool /*treatVertexDataAsTemporary*/)
+    {
+        ++_primitiveIndex;
+    }
+
+    // handle triangles
+    void operator()(const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2, bool /*treatVertexDataAsTemporary*/)
+    {
+        intersect(v0,v1,v2);
+        ++_primitiveIndex;
+    }
+
+    void operator()(const osg::Vec3& v0, const osg::Vec3& v1, const osg::Vec3& v2, const osg::Vec3& v3, bool /*treatVertexDataAsTemporary*/)
+    {
+        intersect(v0,v1,v3);
+        intersect(v1,v2,v3);
+        ++_primitiveIndex;
+    }
+
+    void intersect(const osg::Vec3Array*, int , unsigned int)
+    {
+    }
+
+    void intersect(const osg::Vec3Array*, int, unsigned int, unsigned int)
+    {
+    }
+
+    void intersect(const osg::Vec3Array* vertices, int primitiveIndex, unsigned int p0, unsigned int p1, unsigned int p2)
+    {
+        _primitiveIndex = primitiveIndex;
+
+        intersect((*vertices)[p0], (*vertices)[p1], (*vertices)[p2]);
+    }
+
+    void intersect(const osg::Vec3Array* vertices, int primitiveIndex, unsigned int p0, unsigned int p1, unsigned int p2, unsigned int p3)
+    {
+        _primitiveIndex = primitiveIndex;
+
+        intersect((*vertices)[p0], (*vertices)[p1], (*vertices)[p3]);
+        intersect((*vertices)[p1], (*vertices)[p2], (*vertices)[p3]);
+    }
+};
+
 } // namespace LineSegmentIntersectorUtils
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -557,6 +889,28 @@ void LineSegmentIntersector::reset()
     _intersections.clear();
 }
 
+Intersector* LineSegmentIntersector::cloneForParallelTraversal()
+{
+    osg::ref_ptr<LineSegmentIntersector> lsi = new LineSegmentIntersector(_coordinateFrame, _start, _end, 0, _intersectionLimit);
+    lsi->_disabledCount = _disabledCount;
+    lsi->setPrecisionHint(getPrecisionHint());
+    return lsi.release();
+}
+
+void LineSegmentIntersector::mergeParallelTraversal(Intersector* intersector)
+{
+    LineSegmentIntersector* lsi = dynamic_cast<LineSegmentIntersector*>(intersector);
+    if (!lsi) return;
+
+    Intersections& intersections = lsi->getIntersections();
+    for(Intersections::iterator itr = intersections.begin();
+        itr != intersections.end() && !reachedLimit();
+        ++itr)
+    {
+        insertIntersection(*itr);
+    }
+}
+
 bool LineSegmentIntersector::intersects(const osg::BoundingSphere& bs)
 {
     // if bs not valid then return true based on the assumption that an invalid sphere is yet to be defined.
@@ -838,3 +1192,285 @@ osg::Texture* LineSegmentIntersector::Intersection::getTextureLookUp(osg::Vec3&
     }
     return 0;
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  LineSegmentIntersectorGroup
+//
+
+namespace LineSegmentIntersectorUtils
+{
+
+// spread the bottom 10 bits of v out so there are two zero bits between each.
+inline unsigned int expandBits(unsigned int v)
+{
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+struct SortByMortonCode
+{
+    SortByMortonCode(const std::vector<unsigned int>& codes): _codes(codes) {}
+
+    bool operator() (unsigned int lhs, unsigned int rhs) const
+    {
+        if (_codes[lhs]<_codes[rhs]) return true;
+        if (_codes[rhs]<_codes[lhs]) return false;
+        return lhs<rhs;
+    }
+
+    const std::vector<unsigned int>& _codes;
+};
+
+}
+
+LineSegmentIntersectorGroup::LineSegmentIntersectorGroup():
+    _numIntersectorsInPackets(0),
+    _sortSegments(true)
+{
+}
+
+LineSegmentIntersector* LineSegmentIntersectorGroup::addLineSegment(const osg::Vec3d& start, const osg::Vec3d& end)
+{
+    LineSegmentIntersector* lsi = new LineSegmentIntersector(start, end);
+    addIntersector(lsi);
+    return lsi;
+}
+
+void LineSegmentIntersectorGroup::updatePackets()
+{
+    if (_numIntersectorsInPackets==_intersectors.size()) return;
+
+    _packets.clear();
+    _otherIntersectors.clear();
+    _numIntersectorsInPackets = _intersectors.size();
+
+    IndexList segments;
+    for(unsigned int i=0; i<_intersectors.size(); ++i)
+    {
+        if (dynamic_cast<LineSegmentIntersector*>(_intersectors[i].get())) segments.push_back(i);
+        else _otherIntersectors.push_back(i);
+    }
+
+    if (segments.empty()) return;
+
+    // sort the segments along a Morton curve through their mid points so that nearby segments share packets,
+    // keeping the packet bounding boxes tight.  Only done on the group the user set up, clones inherit its ordering.
+    if (_sortSegments && segments.size()>PACKET_SIZE)
+    {
+        osg::BoundingBoxd bb;
+        std::vector<osg::Vec3d> midPoints(_intersectors.size());
+        for(IndexList::iterator itr = segments.begin();
+            itr != segments.end();
+            ++itr)
+        {
+            LineSegmentIntersector* lsi = static_cast<LineSegmentIntersector*>(_intersectors[*itr].get());
+            midPoints[*itr] = (lsi->getStart()+lsi->getEnd())*0.5;
+            bb.expandBy(midPoints[*itr]);
+        }
+
+        osg::Vec3d extents = bb._max-bb._min;
+        osg::Vec3d scale(extents.x()>0.0 ? 1023.0/extents.x() : 0.0,
+                         extents.y()>0.0 ? 1023.0/extents.y() : 0.0,
+                         extents.z()>0.0 ? 1023.0/extents.z() : 0.0);
+
+        std::vector<unsigned int> codes(_intersectors.size(), 0);
+        for(IndexList::iterator itr = segments.begin();
+            itr != segments.end();
+            ++itr)
+        {
+            osg::Vec3d p = midPoints[*itr]-bb._min;
+            codes[*itr] = (LineSegmentIntersectorUtils::expandBits(static_cast<unsigned int>(p.x()*scale.x()))<<2) |
+                          (LineSegmentIntersectorUtils::expandBits(static_cast<unsigned int>(p.y()*scale.y()))<<1) |
+                          LineSegmentIntersectorUtils::expandBits(static_cast<unsigned int>(p.z()*scale.z()));
+        }
+
+        std::sort(segments.begin(), segments.end(), LineSegmentIntersectorUtils::SortByMortonCode(codes));
+    }
+
+    for(unsigned int i=0; i<segments.size(); ++i)
+    {
+        if ((i%PACKET_SIZE)==0) _packets.push_back(Packet());
+
+        Packet& packet = _packets.back();
+        LineSegmentIntersector* lsi = static_cast<LineSegmentIntersector*>(_intersectors[segments[i]].get());
+        packet._segments[packet._numSegments++] = segments[i];
+        packet._bb.expandBy(lsi->getStart());
+        packet._bb.expandBy(lsi->getEnd());
+    }
+}
+
+Intersector* LineSegmentIntersectorGroup::clone(osgUtil::IntersectionVisitor& iv)
+{
+    updatePackets();
+
+    LineSegmentIntersectorGroup* ig = new LineSegmentIntersectorGroup;
+    ig->_sortSegments = false;
+
+    // copy across all the segments that aren't disabled, in packet order so the clone keeps the same grouping.
+    for(Packets::iterator itr = _packets.begin();
+        itr != _packets.end();
+        ++itr)
+    {
+        for(unsigned int i=0; i<itr->_numSegments; ++i)
+        {
+            Intersector* intersector = _intersectors[itr->_segments[i]].get();
+            if (!intersector->disabled())
+            {
+                ig->addIntersector( intersector->clone(iv) );
+            }
+        }
+    }
+
+    for(IndexList::iterator itr = _otherIntersectors.begin();
+        itr != _otherIntersectors.end();
+        ++itr)
+    {
+        Intersector* intersector = _intersectors[*itr].get();
+        if (!intersector->disabled())
+        {
+            ig->addIntersector( intersector->clone(iv) );
+        }
+    }
+
+    return ig;
+}
+
+bool LineSegmentIntersectorGroup::enter(const osg::Node& node)
+{
+    if (disabled()) return false;
+
+    updatePackets();
+
+    bool foundIntersections = false;
+
+    const osg::BoundingSphere& bs = node.getBound();
+    bool testPackets = node.isCullingActive() && bs.valid();
+
+    for(Packets::iterator itr = _packets.begin();
+        itr != _packets.end();
+        ++itr)
+    {
+        // reject the whole packet when the node's bounding sphere doesn't touch the box around its segments.
+        if (testPackets && itr->_bb.valid())
+        {
+            osg::Vec3d closest(osg::clampTo(double(bs.center().x()), itr->_bb.xMin(), itr->_bb.xMax()),
+                               osg::clampTo(double(bs.center().y()), itr->_bb.yMin(), itr->_bb.yMax()),
+                               osg::clampTo(double(bs.center().z()), itr->_bb.zMin(), itr->_bb.zMax()));
+            if ((closest-osg::Vec3d(bs.center())).length2() > double(bs.radius2()))
+            {
+                for(unsigned int i=0; i<itr->_numSegments; ++i)
+                {
+                    _intersectors[itr->_segments[i]]->incrementDisabledCount();
+                }
+                continue;
+            }
+        }
+
+        for(unsigned int i=0; i<itr->_numSegments; ++i)
+        {
+            Intersector* intersector = _intersectors[itr->_segments[i]].get();
+            if (intersector->disabled()) intersector->incrementDisabledCount();
+            else if (intersector->enter(node)) foundIntersections = true;
+            else intersector->incrementDisabledCount();
+        }
+    }
+
+    for(IndexList::iterator itr = _otherIntersectors.begin();
+        itr != _otherIntersectors.end();
+        ++itr)
+    {
+        Intersector* intersector = _intersectors[*itr].get();
+        if (intersector->disabled()) intersector->incrementDisabledCount();
+        else if (intersector->enter(node)) foundIntersections = true;
+        else intersector->incrementDisabledCount();
+    }
+
+    if (!foundIntersections)
+    {
+        // need to call leave to clean up the DisabledCount's.
+        leave();
+        return false;
+    }
+
+    // we have found at least one suitable intersector, so return true
+    return true;
+}
+
+void LineSegmentIntersectorGroup::intersect(osgUtil::IntersectionVisitor& iv, osg::Drawable* drawable)
+{
+    if (disabled()) return;
+
+    updatePackets();
+
+    for(IndexList::iterator itr = _otherIntersectors.begin();
+        itr != _otherIntersectors.end();
+        ++itr)
+    {
+        Intersector* intersector = _intersectors[*itr].get();
+        if (!intersector->disabled()) intersector->intersect(iv, drawable);
+    }
+
+    if (iv.getDoDummyTraversal()) return;
+
+    const osg::BoundingBox& bb = drawable->getBoundingBox();
+    bool cullingActive = drawable->isCullingActive();
+
+    osg::Geometry* geometry = drawable->asGeometry();
+    osg::Vec3Array* vertices = geometry ? dynamic_cast<osg::Vec3Array*>(geometry->getVertexArray()) : 0;
+
+    osg::KdTree* kdTree = iv.getUseKdTreeWhenAvailable() ? dynamic_cast<osg::KdTree*>(drawable->getShape()) : 0;
+
+    osg::TemplatePrimitiveFunctor<LineSegmentIntersectorUtils::PacketIntersectFunctor> functor;
+
+    for(Packets::iterator itr = _packets.begin();
+        itr != _packets.end();
+        ++itr)
+    {
+        if (cullingActive && itr->_bb.valid() &&
+            (itr->_bb.xMax()<bb.xMin() || itr->_bb.xMin()>bb.xMax() ||
+             itr->_bb.yMax()<bb.yMin() || itr->_bb.yMin()>bb.yMax() ||
+             itr->_bb.zMax()<bb.zMin() || itr->_bb.zMin()>bb.zMax())) continue;
+
+        functor.reset();
+
+        for(unsigned int i=0; i<itr->_numSegments; ++i)
+        {
+            LineSegmentIntersector* lsi = static_cast<LineSegmentIntersector*>(_intersectors[itr->_segments[i]].get());
+            if (lsi->disabled() || lsi->reachedLimit()) continue;
+
+            osg::Vec3d s(lsi->getStart()), e(lsi->getEnd());
+            if (cullingActive && !lsi->intersectAndClip(s, e, bb)) continue;
+
+            functor.addSegment(s, e, lsi, &iv, drawable, vertices);
+        }
+
+        if (functor._numSegments==0) continue;
+
+        functor.setUpPacket(bb.valid() ? osg::Vec3d(bb.center()) : osg::Vec3d(0.0,0.0,0.0));
+
+        if (kdTree) kdTree->intersect(functor, kdTree->getNode(0));
+        else drawable->accept(functor);
+    }
+}
+
+Intersector* LineSegmentIntersectorGroup::cloneForParallelTraversal()
+{
+    osg::ref_ptr<LineSegmentIntersectorGroup> ig = new LineSegmentIntersectorGroup;
+    ig->_sortSegments = _sortSegments;
+    if (!cloneIntersectorsForParallelTraversal(*ig)) return 0;
+    return ig.release();
+}
+
+void LineSegmentIntersectorGroup::reset()
+{
+    IntersectorGroup::reset();
+
+    // force the packets to be rebuilt in case intersectors have been added or removed.
+    _numIntersectorsInPackets = 0;
+    _packets.clear();
+    _otherIntersectors.clear();
+}
@@ -17,15 +17,19 @@
 
 #include <algorithm>
 #include <vector>
+#include <map>
 
 #include <iostream>
 
 #include <osg/Geometry>
 #include <osg/Math>
+#include <osg/ParallelTask>
 #include <osg/PrimitiveSet>
 #include <osg/TriangleIndexFunctor>
 #include <osg/TriangleLinePointIndexFunctor>
 
+#include <OpenThreads/Thread>
+
 #include <osgUtil/MeshOptimizers>
 
 using namespace osg;
@@ -43,6 +47,152 @@ void GeometryCollector::apply(Geometry& geom)
     _geometryList.insert(&geom);
 }
 
+namespace
+{
+// Groups geometries that share arrays, primitive sets or buffer objects so
+// that each group can be modified by a single thread.
+class GeometryJobBuilder
+{
+public:
+
+    typedef std::vector<osg::Geometry*> Job;
+    typedef std::vector<Job> Jobs;
+
+    void addGeometry(osg::Geometry* geom)
+    {
+        unsigned int index = _parents.size();
+        _geometries.push_back(geom);
+        _parents.push_back(index);
+
+        osg::Geometry::ArrayList arrays;
+        geom->getArrayList(arrays);
+        for(osg::Geometry::ArrayList::iterator itr = arrays.begin();
+            itr != arrays.end();
+            ++itr)
+        {
+            addResource(index, itr->get());
+            addResource(index, (*itr)->getBufferObject());
+        }
+
+        for(unsigned int i=0; i<geom->getNumPrimitiveSets(); ++i)
+        {
+            osg::PrimitiveSet* primitiveSet = geom->getPrimitiveSet(i);
+            addResource(index, primitiveSet);
+            if (primitiveSet) addResource(index, primitiveSet->getBufferObject());
+        }
+    }
+
+    void buildJobs(Jobs& jobs)
+    {
+        std::map<unsigned int, unsigned int> rootToJob;
+        for(unsigned int i=0; i<_geometries.size(); ++i)
+        {
+            unsigned int root = find(i);
+            std::map<unsigned int, unsigned int>::iterator itr = rootToJob.find(root);
+            if (itr==rootToJob.end())
+            {
+                itr = rootToJob.insert(std::make_pair(root, static_cast<unsigned int>(jobs.size()))).first;
+                jobs.push_back(Job());
+            }
+            jobs[itr->second].push_back(_geometries[i]);
+        }
+    }
+
+protected:
+
+    void addResource(unsigned int index, const void* resource)
+    {
+        if (!resource) return;
+
+        std::pair<ResourceMap::iterator, bool> result = _resources.insert(std::make_pair(resource, index));
+        if (!result.second)
+        {
+            unsigned int lhs = find(index);
+            unsigned int rhs = find(result.first->second);
+            if (lhs!=rhs) _parents[osg::maximum(lhs, rhs)] = osg::minimum(lhs, rhs);
+        }
+    }
+
+    unsigned int find(unsigned int index)
+    {
+        while(_parents[index]!=index)
+        {
+            _parents[index] = _parents[_parents[index]];
+            index = _parents[index];
+        }
+        return index;
+    }
+
+    typedef std::map<const void*, unsigned int> ResourceMap;
+
+    std::vector<osg::Geometry*>     _geometries;
+    std::vector<unsigned int>       _parents;
+    ResourceMap                     _resources;
+};
+
+class GeometryOperationTask : public osg::ParallelTask
+{
+public:
+
+    GeometryOperationTask(GeometryJobBuilder::Jobs& jobs, GeometryCollector::GeometryOperation& operation):
+        osg::ParallelTask(jobs.size()),
+        _jobs(jobs),
+        _operation(operation) {}
+
+    virtual void process(unsigned int i)
+    {
+        GeometryJobBuilder::Job& job = _jobs[i];
+        for(GeometryJobBuilder::Job::iterator itr = job.begin();
+            itr != job.end();
+            ++itr)
+        {
+            _operation(*(*itr));
+        }
+    }
+
+protected:
+
+    GeometryOperationTask& operator = (const GeometryOperationTask&) { return *this; }
+
+    GeometryJobBuilder::Jobs&               _jobs;
+    GeometryCollector::GeometryOperation&   _operation;
+};
+}
+
+void GeometryCollector::processGeometries(GeometryOperation& operation)
+{
+    unsigned int numThreads = _numThreads>0 ? _numThreads : static_cast<unsigned int>(osg::maximum(OpenThreads::GetNumberOfProcessors(), 1));
+
+    if (numThreads<=1 || _geometryList.size()<2)
+    {
+        for(GeometryList::iterator itr=_geometryList.begin();
+            itr!=_geometryList.end();
+            ++itr)
+        {
+            operation(*(*itr));
+        }
+        return;
+    }
+
+    GeometryJobBuilder builder;
+    for(GeometryList::iterator itr=_geometryList.begin();
+        itr!=_geometryList.end();
+        ++itr)
+    {
+        builder.addGeometry(*itr);
+
+        // dirty the bounds up front on this thread, so that the dirtyBound() calls made by the Geometry setters in the jobs
+        // stop at the already dirty geometry rather than walking up into parents shared with other jobs.
+        (*itr)->dirtyBound();
+    }
+
+    GeometryJobBuilder::Jobs jobs;
+    builder.buildJobs(jobs);
+
+    osg::ref_ptr<GeometryOperationTask> task = new GeometryOperationTask(jobs, operation);
+    osg::ParallelTaskThreadPool::instance()->run(task.get(), numThreads);
+}
+
 namespace
 {
 typedef std::vector<unsigned int> IndexList;
@@ -399,14 +549,22 @@ void IndexMeshVisitor::makeMesh(Geometry& geom)
     geom.setPrimitiveSetList(new_primitives);
 }
 
+namespace
+{
+struct MakeMeshOperation : public GeometryCollector::GeometryOperation
+{
+    MakeMeshOperation(IndexMeshVisitor& visitor) : _visitor(visitor) {}
+    virtual void operator () (osg::Geometry& geom) { _visitor.makeMesh(geom); }
+    IndexMeshVisitor& _visitor;
+protected:
+    MakeMeshOperation& operator = (const MakeMeshOperation&) { return *this; }
+};
+}
+
 void IndexMeshVisitor::makeMesh()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        makeMesh(*(*itr));
-    }
+    MakeMeshOperation operation(*this);
+    processGeometries(operation);
 }
 
 namespace
@@ -876,14 +1034,22 @@ void VertexCacheVisitor::doVertexOptimization(Geometry& geom,
      }
 }
 
+namespace
+{
+struct OptimizeVerticesOperation : public GeometryCollector::GeometryOperation
+{
+    OptimizeVerticesOperation(VertexCacheVisitor& visitor) : _visitor(visitor) {}
+    virtual void operator () (osg::Geometry& geom) { _visitor.optimizeVertices(geom); }
+    VertexCacheVisitor& _visitor;
+protected:
+    OptimizeVerticesOperation& operator = (const OptimizeVerticesOperation&) { return *this; }
+};
+}
+
 void VertexCacheVisitor::optimizeVertices()
 {
-    for(GeometryList::iterator itr=_geometryList.begin();
-        itr!=_geometryList.end();
-        ++itr)
-    {
-        optimizeVertices(*(*itr));
-    }
+    OptimizeVerticesOperation operation(*this);
+    processGeometries(operation);
 }
 
 VertexCacheMissVisitor::VertexCacheMissVisitor(unsigned cacheSize)
@@ -1105,14 +1271,22 @@ struct VertexReorder : public TriangleLinePointIndexFunctor<osgUtil::VertexReord
 };
 }
 
+namespace
+{
+struct OptimizeOrderOperation : public GeometryCollector::GeometryOperation
+{
+    OptimizeOrderOperation(VertexAccessOrderVisitor& visitor) : _visitor(visitor) {}
+    virtual void operator () (osg::Geometry& geom) { _visitor.optimizeOrder(geom); }
+    VertexAccessOrderVisitor& _visitor;
+protected:
+    OptimizeOrderOperation& operator = (const OptimizeOrderOperation&) { return *this; }
+};
+}
+
 void VertexAccessOrderVisitor::optimizeOrder()
 {
-    for (GeometryList::iterator itr = _geometryList.begin(), end = _geometryList.end();
-         itr != end;
-         ++itr)
-    {
-        optimizeOrder(*(*itr));
-    }
+    OptimizeOrderOperation operation(*this);
+    processGeometries(operation);
 }
 
 template<typename DE>
@@ -34,6 +34,9 @@
 #include <osg/Timer>
 #include <osg/TexMat>
 #include <osg/io_utils>
+#include <osg/os_utils>
+
+#include <OpenThreads/Thread>
 
 #include <osgUtil/TransformAttributeFunctor>
 #include <osgUtil/Tessellator>
@@ -41,6 +44,7 @@
 #include <osgUtil/MeshOptimizers>
 
 #include <typeinfo>
+#include <ctype.h>
 #include <algorithm>
 #include <numeric>
 #include <sstream>
@@ -49,11 +53,198 @@
 
 using namespace osgUtil;
 
+static osg::ApplicationUsageProxy Optimizer_e2(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER_MERGE_TRIANGLES <value>","Target maximum number of triangles in a batch merged by SPATIAL_MERGE_GEOMETRY.");
+static osg::ApplicationUsageProxy Optimizer_e3(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER_MERGE_EXTENT <value>","Maximum extent of the bounding box of a batch merged by SPATIAL_MERGE_GEOMETRY.");
+static osg::ApplicationUsageProxy Optimizer_e1(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER_THREADS <value>","Number of threads used by the INDEX_MESH, VERTEX_POSTTRANSFORM, VERTEX_PRETRANSFORM and MAKE_FAST_GEOMETRY passes, 0 for one per processor.");
+
+Optimizer::Optimizer():
+    _numThreads(1),
+    _mergeTargetMaximumNumberOfTriangles(0),
+    _mergeMaximumBatchExtent(0.0f)
+{
+    // parse as signed so that negative or malformed values are ignored rather than wrapping to huge thread counts.
+    int numThreads = 0;
+    if (osg::getEnvVar("OSG_OPTIMIZER_THREADS", numThreads))
+    {
+        int maxNumThreads = 4*osg::maximum(OpenThreads::GetNumberOfProcessors(), 1);
+        if (numThreads>=0) _numThreads = osg::minimum(numThreads, maxNumThreads);
+        else OSG_NOTICE<<"Warning: OSG_OPTIMIZER_THREADS value "<<numThreads<<" ignored, must be 0 or more."<<std::endl;
+    }
+
+    int numTriangles = 0;
+    if (osg::getEnvVar("OSG_OPTIMIZER_MERGE_TRIANGLES", numTriangles))
+    {
+        if (numTriangles>=0) _mergeTargetMaximumNumberOfTriangles = numTriangles;
+        else OSG_NOTICE<<"Warning: OSG_OPTIMIZER_MERGE_TRIANGLES value "<<numTriangles<<" ignored, must be 0 or more."<<std::endl;
+    }
+
+    osg::getEnvVar("OSG_OPTIMIZER_MERGE_EXTENT", _mergeMaximumBatchExtent);
+}
+
 void Optimizer::reset()
 {
 }
 
-static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS");
+Optimizer::SceneCounts::SceneCounts():
+    _numGroups(0),
+    _numTransforms(0),
+    _numLODs(0),
+    _numGeodes(0),
+    _numDrawables(0),
+    _numGeometries(0),
+    _numStateSets(0),
+    _numVertices(0),
+    _numPrimitives(0)
+{
+}
+
+void Optimizer::SceneCounts::count(osg::Node* node)
+{
+    StatsVisitor stats;
+    node->accept(stats);
+    stats.totalUpStats();
+
+    _numGroups = stats._groupSet.size();
+    _numTransforms = stats._transformSet.size();
+    _numLODs = stats._lodSet.size();
+    _numGeodes = stats._geodeSet.size();
+    _numDrawables = stats._drawableSet.size();
+    _numGeometries = stats._geometrySet.size();
+    _numStateSets = stats._statesetSet.size();
+    _numVertices = stats._uniqueStats._vertexCount;
+
+    _numPrimitives = 0;
+    const Statistics::PrimitiveCountMap& primitives = stats._uniqueStats.getPrimitiveCountMap();
+    for(Statistics::PrimitiveCountMap::const_iterator itr = primitives.begin();
+        itr != primitives.end();
+        ++itr)
+    {
+        _numPrimitives += itr->second;
+    }
+}
+
+double Optimizer::Stats::getTotalDuration() const
+{
+    double duration = 0.0;
+    for(PassStatsList::const_iterator itr = _passStats.begin();
+        itr != _passStats.end();
+        ++itr)
+    {
+        duration += itr->_duration;
+    }
+    return duration;
+}
+
+void Optimizer::Stats::print(std::ostream& out) const
+{
+    out<<"Optimizer stats, time in seconds followed by the before->after counts:"<<std::endl;
+    for(PassStatsList::const_iterator itr = _passStats.begin();
+        itr != _passStats.end();
+        ++itr)
+    {
+        const PassStats& pass = *itr;
+        out<<"  "<<pass._name<<" "<<pass._duration<<"s"<<std::endl;
+        out<<"      groups "<<pass._before._numGroups<<"->"<<pass._after._numGroups
+           <<", transforms "<<pass._before._numTransforms<<"->"<<pass._after._numTransforms
+           <<", LODs "<<pass._before._numLODs<<"->"<<pass._after._numLODs
+           <<", geodes "<<pass._before._numGeodes<<"->"<<pass._after._numGeodes<<std::endl;
+        out<<"      drawables "<<pass._before._numDrawables<<"->"<<pass._after._numDrawables
+           <<", geometries "<<pass._before._numGeometries<<"->"<<pass._after._numGeometries
+           <<", statesets "<<pass._before._numStateSets<<"->"<<pass._after._numStateSets<<std::endl;
+        out<<"      vertices "<<pass._before._numVertices<<"->"<<pass._after._numVertices
+           <<", primitives "<<pass._before._numPrimitives<<"->"<<pass._after._numPrimitives<<std::endl;
+    }
+    out<<"  total "<<getTotalDuration()<<"s"<<std::endl;
+}
+
+namespace
+{
+// Records the duration and before/after scene counts of a single pass into
+// the Optimizer::Stats, if any, over the lifetime of the PassTimer.
+class PassTimer
+{
+public:
+
+    PassTimer(Optimizer::Stats* stats, const char* name, osg::Node* node):
+        _stats(stats),
+        _node(node),
+        _startTick(0)
+    {
+        if (!_stats) return;
+
+        _pass._name = name;
+
+        // the counts after the previous pass are the counts before this one.
+        Optimizer::Stats::PassStatsList& passes = _stats->getPassStats();
+        if (passes.empty()) _pass._before.count(_node);
+        else _pass._before = passes.back()._after;
+
+        _startTick = osg::Timer::instance()->tick();
+    }
+
+    ~PassTimer()
+    {
+        if (!_stats) return;
+
+        _pass._duration = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
+        _pass._after.count(_node);
+        _stats->getPassStats().push_back(_pass);
+    }
+
+protected:
+
+    PassTimer(const PassTimer&);
+    PassTimer& operator = (const PassTimer&);
+
+    Optimizer::Stats*       _stats;
+    osg::Node*              _node;
+    osg::Timer_t            _startTick;
+    Optimizer::PassStats    _pass;
+};
+
+// Collects the geometries that MAKE_FAST_GEOMETRY needs to fix, checking the
+// permissions on the calling thread so the fixes themselves can run in parallel.
+class MakeFastGeometryCollector : public GeometryCollector
+{
+public:
+
+    MakeFastGeometryCollector(Optimizer* optimizer):
+        GeometryCollector(optimizer, Optimizer::MAKE_FAST_GEOMETRY) {}
+
+    virtual void apply(osg::Geometry& geom)
+    {
+        if (isOperationPermissibleForObject(&geom) && geom.checkForDeprecatedData())
+        {
+            GeometryCollector::apply(geom);
+        }
+    }
+};
+
+struct FixDeprecatedDataOperation : public GeometryCollector::GeometryOperation
+{
+    virtual void operator () (osg::Geometry& geom) { geom.fixDeprecatedData(); }
+};
+}
+
+static osg::ApplicationUsageProxy Optimizer_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_OPTIMIZER \"<type> [<type>]\"","OFF | DEFAULT | FLATTEN_STATIC_TRANSFORMS | FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS | REMOVE_REDUNDANT_NODES | COMBINE_ADJACENT_LODS | SHARE_DUPLICATE_STATE | MERGE_GEOMETRY | MERGE_GEODES | SPATIALIZE_GROUPS  | COPY_SHARED_NODES | OPTIMIZE_TEXTURE_SETTINGS | REMOVE_LOADED_PROXY_NODES | TESSELLATE_GEOMETRY | CHECK_GEOMETRY |  FLATTEN_BILLBOARDS | TEXTURE_ATLAS_BUILDER | STATIC_OBJECT_DETECTION | INDEX_MESH | VERTEX_POSTTRANSFORM | VERTEX_PRETRANSFORM | BUFFER_OBJECT_SETTINGS | SPATIAL_MERGE_GEOMETRY");
+
+namespace
+{
+
+// match whole option names, so that SPATIAL_MERGE_GEOMETRY doesn't also select MERGE_GEOMETRY.
+bool containsOption(const std::string& str, const std::string& option)
+{
+    for(std::string::size_type pos = str.find(option); pos != std::string::npos; pos = str.find(option, pos+1))
+    {
+        std::string::size_type end = pos+option.size();
+        bool validStart = pos==0 || !(isalnum(str[pos-1]) || str[pos-1]=='_');
+        bool validEnd = end==str.size() || !(isalnum(str[end]) || str[end]=='_');
+        if (validStart && validEnd) return true;
+    }
+    return false;
+}
+
+}
 
 void Optimizer::optimize(osg::Node* node)
 {
@@ -65,73 +256,76 @@ void Optimizer::optimize(osg::Node* node)
     {
         std::string str(env);
 
-        if(str.find("OFF")!=std::string::npos) options = 0;
+        if(containsOption(str, "OFF")) options = 0;
+
+        if(containsOption(str, "~DEFAULT")) options ^= DEFAULT_OPTIMIZATIONS;
+        else if(containsOption(str, "DEFAULT")) options |= DEFAULT_OPTIMIZATIONS;
 
-        if(str.find("~DEFAULT")!=std::string::npos) options ^= DEFAULT_OPTIMIZATIONS;
-        else if(str.find("DEFAULT")!=std::string::npos) options |= DEFAULT_OPTIMIZATIONS;
+        if(containsOption(str, "~FLATTEN_STATIC_TRANSFORMS")) options ^= FLATTEN_STATIC_TRANSFORMS;
+        else if(containsOption(str, "FLATTEN_STATIC_TRANSFORMS")) options |= FLATTEN_STATIC_TRANSFORMS;
 
-        if(str.find("~FLATTEN_STATIC_TRANSFORMS")!=std::string::npos) options ^= FLATTEN_STATIC_TRANSFORMS;
-        else if(str.find("FLATTEN_STATIC_TRANSFORMS")!=std::string::npos) options |= FLATTEN_STATIC_TRANSFORMS;
+        if(containsOption(str, "~FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS")) options ^= FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS;
+        else if(containsOption(str, "FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS")) options |= FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS;
 
-        if(str.find("~FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS")!=std::string::npos) options ^= FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS;
-        else if(str.find("FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS")!=std::string::npos) options |= FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS;
+        if(containsOption(str, "~REMOVE_REDUNDANT_NODES")) options ^= REMOVE_REDUNDANT_NODES;
+        else if(containsOption(str, "REMOVE_REDUNDANT_NODES")) options |= REMOVE_REDUNDANT_NODES;
 
-        if(str.find("~REMOVE_REDUNDANT_NODES")!=std::string::npos) options ^= REMOVE_REDUNDANT_NODES;
-        else if(str.find("REMOVE_REDUNDANT_NODES")!=std::string::npos) options |= REMOVE_REDUNDANT_NODES;
+        if(containsOption(str, "~REMOVE_LOADED_PROXY_NODES")) options ^= REMOVE_LOADED_PROXY_NODES;
+        else if(containsOption(str, "REMOVE_LOADED_PROXY_NODES")) options |= REMOVE_LOADED_PROXY_NODES;
 
-        if(str.find("~REMOVE_LOADED_PROXY_NODES")!=std::string::npos) options ^= REMOVE_LOADED_PROXY_NODES;
-        else if(str.find("REMOVE_LOADED_PROXY_NODES")!=std::string::npos) options |= REMOVE_LOADED_PROXY_NODES;
+        if(containsOption(str, "~COMBINE_ADJACENT_LODS")) options ^= COMBINE_ADJACENT_LODS;
+        else if(containsOption(str, "COMBINE_ADJACENT_LODS")) options |= COMBINE_ADJACENT_LODS;
 
-        if(str.find("~COMBINE_ADJACENT_LODS")!=std::string::npos) options ^= COMBINE_ADJACENT_LODS;
-        else if(str.find("COMBINE_ADJACENT_LODS")!=std::string::npos) options |= COMBINE_ADJACENT_LODS;
+        if(containsOption(str, "~SHARE_DUPLICATE_STATE")) options ^= SHARE_DUPLICATE_STATE;
+        else if(containsOption(str, "SHARE_DUPLICATE_STATE")) options |= SHARE_DUPLICATE_STATE;
 
-        if(str.find("~SHARE_DUPLICATE_STATE")!=std::string::npos) options ^= SHARE_DUPLICATE_STATE;
-        else if(str.find("SHARE_DUPLICATE_STATE")!=std::string::npos) options |= SHARE_DUPLICATE_STATE;
+        if(containsOption(str, "~MERGE_GEODES")) options ^= MERGE_GEODES;
+        else if(containsOption(str, "MERGE_GEODES")) options |= MERGE_GEODES;
 
-        if(str.find("~MERGE_GEODES")!=std::string::npos) options ^= MERGE_GEODES;
-        else if(str.find("MERGE_GEODES")!=std::string::npos) options |= MERGE_GEODES;
+        if(containsOption(str, "~MERGE_GEOMETRY")) options ^= MERGE_GEOMETRY;
+        else if(containsOption(str, "MERGE_GEOMETRY")) options |= MERGE_GEOMETRY;
 
-        if(str.find("~MERGE_GEOMETRY")!=std::string::npos) options ^= MERGE_GEOMETRY;
-        else if(str.find("MERGE_GEOMETRY")!=std::string::npos) options |= MERGE_GEOMETRY;
+        if(containsOption(str, "~SPATIAL_MERGE_GEOMETRY")) options &= ~SPATIAL_MERGE_GEOMETRY;
+        else if(containsOption(str, "SPATIAL_MERGE_GEOMETRY")) options |= SPATIAL_MERGE_GEOMETRY;
 
-        if(str.find("~SPATIALIZE_GROUPS")!=std::string::npos) options ^= SPATIALIZE_GROUPS;
-        else if(str.find("SPATIALIZE_GROUPS")!=std::string::npos) options |= SPATIALIZE_GROUPS;
+        if(containsOption(str, "~SPATIALIZE_GROUPS")) options ^= SPATIALIZE_GROUPS;
+        else if(containsOption(str, "SPATIALIZE_GROUPS")) options |= SPATIALIZE_GROUPS;
 
-        if(str.find("~COPY_SHARED_NODES")!=std::string::npos) options ^= COPY_SHARED_NODES;
-        else if(str.find("COPY_SHARED_NODES")!=std::string::npos) options |= COPY_SHARED_NODES;
+        if(containsOption(str, "~COPY_SHARED_NODES")) options ^= COPY_SHARED_NODES;
+        else if(containsOption(str, "COPY_SHARED_NODES")) options |= COPY_SHARED_NODES;
 
-        if(str.find("~TESSELLATE_GEOMETRY")!=std::string::npos) options ^= TESSELLATE_GEOMETRY;
-        else if(str.find("TESSELLATE_GEOMETRY")!=std::string::npos) options |= TESSELLATE_GEOMETRY;
+        if(containsOption(str, "~TESSELLATE_GEOMETRY")) options ^= TESSELLATE_GEOMETRY;
+        else if(containsOption(str, "TESSELLATE_GEOMETRY")) options |= TESSELLATE_GEOMETRY;
 
-        if(str.find("~OPTIMIZE_TEXTURE_SETTINGS")!=std::string::npos) options ^= OPTIMIZE_TEXTURE_SETTINGS;
-        else if(str.find("OPTIMIZE_TEXTURE_SETTINGS")!=std::string::npos) options |= OPTIMIZE_TEXTURE_SETTINGS;
+        if(containsOption(str, "~OPTIMIZE_TEXTURE_SETTINGS")) options ^= OPTIMIZE_TEXTURE_SETTINGS;
+        else if(containsOption(str, "OPTIMIZE_TEXTURE_SETTINGS")) options |= OPTIMIZE_TEXTURE_SETTINGS;
 
-        if(str.find("~CHECK_GEOMETRY")!=std::string::npos) options ^= CHECK_GEOMETRY;
-        else if(str.find("CHECK_GEOMETRY")!=std::string::npos) options |= CHECK_GEOMETRY;
+        if(containsOption(str, "~CHECK_GEOMETRY")) options ^= CHECK_GEOMETRY;
+        else if(containsOption(str, "CHECK_GEOMETRY")) options |= CHECK_GEOMETRY;
 
-        if(str.find("~MAKE_FAST_GEOMETRY")!=std::string::npos) options ^= MAKE_FAST_GEOMETRY;
-        else if(str.find("MAKE_FAST_GEOMETRY")!=std::string::npos) options |= MAKE_FAST_GEOMETRY;
+        if(containsOption(str, "~MAKE_FAST_GEOMETRY")) options ^= MAKE_FAST_GEOMETRY;
+        else if(containsOption(str, "MAKE_FAST_GEOMETRY")) options |= MAKE_FAST_GEOMETRY;
 
-        if(str.find("~FLATTEN_BILLBOARDS")!=std::string::npos) options ^= FLATTEN_BILLBOARDS;
-        else if(str.find("FLATTEN_BILLBOARDS")!=std::string::npos) options |= FLATTEN_BILLBOARDS;
+        if(containsOption(str, "~FLATTEN_BILLBOARDS")) options ^= FLATTEN_BILLBOARDS;
+        else if(containsOption(str, "FLATTEN_BILLBOARDS")) options |= FLATTEN_BILLBOARDS;
 
-        if(str.find("~TEXTURE_ATLAS_BUILDER")!=std::string::npos) options ^= TEXTURE_ATLAS_BUILDER;
-        else if(str.find("TEXTURE_ATLAS_BUILDER")!=std::string::npos) options |= TEXTURE_ATLAS_BUILDER;
+        if(containsOption(str, "~TEXTURE_ATLAS_BUILDER")) options ^= TEXTURE_ATLAS_BUILDER;
+        else if(containsOption(str, "TEXTURE_ATLAS_BUILDER")) options |= TEXTURE_ATLAS_BUILDER;
 
-        if(str.find("~STATIC_OBJECT_DETECTION")!=std::string::npos) options ^= STATIC_OBJECT_DETECTION;
-        else if(str.find("STATIC_OBJECT_DETECTION")!=std::string::npos) options |= STATIC_OBJECT_DETECTION;
+        if(containsOption(str, "~STATIC_OBJECT_DETECTION")) options ^= STATIC_OBJECT_DETECTION;
+        else if(containsOption(str, "STATIC_OBJECT_DETECTION")) options |= STATIC_OBJECT_DETECTION;
 
-        if(str.find("~INDEX_MESH")!=std::string::npos) options ^= INDEX_MESH;
-        else if(str.find("INDEX_MESH")!=std::string::npos) options |= INDEX_MESH;
+        if(containsOption(str, "~INDEX_MESH")) options ^= INDEX_MESH;
+        else if(containsOption(str, "INDEX_MESH")) options |= INDEX_MESH;
 
-        if(str.find("~VERTEX_POSTTRANSFORM")!=std::string::npos) options ^= VERTEX_POSTTRANSFORM;
-        else if(str.find("VERTEX_POSTTRANSFORM")!=std::string::npos) options |= VERTEX_POSTTRANSFORM;
+        if(containsOption(str, "~VERTEX_POSTTRANSFORM")) options ^= VERTEX_POSTTRANSFORM;
+        else if(containsOption(str, "VERTEX_POSTTRANSFORM")) options |= VERTEX_POSTTRANSFORM;
 
-        if(str.find("~VERTEX_PRETRANSFORM")!=std::string::npos) options ^= VERTEX_PRETRANSFORM;
-        else if(str.find("VERTEX_PRETRANSFORM")!=std::string::npos) options |= VERTEX_PRETRANSFORM;
+        if(containsOption(str, "~VERTEX_PRETRANSFORM")) options ^= VERTEX_PRETRANSFORM;
+        else if(containsOption(str, "VERTEX_PRETRANSFORM")) options |= VERTEX_PRETRANSFORM;
 
-        if(str.find("~BUFFER_OBJECT_SETTINGS")!=std::string::npos) options ^= BUFFER_OBJECT_SETTINGS;
-        else if(str.find("BUFFER_OBJECT_SETTINGS")!=std::string::npos) options |= BUFFER_OBJECT_SETTINGS;
+        if(containsOption(str, "~BUFFER_OBJECT_SETTINGS")) options ^= BUFFER_OBJECT_SETTINGS;
+        else if(containsOption(str, "BUFFER_OBJECT_SETTINGS")) options |= BUFFER_OBJECT_SETTINGS;
     }
     else
     {
@@ -144,6 +338,8 @@ void Optimizer::optimize(osg::Node* node)
 
 void Optimizer::optimize(osg::Node* node, unsigned int options)
 {
+    _mergeStats = MergeStats();
+
     StatsVisitor stats;
 
     if (osg::getNotifyLevel()>=osg::INFO)
@@ -156,12 +352,16 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & STATIC_OBJECT_DETECTION)
     {
+        PassTimer passTimer(_stats.get(), "STATIC_OBJECT_DETECTION", node);
+
         StaticObjectDetectionVisitor sodv;
         node->accept(sodv);
     }
 
     if (options & TESSELLATE_GEOMETRY)
     {
+        PassTimer passTimer(_stats.get(), "TESSELLATE_GEOMETRY", node);
+
         OSG_INFO<<"Optimizer::optimize() doing TESSELLATE_GEOMETRY"<<std::endl;
 
         TessellateVisitor tsv;
@@ -170,6 +370,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & REMOVE_LOADED_PROXY_NODES)
     {
+        PassTimer passTimer(_stats.get(), "REMOVE_LOADED_PROXY_NODES", node);
+
         OSG_INFO<<"Optimizer::optimize() doing REMOVE_LOADED_PROXY_NODES"<<std::endl;
 
         RemoveLoadedProxyNodesVisitor rlpnv(this);
@@ -180,6 +382,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & COMBINE_ADJACENT_LODS)
     {
+        PassTimer passTimer(_stats.get(), "COMBINE_ADJACENT_LODS", node);
+
         OSG_INFO<<"Optimizer::optimize() doing COMBINE_ADJACENT_LODS"<<std::endl;
 
         CombineLODsVisitor clv(this);
@@ -189,6 +393,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & OPTIMIZE_TEXTURE_SETTINGS)
     {
+        PassTimer passTimer(_stats.get(), "OPTIMIZE_TEXTURE_SETTINGS", node);
+
         OSG_INFO<<"Optimizer::optimize() doing OPTIMIZE_TEXTURE_SETTINGS"<<std::endl;
 
         TextureVisitor tv(true,true, // unref image
@@ -200,6 +406,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & SHARE_DUPLICATE_STATE)
     {
+        PassTimer passTimer(_stats.get(), "SHARE_DUPLICATE_STATE", node);
+
         OSG_INFO<<"Optimizer::optimize() doing SHARE_DUPLICATE_STATE"<<std::endl;
 
         bool combineDynamicState = false;
@@ -213,6 +421,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & TEXTURE_ATLAS_BUILDER)
     {
+        PassTimer passTimer(_stats.get(), "TEXTURE_ATLAS_BUILDER", node);
+
         OSG_INFO<<"Optimizer::optimize() doing TEXTURE_ATLAS_BUILDER"<<std::endl;
 
         // traverse the scene collecting textures into texture atlas.
@@ -232,6 +442,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & COPY_SHARED_NODES)
     {
+        PassTimer passTimer(_stats.get(), "COPY_SHARED_NODES", node);
+
         OSG_INFO<<"Optimizer::optimize() doing COPY_SHARED_NODES"<<std::endl;
 
         CopySharedSubgraphsVisitor cssv(this);
@@ -241,6 +453,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & FLATTEN_STATIC_TRANSFORMS)
     {
+        PassTimer passTimer(_stats.get(), "FLATTEN_STATIC_TRANSFORMS", node);
+
         OSG_INFO<<"Optimizer::optimize() doing FLATTEN_STATIC_TRANSFORMS"<<std::endl;
 
         int i=0;
@@ -262,6 +476,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS)
     {
+        PassTimer passTimer(_stats.get(), "FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS", node);
+
         OSG_INFO<<"Optimizer::optimize() doing FLATTEN_STATIC_TRANSFORMS_DUPLICATING_SHARED_SUBGRAPHS"<<std::endl;
 
         // now combine any adjacent static transforms.
@@ -272,6 +488,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & REMOVE_REDUNDANT_NODES)
     {
+        PassTimer passTimer(_stats.get(), "REMOVE_REDUNDANT_NODES", node);
+
         OSG_INFO<<"Optimizer::optimize() doing REMOVE_REDUNDANT_NODES"<<std::endl;
 
         RemoveEmptyNodesVisitor renv(this);
@@ -286,6 +504,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & MERGE_GEODES)
     {
+        PassTimer passTimer(_stats.get(), "MERGE_GEODES", node);
+
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEODES"<<std::endl;
 
         osg::Timer_t startTick = osg::Timer::instance()->tick();
@@ -300,30 +520,56 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & MAKE_FAST_GEOMETRY)
     {
+        PassTimer passTimer(_stats.get(), "MAKE_FAST_GEOMETRY", node);
+
         OSG_INFO<<"Optimizer::optimize() doing MAKE_FAST_GEOMETRY"<<std::endl;
 
-        MakeFastGeometryVisitor mgv(this);
-        node->accept(mgv);
+        if (_numThreads==1)
+        {
+            MakeFastGeometryVisitor mgv(this);
+            node->accept(mgv);
+        }
+        else
+        {
+            MakeFastGeometryCollector mfgc(this);
+            node->accept(mfgc);
+
+            FixDeprecatedDataOperation operation;
+            mfgc.processGeometries(operation);
+        }
     }
 
-    if (options & MERGE_GEOMETRY)
+    if (options & (MERGE_GEOMETRY|SPATIAL_MERGE_GEOMETRY))
     {
+        PassTimer passTimer(_stats.get(), "MERGE_GEOMETRY", node);
+
         OSG_INFO<<"Optimizer::optimize() doing MERGE_GEOMETRY"<<std::endl;
 
         osg::Timer_t startTick = osg::Timer::instance()->tick();
 
         MergeGeometryVisitor mgv(this);
         mgv.setTargetMaximumNumberOfVertices(10000);
+        mgv.setSpatialMerge((options & SPATIAL_MERGE_GEOMETRY)!=0);
+        mgv.setTargetMaximumNumberOfTriangles(_mergeTargetMaximumNumberOfTriangles);
+        mgv.setMaximumBatchExtent(_mergeMaximumBatchExtent);
+
         node->accept(mgv);
 
         osg::Timer_t endTick = osg::Timer::instance()->tick();
 
+        _mergeStats = mgv.getMergeStats();
+        OSG_INFO<<"MERGE_GEOMETRY merged "<<_mergeStats._numGeometriesBefore<<" geometries into "<<_mergeStats._numGeometriesAfter
+                <<", draw call reduction "<<_mergeStats.getDrawCallReduction()
+                <<", cull efficiency "<<_mergeStats.getCullEfficiency()<<std::endl;
+
         OSG_INFO<<"MERGE_GEOMETRY took "<<osg::Timer::instance()->delta_s(startTick,endTick)<<std::endl;
     }
 
 
     if (options & FLATTEN_BILLBOARDS)
     {
+        PassTimer passTimer(_stats.get(), "FLATTEN_BILLBOARDS", node);
+
         FlattenBillboardVisitor fbv(this);
         node->accept(fbv);
         fbv.process();
@@ -331,6 +577,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & SPATIALIZE_GROUPS)
     {
+        PassTimer passTimer(_stats.get(), "SPATIALIZE_GROUPS", node);
+
         OSG_INFO<<"Optimizer::optimize() doing SPATIALIZE_GROUPS"<<std::endl;
 
         SpatializeGroupsVisitor sv(this);
@@ -340,6 +588,8 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & INDEX_MESH)
     {
+        PassTimer passTimer(_stats.get(), "INDEX_MESH", node);
+
         OSG_INFO<<"Optimizer::optimize() doing INDEX_MESH"<<std::endl;
         IndexMeshVisitor imv(this);
         node->accept(imv);
@@ -348,22 +598,28 @@ void Optimizer::optimize(osg::Node* node, unsigned int options)
 
     if (options & VERTEX_POSTTRANSFORM)
     {
+        PassTimer passTimer(_stats.get(), "VERTEX_POSTTRANSFORM", node);
+
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_POSTTRANSFORM"<<std::endl;
-        VertexCacheVisitor vcv;
+        VertexCacheVisitor vcv(this);
         node->accept(vcv);
         vcv.optimizeVertices();
     }
 
     if (options & VERTEX_PRETRANSFORM)
     {
+        PassTimer passTimer(_stats.get(), "VERTEX_PRETRANSFORM", node);
+
         OSG_INFO<<"Optimizer::optimize() doing VERTEX_PRETRANSFORM"<<std::endl;
-        VertexAccessOrderVisitor vaov;
+        VertexAccessOrderVisitor vaov(this);
         node->accept(vaov);
         vaov.optimizeOrder();
     }
 
     if (options & BUFFER_OBJECT_SETTINGS)
     {
+        PassTimer passTimer(_stats.get(), "BUFFER_OBJECT_SETTINGS", node);
+
         OSG_INFO<<"Optimizer::optimize() doing BUFFER_OBJECT_SETTINGS"<<std::endl;
         BufferObjectVisitor bov(true, true, true, true, true, false);
         node->accept(bov);
@@ -394,15 +650,43 @@ void Optimizer::TessellateVisitor::apply(osg::Geometry &geom)
 // Optimize State Visitor
 ////////////////////////////////////////////////////////////////////////////
 
+// Orders objects by their content hash first, so the deep compare is only
+// needed between objects whose hashes collide.
 template<typename T>
-struct LessDerefFunctor
+struct LessHashThenDerefFunctor
 {
-    bool operator () (const T* lhs,const T* rhs) const
+    typedef std::pair<unsigned int, T*> HashedObject;
+
+    bool operator () (const HashedObject& lhs, const HashedObject& rhs) const
     {
-        return (*lhs<*rhs);
+        if (lhs.first<rhs.first) return true;
+        if (rhs.first<lhs.first) return false;
+        return (*lhs.second<*rhs.second);
     }
 };
 
+// Sort the objects so that equal objects sit along side each other.
+template<typename T>
+void sortByHashThenContents(std::vector<T*>& objects)
+{
+    typedef std::pair<unsigned int, T*> HashedObject;
+    std::vector<HashedObject> hashedObjects;
+    hashedObjects.reserve(objects.size());
+    for(typename std::vector<T*>::iterator itr = objects.begin();
+        itr != objects.end();
+        ++itr)
+    {
+        hashedObjects.push_back(HashedObject((*itr)->computeHash(), *itr));
+    }
+
+    std::sort(hashedObjects.begin(), hashedObjects.end(), LessHashThenDerefFunctor<T>());
+
+    for(unsigned int i=0; i<hashedObjects.size(); ++i)
+    {
+        objects[i] = hashedObjects[i].second;
+    }
+}
+
 struct LessStateSetFunctor
 {
     bool operator () (const osg::StateSet* lhs,const osg::StateSet* rhs) const
@@ -520,7 +804,7 @@ void Optimizer::StateVisitor::optimize()
 
             // sort the attributes so that equal attributes sit along side each
             // other.
-            std::sort(attributeList.begin(),attributeList.end(),LessDerefFunctor<osg::StateAttribute>());
+            sortByHashThenContents(attributeList);
 
             OSG_INFO << "state attribute list"<< std::endl;
             for(AttributeList::iterator aaitr = attributeList.begin();
@@ -572,7 +856,7 @@ void Optimizer::StateVisitor::optimize()
 
             // sort the uniforms so that equal uniforms sit along side each
             // other.
-            std::sort(uniformList.begin(),uniformList.end(),LessDerefFunctor<osg::UniformBase>());
+            sortByHashThenContents(uniformList);
 
             OSG_INFO << "state uniform list"<< std::endl;
             for(UniformList::iterator uuitr = uniformList.begin();
@@ -625,7 +909,7 @@ void Optimizer::StateVisitor::optimize()
 
         // sort the StateSet's so that equal StateSet's sit along side each
         // other.
-        std::sort(statesetSortList.begin(),statesetSortList.end(),LessDerefFunctor<osg::StateSet>());
+        sortByHashThenContents(statesetSortList);
 
         OSG_INFO << "searching for duplicate attributes"<< std::endl;
         // find the duplicates.
@@ -1773,6 +2057,172 @@ bool isAbleToMerge(const osg::Geometry& g1, const osg::Geometry& g2)
     return true;
 }
 
+namespace
+{
+typedef std::vector< osg::ref_ptr<osg::Geometry> > GeometryBatch;
+typedef std::vector< GeometryBatch > GeometryBatches;
+
+/// Estimate the number of triangles a geometry renders, without visiting its indices.
+unsigned int estimateNumTriangles(const osg::Geometry& geom)
+{
+    unsigned int numTriangles = 0;
+    for(unsigned int i=0; i<geom.getNumPrimitiveSets(); ++i)
+    {
+        const osg::PrimitiveSet* primitiveSet = geom.getPrimitiveSet(i);
+        unsigned int numIndices = primitiveSet->getNumIndices();
+        switch(primitiveSet->getMode())
+        {
+            case(osg::PrimitiveSet::TRIANGLES): numTriangles += numIndices/3; break;
+            case(osg::PrimitiveSet::QUADS): numTriangles += (numIndices/4)*2; break;
+            case(osg::PrimitiveSet::TRIANGLE_STRIP):
+            case(osg::PrimitiveSet::TRIANGLE_FAN):
+            case(osg::PrimitiveSet::QUAD_STRIP):
+            case(osg::PrimitiveSet::POLYGON):
+            {
+                // each strip, fan or polygon loses two indices to the first triangle.
+                unsigned int numPrimitives = primitiveSet->getNumPrimitives();
+                if (numIndices>2*numPrimitives) numTriangles += numIndices-2*numPrimitives;
+                break;
+            }
+            default: break;
+        }
+    }
+    return numTriangles;
+}
+
+struct SpatialMergeCandidate
+{
+    SpatialMergeCandidate(osg::Geometry* geometry):
+        _geometry(geometry),
+        _bb(geometry->getBoundingBox()),
+        _numVertices(geometry->getVertexArray() ? geometry->getVertexArray()->getNumElements() : 0),
+        _numTriangles(estimateNumTriangles(*geometry)) {}
+
+    osg::ref_ptr<osg::Geometry> _geometry;
+    osg::BoundingBox            _bb;
+    unsigned int                _numVertices;
+    unsigned int                _numTriangles;
+};
+
+typedef std::vector<SpatialMergeCandidate> SpatialMergeCandidates;
+
+struct LessCandidateCenter
+{
+    LessCandidateCenter(unsigned int axis) : _axis(axis) {}
+
+    bool operator() (const SpatialMergeCandidate& lhs, const SpatialMergeCandidate& rhs) const
+    {
+        return lhs._bb.center()[_axis]<rhs._bb.center()[_axis];
+    }
+
+    unsigned int _axis;
+};
+
+struct SpatialMergeLimits
+{
+    unsigned int _maxNumVertices;
+    unsigned int _maxNumTriangles;
+    float _maxExtent;
+};
+
+/// Recursively divide candidates [begin,end) at the median of their centers along the longest axis, until each range fits the limits.
+void divideSpatially(SpatialMergeCandidates& candidates, unsigned int begin, unsigned int end, const SpatialMergeLimits& limits, GeometryBatches& batches)
+{
+    unsigned int numVertices = 0;
+    unsigned int numTriangles = 0;
+    osg::BoundingBox bb;
+    osg::BoundingBox centers;
+    for(unsigned int i=begin; i<end; ++i)
+    {
+        numVertices += candidates[i]._numVertices;
+        numTriangles += candidates[i]._numTriangles;
+        bb.expandBy(candidates[i]._bb);
+        centers.expandBy(candidates[i]._bb.center());
+    }
+
+    float extent = bb.valid() ? osg::maximum(bb.xMax()-bb.xMin(), osg::maximum(bb.yMax()-bb.yMin(), bb.zMax()-bb.zMin())) : 0.0f;
+
+    bool fits = (end-begin==1) ||
+                ((limits._maxNumVertices==0 || numVertices<=limits._maxNumVertices) &&
+                 (limits._maxNumTriangles==0 || numTriangles<=limits._maxNumTriangles) &&
+                 (limits._maxExtent<=0.0f || extent<=limits._maxExtent));
+
+    if (fits)
+    {
+        batches.push_back(GeometryBatch());
+        GeometryBatch& batch = batches.back();
+        batch.reserve(end-begin);
+        for(unsigned int i=begin; i<end; ++i) batch.push_back(candidates[i]._geometry);
+        return;
+    }
+
+    unsigned int axis = 0;
+    if (centers.valid())
+    {
+        osg::Vec3 size = centers._max-centers._min;
+        if (size.y()>size[axis]) axis = 1;
+        if (size.z()>size[axis]) axis = 2;
+    }
+
+    unsigned int mid = (begin+end)/2;
+    std::nth_element(candidates.begin()+begin, candidates.begin()+mid, candidates.begin()+end, LessCandidateCenter(axis));
+
+    divideSpatially(candidates, begin, mid, limits, batches);
+    divideSpatially(candidates, mid, end, limits, batches);
+}
+
+inline double boundVolume(const osg::BoundingBox& bb)
+{
+    // the 4/3 pi of the sphere volume cancels out of the MergeStats ratio.
+    if (!bb.valid()) return 0.0;
+    double radius = bb.radius();
+    return radius*radius*radius;
+}
+
+/// Reserve the lhs arrays for everything to be appended, so each merge appends without reallocating.
+void reserveArraysForMerge(osg::Geometry& lhs, const GeometryBatch& batch)
+{
+    osg::Geometry::ArrayList lhsArrays;
+    lhs.getArrayList(lhsArrays);
+
+    unsigned int totalNumVertices = 0;
+    for(GeometryBatch::const_iterator itr = batch.begin();
+        itr != batch.end();
+        ++itr)
+    {
+        if ((*itr)->getVertexArray()) totalNumVertices += (*itr)->getVertexArray()->getNumElements();
+    }
+
+    // mergeGeometry() only appends arrays with per vertex data, which isAbleToMerge() has checked match in size.
+    for(osg::Geometry::ArrayList::iterator itr = lhsArrays.begin();
+        itr != lhsArrays.end();
+        ++itr)
+    {
+        if (itr->valid() &&
+            (*itr)->getBinding()!=osg::Array::BIND_OVERALL &&
+            (*itr)->getNumElements()==getSize(lhs.getVertexArray()))
+        {
+            (*itr)->reserveArray(totalNumVertices);
+        }
+    }
+}
+
+/// Release the arrays and primitives of a geometry that has been merged and is no longer in the scene graph.
+void releaseMergedGeometry(osg::Geometry& geom)
+{
+    if (geom.getNumParents()>0) return;
+
+    geom.setVertexArray(0);
+    geom.setNormalArray(0);
+    geom.setColorArray(0);
+    geom.setSecondaryColorArray(0);
+    geom.setFogCoordArray(0);
+    geom.setTexCoordArrayList(osg::Geometry::ArrayList());
+    geom.setVertexAttribArrayList(osg::Geometry::ArrayList());
+    geom.setPrimitiveSetList(osg::Geometry::PrimitiveSetList());
+}
+}
+
 bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
 {
     if (!isOperationPermissibleForObject(&group)) return false;
@@ -1889,6 +2339,31 @@ bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
                 continue;
             }
 
+            if (_spatialMerge)
+            {
+                SpatialMergeCandidates candidates;
+                candidates.reserve(duplicateList.size());
+                for(DuplicateList::iterator ditr = duplicateList.begin();
+                    ditr != duplicateList.end();
+                    ++ditr)
+                {
+                    candidates.push_back(SpatialMergeCandidate(ditr->get()));
+                }
+
+                SpatialMergeLimits limits;
+                limits._maxNumVertices = _targetMaximumNumberOfVertices;
+                limits._maxNumTriangles = _targetMaximumNumberOfTriangles;
+                limits._maxExtent = _maximumBatchExtent;
+
+                unsigned int firstBatch = mergeList.size();
+                divideSpatially(candidates, 0, candidates.size(), limits, mergeList);
+                for(unsigned int b=firstBatch; b<mergeList.size(); ++b)
+                {
+                    if (mergeList[b].size()>1) needToDoMerge = true;
+                }
+                continue;
+            }
+
             unsigned int totalNumberVertices = 0;
             DuplicateList subset;
             for(DuplicateList::iterator ditr = duplicateList.begin();
@@ -1931,15 +2406,32 @@ bool Optimizer::MergeGeometryVisitor::mergeGroup(osg::Group& group)
                 DuplicateList& duplicateList = *mitr;
                 if (!duplicateList.empty())
                 {
+                    osg::BoundingBox batchBound;
+                    for(DuplicateList::iterator ditr = duplicateList.begin();
+                        ditr != duplicateList.end();
+                        ++ditr)
+                    {
+                        _mergeStats._boundVolumeBefore += boundVolume((*ditr)->getBoundingBox());
+                        batchBound.expandBy((*ditr)->getBoundingBox());
+                    }
+                    _mergeStats._numGeometriesBefore += duplicateList.size();
+                    _mergeStats._numGeometriesAfter += 1;
+                    _mergeStats._boundVolumeAfter += boundVolume(batchBound);
+
                     DuplicateList::iterator ditr = duplicateList.begin();
                     osg::ref_ptr<osg::Geometry> lhs = *ditr++;
                     group.addChild(lhs.get());
 
+                    if (duplicateList.size()>1) reserveArraysForMerge(*lhs, duplicateList);
+
                     for(;
                         ditr != duplicateList.end();
                         ++ditr)
                     {
                         mergeGeometry(*lhs, **ditr);
+
+                        // in the bounded memory spatial mode free the merged geometry's data now rather than holding it until the whole group is done.
+                        if (_spatialMerge) releaseMergedGeometry(**ditr);
                     }
                 }
             }
@@ -585,3 +585,28 @@ void PolytopeIntersector::reset()
     _intersections.clear();
 }
 
+Intersector* PolytopeIntersector::cloneForParallelTraversal()
+{
+    osg::ref_ptr<PolytopeIntersector> pi = new PolytopeIntersector(_coordinateFrame, _polytope);
+    pi->_intersectionLimit = this->_intersectionLimit;
+    pi->_disabledCount = this->_disabledCount;
+    pi->_primitiveMask = this->_primitiveMask;
+    pi->_referencePlane = this->_referencePlane;
+    pi->setPrecisionHint(getPrecisionHint());
+    return pi.release();
+}
+
+void PolytopeIntersector::mergeParallelTraversal(Intersector* intersector)
+{
+    PolytopeIntersector* pi = dynamic_cast<PolytopeIntersector*>(intersector);
+    if (!pi) return;
+
+    Intersections& intersections = pi->getIntersections();
+    for(Intersections::iterator itr = intersections.begin();
+        itr != intersections.end() && !reachedLimit();
+        ++itr)
+    {
+        insertIntersection(*itr);
+    }
+}
+
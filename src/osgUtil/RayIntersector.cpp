@@ -101,6 +101,28 @@ void RayIntersector::reset()
     _intersections.clear();
 }
 
+Intersector* RayIntersector::cloneForParallelTraversal()
+{
+    osg::ref_ptr<RayIntersector> ri = new RayIntersector(_coordinateFrame, _start, _direction, NULL, _intersectionLimit);
+    ri->_disabledCount = _disabledCount;
+    ri->setPrecisionHint(getPrecisionHint());
+    return ri.release();
+}
+
+void RayIntersector::mergeParallelTraversal(Intersector* intersector)
+{
+    RayIntersector* ri = dynamic_cast<RayIntersector*>(intersector);
+    if (!ri) return;
+
+    Intersections& intersections = ri->getIntersections();
+    for(Intersections::iterator itr = intersections.begin();
+        itr != intersections.end() && !reachedLimit();
+        ++itr)
+    {
+        insertIntersection(*itr);
+    }
+}
+
 void RayIntersector::intersect(IntersectionVisitor& iv, Drawable* drawable)
 {
     // did we reached what we wanted as specified by setIntersectionLimit()?
@@ -38,6 +38,8 @@ class RenderBinPrototypeList : osg::depends_on<OpenThreads::Mutex*, osg::Referen
             add("SORT_BACK_TO_FRONT",new RenderBin(RenderBin::SORT_BACK_TO_FRONT));
             add("SORT_FRONT_TO_BACK",new RenderBin(RenderBin::SORT_FRONT_TO_BACK));
             add("TraversalOrderBin",new RenderBin(RenderBin::TRAVERSAL_ORDER));
+            add("RADIX_SORT_BACK_TO_FRONT",new RenderBin(RenderBin::RADIX_SORT_BACK_TO_FRONT));
+            add("RADIX_SORT_FRONT_TO_BACK",new RenderBin(RenderBin::RADIX_SORT_FRONT_TO_BACK));
         }
 
         void add(const std::string& name, RenderBin* bin)
@@ -113,7 +115,7 @@ void RenderBin::removeRenderBinPrototype(RenderBin* proto)
 
 static bool s_defaultBinSortModeInitialized = false;
 static RenderBin::SortMode s_defaultBinSortMode = RenderBin::SORT_BY_STATE;
-static osg::ApplicationUsageProxy RenderBin_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_SORT_MODE <type>","SORT_BY_STATE | SORT_BY_STATE_THEN_FRONT_TO_BACK | SORT_FRONT_TO_BACK | SORT_BACK_TO_FRONT");
+static osg::ApplicationUsageProxy RenderBin_e0(osg::ApplicationUsage::ENVIRONMENTAL_VARIABLE,"OSG_DEFAULT_BIN_SORT_MODE <type>","SORT_BY_STATE | SORT_BY_STATE_THEN_FRONT_TO_BACK | SORT_FRONT_TO_BACK | SORT_BACK_TO_FRONT | RADIX_SORT_FRONT_TO_BACK | RADIX_SORT_BACK_TO_FRONT");
 
 void RenderBin::setDefaultRenderBinSortMode(RenderBin::SortMode mode)
 {
@@ -136,6 +138,8 @@ RenderBin::SortMode RenderBin::getDefaultRenderBinSortMode()
             else if (strcmp(str,"SORT_FRONT_TO_BACK")==0) s_defaultBinSortMode = RenderBin::SORT_FRONT_TO_BACK;
             else if (strcmp(str,"SORT_BACK_TO_FRONT")==0) s_defaultBinSortMode = RenderBin::SORT_BACK_TO_FRONT;
             else if (strcmp(str,"TRAVERSAL_ORDER")==0) s_defaultBinSortMode = RenderBin::TRAVERSAL_ORDER;
+            else if (strcmp(str,"RADIX_SORT_FRONT_TO_BACK")==0) s_defaultBinSortMode = RenderBin::RADIX_SORT_FRONT_TO_BACK;
+            else if (strcmp(str,"RADIX_SORT_BACK_TO_FRONT")==0) s_defaultBinSortMode = RenderBin::RADIX_SORT_BACK_TO_FRONT;
         }
     }
 
@@ -160,7 +164,7 @@ RenderBin::RenderBin(SortMode mode)
     _sortMode = mode;
 
 #if 1
-    if (_sortMode==SORT_BACK_TO_FRONT)
+    if (_sortMode==SORT_BACK_TO_FRONT || _sortMode==RADIX_SORT_BACK_TO_FRONT)
     {
         _stateset  = new osg::StateSet;
         _stateset->setThreadSafeRefUnref(true);
@@ -250,6 +254,12 @@ void RenderBin::sortImplementation()
         case(TRAVERSAL_ORDER):
             sortTraversalOrder();
             break;
+        case(RADIX_SORT_FRONT_TO_BACK):
+            radixSortFrontToBack();
+            break;
+        case(RADIX_SORT_BACK_TO_FRONT):
+            radixSortBackToFront();
+            break;
     }
 }
 
@@ -346,6 +356,105 @@ void RenderBin::sortTraversalOrder()
     std::sort(_renderLeafList.begin(),_renderLeafList.end(),TraversalOrderFunctor());
 }
 
+void RenderBin::radixSortFrontToBack()
+{
+    radixSortByDepth(false);
+}
+
+void RenderBin::radixSortBackToFront()
+{
+    radixSortByDepth(true);
+}
+
+// map a float onto an unsigned int with the same ordering, flipping all the bits of negative values and just the sign bit of positive ones.
+static inline unsigned int orderedFloatBits(float value)
+{
+    if (value==0.0f) value = 0.0f; // treat -0.0 as 0.0, as the comparison based sorts do
+
+    union { float f; unsigned int i; } bits;
+    bits.f = value;
+    return (bits.i & 0x80000000u) ? ~bits.i : (bits.i | 0x80000000u);
+}
+
+void RenderBin::radixSortByDepth(bool backToFront)
+{
+    copyLeavesFromStateGraphListToRenderLeafList();
+
+    unsigned int numLeaves = _renderLeafList.size();
+    if (numLeaves<2) return;
+
+    // the bins of a RenderStage are recreated every frame so share the RenderStage's buffers, sorting runs single threaded per stage.
+    RenderBin* buffers = _stage ? static_cast<RenderBin*>(_stage) : this;
+    SortKeyList& keys = buffers->_sortKeys;
+    SortKeyList& swap = buffers->_sortKeysSwap;
+    RenderLeafList& leaves = buffers->_sortLeaves;
+
+    keys.resize(numLeaves);
+    swap.resize(numLeaves);
+    leaves.assign(_renderLeafList.begin(), _renderLeafList.end());
+
+    // the leaves are grouped by StateGraph, so the leaf index in the low bits breaks depth ties by StateGraph and
+    // then by leaf order. The keys are unique so any sort of them gives the same order.
+    unsigned int depthMask = backToFront ? 0xffffffffu : 0u;
+    for(unsigned int i=0; i<numLeaves; ++i)
+    {
+        keys[i] = (static_cast<unsigned long long>(orderedFloatBits(leaves[i]->_depth) ^ depthMask) << 32) | i;
+    }
+
+    const unsigned long long* sorted = &keys.front();
+    if (numLeaves<1024)
+    {
+        // the histograms cost more than a comparison sort of small bins.
+        std::sort(keys.begin(), keys.end());
+    }
+    else
+    {
+        // a histogram for each of the 8 byte wide digits, all gathered in one pass.
+        unsigned int counts[8][256];
+        memset(counts, 0, sizeof(counts));
+        for(unsigned int i=0; i<numLeaves; ++i)
+        {
+            unsigned long long key = keys[i];
+            for(unsigned int digit=0; digit<8; ++digit)
+            {
+                ++counts[digit][(key >> (digit*8)) & 0xff];
+            }
+        }
+
+        // least significant digit first, skipping the digits all the keys share such as the high bytes of the leaf index.
+        unsigned long long* source = &keys.front();
+        unsigned long long* destination = &swap.front();
+        for(unsigned int digit=0; digit<8; ++digit)
+        {
+            unsigned int* count = counts[digit];
+            unsigned int shift = digit*8;
+            if (count[(source[0] >> shift) & 0xff]==numLeaves) continue;
+
+            unsigned int offset = 0;
+            for(unsigned int b=0; b<256; ++b)
+            {
+                unsigned int c = count[b];
+                count[b] = offset;
+                offset += c;
+            }
+
+            for(unsigned int i=0; i<numLeaves; ++i)
+            {
+                unsigned long long key = source[i];
+                destination[count[(key >> shift) & 0xff]++] = key;
+            }
+
+            std::swap(source, destination);
+        }
+        sorted = source;
+    }
+
+    for(unsigned int i=0; i<numLeaves; ++i)
+    {
+        _renderLeafList[i] = leaves[static_cast<unsigned int>(sorted[i] & 0xffffffffu)];
+    }
+}
+
 void RenderBin::copyLeavesFromStateGraphListToRenderLeafList()
 {
     _renderLeafList.clear();
@@ -419,6 +528,44 @@ RenderBin* RenderBin::find_or_insert(int binNum,const std::string& binName)
     return rb;
 }
 
+void RenderBin::mergeRenderBin(RenderBin& rhs)
+{
+    _stateGraphList.insert(_stateGraphList.end(), rhs._stateGraphList.begin(), rhs._stateGraphList.end());
+    rhs._stateGraphList.clear();
+
+    for(RenderBinList::iterator itr = rhs._bins.begin();
+        itr != rhs._bins.end();
+        ++itr)
+    {
+        RenderBinList::iterator found = _bins.find(itr->first);
+        if (found!=_bins.end())
+        {
+            found->second->mergeRenderBin(*(itr->second));
+        }
+        else
+        {
+            itr->second->setParentAndStage(this, _stage);
+            _bins[itr->first] = itr->second;
+        }
+    }
+    rhs._bins.clear();
+
+    _sorted = false;
+}
+
+void RenderBin::setParentAndStage(RenderBin* parent, RenderStage* stage)
+{
+    _parent = parent;
+    _stage = stage;
+
+    for(RenderBinList::iterator itr = _bins.begin();
+        itr != _bins.end();
+        ++itr)
+    {
+        itr->second->setParentAndStage(this, stage);
+    }
+}
+
 void RenderBin::draw(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
     renderInfo.pushRenderBin(this);
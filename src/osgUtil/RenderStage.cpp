@@ -210,6 +210,62 @@ void RenderStage::addPostRenderStage(RenderStage* rs, int order)
     }
 }
 
+void RenderStage::mergeRenderStage(RenderStage& rhs)
+{
+    RenderBin::mergeRenderBin(rhs);
+
+    // stages of Cameras below rhs that inherit its positional state now inherit this stage's.
+    PositionalStateContainer* rhsPositionalStateContainer = rhs._renderStageLighting.get();
+
+    for(RenderStageList::iterator itr = rhs._preRenderList.begin();
+        itr != rhs._preRenderList.end();
+        ++itr)
+    {
+        if (rhsPositionalStateContainer && itr->second->getInheritedPositionalStateContainer()==rhsPositionalStateContainer)
+        {
+            itr->second->setInheritedPositionalStateContainer(getPositionalStateContainer());
+        }
+        addPreRenderStage(itr->second.get(), itr->first);
+    }
+    rhs._preRenderList.clear();
+
+    for(RenderStageList::iterator itr = rhs._postRenderList.begin();
+        itr != rhs._postRenderList.end();
+        ++itr)
+    {
+        if (rhsPositionalStateContainer && itr->second->getInheritedPositionalStateContainer()==rhsPositionalStateContainer)
+        {
+            itr->second->setInheritedPositionalStateContainer(getPositionalStateContainer());
+        }
+        addPostRenderStage(itr->second.get(), itr->first);
+    }
+    rhs._postRenderList.clear();
+
+    if (rhsPositionalStateContainer)
+    {
+        PositionalStateContainer::AttrMatrixList& rhsAttrList = rhsPositionalStateContainer->getAttrMatrixList();
+        PositionalStateContainer::TexUnitAttrMatrixListMap& rhsTexAttrListMap = rhsPositionalStateContainer->getTexUnitAttrMatrixListMap();
+
+        if (!rhsAttrList.empty() || !rhsTexAttrListMap.empty())
+        {
+            PositionalStateContainer* positionalStateContainer = getPositionalStateContainer();
+
+            PositionalStateContainer::AttrMatrixList& attrList = positionalStateContainer->getAttrMatrixList();
+            attrList.insert(attrList.end(), rhsAttrList.begin(), rhsAttrList.end());
+
+            for(PositionalStateContainer::TexUnitAttrMatrixListMap::iterator itr = rhsTexAttrListMap.begin();
+                itr != rhsTexAttrListMap.end();
+                ++itr)
+            {
+                PositionalStateContainer::AttrMatrixList& texAttrList = positionalStateContainer->getTexUnitAttrMatrixListMap()[itr->first];
+                texAttrList.insert(texAttrList.end(), itr->second.begin(), itr->second.end());
+            }
+
+            rhsPositionalStateContainer->reset();
+        }
+    }
+}
+
 void RenderStage::drawPreRenderStages(osg::RenderInfo& renderInfo,RenderLeaf*& previous)
 {
     if (_preRenderList.empty()) return;
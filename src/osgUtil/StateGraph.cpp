@@ -26,6 +26,7 @@ void StateGraph::reset()
 
     _children.clear();
     _leaves.clear();
+    _stateGraphPool.clear();
 }
 
 /** recursively clean the StateGraph of all its drawables, lights and depths.
@@ -36,6 +37,8 @@ void StateGraph::clean()
     // clean local drawables etc.
     _leaves.clear();
 
+    _numAllocatedStateGraphs = 0;
+
     // call clean on all children.
     for(ChildList::iterator itr=_children.begin();
         itr!=_children.end();
@@ -48,18 +51,43 @@ void StateGraph::clean()
 
 /** recursively prune the StateGraph of empty children.*/
 void StateGraph::prune()
+{
+    StateGraph* root = this;
+    while(root->_parent) root = root->_parent;
+
+    prune(root->_stateGraphPool);
+}
+
+void StateGraph::prune(StateGraphPool& pool)
 {
     // call prune on all children.
     ChildList::iterator citr=_children.begin();
     while(citr!=_children.end())
     {
-        citr->second->prune();
+        citr->second->prune(pool);
 
         if (citr->second->empty())
         {
-            ChildList::iterator ditr= citr++;
-            _children.erase(ditr);
+            // keep the child for reuse unless something else still references it.
+            if (citr->second->referenceCount()==1) pool.push_back(citr->second);
+
+            // erase moves the last child into this position so it's checked next.
+            citr = _children.erase(citr);
         }
         else ++citr;
     }
 }
+
+/** set up a pruned StateGraph as a new child of parent, keeping the storage of its leaf list.*/
+void StateGraph::reuse(StateGraph* parent, const osg::StateSet* stateset)
+{
+    _parent = parent;
+    _stateset = stateset;
+    _depth = _parent ? _parent->_depth + 1 : 0;
+    _averageDistance = 0;
+    _minimumDistance = 0;
+    _userData = NULL;
+
+    if (_parent && _parent->_dynamic) _dynamic = true;
+    else _dynamic = stateset->getDataVariance()==osg::Object::DYNAMIC;
+}
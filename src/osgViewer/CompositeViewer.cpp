@@ -1475,6 +1475,11 @@ void CompositeViewer::updateTraversal()
         }
         view->updateSlaves();
 
+        osgDB::DatabasePager* dp = view->getScene() ? view->getScene()->getDatabasePager() : 0;
+        if (dp && dp->getPrefetchTime()>0.0)
+        {
+            dp->prefetch(view->getSceneData(), view->getCamera(), _frameStamp.get());
+        }
     }
 
     if (getViewerStats() && getViewerStats()->collectStats("update"))
@@ -1485,6 +1490,17 @@ void CompositeViewer::updateTraversal()
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal begin time", beginUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal end time", endUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal time taken", endUpdateTraversal-beginUpdateTraversal);
+
+        for(Scenes::iterator sitr = scenes.begin();
+            sitr != scenes.end();
+            ++sitr)
+        {
+            osgDB::DatabasePager* dp = (*sitr)->getDatabasePager();
+            if (dp) dp->reportStats(_frameStamp->getFrameNumber(), *getViewerStats());
+        }
+
+        osgDB::ObjectCache* objectCache = osgDB::Registry::instance()->getObjectCache();
+        if (objectCache) objectCache->reportStats(_frameStamp->getFrameNumber(), *getViewerStats());
     }
 
 }
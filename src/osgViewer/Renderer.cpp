@@ -655,6 +655,34 @@ static void collectSceneViewStats(unsigned int frameNumber, osgUtil::SceneView*
     stats->setAttribute(frameNumber, "Visible number of GL_POLYGON", static_cast<double>(pcm[GL_POLYGON]));
 }
 
+static void collectCullVisitorStats(unsigned int frameNumber, osgUtil::SceneView* sceneView, osg::Stats* stats, double cullTime)
+{
+    osgUtil::CullVisitor* cullVisitors[3] = { sceneView->getCullVisitor(), sceneView->getCullVisitorLeft(), sceneView->getCullVisitorRight() };
+
+    double parallelCullTime = 0.0;
+    double parallelCullTaskTime = 0.0;
+    unsigned int numAllocations = 0;
+    for(unsigned int i=0; i<3; ++i)
+    {
+        if (cullVisitors[i])
+        {
+            parallelCullTime += cullVisitors[i]->getParallelCullTime();
+            parallelCullTaskTime += cullVisitors[i]->getParallelCullTaskTime();
+            numAllocations += cullVisitors[i]->getNumAllocations();
+        }
+    }
+
+    // RenderLeafs and StateGraphs allocated rather than reused, zero once a scene has been in view for a frame.
+    // RenderBins are still recreated every frame and aren't included.
+    stats->setAttribute(frameNumber, "Cull RenderLeaf/StateGraph allocations", static_cast<double>(numAllocations));
+
+    // the speedup over a serial cull, estimated from the time the parallel culls' tasks would have taken one after another.
+    if (parallelCullTaskTime>0.0 && cullTime>0.0)
+    {
+        stats->setAttribute(frameNumber, "Cull traversal speedup", (cullTime-parallelCullTime+parallelCullTaskTime)/cullTime);
+    }
+}
+
 void Renderer::cull()
 {
     DEBUG_MESSAGE<<"cull()"<<std::endl;
@@ -699,6 +727,8 @@ void Renderer::cull()
             stats->setAttribute(frameNumber, "Cull traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeCullTick));
             stats->setAttribute(frameNumber, "Cull traversal end time", osg::Timer::instance()->delta_s(_startTick, afterCullTick));
             stats->setAttribute(frameNumber, "Cull traversal time taken", osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
+
+            collectCullVisitorStats(frameNumber, sceneView, stats, osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
         }
 
         if (stats && stats->collectStats("scene"))
@@ -923,6 +953,8 @@ void Renderer::cull_draw()
         stats->setAttribute(frameNumber, "Cull traversal end time", osg::Timer::instance()->delta_s(_startTick, afterCullTick));
         stats->setAttribute(frameNumber, "Cull traversal time taken", osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
 
+        collectCullVisitorStats(frameNumber, sceneView, stats, osg::Timer::instance()->delta_s(beforeCullTick, afterCullTick));
+
         stats->setAttribute(frameNumber, "Draw traversal begin time", osg::Timer::instance()->delta_s(_startTick, beforeDrawTick));
         stats->setAttribute(frameNumber, "Draw traversal end time", osg::Timer::instance()->delta_s(_startTick, afterDrawTick));
         stats->setAttribute(frameNumber, "Draw traversal time taken", osg::Timer::instance()->delta_s(beforeDrawTick, afterDrawTick));
@@ -607,6 +607,11 @@ struct CameraSceneStatsTextDrawCallback : public virtual osg::Drawable::DrawCall
                 STATS_ATTRIBUTE("Visible number of fast drawables")
                 STATS_ATTRIBUTE("Visible vertex count")
 
+                // the speedup is a ratio close to 1, so is shown with decimals, it is only set when the cull runs in parallel.
+                viewStr.precision(2);
+                STATS_ATTRIBUTE("Cull traversal speedup")
+                viewStr.precision(0);
+
                 STATS_ATTRIBUTE("Visible number of PrimitiveSets")
                 STATS_ATTRIBUTE("Visible number of GL_POINTS")
                 STATS_ATTRIBUTE("Visible number of GL_LINES")
@@ -1057,6 +1062,8 @@ struct PagerCallback : public virtual osg::NodeCallback
                     osgText::Text* averageValue,
                     osgText::Text* filerequestlist,
                     osgText::Text* compilelist,
+                    osgText::Text* mergetime,
+                    osgText::Text* mergebacklog,
                     double multiplier):
         _dp(dp),
         _minValue(minValue),
@@ -1064,6 +1071,8 @@ struct PagerCallback : public virtual osg::NodeCallback
         _averageValue(averageValue),
         _filerequestlist(filerequestlist),
         _compilelist(compilelist),
+        _mergetime(mergetime),
+        _mergebacklog(mergebacklog),
         _multiplier(multiplier)
     {
     }
@@ -1112,6 +1121,12 @@ struct PagerCallback : public virtual osg::NodeCallback
 
             sprintf(tmpText,"%4d", _dp->getDataToCompileListSize());
             _compilelist->setText(tmpText);
+
+            sprintf(tmpText,"%4.1f", _dp->getMergeTimeLastFrame() * _multiplier);
+            _mergetime->setText(tmpText);
+
+            sprintf(tmpText,"%4d", _dp->getMergeBacklog());
+            _mergebacklog->setText(tmpText);
         }
 
         traverse(node,nv);
@@ -1124,6 +1139,8 @@ struct PagerCallback : public virtual osg::NodeCallback
     osg::ref_ptr<osgText::Text> _averageValue;
     osg::ref_ptr<osgText::Text> _filerequestlist;
     osg::ref_ptr<osgText::Text> _compilelist;
+    osg::ref_ptr<osgText::Text> _mergetime;
+    osg::ref_ptr<osgText::Text> _mergebacklog;
     double                      _multiplier;
 };
 
@@ -1576,9 +1593,57 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
                 compileList->setDataVariance(osg::Object::DYNAMIC);
 
 
+                pos.x() = compileList->getBoundingBox().xMax() + 2.0f*_characterSize;
+
+                osg::ref_ptr<osgText::Text> mergeTimeLabel = new osgText::Text;
+                _statsGeode->addDrawable( mergeTimeLabel.get() );
+
+                mergeTimeLabel->setColor(colorDP);
+                mergeTimeLabel->setFont(_font);
+                mergeTimeLabel->setCharacterSize(_characterSize);
+                mergeTimeLabel->setPosition(pos);
+                mergeTimeLabel->setText("merge: ");
+
+                pos.x() = mergeTimeLabel->getBoundingBox().xMax();
+
+                osg::ref_ptr<osgText::Text> mergeTime = new osgText::Text;
+                _statsGeode->addDrawable( mergeTime.get() );
+
+                mergeTime->setColor(colorDP);
+                mergeTime->setFont(_font);
+                mergeTime->setCharacterSize(_characterSize);
+                mergeTime->setPosition(pos);
+                mergeTime->setText("0.0");
+                mergeTime->setDataVariance(osg::Object::DYNAMIC);
+
+
+                pos.x() = mergeTime->getBoundingBox().xMax() + 2.0f*_characterSize;
+
+                osg::ref_ptr<osgText::Text> mergeBacklogLabel = new osgText::Text;
+                _statsGeode->addDrawable( mergeBacklogLabel.get() );
+
+                mergeBacklogLabel->setColor(colorDP);
+                mergeBacklogLabel->setFont(_font);
+                mergeBacklogLabel->setCharacterSize(_characterSize);
+                mergeBacklogLabel->setPosition(pos);
+                mergeBacklogLabel->setText("backlog: ");
+
+                pos.x() = mergeBacklogLabel->getBoundingBox().xMax();
+
+                osg::ref_ptr<osgText::Text> mergeBacklog = new osgText::Text;
+                _statsGeode->addDrawable( mergeBacklog.get() );
+
+                mergeBacklog->setColor(colorDP);
+                mergeBacklog->setFont(_font);
+                mergeBacklog->setCharacterSize(_characterSize);
+                mergeBacklog->setPosition(pos);
+                mergeBacklog->setText("0");
+                mergeBacklog->setDataVariance(osg::Object::DYNAMIC);
+
+
                 pos.x() = maxLabel->getBoundingBox().xMax();
 
-                _statsGeode->setCullCallback(new PagerCallback(dp, minValue.get(), maxValue.get(), averageValue.get(), requestList.get(), compileList.get(), 1000.0));
+                _statsGeode->setCullCallback(new PagerCallback(dp, minValue.get(), maxValue.get(), averageValue.get(), requestList.get(), compileList.get(), mergeTime.get(), mergeBacklog.get(), 1000.0));
             }
 
             pos.x() = _leftPos;
@@ -1598,7 +1663,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         group->addChild(geode);
         geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
                                                         10 * _characterSize + 2 * backgroundMargin,
-                                                        22 * _characterSize + 2 * backgroundMargin,
+                                                        23 * _characterSize + 2 * backgroundMargin,
                                                         backgroundColor));
 
         // Camera scene & primitive stats static text
@@ -1624,6 +1689,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         viewStr << "Sorted Drawables" << std::endl;
         viewStr << "Fast Drawables" << std::endl;
         viewStr << "Vertices" << std::endl;
+        viewStr << "Cull speedup" << std::endl;
         viewStr << "PrimitiveSets" << std::endl;
         viewStr << "Points" << std::endl;
         viewStr << "Lines" << std::endl;
@@ -1647,7 +1713,7 @@ void StatsHandler::setUpScene(osgViewer::ViewerBase* viewer)
         {
             geode->addDrawable(createBackgroundRectangle(pos + osg::Vec3(-backgroundMargin, _characterSize + backgroundMargin, 0),
                                                             5 * _characterSize + 2 * backgroundMargin,
-                                                            22 * _characterSize + 2 * backgroundMargin,
+                                                            23 * _characterSize + 2 * backgroundMargin,
                                                             backgroundColor));
 
             // Camera scene stats
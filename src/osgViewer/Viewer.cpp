@@ -1215,6 +1215,12 @@ void Viewer::updateTraversal()
 
     updateSlaves();
 
+    osgDB::DatabasePager* dp = _scene->getDatabasePager();
+    if (dp && dp->getPrefetchTime()>0.0)
+    {
+        dp->prefetch(_scene->getSceneData(), _camera.get(), _frameStamp.get());
+    }
+
     if (getViewerStats() && getViewerStats()->collectStats("update"))
     {
         double endUpdateTraversal = osg::Timer::instance()->delta_s(_startTick, osg::Timer::instance()->tick());
@@ -1223,6 +1229,11 @@ void Viewer::updateTraversal()
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal begin time", beginUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal end time", endUpdateTraversal);
         getViewerStats()->setAttribute(_frameStamp->getFrameNumber(), "Update traversal time taken", endUpdateTraversal-beginUpdateTraversal);
+
+        if (dp) dp->reportStats(_frameStamp->getFrameNumber(), *getViewerStats());
+
+        osgDB::ObjectCache* objectCache = osgDB::Registry::instance()->getObjectCache();
+        if (objectCache) objectCache->reportStats(_frameStamp->getFrameNumber(), *getViewerStats());
     }
 }
 